@@ -0,0 +1,148 @@
+/**
+ * File Name: bench_arrays.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Compares element-wise array arithmetic and dot() against the same work
+ * written as scalar `for` loops over a[i], first as jff programs, then the
+ * bare kernels (scalar, SSE2, AVX2 as far as the CPU supports them) on the
+ * same data. All variants must produce the same result.
+ *
+ * Usage: bench_arrays [--length=N] [--repeat=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench_util.h"
+#include "../src/include/compiler.h"
+#include "../src/include/array.h"
+#include "../src/include/vm.h"
+
+static const char *program_prologue =
+    "result : float = 0;\n"
+    "\n"
+    "func main() : void {\n"
+    "    n : int = %ld;\n"
+    "    a : float[] = float_array(n);\n"
+    "    b : float[] = float_array(n);\n"
+    "    for (i : int = 0; i < n; i += 1) {\n"
+    "        a[i] = i %% 1000;\n"
+    "        b[i] = (i * 7) %% 1000;\n"
+    "    }\n"
+    "    total : float = 0;\n"
+    "    for (r : int = 0; r < %ld; r += 1) {\n";
+
+static const char *scalar_body =
+    "        c : float[] = float_array(n);\n"
+    "        for (i : int = 0; i < n; i += 1) {\n"
+    "            c[i] = a[i] + b[i];\n"
+    "        }\n"
+    "        for (i : int = 0; i < n; i += 1) {\n"
+    "            total += c[i] * b[i];\n"
+    "        }\n";
+
+static const char *array_body =
+    "        c : float[] = a + b;\n"
+    "        total += dot(c, b);\n";
+
+static const char *program_epilogue =
+    "    }\n"
+    "    result = total;\n"
+    "}\n";
+
+/**
+ * @brief Runs the program with the given loop body and returns its wall time.
+ */
+static double run_program(const char *body, long length, long repeat, value_t *result) {
+    char source[2048];
+    int used = snprintf(source, sizeof(source), program_prologue, length, repeat);
+    snprintf(source + used, sizeof(source) - (size_t)used, "%s%s", body, program_epilogue);
+    image_t *image = compile_source(source);
+    vm_t *vm = init_vm(image);
+    double start = now_seconds();
+    if (vm_run(vm) != VM_OK) exit(EXIT_FAILURE);
+    double elapsed = now_seconds() - start;
+    *result = vm->globals[0];
+    free_vm(vm);
+    free_image(image);
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    long length = 1000000;
+    long repeat = 5;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--length=", 9) == 0) {
+            length = atol(argv[i] + 9);
+        } else if (strncmp(argv[i], "--repeat=", 9) == 0) {
+            repeat = atol(argv[i] + 9);
+        } else {
+            fprintf(stderr, "Usage: %s [--length=N] [--repeat=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (length <= 0) length = 1;
+    if (repeat <= 0) repeat = 1;
+
+    printf("c = a + b; total += dot(c, b) on float[%ld], %ld times\n", length, repeat);
+    value_t fill_result, scalar_result, array_result;
+    double fill_time = run_program("", length, repeat, &fill_result);
+    double scalar_time = run_program(scalar_body, length, repeat, &scalar_result) - fill_time;
+    double array_time = run_program(array_body, length, repeat, &array_result) - fill_time;
+    if (!values_equal(scalar_result, array_result)) {
+        fprintf(stderr, "Result mismatch between the scalar loop and the array builtins\n");
+        return EXIT_FAILURE;
+    }
+    printf("  %-22s %10.2f ms (filling a and b, not counted below)\n", "jff setup", fill_time * 1e3);
+    printf("  %-22s %10.2f ms\n", "jff scalar for loops", scalar_time * 1e3);
+    printf("  %-22s %10.2f ms %8.1fx\n", "jff array builtins", array_time * 1e3, scalar_time / array_time);
+
+    array_t *a = init_array(VALUE_FLOAT, (size_t)length);
+    array_t *b = init_array(VALUE_FLOAT, (size_t)length);
+    array_t *c = init_array(VALUE_FLOAT, (size_t)length);
+    for (long i = 0; i < length; ++i) {
+        a->as.floats[i] = (double)(i % 1000) / 7.0;
+        b->as.floats[i] = (double)((i * 7) % 1000) / 3.0;
+    }
+
+    printf("kernels, %ld elements, 10 passes\n", length);
+    printf("  %-8s %12s %12s\n", "kernel", "add ms", "dot ms");
+    array_kernel_t best = array_kernel();
+    value_t expected = NULL_VALUE;
+    gc_heap_t heap;     // float sums never box, but array_dot() takes a heap
+    init_gc_heap(&heap);
+    for (int kernel = ARRAY_KERNEL_SCALAR; kernel <= (int)best; ++kernel) {
+        array_set_kernel((array_kernel_t)kernel);
+        double start = now_seconds();
+        for (int pass = 0; pass < 10; ++pass) {
+            array_elementwise(ARRAY_ADD, a->as.data, 1, b->as.data, 1, c);
+        }
+        double add_time = now_seconds() - start;
+        value_t dot = NULL_VALUE;
+        start = now_seconds();
+        for (int pass = 0; pass < 10; ++pass) {
+            dot = array_dot(&heap, c, b);
+        }
+        double dot_time = now_seconds() - start;
+
+        // Every kernel sums in the same lanes, so even float results match exactly.
+        if (kernel == ARRAY_KERNEL_SCALAR) {
+            expected = dot;
+        } else if (AS_FLOAT(dot) != AS_FLOAT(expected)) {
+            fprintf(stderr, "Kernel %s disagrees with the scalar kernel\n", array_kernel_to_string((array_kernel_t)kernel));
+            return EXIT_FAILURE;
+        }
+        printf("  %-8s %12.2f %12.2f\n", array_kernel_to_string((array_kernel_t)kernel), add_time * 1e3, dot_time * 1e3);
+    }
+    array_set_kernel(best);
+    free_gc_heap(&heap);
+
+    free_array(a);
+    free_array(b);
+    free_array(c);
+    return EXIT_SUCCESS;
+}
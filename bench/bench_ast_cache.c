@@ -0,0 +1,88 @@
+/**
+ * File Name: bench_ast_cache.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Compares a cold lex + parse of a file with loading the same tree from the
+ * binary AST cache. tests/test_ast_cache.c checks that the cached tree is
+ * the parsed one.
+ *
+ * Usage: bench_ast_cache [file.jff] [iterations]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_util.h"
+#include "../src/include/lexer.h"
+#include "../src/include/parser.h"
+#include "../src/include/ast_serialize.h"
+
+static parser_t *parse_file(const char *filename) {
+    lexer_t *lexer = init_lexer(filename);
+    if (!lexer) exit(EXIT_FAILURE);
+    token_t *token;
+    while ((token = lexer_next_token(lexer))->type != TOKEN_EOF) {
+        lexer_append_token(lexer, token);
+    }
+    lexer_append_token(lexer, token);
+    parser_t *parser = init_parser(lexer);
+    parser_parse_program(parser);
+    return parser;
+}
+
+static void free_parsed(parser_t *parser) {
+    free_lexer(parser->lexer);
+    free_parser(parser);
+}
+
+int main(int argc, char **argv) {
+    const char *filename = argc > 1 ? argv[1] : "examples/e2.jff";
+    int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+    if (iterations <= 0) iterations = 1;
+
+    char cache_dir[] = "/tmp/jff-bench-cache-XXXXXX";
+    if (!mkdtemp(cache_dir)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    parser_t *parser = parse_file(filename);
+    if (!ast_cache_store(cache_dir, filename, parser->ast)) {
+        fprintf(stderr, "Could not write cache entry\n");
+        return EXIT_FAILURE;
+    }
+    ast_t *cached = ast_cache_load(cache_dir, filename);
+    if (!cached) {
+        fprintf(stderr, "Could not load cache entry\n");
+        return EXIT_FAILURE;
+    }
+
+    free_ast(cached);
+    free_parsed(parser);
+
+    double start = now_seconds();
+    for (int i = 0; i < iterations; i++) {
+        free_parsed(parse_file(filename));
+    }
+    double parse_time = now_seconds() - start;
+
+    start = now_seconds();
+    for (int i = 0; i < iterations; i++) {
+        free_ast(ast_cache_load(cache_dir, filename));
+    }
+    double load_time = now_seconds() - start;
+
+    printf("%s, %d iterations\n", filename, iterations);
+    printf("  cold lex + parse : %10.3f us/iter\n", parse_time * 1e6 / iterations);
+    printf("  cache load       : %10.3f us/iter\n", load_time * 1e6 / iterations);
+    printf("  speedup          : %10.2fx\n", parse_time / load_time);
+
+    char command[sizeof(cache_dir) + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", cache_dir);
+    if (system(command) != 0) {
+        fprintf(stderr, "Could not remove %s\n", cache_dir);
+    }
+    return 0;
+}
@@ -0,0 +1,285 @@
+/**
+ * File Name: bench_dispatch.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Runs jff programs compiled without and with superinstructions and reports
+ * how many instructions the VM dispatched each way, and the run times. Both
+ * ways must end the same; program output goes to /dev/null.
+ *
+ * Then compiles a corpus of synthetic programs from program_gen.h, which
+ * are grammatical but not meant to run, and reports the static count: the
+ * instructions in their code, and the dispatches left if each ran once.
+ *
+ * With --profile=FILE, the opcode profile of all the runs without
+ * superinstructions is written to FILE, for gen_superinstructions.
+ *
+ * Usage: bench_dispatch [--corpus=N] [--size=N[K|M|G]] [--profile=FILE] [FILE.jff...]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../src/include/lexer.h"
+#include "../src/include/parser.h"
+#include "../src/include/compiler.h"
+#include "../src/include/output.h"
+#include "../src/include/vm.h"
+#include "bench_util.h"
+#include "program_gen.h"
+
+typedef struct {
+    uint64_t plain;
+    uint64_t fused;
+    double plain_time;
+    double fused_time;
+} totals_t;
+
+/**
+ * @brief Compiles the file, or returns NULL with the errors on stderr.
+ */
+static image_t *compile_file(const char *path) {
+    lexer_t *lexer = init_lexer(path);
+    if (!lexer) return NULL;
+    token_t *token;
+    while ((token = lexer_next_token(lexer))->type != TOKEN_EOF) {
+        lexer_append_token(lexer, token);
+    }
+    lexer_append_token(lexer, token);
+    parser_t *parser = init_parser(lexer);
+    parser_parse_program(parser);
+    image_t *image = compile_program(parser->ast);
+    free_lexer(lexer);
+    free_parser(parser);
+    return image;
+}
+
+typedef struct {
+    int out;
+    int err;
+} saved_fds_t;
+
+/**
+ * @brief Sends stdout and stderr to /dev/null until quiet_end().
+ */
+static saved_fds_t quiet_begin(void) {
+    fflush(stdout);
+    fflush(stderr);
+    saved_fds_t saved = { dup(STDOUT_FILENO), dup(STDERR_FILENO) };
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    dup2(null, STDERR_FILENO);
+    close(null);
+    return saved;
+}
+
+static void quiet_end(saved_fds_t saved) {
+    output_flush_all();
+    fflush(stderr);
+    dup2(saved.out, STDOUT_FILENO);
+    dup2(saved.err, STDERR_FILENO);
+    close(saved.out);
+    close(saved.err);
+}
+
+/**
+ * @brief Runs the image quietly, counting its dispatches into `profile` if
+ * there is one.
+ */
+static vm_status_t run_quietly(const image_t *image, opcode_profile_t *profile, double *elapsed) {
+    saved_fds_t saved = quiet_begin();
+    vm_t *vm = init_vm(image);
+    if (profile) {
+        vm->opcode_profile = profile;
+        opcode_profile_start(profile);
+    }
+    double start = now_seconds();
+    vm_status_t status = vm_run(vm);
+    *elapsed = now_seconds() - start;
+    if (profile) opcode_profile_stop(profile);
+    free_vm(vm);
+    quiet_end(saved);
+    return status;
+}
+
+/**
+ * @brief Counts the instructions in the image's code, and the dispatches
+ * they take when each runs once: one per superinstruction, not one per
+ * component.
+ */
+static void count_code(const image_t *image, uint64_t *instructions, uint64_t *dispatches) {
+    for (uint32_t f = 0; f < image->header->function_count; ++f) {
+        const image_function_t *function = &image->functions[f];
+        const uint8_t *code = image->code + function->code_offset;
+        uint32_t pc = 0;
+        while (pc < function->code_size) {
+            opcode_t op = (opcode_t)code[pc];
+            opcode_t components[OP_MAX_COMPONENTS];
+            size_t count = opcode_components(op, components);
+            (*dispatches)++;
+            if (count == 0) {
+                components[0] = op;
+                count = 1;
+            }
+            for (size_t k = 0; k < count; ++k) {
+                (*instructions)++;
+                pc += 1 + (uint32_t)opcode_operand_size(components[k]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Compiles and runs the program one way: once counting dispatches,
+ * once for the time.
+ */
+static bool measure(const char *path, opcode_profile_t *profile, uint64_t *dispatches, double *elapsed, vm_status_t *status) {
+    image_t *image = compile_file(path);
+    if (!image) return false;
+    uint64_t before = opcode_profile_dispatches(profile);
+    double counted_time;
+    *status = run_quietly(image, profile, &counted_time);
+    *dispatches = opcode_profile_dispatches(profile) - before;
+    run_quietly(image, NULL, elapsed);
+    free_image(image);
+    return true;
+}
+
+/**
+ * @brief Measures the program without and with superinstructions and prints
+ * a row. Programs that do not compile are skipped.
+ */
+static bool compare(const char *name, const char *path, opcode_profile_t *plain_profile, totals_t *totals) {
+    opcode_profile_t *fused_profile = init_opcode_profile();
+    uint64_t plain, fused;
+    double plain_time, fused_time;
+    vm_status_t plain_status, fused_status;
+    compiler_set_superinstructions(false);
+    bool compiled = measure(path, plain_profile, &plain, &plain_time, &plain_status);
+    compiler_set_superinstructions(true);
+    compiled = compiled && measure(path, fused_profile, &fused, &fused_time, &fused_status);
+    free_opcode_profile(fused_profile);
+    if (!compiled) {
+        printf("  %-16s (does not compile, skipped)\n", name);
+        return true;
+    }
+    if (plain_status != fused_status) {
+        fprintf(stderr, "%s ended differently with superinstructions\n", name);
+        return false;
+    }
+    printf("  %-16s %14llu %14llu %7.1f%% %10.2f %10.2f\n", name, (unsigned long long)plain, (unsigned long long)fused,
+        plain ? 100.0 * (double)(plain - fused) / (double)plain : 0.0, plain_time * 1e3, fused_time * 1e3);
+    totals->plain += plain;
+    totals->fused += fused;
+    totals->plain_time += plain_time;
+    totals->fused_time += fused_time;
+    return true;
+}
+
+static void print_header(const char *title) {
+    printf("%s\n", title);
+    printf("  %-16s %14s %14s %8s %10s %10s\n", "program", "plain", "fused", "saved", "plain ms", "fused ms");
+}
+
+static void print_totals(const totals_t *totals) {
+    printf("  %-16s %14llu %14llu %7.1f%% %10.2f %10.2f\n", "total", (unsigned long long)totals->plain,
+        (unsigned long long)totals->fused,
+        totals->plain ? 100.0 * (double)(totals->plain - totals->fused) / (double)totals->plain : 0.0,
+        totals->plain_time * 1e3, totals->fused_time * 1e3);
+}
+
+int main(int argc, char **argv) {
+    size_t corpus = 10;
+    size_t size = 16 * 1024;
+    const char *profile_path = NULL;
+    int first_file = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--corpus=", 9) == 0) {
+            corpus = (size_t)strtoul(argv[i] + 9, NULL, 10);
+        } else if (strncmp(argv[i], "--size=", 7) == 0) {
+            if (!parse_size(argv[i] + 7, &size)) {
+                fprintf(stderr, "Invalid size: %s\n", argv[i] + 7);
+                return EXIT_FAILURE;
+            }
+        } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            profile_path = argv[i] + 10;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Usage: %s [--corpus=N] [--size=N[K|M|G]] [--profile=FILE] [FILE.jff...]\n", argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            first_file = i;
+            break;
+        }
+    }
+
+    opcode_profile_t *profile = init_opcode_profile();
+    totals_t totals = {0};
+    if (first_file < argc) {
+        print_header("dispatches without and with superinstructions");
+        for (int i = first_file; i < argc; i++) {
+            const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+            if (!compare(name, argv[i], profile, &totals)) return EXIT_FAILURE;
+        }
+        print_totals(&totals);
+    }
+
+    if (corpus > 0) {
+        char size_text[32];
+        format_size(size, size_text, sizeof(size_text));
+        printf("synthetic corpus, %zu programs of %s, static counts\n", corpus, size_text);
+        printf("  %-16s %14s %14s %8s\n", "program", "instructions", "dispatches", "saved");
+        uint64_t total_instructions = 0, total_dispatches = 0;
+        for (size_t n = 0; n < corpus; ++n) {
+            program_shape_t shape = (program_shape_t)(n % PROGRAM_SHAPE_COUNT);
+            program_gen_config_t config;
+            program_gen_default_config(&config, shape, size);
+            config.seed = n + 1;
+            size_t length;
+            char *source = generate_program(&config, &length);
+
+            char path[] = "/tmp/jff-bench-dispatch-XXXXXX";
+            int fd = mkstemp(path);
+            if (fd < 0) {
+                perror("mkstemp");
+                return EXIT_FAILURE;
+            }
+            FILE *file = fdopen(fd, "w");
+            fwrite(source, 1, length, file);
+            fclose(file);
+            free(source);
+
+            // A generated program may not compile; its errors are of no interest here.
+            saved_fds_t saved = quiet_begin();
+            image_t *image = compile_file(path);
+            quiet_end(saved);
+            unlink(path);
+            char name[64];
+            snprintf(name, sizeof(name), "%s/%zu", program_shape_to_string(shape), n + 1);
+            if (!image) {
+                printf("  %-16s (does not compile, skipped)\n", name);
+                continue;
+            }
+            uint64_t instructions = 0, dispatches = 0;
+            count_code(image, &instructions, &dispatches);
+            free_image(image);
+            printf("  %-16s %14llu %14llu %7.1f%%\n", name, (unsigned long long)instructions,
+                (unsigned long long)dispatches, 100.0 * (double)(instructions - dispatches) / (double)instructions);
+            total_instructions += instructions;
+            total_dispatches += dispatches;
+        }
+        printf("  %-16s %14llu %14llu %7.1f%%\n", "total", (unsigned long long)total_instructions,
+            (unsigned long long)total_dispatches,
+            total_instructions ? 100.0 * (double)(total_instructions - total_dispatches) / (double)total_instructions : 0.0);
+    }
+
+    if (profile_path && !opcode_profile_write(profile, profile_path)) {
+        return EXIT_FAILURE;
+    }
+    free_opcode_profile(profile);
+    return EXIT_SUCCESS;
+}
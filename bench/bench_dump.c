@@ -0,0 +1,190 @@
+/**
+ * File Name: bench_dump.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Times writing a parsed tree out with print_ast() and with each
+ * --dump-ast format, all into /dev/null, on generated programs of every
+ * shape (see program_gen.h) or on the given files. Before timing, the text
+ * dump is checked to match print_ast() byte for byte, and the binary dump
+ * to read back into a tree that dumps the same.
+ *
+ * Usage: bench_dump [--size=N[K|M|G]] [--iterations=N] [FILE.jff...]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../src/include/lexer.h"
+#include "../src/include/parser.h"
+#include "../src/include/ast_dump.h"
+#include "../src/include/ast_serialize.h"
+#include "bench_util.h"
+#include "program_gen.h"
+
+static char *read_file(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char *source = malloc((size_t)size + 1);
+    if (!source) exit(EXIT_FAILURE);
+    *length = fread(source, 1, (size_t)size, file);
+    source[*length] = '\0';
+    fclose(file);
+    return source;
+}
+
+/**
+ * @brief Whether the text dump is exactly print_ast(), and the binary dump
+ * reads back into the same tree.
+ */
+static bool check_dumps(const char *name, ast_t *ast) {
+    size_t expected_length, text_length;
+    char *expected = capture_print_ast(ast, &expected_length);
+    char *text = ast_dump_to_string(ast, AST_DUMP_TEXT, &text_length);
+    bool ok = expected_length == text_length && memcmp(expected, text, text_length) == 0;
+    if (!ok) fprintf(stderr, "%s: the text dump differs from print_ast()\n", name);
+
+    char path[] = "/tmp/jff-bench-dump-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        exit(EXIT_FAILURE);
+    }
+    bool written = ast_dump(ast, AST_DUMP_BIN, fd);
+    close(fd);
+    ast_t *loaded = written ? ast_deserialize(path, 0) : NULL;
+    unlink(path);
+    if (!loaded) {
+        fprintf(stderr, "%s: the binary dump does not read back\n", name);
+        ok = false;
+    } else {
+        size_t loaded_length;
+        char *reloaded = ast_dump_to_string(loaded, AST_DUMP_TEXT, &loaded_length);
+        if (loaded_length != text_length || memcmp(reloaded, text, text_length) != 0) {
+            fprintf(stderr, "%s: the binary dump reads back into another tree\n", name);
+            ok = false;
+        }
+        free(reloaded);
+        free_ast(loaded);
+    }
+    free(expected);
+    free(text);
+    return ok;
+}
+
+/**
+ * @brief Seconds per dump, with print_ast() for `format` < 0. Returns the
+ * bytes written in `bytes`.
+ */
+static double time_dump(ast_t *ast, int format, int iterations, size_t *bytes) {
+    int null = open("/dev/null", O_WRONLY);
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+
+    double start = now_seconds();
+    for (int i = 0; i < iterations; ++i) {
+        if (format < 0) {
+            print_ast(ast);
+            fflush(stdout);
+        } else if (!ast_dump(ast, (ast_dump_format_t)format, STDOUT_FILENO)) {
+            exit(EXIT_FAILURE);
+        }
+    }
+    double elapsed = (now_seconds() - start) / iterations;
+
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    if (format < 0) {
+        free(capture_print_ast(ast, bytes));
+    } else if (format == AST_DUMP_BIN) {
+        FILE *capture = tmpfile();
+        if (!capture || !ast_dump(ast, AST_DUMP_BIN, fileno(capture))) exit(EXIT_FAILURE);
+        *bytes = (size_t)lseek(fileno(capture), 0, SEEK_END);
+        fclose(capture);
+    } else {
+        free(ast_dump_to_string(ast, (ast_dump_format_t)format, bytes));
+    }
+    return elapsed;
+}
+
+static bool bench(const char *name, const char *source, size_t length, int iterations) {
+    parser_t *parser = parse_source(name, source, length);
+    if (!check_dumps(name, parser->ast)) return false;
+
+    static const char *labels[] = { "print_ast", "text", "json", "bin" };
+    double baseline = 0;
+    for (int format = -1; format <= AST_DUMP_BIN; ++format) {
+        size_t bytes;
+        double seconds = time_dump(parser->ast, format, iterations, &bytes);
+        if (format < 0) baseline = seconds;
+        printf("  %-20s %-10s %10.2f %12zu %10.1f %8.2fx\n", name, labels[format + 1], seconds * 1e3, bytes,
+            (double)bytes / (1024.0 * 1024.0) / seconds, baseline / seconds);
+    }
+    free_lexer(parser->lexer);
+    free_parser(parser);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    size_t size = 1024 * 1024;
+    int iterations = 5;
+    int first_file = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--size=", 7) == 0) {
+            if (!parse_size(argv[i] + 7, &size)) {
+                fprintf(stderr, "Invalid size: %s\n", argv[i] + 7);
+                return EXIT_FAILURE;
+            }
+        } else if (strncmp(argv[i], "--iterations=", 13) == 0) {
+            iterations = atoi(argv[i] + 13);
+            if (iterations <= 0) iterations = 1;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Usage: %s [--size=N[K|M|G]] [--iterations=N] [FILE.jff...]\n", argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            first_file = i;
+            break;
+        }
+    }
+
+    printf("  %-20s %-10s %10s %12s %10s %9s\n", "program", "format", "ms", "bytes", "MB/s", "speedup");
+    if (first_file < argc) {
+        for (int i = first_file; i < argc; i++) {
+            size_t length;
+            char *source = read_file(argv[i], &length);
+            const char *name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+            bool ok = bench(name, source, length, iterations);
+            free(source);
+            if (!ok) return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    for (int shape = 0; shape < PROGRAM_SHAPE_COUNT; ++shape) {
+        program_gen_config_t config;
+        program_gen_default_config(&config, (program_shape_t)shape, size);
+        size_t length;
+        char *source = generate_program(&config, &length);
+        char name[64];
+        char size_text[32];
+        format_size(size, size_text, sizeof(size_text));
+        snprintf(name, sizeof(name), "%s/%s", program_shape_to_string((program_shape_t)shape), size_text);
+        bool ok = bench(name, source, length, iterations);
+        free(source);
+        if (!ok) return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/**
+ * File Name: bench_frontend.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Lexer and parser throughput on generated programs (see program_gen.h),
+ * for every program shape and for sizes growing 4x at a time, which gives
+ * the scaling curve of each phase.
+ *
+ * Lexing streams tokens and frees them as it goes, so it scales to inputs
+ * as large as memory allows for the source itself. Parsing needs the whole
+ * token array and the tree in memory, so it stops at --parse-max-size.
+ *
+ * Usage: bench_frontend [--min-size=N] [--max-size=N] [--parse-max-size=N]
+ *                       [--shape=NAME] [--seed=N] [--csv]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "program_gen.h"
+#include "../src/include/lexer.h"
+#include "../src/include/parser.h"
+
+/* Each measurement repeats until at least this many bytes went through. */
+#define BENCH_MIN_BYTES_PER_POINT (8u * 1024 * 1024)
+
+static size_t iterations_for(size_t size) {
+    size_t iterations = BENCH_MIN_BYTES_PER_POINT / (size ? size : 1);
+    return iterations ? iterations : 1;
+}
+
+/**
+ * @brief Times lexing `source`, discarding each token as soon as it is produced.
+ */
+static double time_lex(const char *source, size_t length, size_t iterations, size_t *token_count) {
+    double total = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        lexer_t *lexer = init_lexer_from_source("<bench>", source, length);
+        size_t count = 0;
+        double start = now_seconds();
+        token_t *token;
+        while ((token = lexer_next_token(lexer))->type != TOKEN_EOF) {
+            if (token->type == TOKEN_INVALID) {
+                size_t line, column;
+                source_map_locate(lexer->source, token->offset, &line, &column);
+                fprintf(stderr, "[%zu:%zu] Generated program does not lex: %s\n", line, column, token->value);
+                exit(EXIT_FAILURE);
+            }
+            free_token(token);
+            count++;
+        }
+        free_token(token);
+        total += now_seconds() - start;
+        free_lexer(lexer);
+        *token_count = count + 1;
+    }
+    return total / iterations;
+}
+
+/**
+ * @brief Times parsing an already lexed `source`.
+ */
+static double time_parse(const char *source, size_t length, size_t iterations) {
+    double total = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        lexer_t *lexer = init_lexer_from_source("<bench>", source, length);
+        token_t *token;
+        while ((token = lexer_next_token(lexer))->type != TOKEN_EOF) {
+            lexer_append_token(lexer, token);
+        }
+        lexer_append_token(lexer, token);
+
+        double start = now_seconds();
+        parser_t *parser = init_parser(lexer);
+        parser_parse_program(parser);
+        total += now_seconds() - start;
+
+        free_parser(parser);
+        free_lexer(lexer);
+    }
+    return total / iterations;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --min-size=N        smallest program (default 1K)\n");
+    fprintf(stderr, "  --max-size=N        largest program (default 16M, up to 1G)\n");
+    fprintf(stderr, "  --parse-max-size=N  largest program that is also parsed (default 64M)\n");
+    fprintf(stderr, "  --shape=NAME        only this shape (default all)\n");
+    fprintf(stderr, "  --seed=N            random seed (default 1)\n");
+    fprintf(stderr, "  --csv               print comma separated values\n");
+}
+
+int main(int argc, char **argv) {
+    size_t min_size = 1024;
+    size_t max_size = 16u * 1024 * 1024;
+    size_t parse_max_size = 64u * 1024 * 1024;
+    int only_shape = -1;
+    unsigned long long seed = 1;
+    bool csv = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool ok = true;
+        if (strncmp(arg, "--min-size=", 11) == 0) {
+            ok = parse_size(arg + 11, &min_size) && min_size > 0;
+        } else if (strncmp(arg, "--max-size=", 11) == 0) {
+            ok = parse_size(arg + 11, &max_size);
+        } else if (strncmp(arg, "--parse-max-size=", 17) == 0) {
+            ok = parse_size(arg + 17, &parse_max_size);
+        } else if (strncmp(arg, "--shape=", 8) == 0) {
+            program_shape_t shape;
+            ok = program_shape_from_string(arg + 8, &shape);
+            only_shape = (int)shape;
+        } else if (strncmp(arg, "--seed=", 7) == 0) {
+            seed = strtoull(arg + 7, NULL, 10);
+        } else if (strcmp(arg, "--csv") == 0) {
+            csv = true;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (csv) {
+        printf("shape,size,bytes,tokens,lex_seconds,lex_mb_per_s,parse_seconds,parse_mb_per_s\n");
+    } else {
+        printf("%-15s %6s %12s %12s %10s %9s %10s %9s\n",
+            "shape", "size", "bytes", "tokens", "lex MB/s", "ns/tok", "parse MB/s", "ns/tok");
+    }
+
+    for (int shape = 0; shape < PROGRAM_SHAPE_COUNT; ++shape) {
+        if (only_shape >= 0 && shape != only_shape) continue;
+
+        for (size_t size = min_size; size <= max_size; size *= 4) {
+            program_gen_config_t config;
+            program_gen_default_config(&config, (program_shape_t)shape, size);
+            config.seed = seed;
+            size_t length;
+            char *source = generate_program(&config, &length);
+
+            size_t tokens = 0;
+            double lex_time = time_lex(source, length, iterations_for(length), &tokens);
+            double parse_time = -1;
+            if (size <= parse_max_size) {
+                parse_time = time_parse(source, length, iterations_for(length));
+            }
+            free(source);
+
+            char label[32];
+            format_size(size, label, sizeof(label));
+            double mb = (double)length / (1024.0 * 1024.0);
+            if (csv) {
+                printf("%s,%s,%zu,%zu,%.6f,%.2f,", program_shape_to_string((program_shape_t)shape),
+                    label, length, tokens, lex_time, mb / lex_time);
+                if (parse_time >= 0) {
+                    printf("%.6f,%.2f\n", parse_time, mb / parse_time);
+                } else {
+                    printf(",\n");
+                }
+            } else {
+                printf("%-15s %6s %12zu %12zu %10.1f %9.1f", program_shape_to_string((program_shape_t)shape),
+                    label, length, tokens, mb / lex_time, lex_time * 1e9 / tokens);
+                if (parse_time >= 0) {
+                    printf(" %10.1f %9.1f\n", mb / parse_time, parse_time * 1e9 / tokens);
+                } else {
+                    printf(" %10s %9s\n", "-", "-");
+                }
+            }
+            fflush(stdout);
+
+            if (size > max_size / 4) break;
+        }
+    }
+    return 0;
+}
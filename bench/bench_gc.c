@@ -0,0 +1,103 @@
+/**
+ * File Name: bench_gc.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Runs a program that allocates short lived strings, arrays and tasks while
+ * a slowly growing string stays live, once per nursery size, and reports
+ * the run time, the number of collections and the pause percentiles.
+ *
+ * Usage: bench_gc [--rounds=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/include/compiler.h"
+#include "../src/include/gc.h"
+#include "../src/include/vm.h"
+
+static const char *program_template =
+    "result : int = 0;\n"
+    "kept : string = \"\";\n"
+    "\n"
+    "async func tick(r : int) : int {\n"
+    "    return r;\n"
+    "}\n"
+    "\n"
+    "async func main() : void {\n"
+    "    total : int = 0;\n"
+    "    for (r : int = 0; r < %ld; r += 1) {\n"
+    "        s : string = \"item\";\n"
+    "        for (i : int = 0; i < 8; i += 1) {\n"
+    "            s = s + \"-x\";\n"
+    "        }\n"
+    "        a : int[] = int_array(16);\n"
+    "        a[r %% 16] = r;\n"
+    "        total += sum(a + 1);\n"
+    "        if (r %% 64 == 0) {\n"
+    "            kept = kept + \"k\";\n"
+    "            total += await tick(r);\n"
+    "        }\n"
+    "    }\n"
+    "    result = total;\n"
+    "}\n";
+
+static const size_t nursery_sizes[] = { 16 << 10, 64 << 10, 256 << 10, 1 << 20, 4 << 20 };
+
+int main(int argc, char **argv) {
+    long rounds = 200000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--rounds=", 9) == 0) {
+            rounds = atol(argv[i] + 9);
+        } else {
+            fprintf(stderr, "Usage: %s [--rounds=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (rounds <= 0) rounds = 1;
+
+    char source[2048];
+    snprintf(source, sizeof(source), program_template, rounds);
+    image_t *image = compile_source(source);
+
+    printf("strings, arrays and tasks, %ld rounds\n", rounds);
+    printf("  %9s %10s %9s %9s %10s %10s %10s %10s\n", "nursery", "wall ms", "minor", "major",
+        "gc ms", "p50 us", "p99 us", "max us");
+    int64_t expected = 0;   // an int, which may be boxed in a heap freed with its VM
+    for (size_t n = 0; n < sizeof(nursery_sizes) / sizeof(nursery_sizes[0]); ++n) {
+        vm_t *vm = init_vm(image);
+        gc_set_limits(&vm->heap, nursery_sizes[n], 0);
+
+        double start = now_seconds();
+        if (vm_run(vm) != VM_OK) return EXIT_FAILURE;
+        double elapsed = now_seconds() - start;
+
+        if (n == 0) {
+            expected = AS_INT(vm->globals[0]);
+        } else if (expected != AS_INT(vm->globals[0])) {
+            fprintf(stderr, "Result changed with a %zu byte nursery\n", nursery_sizes[n]);
+            return EXIT_FAILURE;
+        }
+
+        // Percentiles are histogram bucket bounds, over minor and major pauses alike.
+        const gc_stats_t *stats = &vm->heap.stats;
+        gc_pauses_t all = stats->minor;
+        all.count += stats->major.count;
+        all.total_ns += stats->major.total_ns;
+        if (stats->major.max_ns > all.max_ns) all.max_ns = stats->major.max_ns;
+        for (size_t b = 0; b < GC_PAUSE_BUCKETS; ++b) {
+            all.buckets[b] += stats->major.buckets[b];
+        }
+        printf("  %8zuK %10.2f %9llu %9llu %10.2f %10llu %10llu %10.1f\n", nursery_sizes[n] >> 10, elapsed * 1e3,
+            (unsigned long long)stats->minor.count, (unsigned long long)stats->major.count, (double)all.total_ns / 1e6,
+            (unsigned long long)gc_pause_percentile(&all, 0.50), (unsigned long long)gc_pause_percentile(&all, 0.99),
+            (double)all.max_ns / 1e3);
+        free_vm(vm);
+    }
+    free_image(image);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+/**
+ * File Name: bench_loops.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Runs loop heavy programs compiled with and without loop invariant code
+ * motion, then others with and without the counted loop optimizations, then
+ * with generic and with typed arithmetic opcodes, and reports the time of
+ * each and the speedup. Every program leaves its result in a global, which
+ * must come out the same both ways.
+ *
+ * Usage: bench_loops [--count=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench_util.h"
+#include "../src/include/compiler.h"
+#include "../src/include/vm.h"
+
+typedef struct {
+    const char *name;
+    const char *source;     /**< printf format taking the iteration count */
+} program_t;
+
+static const program_t programs[] = {
+    { "bound",
+      "result : int = 0;\n"
+      "func main() : void {\n"
+      "    rows : int = %ld;\n"
+      "    cols : int = 4;\n"
+      "    for (i : int = 0; i < rows * cols - cols; i += 1) {\n"
+      "        result += i %% 7;\n"
+      "    }\n"
+      "}\n" },
+    { "body",
+      "result : int = 0;\n"
+      "func main() : void {\n"
+      "    width : int = 640;\n"
+      "    height : int = 480;\n"
+      "    for (i : int = 0; i < %ld; i += 1) {\n"
+      "        area : int = width * height + width * 2 + height * 2;\n"
+      "        result += (i + area) %% 11;\n"
+      "    }\n"
+      "}\n" },
+    { "nested",
+      "result : int = 0;\n"
+      "func main() : void {\n"
+      "    a : int[] = int_array(1000);\n"
+      "    scale : int = 3;\n"
+      "    offset : int = 5;\n"
+      "    for (r : int = 0; r < %ld / 1000; r += 1) {\n"
+      "        for (j : int = 0; j < len(a); j += 1) {\n"
+      "            result += scale * offset * (scale + offset) + a[j];\n"
+      "        }\n"
+      "    }\n"
+      "}\n" },
+    { "call",
+      "result : int = 0;\n"
+      "func norm(x : int, y : int, z : int) : int {\n"
+      "    return x * x + y * y + z * z;\n"
+      "}\n"
+      "func main() : void {\n"
+      "    x : int = 3;\n"
+      "    y : int = 4;\n"
+      "    for (i : int = 0; i < %ld; i += 1) {\n"
+      "        result += i %% (norm(x, y, 12) + 1);\n"
+      "    }\n"
+      "}\n" },
+};
+
+static const program_t counted_programs[] = {
+    { "unroll",
+      "result : int = 0;\n"
+      "func main() : void {\n"
+      "    for (r : int = 0; r < %ld / 10; r += 1) {\n"
+      "        for (k : int = 1; k <= 10; k += 1) {\n"
+      "            result += (r + k * 3) %% 5;\n"
+      "        }\n"
+      "    }\n"
+      "}\n" },
+    { "stride",
+      "result : int = 0;\n"
+      "func main() : void {\n"
+      "    a : int[] = int_array(2000);\n"
+      "    for (j : int = 0; j < len(a); j += 1) {\n"
+      "        a[j] = j %% 17;\n"
+      "    }\n"
+      "    for (r : int = 0; r < %ld / 1000; r += 1) {\n"
+      "        for (i : int = 0; i < len(a) / 2; i += 1) {\n"
+      "            result += a[i * 2];\n"
+      "        }\n"
+      "    }\n"
+      "}\n" },
+    { "scaled",
+      "result : int = 0;\n"
+      "func main() : void {\n"
+      "    for (i : int = 0; i < %ld; i += 1) {\n"
+      "        result += i * 7 %% 13;\n"
+      "    }\n"
+      "}\n" },
+};
+
+static const program_t typed_programs[] = {
+    { "int",
+      "result : int = 0;\n"
+      "func main() : void {\n"
+      "    a : int = 1;\n"
+      "    b : int = 0;\n"
+      "    for (i : int = 0; i < %ld; i += 1) {\n"
+      "        a = (a * 31 + i) %% 1000003;\n"
+      "        if (a > b) {\n"
+      "            b = a - b;\n"
+      "        } else {\n"
+      "            b = b - a;\n"
+      "        }\n"
+      "    }\n"
+      "    result = a + b;\n"
+      "}\n" },
+    { "float",
+      "result : float = 0;\n"
+      "func main() : void {\n"
+      "    decay : float = 255;\n"
+      "    decay = decay / 256;\n"
+      "    x : float = 0;\n"
+      "    peak : float = 0;\n"
+      "    for (i : int = 0; i < %ld; i += 1) {\n"
+      "        x = x * decay + 1;\n"
+      "        if (x > peak) {\n"
+      "            peak = x;\n"
+      "        }\n"
+      "    }\n"
+      "    result = x + peak;\n"
+      "}\n" },
+    { "mixed",
+      "result : float = 0;\n"
+      "func main() : void {\n"
+      "    scale : float = 1000;\n"
+      "    for (i : int = 0; i < %ld; i += 1) {\n"
+      "        result += (i %% 100) / scale - 1;\n"
+      "    }\n"
+      "}\n" },
+    { "fib",
+      "result : int = 0;\n"
+      "func fib(n : int) : int {\n"
+      "    if (n < 2) {\n"
+      "        return n;\n"
+      "    }\n"
+      "    return fib(n - 1) + fib(n - 2);\n"
+      "}\n"
+      "func main() : void {\n"
+      "    for (r : int = 0; r < %ld / 100000; r += 1) {\n"
+      "        result += fib(22 + r %% 3);\n"
+      "    }\n"
+      "}\n" },
+};
+
+/**
+ * @brief Compiles and runs the program, returning the wall time and storing
+ * the result global.
+ */
+static double run_program(const char *source, double *result) {
+    image_t *image = compile_source(source);
+    vm_t *vm = init_vm(image);
+    double start = now_seconds();
+    if (vm_run(vm) != VM_OK) exit(EXIT_FAILURE);
+    double elapsed = now_seconds() - start;
+    *result = AS_DOUBLE(vm->globals[0]);
+    free_vm(vm);
+    free_image(image);
+    return elapsed;
+}
+
+/**
+ * @brief Runs the program with the optimization turned off by `set`, then
+ * on, and prints a row. Leaves it on.
+ */
+static bool compare(const program_t *program, long count, void (*set)(bool)) {
+    char source[2048];
+    snprintf(source, sizeof(source), program->source, count);
+    double before, after;
+    set(false);
+    double off = run_program(source, &before);
+    set(true);
+    double on = run_program(source, &after);
+    if (before != after) {
+        fprintf(stderr, "Different results for %s: %.17g and %.17g\n", program->name, before, after);
+        return false;
+    }
+    printf("  %-8s %12.2f %12.2f %8.2fx\n", program->name, off * 1e3, on * 1e3, off / on);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    long count = 10000000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--count=", 8) == 0) {
+            count = atol(argv[i] + 8);
+        } else {
+            fprintf(stderr, "Usage: %s [--count=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (count < 1000) count = 1000;
+
+    printf("loop invariant code motion, %ld iterations each\n", count);
+    printf("  %-8s %12s %12s %9s\n", "loop", "inside ms", "hoisted ms", "speedup");
+    for (size_t p = 0; p < sizeof(programs) / sizeof(programs[0]); ++p) {
+        if (!compare(&programs[p], count, compiler_set_hoisting)) return EXIT_FAILURE;
+    }
+
+    printf("counted loops, %ld iterations each\n", count);
+    printf("  %-8s %12s %12s %9s\n", "loop", "plain ms", "counted ms", "speedup");
+    for (size_t p = 0; p < sizeof(counted_programs) / sizeof(counted_programs[0]); ++p) {
+        if (!compare(&counted_programs[p], count, compiler_set_counted_loops)) return EXIT_FAILURE;
+    }
+
+    printf("typed opcodes, %ld iterations each\n", count);
+    printf("  %-8s %12s %12s %9s\n", "program", "generic ms", "typed ms", "speedup");
+    for (size_t p = 0; p < sizeof(typed_programs) / sizeof(typed_programs[0]); ++p) {
+        if (!compare(&typed_programs[p], count, compiler_set_typed_opcodes)) return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
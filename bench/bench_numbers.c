@@ -0,0 +1,338 @@
+/**
+ * File Name: bench_numbers.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Checks and times the numeric literal scanner of number.h. First every
+ * literal of a random set, floats printed with 1 to 17 significant digits
+ * or with up to 25 random digits, and ints in decimal, hex and binary with
+ * separators, is converted and compared bit for bit with strtod() and
+ * strtoll(). Then the same literals are converted by number_scan() and by
+ * the C library, and a program made mostly of numeric literals is lexed.
+ *
+ * Usage: bench_numbers [--count=N] [--iterations=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "bench_util.h"
+#include "../src/include/lexer.h"
+#include "../src/include/number.h"
+
+static uint64_t random_state = 0x9e3779b97f4a7c15ull;
+
+static uint64_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+//--------------------------------------- Literals ----------------------------------------------------------------------------------
+
+typedef struct {
+    char *text;                 /**< All literals, NUL separated */
+    size_t *offsets;
+    bool *is_float;
+    size_t count;
+    size_t size;
+    size_t capacity;
+} literals_t;
+
+static void add_literal(literals_t *literals, const char *text, bool is_float) {
+    size_t length = strlen(text);
+    if (literals->size + length + 1 > literals->capacity) {
+        literals->capacity = (literals->capacity + length + 1) * 2;
+        literals->text = realloc(literals->text, literals->capacity);
+        if (!literals->text) exit(EXIT_FAILURE);
+    }
+    literals->offsets[literals->count] = literals->size;
+    literals->is_float[literals->count++] = is_float;
+    memcpy(literals->text + literals->size, text, length + 1);
+    literals->size += length + 1;
+}
+
+/** A finite double from random bits, without its sign: literals have none. */
+static double random_double(void) {
+    for (;;) {
+        uint64_t bits = next_random() & 0x7fffffffffffffffull;
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (isfinite(value)) return value;
+    }
+}
+
+/** Copies `digits` into `out` with a `_` between every three digits of the integer part. */
+static void add_separators(const char *digits, char *out) {
+    const char *end = digits;
+    while (*end >= '0' && *end <= '9') end++;
+    size_t integer = (size_t)(end - digits);
+    for (size_t i = 0; i < integer; ++i) {
+        if (i > 0 && (integer - i) % 3 == 0) *out++ = '_';
+        *out++ = digits[i];
+    }
+    strcpy(out, end);
+}
+
+static void make_literals(literals_t *literals, size_t count) {
+    literals->offsets = malloc(count * sizeof(size_t));
+    literals->is_float = malloc(count * sizeof(bool));
+    if (!literals->offsets || !literals->is_float) exit(EXIT_FAILURE);
+
+    char text[96], separated[128];
+    for (size_t i = 0; i < count; ++i) {
+        switch (next_random() % 6) {
+            case 0: case 1: {
+                // The shortest forms people write, and the round-trip ones
+                // (those that round up past DBL_MAX keep all 17 digits)
+                int precision = 1 + (int)(next_random() % 17);
+                double value = random_double();
+                snprintf(text, sizeof(text), "%.*e", precision - 1, value);
+                if (isinf(strtod(text, NULL))) snprintf(text, sizeof(text), "%.16e", value);
+                add_literal(literals, text, true);
+                break;
+            }
+            case 2: {
+                // Decimal notation with a fraction, and sometimes separators
+                double value = (double)(next_random() % 100000000) / (double)(1 + next_random() % 10000);
+                snprintf(text, sizeof(text), "%.*f", 1 + (int)(next_random() % 8), value);
+                if (next_random() % 2) {
+                    add_separators(text, separated);
+                    add_literal(literals, separated, true);
+                } else {
+                    add_literal(literals, text, true);
+                }
+                break;
+            }
+            case 3: {
+                // More digits than a uint64_t holds, so some are dropped
+                int digits = 20 + (int)(next_random() % 6);
+                text[0] = (char)('1' + next_random() % 9);
+                for (int d = 1; d < digits; ++d) text[d] = (char)('0' + next_random() % 10);
+                snprintf(text + digits, sizeof(text) - (size_t)digits, "e%d", (int)(next_random() % 600) - 330);
+                add_literal(literals, text, true);
+                break;
+            }
+            case 4: {
+                int64_t value = (int64_t)(next_random() >> (1 + next_random() % 63));
+                snprintf(text, sizeof(text), "%lld", (long long)value);
+                if (next_random() % 2) {
+                    add_separators(text, separated);
+                    add_literal(literals, separated, false);
+                } else {
+                    add_literal(literals, text, false);
+                }
+                break;
+            }
+            default: {
+                uint64_t value = next_random() >> (1 + next_random() % 63);
+                if (next_random() % 2) {
+                    snprintf(text, sizeof(text), "0x%llx", (unsigned long long)value);
+                } else {
+                    char *out = text + 2;
+                    text[0] = '0';
+                    text[1] = 'b';
+                    int bits = 64 - __builtin_clzll(value | 1);
+                    for (int b = bits - 1; b >= 0; --b) {
+                        *out++ = (char)('0' + ((value >> b) & 1));
+                        if (b > 0 && b % 8 == 0) *out++ = '_';
+                    }
+                    *out = '\0';
+                }
+                add_literal(literals, text, false);
+                break;
+            }
+        }
+    }
+}
+
+/** What the C library makes of a literal, with the separators taken out. */
+static void library_convert(const char *literal, bool is_float, number_t *number) {
+    char digits[128];
+    size_t count = 0;
+    for (const char *c = literal; *c && count + 1 < sizeof(digits); ++c) {
+        if (*c != '_') digits[count++] = *c;
+    }
+    digits[count] = '\0';
+    number->is_float = is_float;
+    if (is_float) {
+        number->value.float_value = strtod(digits, NULL);
+    } else if (digits[0] == '0' && digits[1] == 'b') {
+        number->value.int_value = strtoll(digits + 2, NULL, 2);
+    } else {
+        number->value.int_value = strtoll(digits, NULL, 0);
+    }
+}
+
+static bool check_literals(const literals_t *literals) {
+    size_t wrong = 0;
+    for (size_t i = 0; i < literals->count; ++i) {
+        const char *literal = literals->text + literals->offsets[i];
+        number_t scanned, expected;
+        number_status_t status = number_scan(literal, strlen(literal), &scanned);
+        library_convert(literal, literals->is_float[i], &expected);
+        if (status != NUMBER_OK || scanned.is_float != expected.is_float || scanned.length != strlen(literal)
+            || memcmp(&scanned.value, &expected.value, sizeof(scanned.value)) != 0) {
+            if (wrong++ < 10) {
+                fprintf(stderr, "%s: %s, ", literal, number_status_to_string(status));
+                if (scanned.is_float) {
+                    fprintf(stderr, "%.17g instead of %.17g\n", scanned.value.float_value, expected.value.float_value);
+                } else {
+                    fprintf(stderr, "%lld instead of %lld\n", (long long)scanned.value.int_value,
+                        (long long)expected.value.int_value);
+                }
+            }
+        }
+    }
+    if (wrong) fprintf(stderr, "%zu of %zu literals converted wrongly\n", wrong, literals->count);
+    return wrong == 0;
+}
+
+/** Literals that must be rejected, and the boundaries that must not. */
+static bool check_edges(void) {
+    static const struct {
+        const char *text;
+        number_status_t status;
+    } cases[] = {
+        { "9223372036854775807", NUMBER_OK },
+        { "9223372036854775808", NUMBER_INT_OVERFLOW },
+        { "0x7fff_ffff_ffff_ffff", NUMBER_OK },
+        { "0x8000000000000000", NUMBER_INT_OVERFLOW },
+        { "1.7976931348623157e308", NUMBER_OK },
+        { "1.8e308", NUMBER_FLOAT_OVERFLOW },
+        { "4.9e-324", NUMBER_OK },
+        { "1e-400", NUMBER_OK },
+        { "0e999999999", NUMBER_OK },
+        { "1_000", NUMBER_OK },
+        { "1__000", NUMBER_BAD_SEPARATOR },
+        { "1000_", NUMBER_BAD_SEPARATOR },
+        { "0x_ff", NUMBER_BAD_SEPARATOR },
+        { "0x", NUMBER_MISSING_DIGITS },
+        { "1e+", NUMBER_MISSING_DIGITS },
+        { "0b102", NUMBER_BAD_DIGIT },
+        { "12abc", NUMBER_BAD_DIGIT },
+    };
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        number_t number;
+        number_status_t status = number_scan(cases[i].text, strlen(cases[i].text), &number);
+        if (status != cases[i].status) {
+            fprintf(stderr, "%s: %s, expected %s\n", cases[i].text, number_status_to_string(status),
+                number_status_to_string(cases[i].status));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+//--------------------------------------- Timing ------------------------------------------------------------------------------------
+
+static double time_conversion(const literals_t *literals, bool library, int iterations, double *checksum) {
+    double sum = 0;
+    double start = now_seconds();
+    for (int run = 0; run < iterations; ++run) {
+        for (size_t i = 0; i < literals->count; ++i) {
+            const char *literal = literals->text + literals->offsets[i];
+            number_t number;
+            if (library) {
+                library_convert(literal, literals->is_float[i], &number);
+            } else {
+                number_scan(literal, strlen(literal), &number);
+            }
+            sum += number.is_float ? number.value.float_value : (double)number.value.int_value;
+        }
+    }
+    *checksum = sum;
+    return (now_seconds() - start) / iterations;
+}
+
+/** A program that is mostly numeric literals, one per line. */
+static char *make_source(const literals_t *literals, size_t *length) {
+    size_t capacity = literals->size * 2 + 64;
+    char *source = malloc(capacity);
+    if (!source) exit(EXIT_FAILURE);
+    size_t size = (size_t)snprintf(source, capacity, "func main() : void {\n");
+    for (size_t i = 0; i < literals->count; ++i) {
+        size += (size_t)snprintf(source + size, capacity - size, "x = %s;\n", literals->text + literals->offsets[i]);
+    }
+    size += (size_t)snprintf(source + size, capacity - size, "}\n");
+    *length = size;
+    return source;
+}
+
+static double time_lexing(const char *source, size_t length, int iterations, size_t *token_count) {
+    double total = 0;
+    for (int run = 0; run < iterations; ++run) {
+        lexer_t *lexer = init_lexer_from_source("<bench>", source, length);
+        size_t count = 0;
+        double start = now_seconds();
+        token_t *token;
+        while ((token = lexer_next_token(lexer))->type != TOKEN_EOF) {
+            if (token->type == TOKEN_INVALID) {
+                size_t line, column;
+                source_map_locate(lexer->source, token->offset, &line, &column);
+                fprintf(stderr, "[%zu:%zu] %s\n", line, column, token->value);
+                exit(EXIT_FAILURE);
+            }
+            free_token(token);
+            count++;
+        }
+        free_token(token);
+        total += now_seconds() - start;
+        free_lexer(lexer);
+        *token_count = count;
+    }
+    return total / iterations;
+}
+
+int main(int argc, char **argv) {
+    size_t count = 1000000;
+    int iterations = 5;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--count=", 8) == 0) {
+            count = strtoull(argv[i] + 8, NULL, 10);
+            if (count == 0) count = 1;
+        } else if (strncmp(argv[i], "--iterations=", 13) == 0) {
+            iterations = atoi(argv[i] + 13);
+            if (iterations <= 0) iterations = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--count=N] [--iterations=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    literals_t literals = {0};
+    make_literals(&literals, count);
+    if (!check_edges() || !check_literals(&literals)) return EXIT_FAILURE;
+    printf("  %zu literals (%zu bytes) convert exactly as strtod/strtoll do\n", literals.count, literals.size);
+
+    double scan_checksum, library_checksum;
+    double scan = time_conversion(&literals, false, iterations, &scan_checksum);
+    double library = time_conversion(&literals, true, iterations, &library_checksum);
+    printf("  %-24s %10s %12s %10s\n", "conversion", "ms", "ns/literal", "MB/s");
+    printf("  %-24s %10.2f %12.1f %10.1f\n", "number_scan", scan * 1e3, scan * 1e9 / (double)literals.count,
+        (double)literals.size / (1024.0 * 1024.0) / scan);
+    printf("  %-24s %10.2f %12.1f %10.1f  (%.2fx)\n", "strtod/strtoll", library * 1e3,
+        library * 1e9 / (double)literals.count, (double)literals.size / (1024.0 * 1024.0) / library, library / scan);
+    if (scan_checksum != library_checksum) {
+        fprintf(stderr, "the checksums differ\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t length, tokens;
+    char *source = make_source(&literals, &length);
+    double lexing = time_lexing(source, length, iterations, &tokens);
+    printf("  lexing %zu bytes, %zu tokens: %.2f ms, %.1f MB/s, %.1f M tokens/s\n", length, tokens, lexing * 1e3,
+        (double)length / (1024.0 * 1024.0) / lexing, (double)tokens / 1e6 / lexing);
+
+    free(source);
+    free(literals.text);
+    free(literals.offsets);
+    free(literals.is_float);
+    return EXIT_SUCCESS;
+}
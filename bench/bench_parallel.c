@@ -0,0 +1,95 @@
+/**
+ * File Name: bench_parallel.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Runs a CPU bound `parallel for` with a += reduction on 1, 2, 4, ...
+ * threads, up to the number of online CPUs (at least 8), and reports the
+ * wall time and speedup over one thread. Every run must produce the same
+ * reduced value.
+ *
+ * Usage: bench_parallel [--iterations=N] [--max-threads=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench_util.h"
+#include "../src/include/compiler.h"
+#include "../src/include/scheduler.h"
+#include "../src/include/vm.h"
+
+static const char *program_template =
+    "result : int = 0;\n"
+    "\n"
+    "func work(seed : int) : int {\n"
+    "    h : int = seed;\n"
+    "    for (k : int = 0; k < 200; k += 1) {\n"
+    "        h = (h * 1103515245 + 12345) %% 1000003;\n"
+    "    }\n"
+    "    return h %% 1000;\n"
+    "}\n"
+    "\n"
+    "func main() : void {\n"
+    "    total : int = 0;\n"
+    "    parallel for (i : int = 0; i < %ld; i += 1) {\n"
+    "        total += work(i);\n"
+    "    }\n"
+    "    result = total;\n"
+    "}\n";
+
+int main(int argc, char **argv) {
+    long iterations = 20000;
+    long max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_threads < 8) max_threads = 8;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--iterations=", 13) == 0) {
+            iterations = atol(argv[i] + 13);
+        } else if (strncmp(argv[i], "--max-threads=", 14) == 0) {
+            max_threads = atol(argv[i] + 14);
+        } else {
+            fprintf(stderr, "Usage: %s [--iterations=N] [--max-threads=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (iterations <= 0) iterations = 1;
+    if (max_threads <= 0) max_threads = 1;
+    if (max_threads > SCHEDULER_MAX_THREADS) max_threads = SCHEDULER_MAX_THREADS;
+
+    char source[1024];
+    snprintf(source, sizeof(source), program_template, iterations);
+    image_t *image = compile_source(source);
+
+    printf("parallel for, %ld iterations, %ld online CPUs\n", iterations, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("  %7s %12s %9s %12s\n", "threads", "wall ms", "speedup", "result");
+
+    double baseline = 0;
+    int64_t expected = 0;   // an int, which may be boxed in a heap freed with its VM
+    for (long threads = 1; threads <= max_threads; threads *= 2) {
+        scheduler_set_thread_count((size_t)threads);
+        vm_t *vm = init_vm(image);
+        // The first run starts the pool; time the second.
+        if (vm_run(vm) != VM_OK) return EXIT_FAILURE;
+        double start = now_seconds();
+        if (vm_run(vm) != VM_OK) return EXIT_FAILURE;
+        double elapsed = now_seconds() - start;
+
+        int64_t result = AS_INT(vm->globals[0]);
+        if (threads == 1) {
+            baseline = elapsed;
+            expected = result;
+        } else if (result != expected) {
+            fprintf(stderr, "Result mismatch on %ld threads\n", threads);
+            return EXIT_FAILURE;
+        }
+        printf("  %7ld %12.2f %8.2fx %12lld\n", threads, elapsed * 1e3, baseline / elapsed,
+            (long long)result);
+        free_vm(vm);
+    }
+    free_image(image);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/**
+ * File Name: bench_print.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Runs programs that print ints, floats, strings and a mix of the three in a
+ * loop with stdout sent to /dev/null, fully buffered and line buffered, and
+ * reports millions of print statements per second.
+ *
+ * Usage: bench_print [--count=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "bench_util.h"
+#include "../src/include/compiler.h"
+#include "../src/include/output.h"
+#include "../src/include/vm.h"
+
+static const char *program_template =
+    "func main() : void {\n"
+    "    f : float[] = float_array(1);\n"
+    "    f[0] = 1;\n"
+    "    third : float = f[0] / 3;\n"
+    "    name : string = \"request\";\n"
+    "    for (i : int = 0; i < %ld; i += 1) {\n"
+    "        print(%s);\n"
+    "    }\n"
+    "}\n";
+
+typedef struct {
+    const char *name;
+    const char *arguments;
+} shape_t;
+
+static const shape_t shapes[] = {
+    { "int", "i * 7919" },
+    { "float", "third * i" },
+    { "string", "name" },
+    { "mixed", "name, i, third * i, i % 2 == 0" },
+};
+
+static const struct {
+    const char *name;
+    output_mode_t mode;
+} modes[] = {
+    { "full", OUTPUT_FULLY_BUFFERED },
+    { "line", OUTPUT_LINE_BUFFERED },
+};
+
+int main(int argc, char **argv) {
+    long count = 2000000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--count=", 8) == 0) {
+            count = atol(argv[i] + 8);
+        } else {
+            fprintf(stderr, "Usage: %s [--count=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (count <= 0) count = 1;
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    int saved_stdout = dup(STDOUT_FILENO);
+    if (null_fd < 0 || saved_stdout < 0) {
+        perror("/dev/null");
+        return EXIT_FAILURE;
+    }
+
+    printf("print statements to /dev/null, %ld each\n", count);
+    printf("  %-8s %-6s %10s %12s\n", "values", "mode", "wall ms", "M prints/s");
+    fflush(stdout);
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+        char source[1024];
+        snprintf(source, sizeof(source), program_template, count, shapes[s].arguments);
+        image_t *image = compile_source(source);
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+            output_set_mode(modes[m].mode);
+            vm_t *vm = init_vm(image);
+
+            dup2(null_fd, STDOUT_FILENO);
+            double start = now_seconds();
+            vm_status_t status = vm_run(vm);
+            double elapsed = now_seconds() - start;
+            dup2(saved_stdout, STDOUT_FILENO);
+            if (status != VM_OK) return EXIT_FAILURE;
+
+            printf("  %-8s %-6s %10.2f %12.2f\n", shapes[s].name, modes[m].name, elapsed * 1e3,
+                (double)count / elapsed / 1e6);
+            fflush(stdout);
+            free_vm(vm);
+        }
+        free_image(image);
+    }
+    close(null_fd);
+    close(saved_stdout);
+    return EXIT_SUCCESS;
+}
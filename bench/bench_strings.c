@@ -0,0 +1,83 @@
+/**
+ * File Name: bench_strings.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Builds strings with repeated `+` in a loop, appending, prepending and
+ * wrapping, at doubling lengths, and reports the time per concatenation.
+ * Linear time building shows up as a flat ns/op column; quadratic copying
+ * would double it at every row.
+ *
+ * Usage: bench_strings [--max-count=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench_util.h"
+#include "../src/include/compiler.h"
+#include "../src/include/vm.h"
+
+static const char *program_template =
+    "result : int = 0;\n"
+    "\n"
+    "func main() : void {\n"
+    "    s : string = \"\";\n"
+    "    for (i : int = 0; i < %ld; i += 1) {\n"
+    "        s = %s;\n"
+    "    }\n"
+    "    if (s == s + \"\") {\n"
+    "        result = 1;\n"
+    "    }\n"
+    "}\n";
+
+typedef struct {
+    const char *name;
+    const char *expression;
+} pattern_t;
+
+static const pattern_t patterns[] = {
+    { "append", "s + \"ab\"" },
+    { "prepend", "\"ab\" + s" },
+    { "wrap", "\"(\" + s + \")\"" },
+};
+
+int main(int argc, char **argv) {
+    long max_count = 1 << 20;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--max-count=", 12) == 0) {
+            max_count = atol(argv[i] + 12);
+        } else {
+            fprintf(stderr, "Usage: %s [--max-count=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (max_count < 1024) max_count = 1024;
+
+    printf("string building, time per concatenation\n");
+    printf("  %-8s %10s %10s %10s\n", "pattern", "count", "wall ms", "ns/op");
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p) {
+        for (long count = 1024; count <= max_count; count *= 4) {
+            char source[1024];
+            snprintf(source, sizeof(source), program_template, count, patterns[p].expression);
+            image_t *image = compile_source(source);
+            vm_t *vm = init_vm(image);
+
+            double start = now_seconds();
+            if (vm_run(vm) != VM_OK) return EXIT_FAILURE;
+            double elapsed = now_seconds() - start;
+            if (AS_INT(vm->globals[0]) != 1) {
+                fprintf(stderr, "Wrong result for %s\n", patterns[p].name);
+                return EXIT_FAILURE;
+            }
+
+            printf("  %-8s %10ld %10.2f %10.1f\n", patterns[p].name, count, elapsed * 1e3, elapsed * 1e9 / (double)count);
+            free_vm(vm);
+            free_image(image);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+/**
+ * File Name: bench_tasks.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Starts 1k, 10k, ... async tasks from `main` that are all suspended in a
+ * sleep at the same time, runs the event loop until they finish, and
+ * reports the wall time and the peak memory per task: its header, its heap
+ * frame and the timer it awaits.
+ *
+ * Usage: bench_tasks [--max-tasks=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench_util.h"
+#include "../src/include/compiler.h"
+#include "../src/include/vm.h"
+
+static const char *program_template =
+    "result : int = 0;\n"
+    "\n"
+    "async func job(id : int) : int {\n"
+    "    await sleep(id %% 10);\n"
+    "    result += id %% 7;\n"
+    "    return id;\n"
+    "}\n"
+    "\n"
+    "async func main() : void {\n"
+    "    for (i : int = 0; i < %ld; i += 1) {\n"
+    "        job(i);\n"
+    "    }\n"
+    "}\n";
+
+int main(int argc, char **argv) {
+    long max_tasks = 100000;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--max-tasks=", 12) == 0) {
+            max_tasks = atol(argv[i] + 12);
+        } else {
+            fprintf(stderr, "Usage: %s [--max-tasks=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (max_tasks < 1000) max_tasks = 1000;
+
+    printf("async tasks, each sleeping 0-9 ms, sizeof(task_t) %zu\n", sizeof(task_t));
+    printf("  %9s %10s %12s %14s\n", "tasks", "wall ms", "us / task", "bytes / task");
+    for (long tasks = 1000; tasks <= max_tasks; tasks *= 10) {
+        char source[2048];
+        snprintf(source, sizeof(source), program_template, tasks);
+        image_t *image = compile_source(source);
+        vm_t *vm = init_vm(image);
+
+        double start = now_seconds();
+        if (vm_run(vm) != VM_OK) return EXIT_FAILURE;
+        double elapsed = now_seconds() - start;
+
+        printf("  %9ld %10.2f %12.3f %14.1f\n", tasks, elapsed * 1e3, elapsed * 1e6 / (double)tasks,
+            (double)vm->loop.peak_bytes / (double)tasks);
+        free_vm(vm);
+        free_image(image);
+    }
+    return EXIT_SUCCESS;
+}
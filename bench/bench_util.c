@@ -0,0 +1,68 @@
+/**
+ * File Name: bench_util.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench_util.h"
+#include "../src/include/compiler.h"
+#include "../src/include/ast.h"
+
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+parser_t *parse_source(const char *name, const char *source, size_t length) {
+    lexer_t *lexer = init_lexer_from_source(name, source, length);
+    if (!lexer) {
+        fprintf(stderr, "%s: program too long to lex\n", name);
+        exit(EXIT_FAILURE);
+    }
+    token_t *token;
+    while ((token = lexer_next_token(lexer))->type != TOKEN_EOF) {
+        lexer_append_token(lexer, token);
+    }
+    lexer_append_token(lexer, token);
+    parser_t *parser = init_parser(lexer);
+    parser_parse_program(parser);
+    return parser;
+}
+
+image_t *compile_source(const char *source) {
+    parser_t *parser = parse_source("<bench>", source, strlen(source));
+    image_t *image = compile_program(parser->ast);
+    free_lexer(parser->lexer);
+    free_parser(parser);
+    if (!image) exit(EXIT_FAILURE);
+    return image;
+}
+
+char *capture_print_ast(ast_t *ast, size_t *length) {
+    FILE *capture = tmpfile();
+    if (!capture) exit(EXIT_FAILURE);
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(fileno(capture), STDOUT_FILENO);
+    print_ast(ast);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    long size = lseek(fileno(capture), 0, SEEK_END);
+    rewind(capture);
+    char *text = malloc((size_t)size + 1);
+    if (!text) exit(EXIT_FAILURE);
+    *length = fread(text, 1, (size_t)size, capture);
+    text[*length] = '\0';
+    fclose(capture);
+    return text;
+}
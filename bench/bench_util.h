@@ -0,0 +1,44 @@
+/**
+ * File Name: bench_util.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Helpers the benchmarks share: a monotonic clock, turning jff source
+ * held in memory into a parsed tree or a compiled image, and capturing what
+ * print_ast() writes to compare trees.
+ */
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <stddef.h>
+
+#include "../src/include/parser.h"
+#include "../src/include/image.h"
+
+/**
+ * @brief Seconds on the monotonic clock, for timing intervals.
+ */
+double now_seconds(void);
+
+/**
+ * @brief Lexes and parses `length` bytes of `source`; exits if it is too long to lex.
+ *
+ * @param name Name the diagnostics use in place of a file name.
+ * @return The parser holding the tree; free parser->lexer, then the parser.
+ */
+parser_t *parse_source(const char *name, const char *source, size_t length);
+
+/**
+ * @brief Parses and compiles a NUL terminated program; exits if it does not compile.
+ */
+image_t *compile_source(const char *source);
+
+/**
+ * @brief Runs print_ast() with stdout redirected into a temporary file.
+ *
+ * @param length Receives the number of bytes printed.
+ * @return Its NUL terminated, malloc'ed output.
+ */
+char *capture_print_ast(ast_t *ast, size_t *length);
+
+#endif // BENCH_UTIL_H
@@ -0,0 +1,229 @@
+/**
+ * File Name: bench_values.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Compares the NaN-boxed value_t of the runtime with the tagged struct it
+ * replaced, a type field next to a union, on the work an interpreter does
+ * with values: summing int and float arrays through the generic add, adding
+ * a mixed array element-wise, and testing truthiness. Both sides compute the
+ * same results, which are checked against each other.
+ *
+ * Usage: bench_values [--count=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "../src/include/value.h"
+#include "../src/include/gc.h"
+
+#define PASSES 10   /**< Times each loop goes over its arrays */
+
+/** The representation before NaN-boxing: 16 bytes, 4 of them padding. */
+typedef struct {
+    value_type_t type;
+    union {
+        bool boolean;
+        int64_t integer;
+        double floating;
+    } as;
+} tagged_value_t;
+
+#define TAGGED_INT(i)   ((tagged_value_t){ .type = VALUE_INT, .as = { .integer = (i) } })
+#define TAGGED_FLOAT(f) ((tagged_value_t){ .type = VALUE_FLOAT, .as = { .floating = (f) } })
+
+static tagged_value_t tagged_add(tagged_value_t a, tagged_value_t b) {
+    if (a.type == VALUE_INT && b.type == VALUE_INT) {
+        return TAGGED_INT((int64_t)((uint64_t)a.as.integer + (uint64_t)b.as.integer));
+    }
+    double x = a.type == VALUE_INT ? (double)a.as.integer : a.as.floating;
+    double y = b.type == VALUE_INT ? (double)b.as.integer : b.as.floating;
+    return TAGGED_FLOAT(x + y);
+}
+
+static bool tagged_truthy(tagged_value_t value) {
+    switch (value.type) {
+        case VALUE_NULL:  return false;
+        case VALUE_BOOL:  return value.as.boolean;
+        case VALUE_INT:   return value.as.integer != 0;
+        case VALUE_FLOAT: return value.as.floating != 0.0;
+        default:          return true;
+    }
+}
+
+/**
+ * @brief The VM's + on numbers past its fast paths: wide ints and an int
+ * with a float.
+ */
+static value_t boxed_add_slow(gc_heap_t *heap, value_t a, value_t b) {
+    if (IS_INT(a) && IS_INT(b)) {
+        return gc_int_value(heap, (int64_t)((uint64_t)AS_INT(a) + (uint64_t)AS_INT(b)));
+    }
+    return FLOAT_VALUE(AS_DOUBLE(a) + AS_DOUBLE(b));
+}
+
+/**
+ * @brief The VM's + on numbers: the small int and float fast paths are
+ * inline in its dispatch loop, the rest is a call.
+ */
+static inline value_t boxed_add(gc_heap_t *heap, value_t a, value_t b) {
+    if (BOTH_SMALL_INTS(a, b)) {
+        int64_t r = SMALL_INT_OP(a, +, b);
+        if (INT_FITS_SMALL(r)) return SMALL_INT_VALUE(r);
+    } else if (BOTH_FLOATS(a, b)) {
+        return FLOAT_OP(a, +, b);
+    }
+    return boxed_add_slow(heap, a, b);
+}
+
+static double tagged_result(tagged_value_t value) {
+    return value.type == VALUE_INT ? (double)value.as.integer : value.as.floating;
+}
+
+static double boxed_result(value_t value) {
+    return AS_DOUBLE(value);
+}
+
+static void print_row(const char *name, double tagged_time, double boxed_time, size_t n) {
+    double operations = (double)n * PASSES;
+    printf("  %-18s %12.2f %12.2f %8.2fx\n", name, tagged_time * 1e9 / operations, boxed_time * 1e9 / operations,
+        tagged_time / boxed_time);
+}
+
+/**
+ * @brief Sums both copies of the array ten times through the generic add
+ * and prints a row.
+ */
+static bool time_sum(const char *name, gc_heap_t *heap, const tagged_value_t *tagged, const value_t *boxed, size_t n) {
+    double start = now_seconds();
+    tagged_value_t tagged_total = tagged[0];
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (size_t i = 1; i < n; ++i) {
+            tagged_total = tagged_add(tagged_total, tagged[i]);
+        }
+    }
+    double tagged_time = now_seconds() - start;
+    start = now_seconds();
+    value_t boxed_total = boxed[0];
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (size_t i = 1; i < n; ++i) {
+            boxed_total = boxed_add(heap, boxed_total, boxed[i]);
+        }
+    }
+    double boxed_time = now_seconds() - start;
+    if (tagged_result(tagged_total) != boxed_result(boxed_total)) {
+        fprintf(stderr, "Different sums: %g and %g\n", tagged_result(tagged_total), boxed_result(boxed_total));
+        return false;
+    }
+    print_row(name, tagged_time, boxed_time, n);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    long count = 1 << 22;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--count=", 8) == 0) {
+            count = atol(argv[i] + 8);
+        } else {
+            fprintf(stderr, "Usage: %s [--count=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (count < 1024) count = 1024;
+    size_t n = (size_t)count;
+
+    // An int array, a float array, and a mixed one with every eighth value a
+    // float, each in both representations.
+    tagged_value_t *tagged_ints = malloc(n * sizeof(tagged_value_t));
+    tagged_value_t *tagged_floats = malloc(n * sizeof(tagged_value_t));
+    tagged_value_t *tagged_mixed = malloc(n * sizeof(tagged_value_t));
+    tagged_value_t *tagged_out = malloc(n * sizeof(tagged_value_t));
+    value_t *boxed_ints = malloc(n * sizeof(value_t));
+    value_t *boxed_floats = malloc(n * sizeof(value_t));
+    value_t *boxed_mixed = malloc(n * sizeof(value_t));
+    value_t *boxed_out = malloc(n * sizeof(value_t));
+    if (!tagged_ints || !tagged_floats || !tagged_mixed || !tagged_out ||
+        !boxed_ints || !boxed_floats || !boxed_mixed || !boxed_out) {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        tagged_ints[i] = TAGGED_INT((int64_t)(i % 1000));
+        boxed_ints[i] = SMALL_INT_VALUE(i % 1000);
+        tagged_floats[i] = TAGGED_FLOAT((double)(i % 100) / 4.0);
+        boxed_floats[i] = FLOAT_VALUE((double)(i % 100) / 4.0);
+        tagged_mixed[i] = i % 8 == 7 ? tagged_floats[i] : tagged_ints[i];
+        boxed_mixed[i] = i % 8 == 7 ? boxed_floats[i] : boxed_ints[i];
+    }
+    gc_heap_t heap;
+    init_gc_heap(&heap);
+
+    printf("value representations, %zu values\n", n);
+    printf("  %-18s %12s %12s %9s\n", "work", "struct ns", "nan-box ns", "speedup");
+    printf("  %-18s %12zu %12zu\n", "bytes per value", sizeof(tagged_value_t), sizeof(value_t));
+
+    if (!time_sum("int sum", &heap, tagged_ints, boxed_ints, n)) return EXIT_FAILURE;
+    if (!time_sum("float sum", &heap, tagged_floats, boxed_floats, n)) return EXIT_FAILURE;
+
+    // Element-wise c[i] = a[i] + a[n - 1 - i] on the mixed array, streaming
+    // three arrays through memory.
+    double start = now_seconds();
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (size_t i = 0; i < n; ++i) {
+            tagged_out[i] = tagged_add(tagged_mixed[i], tagged_mixed[n - 1 - i]);
+        }
+    }
+    double tagged_time = now_seconds() - start;
+    start = now_seconds();
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (size_t i = 0; i < n; ++i) {
+            boxed_out[i] = boxed_add(&heap, boxed_mixed[i], boxed_mixed[n - 1 - i]);
+        }
+    }
+    double boxed_time = now_seconds() - start;
+    for (size_t i = 0; i < n; ++i) {
+        if (tagged_result(tagged_out[i]) != boxed_result(boxed_out[i])) {
+            fprintf(stderr, "Different element %zu\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    print_row("element-wise add", tagged_time, boxed_time, n);
+
+    // Counts the truthy values of the results, as conditions do.
+    start = now_seconds();
+    size_t tagged_truthy_count = 0;
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (size_t i = 0; i < n; ++i) {
+            tagged_truthy_count += tagged_truthy(tagged_out[i]);
+        }
+    }
+    tagged_time = now_seconds() - start;
+    start = now_seconds();
+    size_t boxed_truthy_count = 0;
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (size_t i = 0; i < n; ++i) {
+            boxed_truthy_count += value_is_truthy(boxed_out[i]);
+        }
+    }
+    boxed_time = now_seconds() - start;
+    if (tagged_truthy_count != boxed_truthy_count) {
+        fprintf(stderr, "Different truthy counts: %zu and %zu\n", tagged_truthy_count, boxed_truthy_count);
+        return EXIT_FAILURE;
+    }
+    print_row("truthiness", tagged_time, boxed_time, n);
+
+    free_gc_heap(&heap);
+    free(tagged_ints);
+    free(tagged_floats);
+    free(tagged_mixed);
+    free(tagged_out);
+    free(boxed_ints);
+    free(boxed_floats);
+    free(boxed_mixed);
+    free(boxed_out);
+    return EXIT_SUCCESS;
+}
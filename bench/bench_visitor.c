@@ -0,0 +1,246 @@
+/**
+ * File Name: bench_visitor.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Runs the first N of eight small analyses over generated programs of every
+ * shape (see program_gen.h), once as N separate walks of the tree and once
+ * fused into a single walk, for N from 1 to 8, next to a walk that calls no
+ * hooks at all. The results of both ways are checked against each other.
+ *
+ * Usage: bench_visitor [--size=N[K|M|G]] [--iterations=N]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../src/include/lexer.h"
+#include "../src/include/parser.h"
+#include "../src/include/ast_visitor.h"
+#include "bench_util.h"
+#include "program_gen.h"
+
+#define PASS_COUNT 8
+
+//--------------------------------------- Analyses ----------------------------------------------------------------------------------
+
+/** What the analyses found; one field or two per pass. */
+typedef struct {
+    uint64_t exprs[EXPR_TYPE_COUNT];
+    uint64_t stmts[STMT_TYPE_COUNT];
+    uint64_t decls;
+    int64_t int_sum;
+    uint64_t name_hash;
+    size_t block_depth, max_block_depth;
+    uint64_t operators[TOKEN_INVALID + 1];
+    size_t expr_depth, max_expr_depth;
+    uint64_t loops, jumps;
+    uint64_t string_bytes;
+} results_t;
+
+static void count_expr(ast_expr_node_t *expr, void *context) {
+    ((results_t *)context)->exprs[expr->type]++;
+}
+
+static void count_stmt(ast_stmt_node_t *stmt, void *context) {
+    ((results_t *)context)->stmts[stmt->type]++;
+}
+
+static void count_decl(ast_decl_node_t *decl, void *context) {
+    (void)decl;
+    ((results_t *)context)->decls++;
+}
+
+static void sum_int(ast_expr_node_t *expr, void *context) {
+    ((results_t *)context)->int_sum += expr->data.literal_int->value;
+}
+
+static void hash_name(results_t *results, const char *name) {
+    uint64_t hash = results->name_hash ^ 0xcbf29ce484222325ULL;
+    for (const char *c = name; *c; ++c) {
+        hash = (hash ^ (unsigned char)*c) * 0x100000001b3ULL;
+    }
+    results->name_hash = hash;
+}
+
+static void hash_identifier(ast_expr_node_t *expr, void *context) {
+    hash_name(context, expr->data.identifier->name);
+}
+
+static void hash_call(ast_expr_node_t *expr, void *context) {
+    hash_name(context, expr->data.call->name);
+}
+
+static void hash_var_decl(ast_stmt_node_t *stmt, void *context) {
+    hash_name(context, stmt->data.var_decl->name);
+}
+
+static void hash_assign(ast_stmt_node_t *stmt, void *context) {
+    hash_name(context, stmt->data.assign->name);
+}
+
+static void enter_block(ast_stmt_node_t *stmt, void *context) {
+    (void)stmt;
+    results_t *results = context;
+    if (++results->block_depth > results->max_block_depth) results->max_block_depth = results->block_depth;
+}
+
+static void leave_block(ast_stmt_node_t *stmt, void *context) {
+    (void)stmt;
+    ((results_t *)context)->block_depth--;
+}
+
+static void count_operator(ast_expr_node_t *expr, void *context) {
+    ((results_t *)context)->operators[expr->data.binary->operator]++;
+}
+
+static void enter_expr(ast_expr_node_t *expr, void *context) {
+    (void)expr;
+    results_t *results = context;
+    if (++results->expr_depth > results->max_expr_depth) results->max_expr_depth = results->expr_depth;
+}
+
+static void leave_expr(ast_expr_node_t *expr, void *context) {
+    (void)expr;
+    ((results_t *)context)->expr_depth--;
+}
+
+static void count_loop(ast_stmt_node_t *stmt, void *context) {
+    (void)stmt;
+    ((results_t *)context)->loops++;
+}
+
+static void count_jump(ast_stmt_node_t *stmt, void *context) {
+    (void)stmt;
+    ((results_t *)context)->jumps++;
+}
+
+static void measure_string(ast_expr_node_t *expr, void *context) {
+    ((results_t *)context)->string_bytes += strlen(expr->data.literal_string->value);
+}
+
+static void make_passes(ast_pass_t passes[PASS_COUNT], results_t *results) {
+    memset(passes, 0, sizeof(ast_pass_t) * PASS_COUNT);
+    for (int i = 0; i < PASS_COUNT; ++i) passes[i].context = results;
+
+    passes[0].name = "count nodes";
+    passes[0].pre_expr = count_expr;
+    passes[0].pre_stmt = count_stmt;
+    passes[0].pre_decl = count_decl;
+
+    passes[1].name = "sum ints";
+    passes[1].pre_literal_int = sum_int;
+
+    passes[2].name = "hash names";
+    passes[2].pre_identifier = hash_identifier;
+    passes[2].pre_call = hash_call;
+    passes[2].pre_var_decl = hash_var_decl;
+    passes[2].pre_assign = hash_assign;
+
+    passes[3].name = "block depth";
+    passes[3].pre_block_stmt = enter_block;
+    passes[3].post_block_stmt = leave_block;
+
+    passes[4].name = "operators";
+    passes[4].pre_binary = count_operator;
+
+    passes[5].name = "expression depth";
+    passes[5].pre_expr = enter_expr;
+    passes[5].post_expr = leave_expr;
+
+    passes[6].name = "loops";
+    passes[6].pre_while_stmt = count_loop;
+    passes[6].pre_for_stmt = count_loop;
+    passes[6].pre_break_stmt = count_jump;
+    passes[6].pre_continue_stmt = count_jump;
+
+    passes[7].name = "strings";
+    passes[7].pre_literal_string = measure_string;
+}
+
+//--------------------------------------- Timing ------------------------------------------------------------------------------------
+
+/** Seconds per run of the first `count` passes, fused into one walk or one walk each. */
+static double time_passes(ast_t *ast, int count, bool fused, int iterations, results_t *results) {
+    ast_pass_t passes[PASS_COUNT];
+    make_passes(passes, results);
+
+    ast_visitor_t *visitors[PASS_COUNT];
+    int visitor_count = fused ? 1 : count;
+    for (int i = 0; i < visitor_count; ++i) visitors[i] = init_ast_visitor();
+    for (int i = 0; i < count; ++i) ast_visitor_add_pass(visitors[fused ? 0 : i], &passes[i]);
+
+    double start = now_seconds();
+    for (int run = 0; run < iterations; ++run) {
+        memset(results, 0, sizeof(results_t));
+        for (int i = 0; i < visitor_count; ++i) ast_visitor_walk(visitors[i], ast);
+    }
+    double elapsed = (now_seconds() - start) / iterations;
+
+    for (int i = 0; i < visitor_count; ++i) free_ast_visitor(visitors[i]);
+    return elapsed;
+}
+
+static bool bench(const char *name, const char *source, size_t length, int iterations) {
+    parser_t *parser = parse_source(name, source, length);
+    ast_t *ast = parser->ast;
+
+    results_t results;
+    double empty = time_passes(ast, 0, true, iterations, &results);
+    printf("  %-20s %6s %10.2f %10s %10s %8s\n", name, "none", empty * 1e3, "", "", "");
+
+    bool ok = true;
+    for (int count = 1; count <= PASS_COUNT; ++count) {
+        results_t separate_results, fused_results;
+        double separate = time_passes(ast, count, false, iterations, &separate_results);
+        double fused = time_passes(ast, count, true, iterations, &fused_results);
+        if (memcmp(&separate_results, &fused_results, sizeof(results_t)) != 0) {
+            fprintf(stderr, "%s: %d fused passes found other results than separate walks\n", name, count);
+            ok = false;
+        }
+        printf("  %-20s %6d %10.2f %10.2f %10.2f %7.2fx\n", name, count, empty * 1e3, separate * 1e3, fused * 1e3,
+            separate / fused);
+    }
+
+    free_lexer(parser->lexer);
+    free_parser(parser);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    size_t size = 4 * 1024 * 1024;
+    int iterations = 3;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--size=", 7) == 0) {
+            if (!parse_size(argv[i] + 7, &size)) {
+                fprintf(stderr, "Invalid size: %s\n", argv[i] + 7);
+                return EXIT_FAILURE;
+            }
+        } else if (strncmp(argv[i], "--iterations=", 13) == 0) {
+            iterations = atoi(argv[i] + 13);
+            if (iterations <= 0) iterations = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--size=N[K|M|G]] [--iterations=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("  %-20s %6s %10s %10s %10s %8s\n", "program", "passes", "walk ms", "separate", "fused", "speedup");
+    for (int shape = 0; shape < PROGRAM_SHAPE_COUNT; ++shape) {
+        program_gen_config_t config;
+        program_gen_default_config(&config, (program_shape_t)shape, size);
+        size_t length;
+        char *source = generate_program(&config, &length);
+        char name[64];
+        char size_text[32];
+        format_size(size, size_text, sizeof(size_text));
+        snprintf(name, sizeof(name), "%s/%s", program_shape_to_string((program_shape_t)shape), size_text);
+        bool ok = bench(name, source, length, iterations);
+        free(source);
+        if (!ok) return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
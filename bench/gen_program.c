@@ -0,0 +1,101 @@
+/**
+ * File Name: gen_program.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Writes a synthetic jff program, see program_gen.h.
+ *
+ * Usage: gen_program [--shape=NAME] [--size=N[K|M|G]] [--seed=N]
+ *                    [--depth=N] [--elifs=N] [--args=N] [--statements=N] [-o FILE]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "program_gen.h"
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [options]\n", program);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --shape=NAME        mixed, deep-expr, elif-chain, many-functions or wide-args (default mixed)\n");
+    fprintf(stderr, "  --size=N[K|M|G]     approximate program size in bytes (default 64K)\n");
+    fprintf(stderr, "  --seed=N            random seed (default 1)\n");
+    fprintf(stderr, "  --depth=N           expression nesting depth\n");
+    fprintf(stderr, "  --elifs=N           elif branches per if statement\n");
+    fprintf(stderr, "  --args=N            parameters per function for wide-args\n");
+    fprintf(stderr, "  --statements=N      statements per function\n");
+    fprintf(stderr, "  -o FILE             write to FILE instead of stdout\n");
+}
+
+static bool parse_count(const char *text, size_t *count) {
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text || *end != '\0') return false;
+    *count = (size_t)value;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    program_shape_t shape = PROGRAM_SHAPE_MIXED;
+    size_t size = 64 * 1024;
+    const char *output = NULL;
+
+    // The shape decides the defaults, so find it before anything else.
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--shape=", 8) == 0 && !program_shape_from_string(argv[i] + 8, &shape)) {
+            fprintf(stderr, "Unknown shape: %s\n", argv[i] + 8);
+            return EXIT_FAILURE;
+        }
+    }
+    program_gen_config_t config;
+    program_gen_default_config(&config, shape, size);
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        size_t seed;
+        bool ok = true;
+        if (strncmp(arg, "--shape=", 8) == 0) {
+            continue;
+        } else if (strncmp(arg, "--size=", 7) == 0) {
+            ok = parse_size(arg + 7, &config.target_size);
+        } else if (strncmp(arg, "--seed=", 7) == 0) {
+            ok = parse_count(arg + 7, &seed);
+            config.seed = seed;
+        } else if (strncmp(arg, "--depth=", 8) == 0) {
+            ok = parse_count(arg + 8, &config.max_depth);
+        } else if (strncmp(arg, "--elifs=", 8) == 0) {
+            ok = parse_count(arg + 8, &config.elif_count);
+        } else if (strncmp(arg, "--args=", 7) == 0) {
+            ok = parse_count(arg + 7, &config.arg_count);
+        } else if (strncmp(arg, "--statements=", 13) == 0) {
+            ok = parse_count(arg + 13, &config.statements_per_function);
+        } else if (strcmp(arg, "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (config.max_depth == 0) config.max_depth = 1;
+
+    size_t length;
+    char *program = generate_program(&config, &length);
+
+    FILE *file = output ? fopen(output, "wb") : stdout;
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", output);
+        free(program);
+        return EXIT_FAILURE;
+    }
+    size_t written = fwrite(program, 1, length, file);
+    if (output) fclose(file);
+    free(program);
+    if (written != length) {
+        fprintf(stderr, "Error writing program\n");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
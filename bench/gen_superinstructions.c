@@ -0,0 +1,244 @@
+/**
+ * File Name: gen_superinstructions.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Picks the superinstructions of the VM from opcode profiles, the files
+ * `main --profile-opcodes` and `bench_dispatch --profile` write, and prints
+ * them as src/include/superinstructions.h. The profiles should come from
+ * code compiled with --no-superinstructions, so every sequence is counted.
+ *
+ * Sequences are chosen greedily by the dispatches they would save on the
+ * profiled runs: a triple saves two per run, a pair one, minus what the
+ * sequences already chosen save on the same runs. Only sequences the VM
+ * can fuse are considered, see opcode_fusible().
+ *
+ * Usage: gen_superinstructions [--max=N] [--min-share=PERCENT] [-o FILE] PROFILE...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "../src/include/opcode.h"
+
+#define DEFAULT_MAX 24              /**< Superinstructions generated at most */
+#define DEFAULT_MIN_SHARE 0.25      /**< Percent of all dispatches one must save to be generated */
+
+typedef struct {
+    uint64_t total;
+    uint64_t pairs[OP_PLAIN_COUNT][OP_PLAIN_COUNT];
+    uint64_t triples[OP_PLAIN_COUNT][OP_PLAIN_COUNT][OP_PLAIN_COUNT];
+} counts_t;
+
+typedef struct {
+    opcode_t ops[OP_MAX_COMPONENTS];
+    size_t length;
+    uint64_t saved;
+} choice_t;
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [options] PROFILE...\n", program);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --max=N             superinstructions to generate at most (default %d)\n", DEFAULT_MAX);
+    fprintf(stderr, "  --min-share=PERCENT skip sequences saving less of all dispatches (default %g)\n", DEFAULT_MIN_SHARE);
+    fprintf(stderr, "  -o FILE             write to FILE instead of stdout\n");
+}
+
+static bool opcode_from_string(const char *name, opcode_t *op) {
+    for (int i = 0; i < OP_PLAIN_COUNT; ++i) {
+        if (strcmp(opcode_to_string((opcode_t)i), name) == 0) {
+            *op = (opcode_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Adds the counts of one profile. Dispatch lines are skipped, and so
+ * are sequences of opcodes this build does not know.
+ */
+static bool read_profile(const char *path, counts_t *counts) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Error opening profile: %s\n", path);
+        return false;
+    }
+    char line[256];
+    size_t number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        number++;
+        char kind[16], names[OP_MAX_COMPONENTS][64];
+        unsigned long long count;
+        int fields = sscanf(line, "%15s %llu %63s %63s %63s", kind, &count, names[0], names[1], names[2]);
+        if (fields < 2) {
+            fprintf(stderr, "%s:%zu: malformed line\n", path, number);
+            fclose(file);
+            return false;
+        }
+        size_t length = strcmp(kind, "pair") == 0 ? 2 : strcmp(kind, "triple") == 0 ? 3 : 0;
+        if (strcmp(kind, "total") == 0) {
+            counts->total += count;
+            continue;
+        }
+        if (length == 0) continue;
+        if (fields != 2 + (int)length) {
+            fprintf(stderr, "%s:%zu: malformed line\n", path, number);
+            fclose(file);
+            return false;
+        }
+        opcode_t ops[OP_MAX_COMPONENTS];
+        bool known = true;
+        for (size_t k = 0; k < length; ++k) {
+            known = known && opcode_from_string(names[k], &ops[k]);
+        }
+        if (!known) continue;
+        if (length == 2) {
+            counts->pairs[ops[0]][ops[1]] += count;
+        } else {
+            counts->triples[ops[0]][ops[1]][ops[2]] += count;
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static bool fusible(const opcode_t *ops, size_t length) {
+    for (size_t k = 0; k < length; ++k) {
+        if (!opcode_fusible(ops[k], k, length)) return false;
+    }
+    return true;
+}
+
+static bool chosen(const choice_t *choices, size_t count, const opcode_t *ops, size_t length) {
+    for (size_t i = 0; i < count; ++i) {
+        if (choices[i].length == length && memcmp(choices[i].ops, ops, length * sizeof(opcode_t)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Dispatches choosing `ops` would save on top of `choices`. The
+ * compiler fuses the longest sequence, so a triple takes over the runs of
+ * its leading pair, and a pair keeps the runs no chosen triple starts with.
+ */
+static uint64_t gain(const counts_t *counts, const choice_t *choices, size_t count, const opcode_t *ops, size_t length) {
+    if (length == 3) {
+        uint64_t runs = counts->triples[ops[0]][ops[1]][ops[2]];
+        return chosen(choices, count, ops, 2) ? runs : 2 * runs;
+    }
+    uint64_t runs = counts->pairs[ops[0]][ops[1]];
+    for (size_t i = 0; i < count; ++i) {
+        if (choices[i].length == 3 && choices[i].ops[0] == ops[0] && choices[i].ops[1] == ops[1]) {
+            uint64_t covered = counts->triples[ops[0]][ops[1]][choices[i].ops[2]];
+            runs = runs > covered ? runs - covered : 0;
+        }
+    }
+    return runs;
+}
+
+static void write_header(FILE *out, const counts_t *counts, const choice_t *choices, size_t count, int profiles) {
+    fprintf(out, "/**\n");
+    fprintf(out, " * File Name: superinstructions.h\n");
+    fprintf(out, " * Author: Vishank Singh\n");
+    fprintf(out, " * Github: https://github.com/VishankSingh\n");
+    fprintf(out, " *\n");
+    fprintf(out, " * Generated by bench/gen_superinstructions from opcode profiles, see the\n");
+    fprintf(out, " * README. Included with SUPERINSTRUCTION(name, first, second, third)\n");
+    fprintf(out, " * defined; the third component is OP_COUNT for a pair.\n");
+    fprintf(out, " *\n");
+    fprintf(out, " * %d profile%s, %" PRIu64 " dispatches. Share of them each sequence saves:\n",
+        profiles, profiles == 1 ? "" : "s", counts->total);
+    fprintf(out, " */\n");
+    for (size_t i = 0; i < count; ++i) {
+        char name[128] = "OP";
+        for (size_t k = 0; k < choices[i].length; ++k) {
+            strcat(name, "_");
+            strcat(name, opcode_to_string(choices[i].ops[k]));
+        }
+        fprintf(out, "SUPERINSTRUCTION(%s, OP_%s, OP_%s, %s%s)", name, opcode_to_string(choices[i].ops[0]),
+            opcode_to_string(choices[i].ops[1]), choices[i].length == 3 ? "OP_" : "",
+            choices[i].length == 3 ? opcode_to_string(choices[i].ops[2]) : "OP_COUNT");
+        fprintf(out, " // %.2f%%\n", counts->total ? 100.0 * (double)choices[i].saved / (double)counts->total : 0.0);
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t max = DEFAULT_MAX;
+    double min_share = DEFAULT_MIN_SHARE;
+    const char *output = NULL;
+    counts_t *counts = calloc(1, sizeof(counts_t));
+    if (!counts) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+
+    int profiles = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--max=", 6) == 0) {
+            max = (size_t)strtoul(argv[i] + 6, NULL, 10);
+        } else if (strncmp(argv[i], "--min-share=", 12) == 0) {
+            min_share = strtod(argv[i] + 12, NULL);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (argv[i][0] == '-') {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            if (!read_profile(argv[i], counts)) return EXIT_FAILURE;
+            profiles++;
+        }
+    }
+    if (profiles == 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // An opcode byte holds every plain opcode and every superinstruction.
+    if (max > 255 - OP_PLAIN_COUNT) max = 255 - OP_PLAIN_COUNT;
+    choice_t *choices = calloc(max ? max : 1, sizeof(choice_t));
+    if (!choices) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    size_t count = 0;
+    uint64_t threshold = (uint64_t)((double)counts->total * min_share / 100.0);
+    while (count < max) {
+        choice_t best = { { OP_COUNT, OP_COUNT, OP_COUNT }, 0, 0 };
+        for (int a = 0; a < OP_PLAIN_COUNT; ++a) {
+            for (int b = 0; b < OP_PLAIN_COUNT; ++b) {
+                opcode_t ops[OP_MAX_COMPONENTS] = { (opcode_t)a, (opcode_t)b, OP_COUNT };
+                if (counts->pairs[a][b] == 0) continue;
+                if (fusible(ops, 2) && !chosen(choices, count, ops, 2)) {
+                    uint64_t saved = gain(counts, choices, count, ops, 2);
+                    if (saved > best.saved) best = (choice_t){ { ops[0], ops[1], OP_COUNT }, 2, saved };
+                }
+                for (int c = 0; c < OP_PLAIN_COUNT; ++c) {
+                    ops[2] = (opcode_t)c;
+                    if (counts->triples[a][b][c] == 0 || !fusible(ops, 3) || chosen(choices, count, ops, 3)) continue;
+                    uint64_t saved = gain(counts, choices, count, ops, 3);
+                    if (saved > best.saved) best = (choice_t){ { ops[0], ops[1], ops[2] }, 3, saved };
+                }
+            }
+        }
+        if (best.saved == 0 || best.saved < threshold) break;
+        choices[count++] = best;
+    }
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Error opening output file: %s\n", output);
+        return EXIT_FAILURE;
+    }
+    write_header(out, counts, choices, count, profiles);
+    if (output && fclose(out) != 0) {
+        perror("fclose");
+        return EXIT_FAILURE;
+    }
+    free(choices);
+    free(counts);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,720 @@
+/**
+ * File Name: program_gen.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Every emit_* function below produces one production of the `grammar`
+ * file. Only the parts the parser implements are used: no postfix
+ * assignments.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "program_gen.h"
+#include "../src/include/utils.h"
+
+typedef struct gen_struct {
+    const program_gen_config_t *config;
+
+    char *data;
+    size_t length;
+    size_t capacity;
+
+    uint64_t random_state;
+    size_t indent;
+
+    size_t *arity;              /**< Parameter count of every function emitted so far */
+    bool *is_async;
+    size_t function_count;
+    size_t function_capacity;
+    size_t global_count;
+
+    size_t param_count;         /**< Scope of the function being emitted */
+    size_t local_count;
+    size_t temp_count;
+    size_t block_depth;
+    size_t loop_depth;
+    size_t parallel_depth;
+    bool async_function;        /**< The function being emitted is async */
+} gen_t;
+
+static const char *binary_operators[] = {
+    "||", "&&", "==", "!=", "<", "<=", ">", ">=", "+", "-", "*", "/", "%"
+};
+#define BINARY_OPERATOR_COUNT (sizeof(binary_operators) / sizeof(binary_operators[0]))
+
+static const char *type_names[] = { "int", "float", "string", "bool" };
+#define TYPE_NAME_COUNT (sizeof(type_names) / sizeof(type_names[0]))
+
+static const char *assign_operators[] = { "=", "+=", "-=", "*=", "/=", "%=" };
+#define ASSIGN_OPERATOR_COUNT (sizeof(assign_operators) / sizeof(assign_operators[0]))
+
+//------------------------------------------------------------------------------
+// output
+//------------------------------------------------------------------------------
+
+static void reserve(gen_t *gen, size_t extra) {
+    if (gen->length + extra + 1 <= gen->capacity) return;
+    while (gen->length + extra + 1 > gen->capacity) {
+        gen->capacity += gen->capacity / 2;
+    }
+    gen->data = realloc(gen->data, gen->capacity);
+    CHECK_MEM_ALLOC_ERROR(gen->data);
+}
+
+static void emit_bytes(gen_t *gen, const char *text, size_t length) {
+    reserve(gen, length);
+    memcpy(gen->data + gen->length, text, length);
+    gen->length += length;
+}
+
+static void emit(gen_t *gen, const char *text) {
+    emit_bytes(gen, text, strlen(text));
+}
+
+static void emit_uint(gen_t *gen, uint64_t value) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    reserve(gen, count);
+    while (count) {
+        gen->data[gen->length++] = digits[--count];
+    }
+}
+
+static void emit_name(gen_t *gen, char prefix, size_t index) {
+    emit_bytes(gen, &prefix, 1);
+    emit_uint(gen, index);
+}
+
+static void emit_newline(gen_t *gen) {
+    reserve(gen, 1 + gen->indent * 4);
+    gen->data[gen->length++] = '\n';
+    memset(gen->data + gen->length, ' ', gen->indent * 4);
+    gen->length += gen->indent * 4;
+}
+
+//------------------------------------------------------------------------------
+// randomness
+//------------------------------------------------------------------------------
+
+static uint64_t next_random(gen_t *gen) {
+    // xorshift64*
+    uint64_t x = gen->random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    gen->random_state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t random_below(gen_t *gen, size_t bound) {
+    return bound ? (size_t)(next_random(gen) % bound) : 0;
+}
+
+static bool chance(gen_t *gen, unsigned percent) {
+    return random_below(gen, 100) < percent;
+}
+
+//------------------------------------------------------------------------------
+// expressions
+//------------------------------------------------------------------------------
+
+static void emit_expression(gen_t *gen, size_t depth);
+
+/**
+ * @brief Emits an IDENTIFIER that names a parameter, local or global in scope.
+ *
+ * @return false if nothing is in scope.
+ */
+static bool emit_variable(gen_t *gen) {
+    size_t total = gen->param_count + gen->local_count + gen->global_count;
+    if (total == 0) return false;
+    size_t pick = random_below(gen, total);
+    if (pick < gen->param_count) {
+        emit_name(gen, 'p', pick);
+    } else if (pick < gen->param_count + gen->local_count) {
+        emit_name(gen, 'v', pick - gen->param_count);
+    } else {
+        emit_name(gen, 'g', pick - gen->param_count - gen->local_count);
+    }
+    return true;
+}
+
+/**
+ * @brief The digits of `value` in base `1 << shift`, with a "_" between
+ * every `group` of them counted from the right, or none when `group` is 0.
+ */
+static void emit_digits(gen_t *gen, uint64_t value, unsigned shift, size_t group) {
+    char digits[128];
+    size_t count = 0;
+    size_t written = 0;
+    uint64_t mask = ((uint64_t)1 << shift) - 1;
+    do {
+        if (group && written && written % group == 0) digits[count++] = '_';
+        digits[count++] = "0123456789abcdef"[value & mask];
+        written++;
+        value >>= shift;
+    } while (value);
+    reserve(gen, count);
+    while (count) {
+        gen->data[gen->length++] = digits[--count];
+    }
+}
+
+/**
+ * @brief INTEGER or FLOAT, in each of the forms the lexer accepts.
+ */
+static void emit_number(gen_t *gen) {
+    switch (random_below(gen, 10)) {
+        case 0:
+            emit(gen, "0x");
+            emit_digits(gen, random_below(gen, 1u << 24), 4, chance(gen, 50) ? 4 : 0);
+            break;
+        case 1:
+            emit(gen, "0b");
+            emit_digits(gen, random_below(gen, 256), 1, chance(gen, 50) ? 4 : 0);
+            break;
+        case 2:
+            emit_uint(gen, 1 + random_below(gen, 999));
+            emit(gen, "_000");
+            break;
+        case 3:
+            emit_uint(gen, random_below(gen, 100));
+            emit(gen, ".");
+            emit_uint(gen, random_below(gen, 100));
+            if (chance(gen, 30)) {
+                emit(gen, chance(gen, 50) ? "e-" : "E+");
+                emit_uint(gen, random_below(gen, 20));
+            }
+            break;
+        case 4:
+            emit_uint(gen, 1 + random_below(gen, 9));
+            emit(gen, "e");
+            emit_uint(gen, random_below(gen, 10));
+            break;
+        default:
+            emit_uint(gen, random_below(gen, chance(gen, 80) ? 100 : 1000000));
+            break;
+    }
+}
+
+static void emit_literal(gen_t *gen) {
+    switch (random_below(gen, 8)) {
+        case 0:
+            emit(gen, "\"s");
+            emit_uint(gen, random_below(gen, 1000));
+            emit(gen, chance(gen, 20) ? "\\n\"" : "\"");
+            break;
+        case 1: emit(gen, "true"); break;
+        case 2: emit(gen, "false"); break;
+        case 3: emit(gen, "null"); break;
+        default: emit_number(gen); break;
+    }
+}
+
+/**
+ * @brief postfix ::= primary { "[" expression "]" }, with a literal or
+ * IDENTIFIER as the primary.
+ */
+static void emit_leaf(gen_t *gen) {
+    if (chance(gen, 50) && emit_variable(gen)) {
+        if (chance(gen, 10)) {
+            emit(gen, "[");
+            emit_number(gen);
+            emit(gen, "]");
+        }
+        return;
+    }
+    emit_literal(gen);
+}
+
+static void emit_arg_list(gen_t *gen, size_t count, size_t depth) {
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) emit(gen, ", ");
+        emit_expression(gen, depth);
+    }
+}
+
+/**
+ * @brief primary ::= IDENTIFIER "(" [ arg_list ] ")"
+ *
+ * Only functions emitted earlier are called, with their declared arity,
+ * and no async ones inside a parallel for.
+ */
+static bool emit_call(gen_t *gen, size_t depth) {
+    if (gen->function_count == 0) return false;
+    size_t function = gen->function_count - 1 - random_below(gen, gen->function_count < 16 ? gen->function_count : 16);
+    if (gen->is_async[function] && gen->parallel_depth > 0) return false;
+    emit_name(gen, 'f', function);
+    emit(gen, "(");
+    emit_arg_list(gen, gen->arity[function], depth);
+    emit(gen, ")");
+    return true;
+}
+
+/**
+ * @brief expression ::= logical_or, with the operator levels chosen at random.
+ *
+ * Operands of unary operators are never themselves unary, so `-` `-` never
+ * lexes as `--`.
+ */
+static void emit_expression(gen_t *gen, size_t depth) {
+    if (depth == 0) {
+        emit_leaf(gen);
+        return;
+    }
+    size_t roll = random_below(gen, 100);
+    if (roll < 45) {
+        emit_expression(gen, depth - 1);
+        emit(gen, " ");
+        emit(gen, binary_operators[random_below(gen, BINARY_OPERATOR_COUNT)]);
+        emit(gen, " ");
+        emit_expression(gen, depth - 1);
+    } else if (roll < 55) {
+        emit(gen, chance(gen, 50) ? "!" : "-");
+        if (chance(gen, 50)) {
+            emit_leaf(gen);
+        } else {
+            emit(gen, "(");
+            emit_expression(gen, depth - 1);
+            emit(gen, ")");
+        }
+    } else if (roll < 70) {
+        emit(gen, "(");
+        emit_expression(gen, depth - 1);
+        emit(gen, ")");
+    } else if (roll < 85) {
+        // unary ::= "await" unary, only in async functions and outside a parallel for
+        bool await = gen->async_function && gen->parallel_depth == 0 && chance(gen, 30);
+        if (await) emit(gen, "await ");
+        if (!emit_call(gen, depth - 1)) {
+            if (await) emit(gen, "(");
+            emit_leaf(gen);
+            if (await) emit(gen, ")");
+        }
+    } else {
+        emit_leaf(gen);
+    }
+}
+
+/**
+ * @brief An expression exactly `depth` parentheses deep.
+ */
+static void emit_deep_expression(gen_t *gen, size_t depth) {
+    for (size_t i = 0; i < depth; ++i) {
+        emit(gen, "(");
+        if (chance(gen, 50)) {
+            emit_leaf(gen);
+            emit(gen, " ");
+            emit(gen, binary_operators[random_below(gen, BINARY_OPERATOR_COUNT)]);
+            emit(gen, " ");
+        }
+    }
+    emit_leaf(gen);
+    for (size_t i = 0; i < depth; ++i) {
+        emit(gen, " ");
+        emit(gen, binary_operators[random_below(gen, BINARY_OPERATOR_COUNT)]);
+        emit(gen, " ");
+        emit_leaf(gen);
+        emit(gen, ")");
+    }
+}
+
+static void emit_shaped_expression(gen_t *gen) {
+    if (gen->config->shape == PROGRAM_SHAPE_DEEP_EXPR) {
+        emit_deep_expression(gen, gen->config->max_depth);
+    } else {
+        emit_expression(gen, 1 + random_below(gen, gen->config->max_depth));
+    }
+}
+
+//------------------------------------------------------------------------------
+// statements
+//------------------------------------------------------------------------------
+
+static void emit_statement(gen_t *gen);
+
+/**
+ * @brief block ::= "{" { statement } "}"
+ */
+static void emit_block(gen_t *gen, size_t statements) {
+    emit(gen, "{");
+    gen->indent++;
+    gen->block_depth++;
+    for (size_t i = 0; i < statements; ++i) {
+        emit_newline(gen);
+        emit_statement(gen);
+    }
+    gen->block_depth--;
+    gen->indent--;
+    emit_newline(gen);
+    emit(gen, "}");
+}
+
+/**
+ * @brief var_decl ::= IDENTIFIER ":" type "=" expression
+ *
+ * Declarations at function body level are visible to the rest of the body;
+ * those in nested blocks get names nothing refers to. Arrays are created
+ * with int_array() or float_array().
+ */
+static void emit_var_decl(gen_t *gen) {
+    if (gen->block_depth == 0) {
+        emit_name(gen, 'v', gen->local_count);
+    } else {
+        emit_name(gen, 't', gen->temp_count++);
+    }
+    if (chance(gen, 10)) {
+        const char *element = chance(gen, 50) ? "int" : "float";
+        emit(gen, " : ");
+        emit(gen, element);
+        emit(gen, "[] = ");
+        emit(gen, element);
+        emit(gen, "_array(");
+        emit_uint(gen, 1 + random_below(gen, 64));
+        emit(gen, ")");
+    } else {
+        emit(gen, " : ");
+        emit(gen, type_names[random_below(gen, TYPE_NAME_COUNT)]);
+        emit(gen, " = ");
+        emit_shaped_expression(gen);
+    }
+    if (gen->block_depth == 0) {
+        gen->local_count++;
+    }
+}
+
+/**
+ * @brief if ( expression ) block { elif ( expression ) block } [ else block ]
+ */
+static void emit_if(gen_t *gen, size_t elifs) {
+    size_t statements = gen->block_depth < 3 ? 1 + random_below(gen, 2) : 0;
+    emit(gen, "if (");
+    emit_shaped_expression(gen);
+    emit(gen, ") ");
+    emit_block(gen, statements);
+    for (size_t i = 0; i < elifs; ++i) {
+        emit_newline(gen);
+        emit(gen, "elif (");
+        if (gen->config->shape == PROGRAM_SHAPE_ELIF_CHAIN && gen->param_count > 0) {
+            emit(gen, "p0 == ");
+            emit_uint(gen, i);
+        } else {
+            emit_shaped_expression(gen);
+        }
+        emit(gen, ") ");
+        emit_block(gen, gen->block_depth < 3 ? 1 : 0);
+    }
+    if (chance(gen, 50)) {
+        emit(gen, " else ");
+        emit_block(gen, statements);
+    }
+}
+
+static void emit_statement(gen_t *gen) {
+    bool nested = gen->block_depth < 3;
+    switch (random_below(gen, nested ? 12 : 8)) {
+        case 0:
+        case 1:
+            emit_var_decl(gen);
+            emit(gen, ";");
+            return;
+        case 2:
+        case 3:
+            // assignment ::= IDENTIFIER [ "[" expression "]" ] assign_op expression
+            if (emit_variable(gen)) {
+                if (chance(gen, 20)) {
+                    emit(gen, "[");
+                    emit_expression(gen, 1);
+                    emit(gen, "]");
+                }
+                emit(gen, " ");
+                emit(gen, assign_operators[chance(gen, 70) ? 0 : random_below(gen, ASSIGN_OPERATOR_COUNT)]);
+                emit(gen, " ");
+                emit_shaped_expression(gen);
+            } else {
+                emit_var_decl(gen);
+            }
+            emit(gen, ";");
+            return;
+        case 4:
+            emit(gen, "print(");
+            emit_arg_list(gen, 1 + random_below(gen, 3), 1);
+            emit(gen, ");");
+            return;
+        case 5:
+            if (gen->loop_depth > 0) {
+                emit(gen, chance(gen, 50) ? "break;" : "continue;");
+                return;
+            }
+            emit(gen, "return");
+            if (chance(gen, 80)) {
+                emit(gen, " ");
+                emit_shaped_expression(gen);
+            }
+            emit(gen, ";");
+            return;
+        case 6:
+        case 7:
+            // expression ";"
+            if (!emit_call(gen, 1)) emit_shaped_expression(gen);
+            emit(gen, ";");
+            return;
+        case 8:
+        case 9:
+            emit_if(gen, random_below(gen, 3));
+            return;
+        case 10:
+            emit(gen, "while (");
+            emit_shaped_expression(gen);
+            emit(gen, ") ");
+            gen->loop_depth++;
+            emit_block(gen, 1 + random_below(gen, 3));
+            gen->loop_depth--;
+            return;
+        default: {
+            // [ "parallel" ] "for" "(" var_decl ";" expression ";" assignment ")" block
+            bool parallel = gen->parallel_depth == 0 && chance(gen, 20);
+            size_t index = gen->temp_count++;
+            emit(gen, parallel ? "parallel for (" : "for (");
+            emit_name(gen, 't', index);
+            emit(gen, " : int = 0; ");
+            emit_name(gen, 't', index);
+            emit(gen, " < ");
+            emit_uint(gen, 1 + random_below(gen, 100));
+            emit(gen, "; ");
+            emit_name(gen, 't', index);
+            emit(gen, " += 1) ");
+            gen->loop_depth++;
+            gen->parallel_depth += parallel;
+            emit_block(gen, 1 + random_below(gen, 3));
+            gen->parallel_depth -= parallel;
+            gen->loop_depth--;
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// declarations
+//------------------------------------------------------------------------------
+
+/**
+ * @brief function_decl ::= [ "async" ] "func" IDENTIFIER "(" [ param_list ] ")" ":" type "{" { statement } "}"
+ */
+static void emit_function(gen_t *gen) {
+    const program_gen_config_t *config = gen->config;
+    size_t params;
+    switch (config->shape) {
+        case PROGRAM_SHAPE_WIDE_ARGS:       params = config->arg_count; break;
+        case PROGRAM_SHAPE_ELIF_CHAIN:      params = 1 + random_below(gen, 2); break;
+        case PROGRAM_SHAPE_MANY_FUNCTIONS:  params = random_below(gen, 3); break;
+        default:                            params = random_below(gen, 5); break;
+    }
+
+    bool async = config->shape == PROGRAM_SHAPE_MIXED && chance(gen, 10);
+    emit(gen, async ? "async func " : "func ");
+    emit_name(gen, 'f', gen->function_count);
+    emit(gen, "(");
+    for (size_t i = 0; i < params; ++i) {
+        if (i > 0) emit(gen, ", ");
+        emit_name(gen, 'p', i);
+        emit(gen, " : ");
+        if (i > 0 && config->shape == PROGRAM_SHAPE_MIXED && chance(gen, 10)) {
+            emit(gen, chance(gen, 50) ? "int[]" : "float[]");
+        } else {
+            emit(gen, type_names[i == 0 ? 0 : random_below(gen, TYPE_NAME_COUNT)]);
+        }
+    }
+    emit(gen, ") : ");
+    emit(gen, chance(gen, 20) ? "void" : type_names[random_below(gen, TYPE_NAME_COUNT)]);
+    emit(gen, " {");
+
+    gen->param_count = params;
+    gen->async_function = async;
+    gen->local_count = 0;
+    gen->temp_count = 0;
+    gen->indent = 1;
+
+    size_t statements = config->statements_per_function;
+    for (size_t i = 0; i < statements; ++i) {
+        emit_newline(gen);
+        switch (config->shape) {
+            case PROGRAM_SHAPE_ELIF_CHAIN:
+                emit_if(gen, config->elif_count);
+                break;
+            case PROGRAM_SHAPE_WIDE_ARGS:
+                if (i == 0 && gen->function_count > 0) {
+                    emit(gen, "return ");
+                    emit_call(gen, 0);
+                    emit(gen, ";");
+                } else {
+                    emit(gen, "print(");
+                    emit_arg_list(gen, config->arg_count, 0);
+                    emit(gen, ");");
+                }
+                break;
+            case PROGRAM_SHAPE_MANY_FUNCTIONS:
+                emit(gen, "return ");
+                emit_expression(gen, 1);
+                emit(gen, ";");
+                break;
+            default:
+                emit_statement(gen);
+                break;
+        }
+    }
+
+    gen->indent = 0;
+    emit_newline(gen);
+    emit(gen, "}");
+    emit_newline(gen);
+    emit_newline(gen);
+
+    gen->param_count = 0;
+    gen->async_function = false;
+    gen->local_count = 0;
+    if (gen->function_count >= gen->function_capacity) {
+        gen->function_capacity *= 2;
+        gen->arity = realloc(gen->arity, gen->function_capacity * sizeof(size_t));
+        CHECK_MEM_ALLOC_ERROR(gen->arity);
+        gen->is_async = realloc(gen->is_async, gen->function_capacity * sizeof(bool));
+        CHECK_MEM_ALLOC_ERROR(gen->is_async);
+    }
+    gen->is_async[gen->function_count] = async;
+    gen->arity[gen->function_count++] = params;
+}
+
+/**
+ * @brief declaration ::= var_decl ";", at the top level.
+ */
+static void emit_global(gen_t *gen) {
+    emit_name(gen, 'g', gen->global_count);
+    emit(gen, " : ");
+    emit(gen, type_names[random_below(gen, TYPE_NAME_COUNT)]);
+    emit(gen, " = ");
+    emit_expression(gen, 2);
+    emit(gen, ";");
+    emit_newline(gen);
+    gen->global_count++;
+}
+
+//------------------------------------------------------------------------------
+// public interface
+//------------------------------------------------------------------------------
+
+void program_gen_default_config(program_gen_config_t *config, program_shape_t shape, size_t target_size) {
+    config->shape = shape;
+    config->target_size = target_size;
+    config->seed = 1;
+    config->max_depth = 3;
+    config->elif_count = 2;
+    config->arg_count = 4;
+    config->statements_per_function = 8;
+
+    switch (shape) {
+        case PROGRAM_SHAPE_DEEP_EXPR:
+            config->max_depth = 64;
+            config->statements_per_function = 4;
+            break;
+        case PROGRAM_SHAPE_ELIF_CHAIN:
+            config->elif_count = 32;
+            config->statements_per_function = 2;
+            break;
+        case PROGRAM_SHAPE_MANY_FUNCTIONS:
+            config->statements_per_function = 1;
+            break;
+        case PROGRAM_SHAPE_WIDE_ARGS:
+            config->arg_count = 32;
+            config->statements_per_function = 2;
+            break;
+        default:
+            break;
+    }
+}
+
+char *generate_program(const program_gen_config_t *config, size_t *length) {
+    gen_t gen = {0};
+    gen.config = config;
+    gen.capacity = config->target_size + 64 * 1024;
+    gen.data = malloc(gen.capacity);
+    CHECK_MEM_ALLOC_ERROR(gen.data);
+    gen.random_state = config->seed ? config->seed : 0x9E3779B97F4A7C15ULL;
+    gen.function_capacity = 64;
+    gen.arity = malloc(gen.function_capacity * sizeof(size_t));
+    CHECK_MEM_ALLOC_ERROR(gen.arity);
+    gen.is_async = malloc(gen.function_capacity * sizeof(bool));
+    CHECK_MEM_ALLOC_ERROR(gen.is_async);
+
+    do {
+        if (config->shape == PROGRAM_SHAPE_MIXED && chance(&gen, 10)) {
+            emit_global(&gen);
+        } else {
+            emit_function(&gen);
+        }
+    } while (gen.length < config->target_size);
+
+    free(gen.arity);
+    free(gen.is_async);
+    gen.data[gen.length] = '\0';
+    *length = gen.length;
+    return gen.data;
+}
+
+const char *program_shape_to_string(program_shape_t shape) {
+    switch (shape) {
+        case PROGRAM_SHAPE_MIXED:           return "mixed";
+        case PROGRAM_SHAPE_DEEP_EXPR:       return "deep-expr";
+        case PROGRAM_SHAPE_ELIF_CHAIN:      return "elif-chain";
+        case PROGRAM_SHAPE_MANY_FUNCTIONS:  return "many-functions";
+        case PROGRAM_SHAPE_WIDE_ARGS:       return "wide-args";
+        default:                            return "unknown";
+    }
+}
+
+bool program_shape_from_string(const char *text, program_shape_t *shape) {
+    for (int i = 0; i < PROGRAM_SHAPE_COUNT; ++i) {
+        if (strcmp(text, program_shape_to_string((program_shape_t)i)) == 0) {
+            *shape = (program_shape_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_size(const char *text, size_t *size) {
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) return false;
+    switch (toupper((unsigned char)*end)) {
+        case 'G': value <<= 10; // fall through
+        case 'M': value <<= 10; // fall through
+        case 'K': value <<= 10; end++; break;
+        case '\0': break;
+        default: return false;
+    }
+    if (*end == 'B' || *end == 'b') end++;
+    if (*end != '\0') return false;
+    *size = (size_t)value;
+    return true;
+}
+
+void format_size(size_t size, char *buffer, size_t buffer_size) {
+    static const char suffixes[] = "BKMG";
+    int unit = 0;
+    while (unit < 3 && size >= 1024 && size % 1024 == 0) {
+        size /= 1024;
+        unit++;
+    }
+    if (unit == 0) {
+        snprintf(buffer, buffer_size, "%zu", size);
+    } else {
+        snprintf(buffer, buffer_size, "%zu%c", size, suffixes[unit]);
+    }
+}
@@ -0,0 +1,64 @@
+/**
+ * File Name: program_gen.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Synthetic jff programs for benchmarking the front end. The generator
+ * walks the productions of the top-level `grammar` file, so every program
+ * it emits lexes and parses.
+ */
+#ifndef PROGRAM_GEN_H
+#define PROGRAM_GEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    PROGRAM_SHAPE_MIXED,            /**< A bit of everything, like hand written code */
+    PROGRAM_SHAPE_DEEP_EXPR,        /**< Parenthesized expressions nested max_depth levels deep */
+    PROGRAM_SHAPE_ELIF_CHAIN,       /**< if statements with elif_count elif branches */
+    PROGRAM_SHAPE_MANY_FUNCTIONS,   /**< Lots of one or two statement functions */
+    PROGRAM_SHAPE_WIDE_ARGS,        /**< Functions and calls with arg_count arguments */
+    PROGRAM_SHAPE_COUNT
+} program_shape_t;
+
+typedef struct program_gen_config_struct {
+    program_shape_t shape;
+    size_t target_size;             /**< Output stops at the first declaration boundary past this many bytes */
+    uint64_t seed;
+
+    size_t max_depth;               /**< Nesting of deep expressions */
+    size_t elif_count;              /**< Branches per elif chain */
+    size_t arg_count;               /**< Parameters per function for wide argument lists */
+    size_t statements_per_function;
+} program_gen_config_t;
+
+/**
+ * @brief Fills `config` with the defaults for `shape`.
+ */
+void program_gen_default_config(program_gen_config_t *config, program_shape_t shape, size_t target_size);
+
+/**
+ * @brief Generates a program.
+ *
+ * @param config What to generate.
+ * @param length Receives the number of bytes generated.
+ * @return A NUL terminated malloc'ed buffer.
+ */
+char *generate_program(const program_gen_config_t *config, size_t *length);
+
+const char *program_shape_to_string(program_shape_t shape);
+bool program_shape_from_string(const char *text, program_shape_t *shape);
+
+/**
+ * @brief Parses a byte count with an optional K, M or G suffix (powers of 1024).
+ */
+bool parse_size(const char *text, size_t *size);
+
+/**
+ * @brief Formats a byte count the way parse_size() reads it, e.g. "16M".
+ */
+void format_size(size_t size, char *buffer, size_t buffer_size);
+
+#endif // PROGRAM_GEN_H
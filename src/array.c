@@ -0,0 +1,400 @@
+/**
+ * File Name: array.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "include/array.h"
+#include "include/utils.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ARRAY_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+#define SUM_LANES 4     /**< Partial sums kept by every kernel, combined as (0 + 1) + (2 + 3) */
+
+size_t array_storage_bytes(size_t length) {
+    // aligned_alloc wants a multiple of the alignment; the padding also lets kernels read whole vectors.
+    size_t bytes = (length * sizeof(int64_t) + ARRAY_ALIGNMENT - 1) & ~(size_t)(ARRAY_ALIGNMENT - 1);
+    return bytes ? bytes : ARRAY_ALIGNMENT;
+}
+
+void array_init_storage(array_t *array, value_type_t element_type, size_t length) {
+    array->element_type = (uint8_t)element_type;
+    array->length = length;
+    size_t bytes = array_storage_bytes(length);
+    array->as.data = aligned_alloc(ARRAY_ALIGNMENT, bytes);
+    CHECK_MEM_ALLOC_ERROR(array->as.data);
+    memset(array->as.data, 0, bytes);
+}
+
+void array_free_storage(array_t *array) {
+    free(array->as.data);
+    array->as.data = NULL;
+}
+
+array_t *init_array(value_type_t element_type, size_t length) {
+    array_t *array = calloc(1, sizeof(array_t));
+    CHECK_MEM_ALLOC_ERROR(array);
+    array->object.kind = GC_ARRAY;
+    array_init_storage(array, element_type, length);
+    return array;
+}
+
+void free_array(array_t *array) {
+    if (array) {
+        array_free_storage(array);
+        free(array);
+    }
+}
+
+const char *array_type_to_string(const array_t *array) {
+    return array->element_type == VALUE_FLOAT ? "float[]" : "int[]";
+}
+
+//------------------------------------------------------------------------------
+// kernel selection
+//------------------------------------------------------------------------------
+
+static atomic_int selected_kernel = -1;
+
+static array_kernel_t supported_kernel(void) {
+#ifdef ARRAY_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return ARRAY_KERNEL_AVX2;
+    }
+    return ARRAY_KERNEL_SSE2;   // part of x86-64
+#else
+    return ARRAY_KERNEL_SCALAR;
+#endif
+}
+
+array_kernel_t array_kernel(void) {
+    int kernel = atomic_load_explicit(&selected_kernel, memory_order_relaxed);
+    if (kernel < 0) {
+        kernel = (int)supported_kernel();
+        atomic_store_explicit(&selected_kernel, kernel, memory_order_relaxed);
+    }
+    return (array_kernel_t)kernel;
+}
+
+void array_set_kernel(array_kernel_t kernel) {
+    array_kernel_t supported = supported_kernel();
+    atomic_store_explicit(&selected_kernel, (int)(kernel < supported ? kernel : supported), memory_order_relaxed);
+}
+
+const char *array_kernel_to_string(array_kernel_t kernel) {
+    switch (kernel) {
+        case ARRAY_KERNEL_SCALAR: return "scalar";
+        case ARRAY_KERNEL_SSE2:   return "sse2";
+        case ARRAY_KERNEL_AVX2:   return "avx2";
+        default:                  return "unknown";
+    }
+}
+
+//------------------------------------------------------------------------------
+// scalar kernels, also used for the tail the vector kernels leave
+//------------------------------------------------------------------------------
+
+static void int_elementwise_scalar(array_op_t op, const int64_t *a, size_t a_step, const int64_t *b, size_t b_step,
+    int64_t *out, size_t start, size_t length) {
+    for (size_t i = start; i < length; ++i) {
+        uint64_t x = (uint64_t)a[i * a_step], y = (uint64_t)b[i * b_step];
+        switch (op) {
+            case ARRAY_ADD: out[i] = (int64_t)(x + y); break;
+            case ARRAY_SUB: out[i] = (int64_t)(x - y); break;
+            default:        out[i] = (int64_t)(x * y); break;
+        }
+    }
+}
+
+static void float_elementwise_scalar(array_op_t op, const double *a, size_t a_step, const double *b, size_t b_step,
+    double *out, size_t start, size_t length) {
+    for (size_t i = start; i < length; ++i) {
+        double x = a[i * a_step], y = b[i * b_step];
+        switch (op) {
+            case ARRAY_ADD: out[i] = x + y; break;
+            case ARRAY_SUB: out[i] = x - y; break;
+            case ARRAY_MUL: out[i] = x * y; break;
+            case ARRAY_DIV: out[i] = x / y; break;
+        }
+    }
+}
+
+/**
+ * @brief Finishes a lane-wise float sum: combines the lanes, then adds the
+ * elements from `start` on in order. `b` NULL sums `a`, otherwise a[i] * b[i].
+ */
+static double float_sum_finish(const double lanes[SUM_LANES], const double *a, const double *b, size_t start, size_t length) {
+    double total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (size_t i = start; i < length; ++i) {
+        total += b ? a[i] * b[i] : a[i];
+    }
+    return total;
+}
+
+static uint64_t int_sum_finish(const uint64_t lanes[SUM_LANES], const int64_t *a, const int64_t *b, size_t start, size_t length) {
+    uint64_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (size_t i = start; i < length; ++i) {
+        total += b ? (uint64_t)a[i] * (uint64_t)b[i] : (uint64_t)a[i];
+    }
+    return total;
+}
+
+static double float_sum_scalar(const double *a, const double *b, size_t length) {
+    double lanes[SUM_LANES] = { 0 };
+    size_t i = 0;
+    for (; i + SUM_LANES <= length; i += SUM_LANES) {
+        for (size_t k = 0; k < SUM_LANES; ++k) {
+            lanes[k] += b ? a[i + k] * b[i + k] : a[i + k];
+        }
+    }
+    return float_sum_finish(lanes, a, b, i, length);
+}
+
+static uint64_t int_sum_scalar(const int64_t *a, const int64_t *b, size_t length) {
+    uint64_t lanes[SUM_LANES] = { 0 };
+    return int_sum_finish(lanes, a, b, 0, length);
+}
+
+#ifdef ARRAY_X86_KERNELS
+
+//------------------------------------------------------------------------------
+// SSE2 kernels
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Low 64 bits of a 64 x 64 bit product; SSE2 and AVX2 only multiply 32 bit halves.
+ */
+static inline __m128i mullo_epi64_sse2(__m128i a, __m128i b) {
+    __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b), _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+    return _mm_add_epi64(_mm_mul_epu32(a, b), _mm_slli_epi64(cross, 32));
+}
+
+static void int_elementwise_sse2(array_op_t op, const int64_t *a, size_t a_step, const int64_t *b, size_t b_step,
+    int64_t *out, size_t length) {
+    __m128i a_scalar = _mm_set1_epi64x(a[0]), b_scalar = _mm_set1_epi64x(b[0]);
+    size_t i = 0;
+    for (; i + 2 <= length; i += 2) {
+        __m128i x = a_step ? _mm_loadu_si128((const __m128i *)(a + i)) : a_scalar;
+        __m128i y = b_step ? _mm_loadu_si128((const __m128i *)(b + i)) : b_scalar;
+        __m128i r;
+        switch (op) {
+            case ARRAY_ADD: r = _mm_add_epi64(x, y); break;
+            case ARRAY_SUB: r = _mm_sub_epi64(x, y); break;
+            default:        r = mullo_epi64_sse2(x, y); break;
+        }
+        _mm_storeu_si128((__m128i *)(out + i), r);
+    }
+    int_elementwise_scalar(op, a, a_step, b, b_step, out, i, length);
+}
+
+static void float_elementwise_sse2(array_op_t op, const double *a, size_t a_step, const double *b, size_t b_step,
+    double *out, size_t length) {
+    __m128d a_scalar = _mm_set1_pd(a[0]), b_scalar = _mm_set1_pd(b[0]);
+    size_t i = 0;
+    for (; i + 2 <= length; i += 2) {
+        __m128d x = a_step ? _mm_loadu_pd(a + i) : a_scalar;
+        __m128d y = b_step ? _mm_loadu_pd(b + i) : b_scalar;
+        __m128d r;
+        switch (op) {
+            case ARRAY_ADD: r = _mm_add_pd(x, y); break;
+            case ARRAY_SUB: r = _mm_sub_pd(x, y); break;
+            case ARRAY_MUL: r = _mm_mul_pd(x, y); break;
+            default:        r = _mm_div_pd(x, y); break;
+        }
+        _mm_storeu_pd(out + i, r);
+    }
+    float_elementwise_scalar(op, a, a_step, b, b_step, out, i, length);
+}
+
+static double float_sum_sse2(const double *a, const double *b, size_t length) {
+    // Two registers hold lanes 0-1 and 2-3.
+    __m128d low = _mm_setzero_pd(), high = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + SUM_LANES <= length; i += SUM_LANES) {
+        __m128d x0 = _mm_loadu_pd(a + i), x1 = _mm_loadu_pd(a + i + 2);
+        if (b) {
+            x0 = _mm_mul_pd(x0, _mm_loadu_pd(b + i));
+            x1 = _mm_mul_pd(x1, _mm_loadu_pd(b + i + 2));
+        }
+        low = _mm_add_pd(low, x0);
+        high = _mm_add_pd(high, x1);
+    }
+    double lanes[SUM_LANES];
+    _mm_storeu_pd(lanes, low);
+    _mm_storeu_pd(lanes + 2, high);
+    return float_sum_finish(lanes, a, b, i, length);
+}
+
+static uint64_t int_sum_sse2(const int64_t *a, const int64_t *b, size_t length) {
+    __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + SUM_LANES <= length; i += SUM_LANES) {
+        __m128i x0 = _mm_loadu_si128((const __m128i *)(a + i)), x1 = _mm_loadu_si128((const __m128i *)(a + i + 2));
+        if (b) {
+            x0 = mullo_epi64_sse2(x0, _mm_loadu_si128((const __m128i *)(b + i)));
+            x1 = mullo_epi64_sse2(x1, _mm_loadu_si128((const __m128i *)(b + i + 2)));
+        }
+        low = _mm_add_epi64(low, x0);
+        high = _mm_add_epi64(high, x1);
+    }
+    uint64_t lanes[SUM_LANES];
+    _mm_storeu_si128((__m128i *)lanes, low);
+    _mm_storeu_si128((__m128i *)(lanes + 2), high);
+    return int_sum_finish(lanes, a, b, i, length);
+}
+
+//------------------------------------------------------------------------------
+// AVX2 kernels, compiled for AVX2 regardless of -march and only called when the CPU has it
+//------------------------------------------------------------------------------
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i mullo_epi64_avx2(__m256i a, __m256i b) {
+    __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+        _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+}
+
+AVX2 static void int_elementwise_avx2(array_op_t op, const int64_t *a, size_t a_step, const int64_t *b, size_t b_step,
+    int64_t *out, size_t length) {
+    __m256i a_scalar = _mm256_set1_epi64x(a[0]), b_scalar = _mm256_set1_epi64x(b[0]);
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m256i x = a_step ? _mm256_loadu_si256((const __m256i *)(a + i)) : a_scalar;
+        __m256i y = b_step ? _mm256_loadu_si256((const __m256i *)(b + i)) : b_scalar;
+        __m256i r;
+        switch (op) {
+            case ARRAY_ADD: r = _mm256_add_epi64(x, y); break;
+            case ARRAY_SUB: r = _mm256_sub_epi64(x, y); break;
+            default:        r = mullo_epi64_avx2(x, y); break;
+        }
+        _mm256_storeu_si256((__m256i *)(out + i), r);
+    }
+    int_elementwise_scalar(op, a, a_step, b, b_step, out, i, length);
+}
+
+AVX2 static void float_elementwise_avx2(array_op_t op, const double *a, size_t a_step, const double *b, size_t b_step,
+    double *out, size_t length) {
+    __m256d a_scalar = _mm256_set1_pd(a[0]), b_scalar = _mm256_set1_pd(b[0]);
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m256d x = a_step ? _mm256_loadu_pd(a + i) : a_scalar;
+        __m256d y = b_step ? _mm256_loadu_pd(b + i) : b_scalar;
+        __m256d r;
+        switch (op) {
+            case ARRAY_ADD: r = _mm256_add_pd(x, y); break;
+            case ARRAY_SUB: r = _mm256_sub_pd(x, y); break;
+            case ARRAY_MUL: r = _mm256_mul_pd(x, y); break;
+            default:        r = _mm256_div_pd(x, y); break;
+        }
+        _mm256_storeu_pd(out + i, r);
+    }
+    float_elementwise_scalar(op, a, a_step, b, b_step, out, i, length);
+}
+
+AVX2 static double float_sum_avx2(const double *a, const double *b, size_t length) {
+    // Separate multiply and add, no FMA: the rounding matches the other kernels.
+    __m256d sum = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + SUM_LANES <= length; i += SUM_LANES) {
+        __m256d x = _mm256_loadu_pd(a + i);
+        if (b) {
+            x = _mm256_mul_pd(x, _mm256_loadu_pd(b + i));
+        }
+        sum = _mm256_add_pd(sum, x);
+    }
+    double lanes[SUM_LANES];
+    _mm256_storeu_pd(lanes, sum);
+    return float_sum_finish(lanes, a, b, i, length);
+}
+
+AVX2 static uint64_t int_sum_avx2(const int64_t *a, const int64_t *b, size_t length) {
+    __m256i sum = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + SUM_LANES <= length; i += SUM_LANES) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        if (b) {
+            x = mullo_epi64_avx2(x, _mm256_loadu_si256((const __m256i *)(b + i)));
+        }
+        sum = _mm256_add_epi64(sum, x);
+    }
+    uint64_t lanes[SUM_LANES];
+    _mm256_storeu_si256((__m256i *)lanes, sum);
+    return int_sum_finish(lanes, a, b, i, length);
+}
+
+#undef AVX2
+
+#endif // ARRAY_X86_KERNELS
+
+//------------------------------------------------------------------------------
+// dispatch
+//------------------------------------------------------------------------------
+
+void array_elementwise(array_op_t op, const void *a, size_t a_step, const void *b, size_t b_step, array_t *out) {
+    size_t length = out->length;
+    array_kernel_t kernel = array_kernel();
+    if (out->element_type == VALUE_INT) {
+        const int64_t *x = a, *y = b;
+        switch (kernel) {
+#ifdef ARRAY_X86_KERNELS
+            case ARRAY_KERNEL_AVX2: int_elementwise_avx2(op, x, a_step, y, b_step, out->as.ints, length); return;
+            case ARRAY_KERNEL_SSE2: int_elementwise_sse2(op, x, a_step, y, b_step, out->as.ints, length); return;
+#endif
+            default: int_elementwise_scalar(op, x, a_step, y, b_step, out->as.ints, 0, length); return;
+        }
+    }
+    const double *x = a, *y = b;
+    switch (kernel) {
+#ifdef ARRAY_X86_KERNELS
+        case ARRAY_KERNEL_AVX2: float_elementwise_avx2(op, x, a_step, y, b_step, out->as.floats, length); return;
+        case ARRAY_KERNEL_SSE2: float_elementwise_sse2(op, x, a_step, y, b_step, out->as.floats, length); return;
+#endif
+        default: float_elementwise_scalar(op, x, a_step, y, b_step, out->as.floats, 0, length); return;
+    }
+}
+
+/**
+ * @brief Sum of a, or of a[i] * b[i] when `b` is not NULL.
+ */
+static value_t sum_products(gc_heap_t *heap, const array_t *a, const array_t *b) {
+    array_kernel_t kernel = array_kernel();
+    if (a->element_type == VALUE_INT) {
+        const int64_t *y = b ? b->as.ints : NULL;
+        uint64_t total;
+        switch (kernel) {
+#ifdef ARRAY_X86_KERNELS
+            case ARRAY_KERNEL_AVX2: total = int_sum_avx2(a->as.ints, y, a->length); break;
+            case ARRAY_KERNEL_SSE2: total = int_sum_sse2(a->as.ints, y, a->length); break;
+#endif
+            default: total = int_sum_scalar(a->as.ints, y, a->length); break;
+        }
+        return gc_int_value(heap, (int64_t)total);
+    }
+
+    const double *y = b ? b->as.floats : NULL;
+    double total;
+    switch (kernel) {
+#ifdef ARRAY_X86_KERNELS
+        case ARRAY_KERNEL_AVX2: total = float_sum_avx2(a->as.floats, y, a->length); break;
+        case ARRAY_KERNEL_SSE2: total = float_sum_sse2(a->as.floats, y, a->length); break;
+#endif
+        default: total = float_sum_scalar(a->as.floats, y, a->length); break;
+    }
+    return FLOAT_VALUE(total);
+}
+
+value_t array_sum(gc_heap_t *heap, const array_t *array) {
+    return sum_products(heap, array, NULL);
+}
+
+value_t array_dot(gc_heap_t *heap, const array_t *a, const array_t *b) {
+    return sum_products(heap, a, b);
+}
@@ -6,11 +6,14 @@
 #define _POSIX_C_SOURCE 200809L 
 
 #include <stddef.h>
+#include <inttypes.h>
 #include <string.h>
 
 #include "include/ast.h"
 #include "include/lexer.h"
 #include "include/utils.h"
+#include "include/stats.h"
+#include "include/trace.h"
 
 char *data_type_to_string(data_type_t type) {
     switch (type) {
@@ -19,70 +22,143 @@ char *data_type_to_string(data_type_t type) {
         case DATA_TYPE_BOOL: return "bool";
         case DATA_TYPE_STRING: return "string";
         case DATA_TYPE_VOID: return "void";
+        case DATA_TYPE_INT_ARRAY: return "int[]";
+        case DATA_TYPE_FLOAT_ARRAY: return "float[]";
         default: return "unknown";
     }
 }
 
-void free_expr_node(ast_expr_node_t *expr) {
+#define AST_KIND_CASE(kind, name, description) case kind: return description;
+
+char *expr_type_to_string(expr_type_t type) {
+    switch (type) {
+        AST_EXPR_KINDS(AST_KIND_CASE)
+        default: return "unknown";
+    }
+}
+
+char *stmt_type_to_string(stmt_type_t type) {
+    switch (type) {
+        AST_STMT_KINDS(AST_KIND_CASE)
+        default: return "unknown";
+    }
+}
+
+char *decl_type_to_string(decl_type_t type) {
+    switch (type) {
+        AST_DECL_KINDS(AST_KIND_CASE)
+        default: return "unknown";
+    }
+}
+
+#undef AST_KIND_CASE
+
+/**
+ * Expressions waiting to be freed. Children are pushed here instead of
+ * freed by recursion, so freeing takes no native stack however deep the
+ * tree; the first few fit in `inline_items` without allocating.
+ */
+typedef struct {
+    ast_expr_node_t **items;
+    size_t count;
+    size_t capacity;
+    ast_expr_node_t *inline_items[32];
+} expr_free_stack_t;
+
+static void push_expr_to_free(expr_free_stack_t *stack, ast_expr_node_t *expr) {
     if (!expr) return;
+    if (stack->count >= stack->capacity) {
+        size_t capacity = stack->capacity * 2;
+        ast_expr_node_t **items = malloc(sizeof(ast_expr_node_t *) * capacity);
+        CHECK_MEM_ALLOC_ERROR(items);
+        memcpy(items, stack->items, sizeof(ast_expr_node_t *) * stack->count);
+        if (stack->items != stack->inline_items) free(stack->items);
+        stack->items = items;
+        stack->capacity = capacity;
+    }
+    stack->items[stack->count++] = expr;
+}
 
-    switch (expr->type) {
-        case EXPR_LITERAL_INT: {
-            free(expr->data.literal_int);
-            break;
-        }
-        case EXPR_LITERAL_FLOAT: {
-            free(expr->data.literal_float);
-            break;
-        }
-        case EXPR_LITERAL_STRING: {
-            free(expr->data.literal_string->value);
-            free(expr->data.literal_string);
-            break;
-        }
-        case EXPR_IDENTIFIER: {
-            free(expr->data.identifier->name);
-            free(expr->data.identifier);
-            break;
-        }
-        case EXPR_ASSIGNMENT: {
-            free(expr->data.assignment->name);
-            free_expr_node(expr->data.assignment->value);
-            free(expr->data.assignment);
-            break;
-        }
-        case EXPR_BINARY: {
-            free_expr_node(expr->data.binary->left);
-            free_expr_node(expr->data.binary->right);
-            free(expr->data.binary);
-            break;
-        }
-        case EXPR_UNARY: {
-            free_expr_node(expr->data.unary->operand);
-            free(expr->data.unary);
-            break;
-        }
-        case EXPR_CALL: {
-            free(expr->data.call->name);
-            for (size_t i = 0; i < expr->data.call->args->arg_count; ++i) {
-                free_expr_node(expr->data.call->args->args[i]);
+void free_expr_node(ast_expr_node_t *expr) {
+    expr_free_stack_t stack;
+    stack.items = stack.inline_items;
+    stack.count = 0;
+    stack.capacity = sizeof(stack.inline_items) / sizeof(stack.inline_items[0]);
+    push_expr_to_free(&stack, expr);
+
+    while (stack.count > 0) {
+        expr = stack.items[--stack.count];
+        switch (expr->type) {
+            case EXPR_LITERAL_INT: {
+                free(expr->data.literal_int);
+                break;
             }
-            free(expr->data.call->args->args);
-            free(expr->data.call->args);
-            free(expr->data.call);
-            break;
-        }
-        case EXPR_ARG_LIST: {
-            for (size_t i = 0; i < expr->data.arg_list->arg_count; ++i) {
-                free_expr_node(expr->data.arg_list->args[i]);
+            case EXPR_LITERAL_FLOAT: {
+                free(expr->data.literal_float);
+                break;
+            }
+            case EXPR_LITERAL_STRING: {
+                free(expr->data.literal_string->value);
+                free(expr->data.literal_string);
+                break;
+            }
+            case EXPR_LITERAL_BOOL: {
+                free(expr->data.literal_bool);
+                break;
+            }
+            case EXPR_LITERAL_NULL:
+                break;
+            case EXPR_IDENTIFIER: {
+                free(expr->data.identifier->name);
+                free(expr->data.identifier);
+                break;
+            }
+            case EXPR_ASSIGNMENT: {
+                free(expr->data.assignment->name);
+                push_expr_to_free(&stack, expr->data.assignment->value);
+                free(expr->data.assignment);
+                break;
+            }
+            case EXPR_BINARY: {
+                push_expr_to_free(&stack, expr->data.binary->left);
+                push_expr_to_free(&stack, expr->data.binary->right);
+                free(expr->data.binary);
+                break;
+            }
+            case EXPR_UNARY: {
+                push_expr_to_free(&stack, expr->data.unary->operand);
+                free(expr->data.unary);
+                break;
+            }
+            case EXPR_CALL: {
+                free(expr->data.call->name);
+                for (size_t i = 0; i < expr->data.call->args->arg_count; ++i) {
+                    push_expr_to_free(&stack, expr->data.call->args->args[i]);
+                }
+                free(expr->data.call->args->args);
+                free(expr->data.call->args);
+                free(expr->data.call);
+                break;
+            }
+            case EXPR_ARG_LIST: {
+                for (size_t i = 0; i < expr->data.arg_list->arg_count; ++i) {
+                    push_expr_to_free(&stack, expr->data.arg_list->args[i]);
+                }
+                free(expr->data.arg_list->args);
+                free(expr->data.arg_list);
+                break;
+            }
+            case EXPR_INDEX: {
+                push_expr_to_free(&stack, expr->data.index->array);
+                push_expr_to_free(&stack, expr->data.index->index);
+                free(expr->data.index);
+                break;
             }
-            free(expr->data.arg_list->args);
-            free(expr->data.arg_list);
-            break;
         }
+        free(expr);
     }
 
-    free(expr);
+    if (stack.items != stack.inline_items) free(stack.items);
 }
 
 void free_stmt_node(ast_stmt_node_t *stmt) {
@@ -98,6 +174,7 @@ void free_stmt_node(ast_stmt_node_t *stmt) {
         case STMT_ASSIGN: {
             free(stmt->data.assign->name);
             free_expr_node(stmt->data.assign->value);
+            free_expr_node(stmt->data.assign->index);
             free(stmt->data.assign);
             break;
         }
@@ -135,6 +212,7 @@ void free_stmt_node(ast_stmt_node_t *stmt) {
             free(stmt->data.if_stmt->elif_blocks);
 
             free_stmt_node(stmt->data.if_stmt->else_block);
+            free(stmt->data.if_stmt);
             break;
         }
         case STMT_WHILE: {
@@ -192,11 +270,11 @@ void free_stmt_node(ast_stmt_node_t *stmt) {
             free(stmt->data.expr_stmt);
             break;
         }
-        case STMT_BREAK: {
+        case STMT_BREAK:
             free(stmt->data.break_stmt);
-        }
+            break;
         case STMT_CONTINUE:
-            // No dynamic memory to free for these types
+            free(stmt->data.continue_stmt);
             break;
     }
 
@@ -245,13 +323,29 @@ void free_ast_node(ast_node_t *node) {
     free(node);
 }
 
+/**
+ * @brief Name of a top level node for the trace timeline: the function or global it declares.
+ */
+static const char *top_level_name(const ast_node_t *node) {
+    if (node->type == AST_NODE_CATEGORY_DECL && node->data.decl_node->type == DECL_FUNCTION) {
+        return node->data.decl_node->data.function_decl->name;
+    }
+    if (node->type == AST_NODE_CATEGORY_STMT && node->data.stmt_node->type == STMT_VAR_DECL) {
+        return node->data.stmt_node->data.var_decl->name;
+    }
+    return NULL;
+}
+
 void free_ast(ast_t *ast) {
     if (!ast) return;
     
     for (size_t i = 0; i < ast->node_count; ++i) {
+        TRACE_BEGIN("free", top_level_name(ast->nodes[i]));
         free_ast_node(ast->nodes[i]);
+        TRACE_END("free");
     }
     free(ast->nodes);
+    free_source_map(ast->source_map);
     free(ast);
 }
 
@@ -262,15 +356,15 @@ ast_t *init_ast(void) {
     ast->nodes_capacity = 1;
     ast->nodes = malloc(ast->nodes_capacity * sizeof(ast_node_t *));
     CHECK_MEM_ALLOC_ERROR(ast->nodes);
+    ast->source_map = NULL;
     return ast;
 }
 
-ast_node_t *init_ast_node(ast_node_category_t type, size_t line, size_t column) {
+ast_node_t *init_ast_node(ast_node_category_t type, uint32_t offset) {
     ast_node_t *node = malloc(sizeof(ast_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = type;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     switch (type) {
         case AST_NODE_CATEGORY_EXPR:
             node->data.expr_node = NULL;
@@ -287,202 +381,250 @@ ast_node_t *init_ast_node(ast_node_category_t type, size_t line, size_t column)
 }
 
 //-------------------- Expression Node Initializers ---------------------------------------------
-ast_expr_node_t *init_expr_literal_int(int value, size_t line, size_t column) {
+ast_expr_node_t *init_expr_literal_int(int64_t value, uint32_t offset) {
     ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = EXPR_LITERAL_INT;
+    STATS_COUNT_EXPR(EXPR_LITERAL_INT);
     node->data.literal_int = malloc(sizeof(expr_literal_int_t));
     CHECK_MEM_ALLOC_ERROR(node->data.literal_int);
     node->data.literal_int->value = value;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_expr_node_t *init_expr_literal_float(float value, size_t line, size_t column) {
+ast_expr_node_t *init_expr_literal_float(double value, uint32_t offset) {
     ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = EXPR_LITERAL_FLOAT;
+    STATS_COUNT_EXPR(EXPR_LITERAL_FLOAT);
     node->data.literal_float = malloc(sizeof(expr_literal_float_t));
     CHECK_MEM_ALLOC_ERROR(node->data.literal_float);
     node->data.literal_float->value = value;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_expr_node_t *init_expr_literal_string(const char * const value, size_t line, size_t column) {
+ast_expr_node_t *init_expr_literal_string(const char * const value, uint32_t offset) {
     ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = EXPR_LITERAL_STRING;
+    STATS_COUNT_EXPR(EXPR_LITERAL_STRING);
     node->data.literal_string = malloc(sizeof(expr_literal_string_t));
     CHECK_MEM_ALLOC_ERROR(node->data.literal_string);
     node->data.literal_string->value = strdup(value);
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
+    return node;
+}
+
+ast_expr_node_t *init_expr_literal_bool(bool value, uint32_t offset) {
+    ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
+    CHECK_MEM_ALLOC_ERROR(node);
+    node->type = EXPR_LITERAL_BOOL;
+    STATS_COUNT_EXPR(EXPR_LITERAL_BOOL);
+    node->data.literal_bool = malloc(sizeof(expr_literal_bool_t));
+    CHECK_MEM_ALLOC_ERROR(node->data.literal_bool);
+    node->data.literal_bool->value = value;
+    node->offset = offset;
+    return node;
+}
+
+ast_expr_node_t *init_expr_literal_null(uint32_t offset) {
+    ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
+    CHECK_MEM_ALLOC_ERROR(node);
+    node->type = EXPR_LITERAL_NULL;
+    STATS_COUNT_EXPR(EXPR_LITERAL_NULL);
+    node->data.literal_string = NULL;
+    node->offset = offset;
     return node;
 }
 
-ast_expr_node_t *init_expr_identifier(const char *name, size_t line, size_t column) {
+ast_expr_node_t *init_expr_identifier(const char *name, uint32_t offset) {
     ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = EXPR_IDENTIFIER;
+    STATS_COUNT_EXPR(EXPR_IDENTIFIER);
     node->data.identifier = malloc(sizeof(expr_identifier_t));
     CHECK_MEM_ALLOC_ERROR(node->data.identifier);
     node->data.identifier->name = strdup(name);
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_expr_node_t *init_expr_binary(token_type_t operator, ast_expr_node_t *left, ast_expr_node_t *right, size_t line, size_t column) {
+ast_expr_node_t *init_expr_binary(token_type_t operator, ast_expr_node_t *left, ast_expr_node_t *right, uint32_t offset) {
     ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = EXPR_BINARY;
+    STATS_COUNT_EXPR(EXPR_BINARY);
     node->data.binary = malloc(sizeof(expr_binary_t));
     CHECK_MEM_ALLOC_ERROR(node->data.binary);
     node->data.binary->left = left;
     node->data.binary->right = right;
     node->data.binary->operator = operator;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_expr_node_t *init_expr_unary(token_type_t operator, ast_expr_node_t *operand, size_t line, size_t column) {
+ast_expr_node_t *init_expr_unary(token_type_t operator, ast_expr_node_t *operand, uint32_t offset) {
     ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = EXPR_UNARY;
+    STATS_COUNT_EXPR(EXPR_UNARY);
     node->data.unary = malloc(sizeof(expr_unary_t));
     CHECK_MEM_ALLOC_ERROR(node->data.unary);
     node->data.unary->operator = operator;
     node->data.unary->operand = operand;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_expr_node_t *init_expr_assignment(const char *name, ast_expr_node_t *value, size_t line, size_t column) {
+ast_expr_node_t *init_expr_assignment(const char *name, ast_expr_node_t *value, uint32_t offset) {
     ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = EXPR_ASSIGNMENT;
+    STATS_COUNT_EXPR(EXPR_ASSIGNMENT);
     node->data.assignment = malloc(sizeof(expr_assignment_t));
     CHECK_MEM_ALLOC_ERROR(node->data.assignment);
     node->data.assignment->name = strdup(name);
     node->data.assignment->value = value;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_expr_node_t *init_expr_call(const char *name, expr_arg_list_t *arg_list, size_t line, size_t column) {
+ast_expr_node_t *init_expr_call(const char *name, expr_arg_list_t *arg_list, uint32_t offset) {
     ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = EXPR_CALL;
+    STATS_COUNT_EXPR(EXPR_CALL);
     node->data.call = malloc(sizeof(expr_call_t));
     CHECK_MEM_ALLOC_ERROR(node->data.call);
     node->data.call->name = strdup(name);
     node->data.call->args = arg_list;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_expr_node_t *init_expr_arg_list(ast_expr_node_t **args, size_t arg_count, size_t line, size_t column) {
+ast_expr_node_t *init_expr_arg_list(ast_expr_node_t **args, size_t arg_count, uint32_t offset) {
     ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = EXPR_ARG_LIST;
+    STATS_COUNT_EXPR(EXPR_ARG_LIST);
     node->data.arg_list = malloc(sizeof(expr_arg_list_t));
     CHECK_MEM_ALLOC_ERROR(node->data.arg_list);
     node->data.arg_list->args = args;
     node->data.arg_list->arg_count = arg_count;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
+    return node;
+}
+
+ast_expr_node_t *init_expr_index(ast_expr_node_t *array, ast_expr_node_t *index, uint32_t offset) {
+    ast_expr_node_t *node = malloc(sizeof(ast_expr_node_t));
+    CHECK_MEM_ALLOC_ERROR(node);
+    node->type = EXPR_INDEX;
+    STATS_COUNT_EXPR(EXPR_INDEX);
+    node->data.index = malloc(sizeof(expr_index_t));
+    CHECK_MEM_ALLOC_ERROR(node->data.index);
+    node->data.index->array = array;
+    node->data.index->index = index;
+    node->offset = offset;
     return node;
 }
 
 
 //-------------------- Statement Node Initializers ----------------------------------------------
-ast_stmt_node_t *init_stmt_var_decl(const char *name, data_type_t type, ast_expr_node_t *initializer, size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_var_decl(const char *name, data_type_t type, ast_expr_node_t *initializer, uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_VAR_DECL;
+    STATS_COUNT_STMT(STMT_VAR_DECL);
     node->data.var_decl = malloc(sizeof(stmt_var_decl_t));
     CHECK_MEM_ALLOC_ERROR(node->data.var_decl);
     node->data.var_decl->name = strdup(name);
     node->data.var_decl->type = type;
     node->data.var_decl->initializer = initializer;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_stmt_node_t *init_stmt_assign(const char *name, ast_expr_node_t *value, size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_assign(const char *name, ast_expr_node_t *value, uint32_t offset) {
+    return init_stmt_compound_assign(name, TOKEN_EQ, value, offset);
+}
+
+ast_stmt_node_t *init_stmt_compound_assign(const char *name, token_type_t operator, ast_expr_node_t *value, uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_ASSIGN;
+    STATS_COUNT_STMT(STMT_ASSIGN);
     node->data.assign = malloc(sizeof(stmt_assign_t));
     CHECK_MEM_ALLOC_ERROR(node->data.assign);
     node->data.assign->name = strdup(name);
+    node->data.assign->operator = operator;
     node->data.assign->value = value;
-    node->line = line;
-    node->column = column;
+    node->data.assign->index = NULL;
+    node->offset = offset;
     return node;
 }
 
-ast_stmt_node_t *init_stmt_return(ast_expr_node_t *value, size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_index_assign(const char *name, ast_expr_node_t *index, token_type_t operator, ast_expr_node_t *value, uint32_t offset) {
+    ast_stmt_node_t *node = init_stmt_compound_assign(name, operator, value, offset);
+    node->data.assign->index = index;
+    return node;
+}
+
+ast_stmt_node_t *init_stmt_return(ast_expr_node_t *value, uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_RETURN;
+    STATS_COUNT_STMT(STMT_RETURN);
     node->data.return_stmt = malloc(sizeof(stmt_return_t));
     CHECK_MEM_ALLOC_ERROR(node->data.return_stmt);
     node->data.return_stmt->value = value;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_stmt_node_t *init_stmt_print(expr_arg_list_t *args, size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_print(expr_arg_list_t *args, uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_PRINT;
+    STATS_COUNT_STMT(STMT_PRINT);
     node->data.print_stmt = malloc(sizeof(stmt_print_t));
     CHECK_MEM_ALLOC_ERROR(node->data.print_stmt);
     node->data.print_stmt->args = args;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_stmt_node_t *init_stmt_break(size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_break(uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_BREAK;
+    STATS_COUNT_STMT(STMT_BREAK);
     node->data.break_stmt = malloc(sizeof(stmt_break_t));
     CHECK_MEM_ALLOC_ERROR(node->data.break_stmt);
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_stmt_node_t *init_stmt_continue(size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_continue(uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_CONTINUE;
+    STATS_COUNT_STMT(STMT_CONTINUE);
     node->data.continue_stmt = malloc(sizeof(stmt_continue_t));
     CHECK_MEM_ALLOC_ERROR(node->data.continue_stmt);
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
 ast_stmt_node_t *init_stmt_if(ast_expr_node_t *if_condition, ast_stmt_node_t *if_block, 
                               ast_expr_node_t **elif_conditions, size_t elif_blocks_count, 
                               ast_stmt_node_t **elif_blocks, ast_stmt_node_t *else_block,
-                              size_t line, size_t column) {
+                              uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_IF;
+    STATS_COUNT_STMT(STMT_IF);
     node->data.if_stmt = malloc(sizeof(stmt_if_t));
     CHECK_MEM_ALLOC_ERROR(node->data.if_stmt);
     node->data.if_stmt->if_condition = if_condition;
@@ -491,30 +633,28 @@ ast_stmt_node_t *init_stmt_if(ast_expr_node_t *if_condition, ast_stmt_node_t *if
     node->data.if_stmt->elif_blocks = elif_blocks;
     node->data.if_stmt->elif_blocks_count = elif_blocks_count;
     node->data.if_stmt->else_block = else_block;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_stmt_node_t *init_stmt_while(ast_expr_node_t *condition, ast_stmt_node_t *block, size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_while(ast_expr_node_t *condition, ast_stmt_node_t *block, uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_WHILE;
+    STATS_COUNT_STMT(STMT_WHILE);
     node->data.while_stmt = malloc(sizeof(stmt_while_t));
     CHECK_MEM_ALLOC_ERROR(node->data.while_stmt);
     node->data.while_stmt->condition = condition;
     node->data.while_stmt->block = block;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-stmt_for_init_t *init_stmt_for_init_var_decl(const char *name, data_type_t type, ast_expr_node_t *expr, size_t line, size_t column) {
+stmt_for_init_t *init_stmt_for_init_var_decl(const char *name, data_type_t type, ast_expr_node_t *expr, uint32_t offset) {
     stmt_for_init_t *init = malloc(sizeof(stmt_for_init_t));
     CHECK_MEM_ALLOC_ERROR(init);
     init->kind = FOR_INIT_VAR_DECL;
-    init->line = line;
-    init->column = column;
+    init->offset = offset;
     init->data.var_decl = malloc(sizeof(stmt_var_decl_t));
     CHECK_MEM_ALLOC_ERROR(init->data.var_decl);
     init->data.var_decl->name = strdup(name);
@@ -523,100 +663,98 @@ stmt_for_init_t *init_stmt_for_init_var_decl(const char *name, data_type_t type,
     return init;
 }
 
-stmt_for_init_t *init_stmt_for_init_assign(const char *name, ast_expr_node_t *value, size_t line, size_t column) {
+stmt_for_init_t *init_stmt_for_init_assign(const char *name, ast_expr_node_t *value, uint32_t offset) {
     stmt_for_init_t *init = malloc(sizeof(stmt_for_init_t));
     CHECK_MEM_ALLOC_ERROR(init);
     init->kind = FOR_INIT_ASSIGN;
-    init->line = line;
-    init->column = column;
+    init->offset = offset;
     init->data.assign = malloc(sizeof(stmt_assign_t));
     CHECK_MEM_ALLOC_ERROR(init->data.assign);
     init->data.assign->name = strdup(name);
+    init->data.assign->operator = TOKEN_EQ;
     init->data.assign->value = value;
+    init->data.assign->index = NULL;
     return init;
 }
 
-stmt_for_init_t *init_stmt_for_init_expr(ast_expr_node_t *expression, size_t line, size_t column) {
+stmt_for_init_t *init_stmt_for_init_expr(ast_expr_node_t *expression, uint32_t offset) {
     stmt_for_init_t *init = malloc(sizeof(stmt_for_init_t));
     CHECK_MEM_ALLOC_ERROR(init);
     init->kind = FOR_INIT_EXPR;
-    init->line = line;
-    init->column = column;
+    init->offset = offset;
     init->data.expr = malloc(sizeof(stmt_expr_t));
     CHECK_MEM_ALLOC_ERROR(init->data.expr);
     init->data.expr->expression = expression;
     return init;
 }
 
-ast_stmt_node_t *init_stmt_for(stmt_for_init_t *init, ast_expr_node_t *condition, stmt_assign_t *increment, ast_stmt_node_t *block, size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_for(stmt_for_init_t *init, ast_expr_node_t *condition, stmt_assign_t *increment, ast_stmt_node_t *block, uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_FOR;
+    STATS_COUNT_STMT(STMT_FOR);
     node->data.for_stmt = malloc(sizeof(stmt_for_t));
     CHECK_MEM_ALLOC_ERROR(node->data.for_stmt);
     node->data.for_stmt->init = init;
     node->data.for_stmt->condition = condition;
     node->data.for_stmt->increment = increment;
     node->data.for_stmt->block = block;
-    node->line = line;
-    node->column = column;
+    node->data.for_stmt->parallel = false;
+    node->offset = offset;
     return node;
 }
 
-ast_stmt_node_t *init_stmt_expr(ast_expr_node_t *expression, size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_expr(ast_expr_node_t *expression, uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_EXPR;
+    STATS_COUNT_STMT(STMT_EXPR);
     node->data.expr_stmt = malloc(sizeof(stmt_expr_t));
     CHECK_MEM_ALLOC_ERROR(node->data.expr_stmt);
     node->data.expr_stmt->expression = expression;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
-ast_stmt_node_t *init_stmt_block(ast_stmt_node_t **statements, size_t statement_count, size_t line, size_t column) {
+ast_stmt_node_t *init_stmt_block(ast_stmt_node_t **statements, size_t statement_count, uint32_t offset) {
     ast_stmt_node_t *node = malloc(sizeof(ast_stmt_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = STMT_BLOCK;
+    STATS_COUNT_STMT(STMT_BLOCK);
     node->data.block_stmt = malloc(sizeof(stmt_block_t));
     CHECK_MEM_ALLOC_ERROR(node->data.block_stmt);
     node->data.block_stmt->statements = statements;
     node->data.block_stmt->statement_count = statement_count;
-    node->line = line;
-    node->column = column;
+    node->offset = offset;
     return node;
 }
 
 
 //-------------------- Declaration Node Initializers -------------------------------------------
-param_t *init_decl_param(const char *name, data_type_t type, size_t line, size_t column) {
+param_t *init_decl_param(const char *name, data_type_t type, uint32_t offset) {
     param_t *param = malloc(sizeof(param_t));
     CHECK_MEM_ALLOC_ERROR(param);
     param->name = strdup(name);
     param->type = type;
-    param->line = line;
-    param->column = column;
+    param->offset = offset;
     return param;
 }
 
-param_list_t *init_decl_param_list(param_t *params, size_t param_count, size_t line, size_t column) {
-    (void)line;
-    (void)column;
+param_list_t *init_decl_param_list(param_t *params, size_t param_count, uint32_t offset) {
     param_list_t *param_list = malloc(sizeof(param_list_t));
     CHECK_MEM_ALLOC_ERROR(param_list);
     param_list->params = params;
     param_list->param_count = param_count;
-    param_list->line = line;
-    param_list->column = column;
+    param_list->offset = offset;
     return param_list;
 }
 
 ast_decl_node_t *init_decl_function(const char *name, data_type_t return_type, param_list_t *params, 
-                            ast_stmt_node_t **body, size_t body_count, size_t line, size_t column) {
+                            ast_stmt_node_t **body, size_t body_count, uint32_t offset) {
     ast_decl_node_t *node = malloc(sizeof(ast_decl_node_t));
     CHECK_MEM_ALLOC_ERROR(node);
     node->type = DECL_FUNCTION;
+    STATS_COUNT_DECL(DECL_FUNCTION);
     node->data.function_decl = malloc(sizeof(decl_function_t));
     CHECK_MEM_ALLOC_ERROR(node->data.function_decl);
     node->data.function_decl->name = strdup(name);
@@ -624,8 +762,8 @@ ast_decl_node_t *init_decl_function(const char *name, data_type_t return_type, p
     node->data.function_decl->param_list = params;
     node->data.function_decl->body = body;
     node->data.function_decl->body_count = body_count;
-    node->line = line;
-    node->column = column;
+    node->data.function_decl->is_async = false;
+    node->offset = offset;
     return node;
 }
 
@@ -638,7 +776,9 @@ void print_indent(int indent_level) {
 void print_ast(ast_t *ast) {
     printf("AST with %zu nodes:\n", ast->node_count);
     for (size_t i = 0; i < ast->node_count; ++i) {
+        TRACE_BEGIN("print", top_level_name(ast->nodes[i]));
         print_ast_node(ast->nodes[i], 1);
+        TRACE_END("print");
     }
 }
 
@@ -664,7 +804,7 @@ void print_expr(ast_expr_node_t *expr, int indent) {
     print_indent(indent);
     switch (expr->type) {
         case EXPR_LITERAL_INT:
-            printf("Literal Int: %d\n", expr->data.literal_int->value);
+            printf("Literal Int: %" PRId64 "\n", expr->data.literal_int->value);
             break;
 
         case EXPR_LITERAL_FLOAT:
@@ -675,6 +815,14 @@ void print_expr(ast_expr_node_t *expr, int indent) {
             printf("Literal String: \"%s\"\n", expr->data.literal_string->value);
             break;
 
+        case EXPR_LITERAL_BOOL:
+            printf("Literal Bool: %s\n", expr->data.literal_bool->value ? "true" : "false");
+            break;
+
+        case EXPR_LITERAL_NULL:
+            printf("Literal Null\n");
+            break;
+
         case EXPR_IDENTIFIER:
             printf("Identifier: %s\n", expr->data.identifier->name);
             break;
@@ -708,11 +856,28 @@ void print_expr(ast_expr_node_t *expr, int indent) {
                 print_expr(expr->data.arg_list->args[i], indent + 1);
             }
             break;
+
+        case EXPR_INDEX:
+            printf("Index Expression:\n");
+            print_expr(expr->data.index->array, indent + 1);
+            print_expr(expr->data.index->index, indent + 1);
+            break;
     }
 }
 
 // ----------------------------- Statement Printer -----------------------------
 
+static const char *assign_operator_symbol(token_type_t operator) {
+    switch (operator) {
+        case TOKEN_PLUSEQ:      return "+=";
+        case TOKEN_MINUSEQ:     return "-=";
+        case TOKEN_ASTERISKEQ:  return "*=";
+        case TOKEN_SLASHEQ:     return "/=";
+        case TOKEN_PERCENT_EQ:  return "%=";
+        default:                return "=";
+    }
+}
+
 void print_stmt(ast_stmt_node_t *stmt, int indent) {
     print_indent(indent);
     switch (stmt->type) {
@@ -724,7 +889,11 @@ void print_stmt(ast_stmt_node_t *stmt, int indent) {
             break;
 
         case STMT_ASSIGN:
-            printf("Assignment Statement: %s\n", stmt->data.assign->name);
+            printf("Assignment Statement: %s%s %s\n", stmt->data.assign->name, stmt->data.assign->index ? "[]" : "",
+                assign_operator_symbol(stmt->data.assign->operator));
+            if (stmt->data.assign->index) {
+                print_expr(stmt->data.assign->index, indent + 1);
+            }
             print_expr(stmt->data.assign->value, indent + 1);
             break;
 
@@ -804,7 +973,7 @@ void print_stmt(ast_stmt_node_t *stmt, int indent) {
         }
 
         case STMT_FOR: {
-            printf("For Statement:\n");
+            printf(stmt->data.for_stmt->parallel ? "Parallel For Statement:\n" : "For Statement:\n");
             stmt_for_t *for_stmt = stmt->data.for_stmt;
             if (for_stmt->init) {
                 print_indent(indent + 1);
@@ -854,7 +1023,7 @@ void print_stmt(ast_stmt_node_t *stmt, int indent) {
                 print_indent(indent + 1);
                 printf("Increment:\n");
                 print_indent(indent + 2);
-                printf("%s =\n", for_stmt->increment->name);
+                printf("%s %s\n", for_stmt->increment->name, assign_operator_symbol(for_stmt->increment->operator));
                 print_expr(for_stmt->increment->value, indent + 3);
             }
 
@@ -872,7 +1041,8 @@ void print_decl(ast_decl_node_t *decl, int indent) {
     print_indent(indent);
     switch (decl->type) {
         case DECL_FUNCTION:
-            printf("Function Declaration: %s (return type %s)\n", decl->data.function_decl->name, data_type_to_string(decl->data.function_decl->return_type));
+            printf("%sFunction Declaration: %s (return type %s)\n", decl->data.function_decl->is_async ? "Async " : "",
+                decl->data.function_decl->name, data_type_to_string(decl->data.function_decl->return_type));
             print_indent(indent + 1);
             printf("Parameters:\n");
             for (size_t i = 0; i < decl->data.function_decl->param_list->param_count; ++i) {
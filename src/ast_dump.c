@@ -0,0 +1,774 @@
+/**
+ * File Name: ast_dump.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "include/ast_dump.h"
+#include "include/ast_serialize.h"
+#include "include/output.h"
+#include "include/utils.h"
+
+#define DUMP_INITIAL_CAPACITY (64u * 1024)
+
+typedef struct dump_buffer_struct {
+    char *data;
+    size_t size;
+    size_t capacity;
+    source_map_t *source_map;   /**< Of the tree being dumped, for the positions of the JSON form */
+} dump_buffer_t;
+
+//--------------------------------------- Buffer ------------------------------------------------------------------------------------
+
+static void dump_reserve(dump_buffer_t *buffer, size_t extra) {
+    if (buffer->size + extra <= buffer->capacity) return;
+    size_t capacity = buffer->capacity ? buffer->capacity : DUMP_INITIAL_CAPACITY;
+    while (buffer->size + extra > capacity) {
+        capacity *= 2;
+    }
+    char *data = realloc(buffer->data, capacity);
+    CHECK_MEM_ALLOC_ERROR(data);
+    buffer->data = data;
+    buffer->capacity = capacity;
+}
+
+static void dump_bytes(dump_buffer_t *buffer, const char *bytes, size_t length) {
+    dump_reserve(buffer, length);
+    memcpy(buffer->data + buffer->size, bytes, length);
+    buffer->size += length;
+}
+
+static void dump_text(dump_buffer_t *buffer, const char *text) {
+    dump_bytes(buffer, text, strlen(text));
+}
+
+static void dump_char(dump_buffer_t *buffer, char c) {
+    dump_reserve(buffer, 1);
+    buffer->data[buffer->size++] = c;
+}
+
+static void dump_int(dump_buffer_t *buffer, int64_t value) {
+    dump_reserve(buffer, OUTPUT_NUMBER_MAX);
+    buffer->size += output_format_int(buffer->data + buffer->size, value);
+}
+
+/**
+ * @brief Formats a float with printf, for the few literals a tree has.
+ */
+static void dump_float(dump_buffer_t *buffer, const char *format, double value) {
+    int length = snprintf(NULL, 0, format, value);
+    dump_reserve(buffer, (size_t)length + 1);
+    snprintf(buffer->data + buffer->size, (size_t)length + 1, format, value);
+    buffer->size += (size_t)length;
+}
+
+static void dump_indent(dump_buffer_t *buffer, int indent) {
+    size_t length = 2 * (size_t)indent;
+    dump_reserve(buffer, length);
+    memset(buffer->data + buffer->size, ' ', length);
+    buffer->size += length;
+}
+
+//--------------------------------------- Text --------------------------------------------------------------------------------------
+
+static const char *assign_operator_symbol(token_type_t operator) {
+    switch (operator) {
+        case TOKEN_PLUSEQ:      return "+=";
+        case TOKEN_MINUSEQ:     return "-=";
+        case TOKEN_ASTERISKEQ:  return "*=";
+        case TOKEN_SLASHEQ:     return "/=";
+        case TOKEN_PERCENT_EQ:  return "%=";
+        default:                return "=";
+    }
+}
+
+static void text_expr(dump_buffer_t *buffer, const ast_expr_node_t *expr, int indent) {
+    dump_indent(buffer, indent);
+    switch (expr->type) {
+        case EXPR_LITERAL_INT:
+            dump_text(buffer, "Literal Int: ");
+            dump_int(buffer, expr->data.literal_int->value);
+            dump_char(buffer, '\n');
+            break;
+
+        case EXPR_LITERAL_FLOAT:
+            dump_text(buffer, "Literal Float: ");
+            dump_float(buffer, "%f", expr->data.literal_float->value);
+            dump_char(buffer, '\n');
+            break;
+
+        case EXPR_LITERAL_STRING:
+            dump_text(buffer, "Literal String: \"");
+            dump_text(buffer, expr->data.literal_string->value);
+            dump_text(buffer, "\"\n");
+            break;
+
+        case EXPR_LITERAL_BOOL:
+            dump_text(buffer, expr->data.literal_bool->value ? "Literal Bool: true\n" : "Literal Bool: false\n");
+            break;
+
+        case EXPR_LITERAL_NULL:
+            dump_text(buffer, "Literal Null\n");
+            break;
+
+        case EXPR_IDENTIFIER:
+            dump_text(buffer, "Identifier: ");
+            dump_text(buffer, expr->data.identifier->name);
+            dump_char(buffer, '\n');
+            break;
+
+        case EXPR_ASSIGNMENT:
+            dump_text(buffer, "Assignment to ");
+            dump_text(buffer, expr->data.assignment->name);
+            dump_text(buffer, ":\n");
+            text_expr(buffer, expr->data.assignment->value, indent + 1);
+            break;
+
+        case EXPR_BINARY:
+            dump_text(buffer, "Binary Expression (");
+            dump_text(buffer, token_type_to_string(expr->data.binary->operator));
+            dump_text(buffer, "):\n");
+            text_expr(buffer, expr->data.binary->left, indent + 1);
+            text_expr(buffer, expr->data.binary->right, indent + 1);
+            break;
+
+        case EXPR_UNARY:
+            dump_text(buffer, "Unary Expression (");
+            dump_text(buffer, token_type_to_string(expr->data.unary->operator));
+            dump_text(buffer, "):\n");
+            text_expr(buffer, expr->data.unary->operand, indent + 1);
+            break;
+
+        case EXPR_CALL:
+            dump_text(buffer, "Function Call: ");
+            dump_text(buffer, expr->data.call->name);
+            dump_text(buffer, " with ");
+            dump_int(buffer, (int64_t)expr->data.call->args->arg_count);
+            dump_text(buffer, " args\n");
+            for (size_t i = 0; i < expr->data.call->args->arg_count; ++i) {
+                text_expr(buffer, expr->data.call->args->args[i], indent + 1);
+            }
+            break;
+
+        case EXPR_ARG_LIST:
+            dump_text(buffer, "Argument List with ");
+            dump_int(buffer, (int64_t)expr->data.arg_list->arg_count);
+            dump_text(buffer, " args\n");
+            for (size_t i = 0; i < expr->data.arg_list->arg_count; ++i) {
+                text_expr(buffer, expr->data.arg_list->args[i], indent + 1);
+            }
+            break;
+
+        case EXPR_INDEX:
+            dump_text(buffer, "Index Expression:\n");
+            text_expr(buffer, expr->data.index->array, indent + 1);
+            text_expr(buffer, expr->data.index->index, indent + 1);
+            break;
+    }
+}
+
+static void text_line(dump_buffer_t *buffer, int indent, const char *text) {
+    dump_indent(buffer, indent);
+    dump_text(buffer, text);
+}
+
+static void text_for_init(dump_buffer_t *buffer, const stmt_for_init_t *init, int indent) {
+    text_line(buffer, indent, "Initializer:\n");
+    switch (init->kind) {
+        case FOR_INIT_VAR_DECL:
+            if (init->data.var_decl) {
+                const stmt_var_decl_t *var_decl = init->data.var_decl;
+                text_line(buffer, indent + 1, "Variable Declaration: ");
+                dump_text(buffer, var_decl->name);
+                dump_text(buffer, " (type: ");
+                dump_text(buffer, data_type_to_string(var_decl->type));
+                dump_text(buffer, ")\n");
+                if (var_decl->initializer) {
+                    text_line(buffer, indent + 2, "Initializer:\n");
+                    text_expr(buffer, var_decl->initializer, indent + 3);
+                }
+            }
+            break;
+        case FOR_INIT_ASSIGN:
+            if (init->data.assign) {
+                text_line(buffer, indent + 1, "Assignment: ");
+                dump_text(buffer, init->data.assign->name);
+                dump_text(buffer, " =\n");
+                text_expr(buffer, init->data.assign->value, indent + 2);
+            }
+            break;
+        case FOR_INIT_EXPR:
+            if (init->data.expr) {
+                text_line(buffer, indent + 1, "Expression:\n");
+                text_expr(buffer, init->data.expr->expression, indent + 2);
+            }
+            break;
+        case FOR_INIT_NONE:
+            text_line(buffer, indent + 1, "No initializer\n");
+            break;
+    }
+}
+
+static void text_stmt(dump_buffer_t *buffer, const ast_stmt_node_t *stmt, int indent) {
+    dump_indent(buffer, indent);
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            dump_text(buffer, "Variable Declaration: ");
+            dump_text(buffer, stmt->data.var_decl->name);
+            dump_text(buffer, " (type ");
+            dump_text(buffer, data_type_to_string(stmt->data.var_decl->type));
+            dump_text(buffer, ")\n");
+            if (stmt->data.var_decl->initializer) {
+                text_expr(buffer, stmt->data.var_decl->initializer, indent + 1);
+            }
+            break;
+
+        case STMT_ASSIGN:
+            dump_text(buffer, "Assignment Statement: ");
+            dump_text(buffer, stmt->data.assign->name);
+            dump_text(buffer, stmt->data.assign->index ? "[] " : " ");
+            dump_text(buffer, assign_operator_symbol(stmt->data.assign->operator));
+            dump_char(buffer, '\n');
+            if (stmt->data.assign->index) {
+                text_expr(buffer, stmt->data.assign->index, indent + 1);
+            }
+            text_expr(buffer, stmt->data.assign->value, indent + 1);
+            break;
+
+        case STMT_RETURN:
+            dump_text(buffer, "Return Statement:\n");
+            if (stmt->data.return_stmt->value) {
+                text_expr(buffer, stmt->data.return_stmt->value, indent + 1);
+            }
+            break;
+
+        case STMT_PRINT:
+            dump_text(buffer, "Print Statement:\n");
+            for (size_t i = 0; i < stmt->data.print_stmt->args->arg_count; ++i) {
+                text_expr(buffer, stmt->data.print_stmt->args->args[i], indent + 1);
+            }
+            break;
+
+        case STMT_BREAK:
+            dump_text(buffer, "Break Statement\n");
+            break;
+
+        case STMT_CONTINUE:
+            dump_text(buffer, "Continue Statement\n");
+            break;
+
+        case STMT_EXPR:
+            dump_text(buffer, "Expression Statement:\n");
+            text_expr(buffer, stmt->data.expr_stmt->expression, indent + 1);
+            break;
+
+        case STMT_BLOCK:
+            dump_text(buffer, "Block:\n");
+            for (size_t i = 0; i < stmt->data.block_stmt->statement_count; ++i) {
+                text_stmt(buffer, stmt->data.block_stmt->statements[i], indent + 1);
+            }
+            break;
+
+        case STMT_IF: {
+            const stmt_if_t *if_stmt = stmt->data.if_stmt;
+            dump_text(buffer, "If Statement:\n");
+            text_line(buffer, indent + 1, "If condition:\n");
+            text_expr(buffer, if_stmt->if_condition, indent + 2);
+            text_stmt(buffer, if_stmt->if_block, indent + 1);
+            // print_stmt() lists elif branches without their conditions.
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                text_line(buffer, indent + 1, "Elif condition ");
+                dump_int(buffer, (int64_t)i);
+                dump_text(buffer, ":\n");
+                text_stmt(buffer, if_stmt->elif_blocks[i], indent + 1);
+            }
+            if (if_stmt->else_block != NULL) {
+                text_stmt(buffer, if_stmt->else_block, indent + 1);
+            }
+            break;
+        }
+
+        case STMT_WHILE:
+            dump_text(buffer, "While Statement:\n");
+            text_expr(buffer, stmt->data.while_stmt->condition, indent + 1);
+            text_stmt(buffer, stmt->data.while_stmt->block, indent + 1);
+            break;
+
+        case STMT_FOR: {
+            const stmt_for_t *for_stmt = stmt->data.for_stmt;
+            dump_text(buffer, for_stmt->parallel ? "Parallel For Statement:\n" : "For Statement:\n");
+            if (for_stmt->init) {
+                text_for_init(buffer, for_stmt->init, indent + 1);
+            }
+            if (for_stmt->condition) {
+                text_line(buffer, indent + 1, "Condition:\n");
+                text_expr(buffer, for_stmt->condition, indent + 2);
+            }
+            if (for_stmt->increment) {
+                text_line(buffer, indent + 1, "Increment:\n");
+                text_line(buffer, indent + 2, for_stmt->increment->name);
+                dump_char(buffer, ' ');
+                dump_text(buffer, assign_operator_symbol(for_stmt->increment->operator));
+                dump_char(buffer, '\n');
+                text_expr(buffer, for_stmt->increment->value, indent + 3);
+            }
+            text_stmt(buffer, for_stmt->block, indent + 1);
+            break;
+        }
+    }
+}
+
+static void text_decl(dump_buffer_t *buffer, const ast_decl_node_t *decl, int indent) {
+    dump_indent(buffer, indent);
+    switch (decl->type) {
+        case DECL_FUNCTION: {
+            const decl_function_t *function = decl->data.function_decl;
+            dump_text(buffer, function->is_async ? "Async Function Declaration: " : "Function Declaration: ");
+            dump_text(buffer, function->name);
+            dump_text(buffer, " (return type ");
+            dump_text(buffer, data_type_to_string(function->return_type));
+            dump_text(buffer, ")\n");
+            text_line(buffer, indent + 1, "Parameters:\n");
+            for (size_t i = 0; i < function->param_list->param_count; ++i) {
+                text_line(buffer, indent + 2, "Param: ");
+                dump_text(buffer, function->param_list->params[i].name);
+                dump_text(buffer, " (type ");
+                dump_text(buffer, data_type_to_string(function->param_list->params[i].type));
+                dump_text(buffer, ")\n");
+            }
+            text_line(buffer, indent + 1, "Body:\n");
+            for (size_t i = 0; i < function->body_count; ++i) {
+                text_stmt(buffer, function->body[i], indent + 2);
+            }
+            break;
+        }
+    }
+}
+
+static void text_ast(dump_buffer_t *buffer, const ast_t *ast) {
+    dump_text(buffer, "AST with ");
+    dump_int(buffer, (int64_t)ast->node_count);
+    dump_text(buffer, " nodes:\n");
+    for (size_t i = 0; i < ast->node_count; ++i) {
+        const ast_node_t *node = ast->nodes[i];
+        switch (node->type) {
+            case AST_NODE_CATEGORY_EXPR:
+                text_expr(buffer, node->data.expr_node, 1);
+                break;
+            case AST_NODE_CATEGORY_STMT:
+                text_stmt(buffer, node->data.stmt_node, 1);
+                break;
+            case AST_NODE_CATEGORY_DECL:
+                text_decl(buffer, node->data.decl_node, 1);
+                break;
+        }
+    }
+}
+
+//--------------------------------------- JSON --------------------------------------------------------------------------------------
+
+static const char *operator_symbol(token_type_t operator) {
+    switch (operator) {
+        case TOKEN_EQ:          return "=";
+        case TOKEN_EQEQ:        return "==";
+        case TOKEN_NEQ:         return "!=";
+        case TOKEN_PLUS:        return "+";
+        case TOKEN_PLUSPLUS:    return "++";
+        case TOKEN_PLUSEQ:      return "+=";
+        case TOKEN_MINUS:       return "-";
+        case TOKEN_MINUSMINUS:  return "--";
+        case TOKEN_MINUSEQ:     return "-=";
+        case TOKEN_ASTERISK:    return "*";
+        case TOKEN_ASTERISKEQ:  return "*=";
+        case TOKEN_SLASH:       return "/";
+        case TOKEN_SLASHEQ:     return "/=";
+        case TOKEN_GT:          return ">";
+        case TOKEN_GEQ:         return ">=";
+        case TOKEN_LT:          return "<";
+        case TOKEN_LEQ:         return "<=";
+        case TOKEN_PERCENT:     return "%";
+        case TOKEN_PERCENT_EQ:  return "%=";
+        case TOKEN_AND:         return "&&";
+        case TOKEN_OR:          return "||";
+        case TOKEN_NOT:         return "!";
+        case TOKEN_AWAIT:       return "await";
+        default:                return token_type_to_string(operator);
+    }
+}
+
+static void json_string(dump_buffer_t *buffer, const char *text) {
+    static const char hex[] = "0123456789abcdef";
+    dump_char(buffer, '"');
+    const char *run = text;
+    for (const char *p = text; *p; ++p) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        dump_bytes(buffer, run, (size_t)(p - run));
+        if (c == '"' || c == '\\') {
+            char escape[2] = { '\\', (char)c };
+            dump_bytes(buffer, escape, 2);
+        } else {
+            char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            dump_bytes(buffer, escape, 6);
+        }
+        run = p + 1;
+    }
+    dump_text(buffer, run);
+    dump_char(buffer, '"');
+}
+
+/**
+ * @brief Opens the object of a node: its kind and position come first.
+ */
+static void json_open(dump_buffer_t *buffer, const char *kind, uint32_t offset) {
+    size_t line, column;
+    source_map_locate(buffer->source_map, offset, &line, &column);
+    dump_text(buffer, "{\"kind\":\"");
+    dump_text(buffer, kind);
+    dump_text(buffer, "\",\"line\":");
+    dump_int(buffer, (int64_t)line);
+    dump_text(buffer, ",\"column\":");
+    dump_int(buffer, (int64_t)column);
+}
+
+static void json_key(dump_buffer_t *buffer, const char *key) {
+    dump_text(buffer, ",\"");
+    dump_text(buffer, key);
+    dump_text(buffer, "\":");
+}
+
+static void json_string_field(dump_buffer_t *buffer, const char *key, const char *value) {
+    json_key(buffer, key);
+    json_string(buffer, value);
+}
+
+static void json_expr(dump_buffer_t *buffer, const ast_expr_node_t *expr);
+static void json_stmt(dump_buffer_t *buffer, const ast_stmt_node_t *stmt);
+
+static void json_optional_expr(dump_buffer_t *buffer, const char *key, const ast_expr_node_t *expr) {
+    json_key(buffer, key);
+    if (expr) {
+        json_expr(buffer, expr);
+    } else {
+        dump_text(buffer, "null");
+    }
+}
+
+static void json_optional_stmt(dump_buffer_t *buffer, const char *key, const ast_stmt_node_t *stmt) {
+    json_key(buffer, key);
+    if (stmt) {
+        json_stmt(buffer, stmt);
+    } else {
+        dump_text(buffer, "null");
+    }
+}
+
+static void json_expr_array(dump_buffer_t *buffer, const char *key, ast_expr_node_t *const *exprs, size_t count) {
+    json_key(buffer, key);
+    dump_char(buffer, '[');
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) dump_char(buffer, ',');
+        json_expr(buffer, exprs[i]);
+    }
+    dump_char(buffer, ']');
+}
+
+static void json_stmt_array(dump_buffer_t *buffer, const char *key, ast_stmt_node_t *const *stmts, size_t count) {
+    json_key(buffer, key);
+    dump_char(buffer, '[');
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) dump_char(buffer, ',');
+        json_stmt(buffer, stmts[i]);
+    }
+    dump_char(buffer, ']');
+}
+
+static void json_expr(dump_buffer_t *buffer, const ast_expr_node_t *expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL_INT:
+            json_open(buffer, "int", expr->offset);
+            json_key(buffer, "value");
+            dump_int(buffer, expr->data.literal_int->value);
+            break;
+        case EXPR_LITERAL_FLOAT:
+            json_open(buffer, "float", expr->offset);
+            json_key(buffer, "value");
+            // Enough digits to read the float back exactly.
+            dump_float(buffer, "%.17g", expr->data.literal_float->value);
+            break;
+        case EXPR_LITERAL_STRING:
+            json_open(buffer, "string", expr->offset);
+            json_string_field(buffer, "value", expr->data.literal_string->value);
+            break;
+        case EXPR_LITERAL_BOOL:
+            json_open(buffer, "bool", expr->offset);
+            json_key(buffer, "value");
+            dump_text(buffer, expr->data.literal_bool->value ? "true" : "false");
+            break;
+        case EXPR_LITERAL_NULL:
+            json_open(buffer, "null", expr->offset);
+            break;
+        case EXPR_IDENTIFIER:
+            json_open(buffer, "identifier", expr->offset);
+            json_string_field(buffer, "name", expr->data.identifier->name);
+            break;
+        case EXPR_ASSIGNMENT:
+            json_open(buffer, "assignment", expr->offset);
+            json_string_field(buffer, "name", expr->data.assignment->name);
+            json_optional_expr(buffer, "value", expr->data.assignment->value);
+            break;
+        case EXPR_BINARY:
+            json_open(buffer, "binary", expr->offset);
+            json_string_field(buffer, "operator", operator_symbol(expr->data.binary->operator));
+            json_optional_expr(buffer, "left", expr->data.binary->left);
+            json_optional_expr(buffer, "right", expr->data.binary->right);
+            break;
+        case EXPR_UNARY:
+            json_open(buffer, "unary", expr->offset);
+            json_string_field(buffer, "operator", operator_symbol(expr->data.unary->operator));
+            json_optional_expr(buffer, "operand", expr->data.unary->operand);
+            break;
+        case EXPR_CALL:
+            json_open(buffer, "call", expr->offset);
+            json_string_field(buffer, "name", expr->data.call->name);
+            json_expr_array(buffer, "args", expr->data.call->args->args, expr->data.call->args->arg_count);
+            break;
+        case EXPR_ARG_LIST:
+            json_open(buffer, "arg_list", expr->offset);
+            json_expr_array(buffer, "args", expr->data.arg_list->args, expr->data.arg_list->arg_count);
+            break;
+        case EXPR_INDEX:
+            json_open(buffer, "index", expr->offset);
+            json_optional_expr(buffer, "array", expr->data.index->array);
+            json_optional_expr(buffer, "index", expr->data.index->index);
+            break;
+    }
+    dump_char(buffer, '}');
+}
+
+static void json_for_init(dump_buffer_t *buffer, const stmt_for_init_t *init) {
+    switch (init->kind) {
+        case FOR_INIT_VAR_DECL:
+            json_open(buffer, "var_decl", init->offset);
+            if (init->data.var_decl) {
+                json_string_field(buffer, "name", init->data.var_decl->name);
+                json_string_field(buffer, "type", data_type_to_string(init->data.var_decl->type));
+                json_optional_expr(buffer, "initializer", init->data.var_decl->initializer);
+            }
+            break;
+        case FOR_INIT_ASSIGN:
+            json_open(buffer, "assign", init->offset);
+            if (init->data.assign) {
+                json_string_field(buffer, "name", init->data.assign->name);
+                json_optional_expr(buffer, "value", init->data.assign->value);
+            }
+            break;
+        case FOR_INIT_EXPR:
+            json_open(buffer, "expr", init->offset);
+            if (init->data.expr) {
+                json_optional_expr(buffer, "expression", init->data.expr->expression);
+            }
+            break;
+        case FOR_INIT_NONE:
+            json_open(buffer, "none", init->offset);
+            break;
+    }
+    dump_char(buffer, '}');
+}
+
+static void json_stmt(dump_buffer_t *buffer, const ast_stmt_node_t *stmt) {
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            json_open(buffer, "var_decl", stmt->offset);
+            json_string_field(buffer, "name", stmt->data.var_decl->name);
+            json_string_field(buffer, "type", data_type_to_string(stmt->data.var_decl->type));
+            json_optional_expr(buffer, "initializer", stmt->data.var_decl->initializer);
+            break;
+        case STMT_ASSIGN:
+            json_open(buffer, "assign", stmt->offset);
+            json_string_field(buffer, "name", stmt->data.assign->name);
+            json_string_field(buffer, "operator", assign_operator_symbol(stmt->data.assign->operator));
+            json_optional_expr(buffer, "index", stmt->data.assign->index);
+            json_optional_expr(buffer, "value", stmt->data.assign->value);
+            break;
+        case STMT_RETURN:
+            json_open(buffer, "return", stmt->offset);
+            json_optional_expr(buffer, "value", stmt->data.return_stmt->value);
+            break;
+        case STMT_PRINT:
+            json_open(buffer, "print", stmt->offset);
+            json_expr_array(buffer, "args", stmt->data.print_stmt->args->args, stmt->data.print_stmt->args->arg_count);
+            break;
+        case STMT_BREAK:
+            json_open(buffer, "break", stmt->offset);
+            break;
+        case STMT_CONTINUE:
+            json_open(buffer, "continue", stmt->offset);
+            break;
+        case STMT_EXPR:
+            json_open(buffer, "expr", stmt->offset);
+            json_optional_expr(buffer, "expression", stmt->data.expr_stmt->expression);
+            break;
+        case STMT_BLOCK:
+            json_open(buffer, "block", stmt->offset);
+            json_stmt_array(buffer, "statements", stmt->data.block_stmt->statements, stmt->data.block_stmt->statement_count);
+            break;
+        case STMT_IF: {
+            const stmt_if_t *if_stmt = stmt->data.if_stmt;
+            json_open(buffer, "if", stmt->offset);
+            json_optional_expr(buffer, "condition", if_stmt->if_condition);
+            json_optional_stmt(buffer, "block", if_stmt->if_block);
+            json_key(buffer, "elifs");
+            dump_char(buffer, '[');
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                dump_text(buffer, i > 0 ? ",{\"condition\":" : "{\"condition\":");
+                json_expr(buffer, if_stmt->elif_conditions[i]);
+                json_optional_stmt(buffer, "block", if_stmt->elif_blocks[i]);
+                dump_char(buffer, '}');
+            }
+            dump_char(buffer, ']');
+            json_optional_stmt(buffer, "else", if_stmt->else_block);
+            break;
+        }
+        case STMT_WHILE:
+            json_open(buffer, "while", stmt->offset);
+            json_optional_expr(buffer, "condition", stmt->data.while_stmt->condition);
+            json_optional_stmt(buffer, "block", stmt->data.while_stmt->block);
+            break;
+        case STMT_FOR: {
+            const stmt_for_t *for_stmt = stmt->data.for_stmt;
+            json_open(buffer, "for", stmt->offset);
+            json_key(buffer, "parallel");
+            dump_text(buffer, for_stmt->parallel ? "true" : "false");
+            json_key(buffer, "init");
+            if (for_stmt->init) {
+                json_for_init(buffer, for_stmt->init);
+            } else {
+                dump_text(buffer, "null");
+            }
+            json_optional_expr(buffer, "condition", for_stmt->condition);
+            json_key(buffer, "increment");
+            if (for_stmt->increment) {
+                // The increment keeps no position of its own.
+                dump_text(buffer, "{\"kind\":\"assign\"");
+                json_string_field(buffer, "name", for_stmt->increment->name);
+                json_string_field(buffer, "operator", assign_operator_symbol(for_stmt->increment->operator));
+                json_optional_expr(buffer, "value", for_stmt->increment->value);
+                dump_char(buffer, '}');
+            } else {
+                dump_text(buffer, "null");
+            }
+            json_optional_stmt(buffer, "block", for_stmt->block);
+            break;
+        }
+    }
+    dump_char(buffer, '}');
+}
+
+static void json_decl(dump_buffer_t *buffer, const ast_decl_node_t *decl) {
+    switch (decl->type) {
+        case DECL_FUNCTION: {
+            const decl_function_t *function = decl->data.function_decl;
+            json_open(buffer, "function", decl->offset);
+            json_string_field(buffer, "name", function->name);
+            json_key(buffer, "async");
+            dump_text(buffer, function->is_async ? "true" : "false");
+            json_string_field(buffer, "return_type", data_type_to_string(function->return_type));
+            json_key(buffer, "params");
+            dump_char(buffer, '[');
+            for (size_t i = 0; i < function->param_list->param_count; ++i) {
+                const param_t *param = &function->param_list->params[i];
+                if (i > 0) dump_char(buffer, ',');
+                json_open(buffer, "param", param->offset);
+                json_string_field(buffer, "name", param->name);
+                json_string_field(buffer, "type", data_type_to_string(param->type));
+                dump_char(buffer, '}');
+            }
+            dump_char(buffer, ']');
+            json_stmt_array(buffer, "body", function->body, function->body_count);
+            break;
+        }
+    }
+    dump_char(buffer, '}');
+}
+
+static void json_ast(dump_buffer_t *buffer, const ast_t *ast) {
+    dump_text(buffer, "{\"nodes\":[");
+    for (size_t i = 0; i < ast->node_count; ++i) {
+        const ast_node_t *node = ast->nodes[i];
+        if (i > 0) dump_char(buffer, ',');
+        switch (node->type) {
+            case AST_NODE_CATEGORY_EXPR:
+                json_expr(buffer, node->data.expr_node);
+                break;
+            case AST_NODE_CATEGORY_STMT:
+                json_stmt(buffer, node->data.stmt_node);
+                break;
+            case AST_NODE_CATEGORY_DECL:
+                json_decl(buffer, node->data.decl_node);
+                break;
+        }
+    }
+    dump_text(buffer, "]}\n");
+}
+
+//--------------------------------------- Entry points ------------------------------------------------------------------------------
+
+bool ast_dump_format_from_string(const char *name, ast_dump_format_t *format) {
+    if (strcmp(name, "text") == 0) {
+        *format = AST_DUMP_TEXT;
+    } else if (strcmp(name, "json") == 0) {
+        *format = AST_DUMP_JSON;
+    } else if (strcmp(name, "bin") == 0) {
+        *format = AST_DUMP_BIN;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+char *ast_dump_to_string(const ast_t *ast, ast_dump_format_t format, size_t *length) {
+    dump_buffer_t buffer = {0};
+    buffer.source_map = ast->source_map;
+    switch (format) {
+        case AST_DUMP_TEXT:
+            text_ast(&buffer, ast);
+            break;
+        case AST_DUMP_JSON:
+            json_ast(&buffer, ast);
+            break;
+        case AST_DUMP_BIN:
+            return NULL;
+    }
+    dump_char(&buffer, '\0');
+    *length = buffer.size - 1;
+    return buffer.data;
+}
+
+bool ast_dump(const ast_t *ast, ast_dump_format_t format, int fd) {
+    if (format == AST_DUMP_BIN) {
+        return ast_serialize_fd(ast, 0, fd);
+    }
+    size_t length;
+    char *text = ast_dump_to_string(ast, format, &length);
+    const char *p = text;
+    bool ok = true;
+    while (length > 0) {
+        ssize_t written = write(fd, p, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        p += written;
+        length -= (size_t)written;
+    }
+    free(text);
+    return ok;
+}
@@ -0,0 +1,974 @@
+/**
+ * File Name: ast_serialize.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "include/ast_serialize.h"
+#include "include/utils.h"
+
+//--------------------------------------- Writer ------------------------------------------------------------------------------------
+
+typedef struct ast_writer_struct {
+    char *strings;
+    size_t strings_size;
+    size_t strings_capacity;
+
+    uint32_t *string_slots;     // open addressing set of string offsets (+1, 0 = empty)
+    size_t string_slots_capacity;
+    size_t string_slots_used;
+
+    ast_record_t *records;
+    size_t record_count;
+    size_t record_capacity;
+
+    uint8_t *positions;         // the position table, see ast_serialize.h
+    size_t positions_size;
+    size_t positions_capacity;
+    uint32_t last_offset;
+} ast_writer_t;
+
+static uint64_t fnv1a(const char *data, size_t length, uint64_t hash) {
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t ast_source_hash(const char *source, size_t length) {
+    uint64_t hash = 14695981039346656037ull ^ AST_FILE_VERSION;
+    hash = fnv1a(source, length, hash);
+    return hash ? hash : 1;
+}
+
+static void writer_grow_string_slots(ast_writer_t *writer) {
+    size_t new_capacity = writer->string_slots_capacity ? writer->string_slots_capacity * 2 : 64;
+    uint32_t *slots = calloc(new_capacity, sizeof(uint32_t));
+    CHECK_MEM_ALLOC_ERROR(slots);
+    for (size_t i = 0; i < writer->string_slots_capacity; ++i) {
+        uint32_t entry = writer->string_slots[i];
+        if (!entry) continue;
+        const char *s = writer->strings + entry - 1;
+        size_t index = fnv1a(s, strlen(s), 14695981039346656037ull) & (new_capacity - 1);
+        while (slots[index]) {
+            index = (index + 1) & (new_capacity - 1);
+        }
+        slots[index] = entry;
+    }
+    free(writer->string_slots);
+    writer->string_slots = slots;
+    writer->string_slots_capacity = new_capacity;
+}
+
+static uint32_t writer_intern(ast_writer_t *writer, const char *s) {
+    if (!s) s = "";
+    size_t length = strlen(s);
+    if ((writer->string_slots_used + 1) * 2 > writer->string_slots_capacity) {
+        writer_grow_string_slots(writer);
+    }
+
+    size_t mask = writer->string_slots_capacity - 1;
+    size_t index = fnv1a(s, length, 14695981039346656037ull) & mask;
+    while (writer->string_slots[index]) {
+        uint32_t offset = writer->string_slots[index] - 1;
+        if (strcmp(writer->strings + offset, s) == 0) {
+            return offset;
+        }
+        index = (index + 1) & mask;
+    }
+
+    if (writer->strings_size + length + 1 > writer->strings_capacity) {
+        while (writer->strings_size + length + 1 > writer->strings_capacity) {
+            writer->strings_capacity = writer->strings_capacity ? writer->strings_capacity * 2 : 256;
+        }
+        writer->strings = realloc(writer->strings, writer->strings_capacity);
+        CHECK_MEM_ALLOC_ERROR(writer->strings);
+    }
+    uint32_t offset = (uint32_t)writer->strings_size;
+    memcpy(writer->strings + offset, s, length + 1);
+    writer->strings_size += length + 1;
+    writer->string_slots[index] = offset + 1;
+    writer->string_slots_used++;
+    return offset;
+}
+
+/**
+ * @brief Appends the source offset of the next record to the position table,
+ * as the zigzag varint of its distance from the offset before.
+ */
+static void writer_position(ast_writer_t *writer, uint32_t offset) {
+    if (writer->positions_size + AST_POSITION_MAX_BYTES > writer->positions_capacity) {
+        writer->positions_capacity = writer->positions_capacity ? writer->positions_capacity * 2 : 256;
+        writer->positions = realloc(writer->positions, writer->positions_capacity);
+        CHECK_MEM_ALLOC_ERROR(writer->positions);
+    }
+    int64_t delta = (int64_t)offset - (int64_t)writer->last_offset;
+    uint64_t zigzag = delta < 0 ? ((uint64_t)-delta << 1) - 1 : (uint64_t)delta << 1;
+    while (zigzag >= 0x80) {
+        writer->positions[writer->positions_size++] = (uint8_t)(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    writer->positions[writer->positions_size++] = (uint8_t)zigzag;
+    writer->last_offset = offset;
+}
+
+static ast_record_t *writer_emit(ast_writer_t *writer, ast_record_kind_t kind, uint32_t offset) {
+    if (writer->record_count >= writer->record_capacity) {
+        writer->record_capacity = writer->record_capacity ? writer->record_capacity * 2 : 64;
+        writer->records = realloc(writer->records, writer->record_capacity * sizeof(ast_record_t));
+        CHECK_MEM_ALLOC_ERROR(writer->records);
+    }
+    ast_record_t *record = &writer->records[writer->record_count];
+    writer->record_count++;
+    writer_position(writer, offset);
+
+    memset(record, 0, sizeof(*record));
+    record->kind = (uint8_t)kind;
+    return record;
+}
+
+/**
+ * @brief Stores the 64 bits of a literal, the low half in `value` and the
+ * high half in `count`.
+ */
+static void record_set_bits(ast_record_t *record, const void *literal) {
+    uint64_t bits;
+    memcpy(&bits, literal, sizeof(bits));
+    record->value = (uint32_t)bits;
+    record->count = (uint32_t)(bits >> 32);
+}
+
+static void write_expr(ast_writer_t *writer, const ast_expr_node_t *expr);
+static void write_stmt(ast_writer_t *writer, const ast_stmt_node_t *stmt);
+
+static void write_none(ast_writer_t *writer) {
+    writer_emit(writer, AST_RECORD_NONE, writer->last_offset);
+}
+
+static void write_arg_list(ast_writer_t *writer, const expr_arg_list_t *args) {
+    for (size_t i = 0; i < args->arg_count; ++i) {
+        write_expr(writer, args->args[i]);
+    }
+}
+
+static void write_expr(ast_writer_t *writer, const ast_expr_node_t *expr) {
+    if (!expr) {
+        write_none(writer);
+        return;
+    }
+
+    ast_record_t *record;
+    switch (expr->type) {
+        case EXPR_LITERAL_INT:
+            record = writer_emit(writer, AST_RECORD_EXPR_LITERAL_INT, expr->offset);
+            record_set_bits(record, &expr->data.literal_int->value);
+            break;
+        case EXPR_LITERAL_FLOAT:
+            record = writer_emit(writer, AST_RECORD_EXPR_LITERAL_FLOAT, expr->offset);
+            record_set_bits(record, &expr->data.literal_float->value);
+            break;
+        case EXPR_LITERAL_STRING:
+            record = writer_emit(writer, AST_RECORD_EXPR_LITERAL_STRING, expr->offset);
+            record->value = writer_intern(writer, expr->data.literal_string->value);
+            break;
+        case EXPR_LITERAL_BOOL:
+            record = writer_emit(writer, AST_RECORD_EXPR_LITERAL_BOOL, expr->offset);
+            record->value = expr->data.literal_bool->value ? 1 : 0;
+            break;
+        case EXPR_LITERAL_NULL:
+            writer_emit(writer, AST_RECORD_EXPR_LITERAL_NULL, expr->offset);
+            break;
+        case EXPR_IDENTIFIER:
+            record = writer_emit(writer, AST_RECORD_EXPR_IDENTIFIER, expr->offset);
+            record->value = writer_intern(writer, expr->data.identifier->name);
+            break;
+        case EXPR_BINARY:
+            record = writer_emit(writer, AST_RECORD_EXPR_BINARY, expr->offset);
+            record->op = (uint8_t)expr->data.binary->operator;
+            write_expr(writer, expr->data.binary->left);
+            write_expr(writer, expr->data.binary->right);
+            break;
+        case EXPR_UNARY:
+            record = writer_emit(writer, AST_RECORD_EXPR_UNARY, expr->offset);
+            record->op = (uint8_t)expr->data.unary->operator;
+            write_expr(writer, expr->data.unary->operand);
+            break;
+        case EXPR_ASSIGNMENT:
+            record = writer_emit(writer, AST_RECORD_EXPR_ASSIGNMENT, expr->offset);
+            record->value = writer_intern(writer, expr->data.assignment->name);
+            write_expr(writer, expr->data.assignment->value);
+            break;
+        case EXPR_ARG_LIST:
+            record = writer_emit(writer, AST_RECORD_EXPR_ARG_LIST, expr->offset);
+            record->count = (uint32_t)expr->data.arg_list->arg_count;
+            write_arg_list(writer, expr->data.arg_list);
+            break;
+        case EXPR_CALL:
+            record = writer_emit(writer, AST_RECORD_EXPR_CALL, expr->offset);
+            record->value = writer_intern(writer, expr->data.call->name);
+            record->count = (uint32_t)expr->data.call->args->arg_count;
+            write_arg_list(writer, expr->data.call->args);
+            break;
+        case EXPR_INDEX:
+            writer_emit(writer, AST_RECORD_EXPR_INDEX, expr->offset);
+            write_expr(writer, expr->data.index->array);
+            write_expr(writer, expr->data.index->index);
+            break;
+    }
+}
+
+static void write_for_init(ast_writer_t *writer, const stmt_for_init_t *init) {
+    if (!init) {
+        write_none(writer);
+        return;
+    }
+
+    ast_record_t *record = writer_emit(writer, AST_RECORD_FOR_INIT, init->offset);
+    record->op = (uint8_t)init->kind;
+    switch (init->kind) {
+        case FOR_INIT_VAR_DECL:
+            record->value = writer_intern(writer, init->data.var_decl->name);
+            record->count = (uint32_t)init->data.var_decl->type;
+            write_expr(writer, init->data.var_decl->initializer);
+            break;
+        case FOR_INIT_ASSIGN:
+            record->value = writer_intern(writer, init->data.assign->name);
+            write_expr(writer, init->data.assign->value);
+            break;
+        case FOR_INIT_EXPR:
+            write_expr(writer, init->data.expr->expression);
+            break;
+        case FOR_INIT_NONE:
+            break;
+    }
+}
+
+static void write_stmt(ast_writer_t *writer, const ast_stmt_node_t *stmt) {
+    if (!stmt) {
+        write_none(writer);
+        return;
+    }
+
+    ast_record_t *record;
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            record = writer_emit(writer, AST_RECORD_STMT_VAR_DECL, stmt->offset);
+            record->value = writer_intern(writer, stmt->data.var_decl->name);
+            record->op = (uint8_t)stmt->data.var_decl->type;
+            write_expr(writer, stmt->data.var_decl->initializer);
+            break;
+        case STMT_ASSIGN:
+            record = writer_emit(writer, AST_RECORD_STMT_ASSIGN, stmt->offset);
+            record->value = writer_intern(writer, stmt->data.assign->name);
+            record->op = (uint8_t)stmt->data.assign->operator;
+            write_expr(writer, stmt->data.assign->index);
+            write_expr(writer, stmt->data.assign->value);
+            break;
+        case STMT_RETURN:
+            writer_emit(writer, AST_RECORD_STMT_RETURN, stmt->offset);
+            write_expr(writer, stmt->data.return_stmt->value);
+            break;
+        case STMT_PRINT:
+            record = writer_emit(writer, AST_RECORD_STMT_PRINT, stmt->offset);
+            record->count = (uint32_t)stmt->data.print_stmt->args->arg_count;
+            write_arg_list(writer, stmt->data.print_stmt->args);
+            break;
+        case STMT_BREAK:
+            writer_emit(writer, AST_RECORD_STMT_BREAK, stmt->offset);
+            break;
+        case STMT_CONTINUE:
+            writer_emit(writer, AST_RECORD_STMT_CONTINUE, stmt->offset);
+            break;
+        case STMT_IF: {
+            stmt_if_t *if_stmt = stmt->data.if_stmt;
+            record = writer_emit(writer, AST_RECORD_STMT_IF, stmt->offset);
+            record->count = (uint32_t)if_stmt->elif_blocks_count;
+            write_expr(writer, if_stmt->if_condition);
+            write_stmt(writer, if_stmt->if_block);
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                write_expr(writer, if_stmt->elif_conditions[i]);
+                write_stmt(writer, if_stmt->elif_blocks[i]);
+            }
+            write_stmt(writer, if_stmt->else_block);
+            break;
+        }
+        case STMT_WHILE:
+            writer_emit(writer, AST_RECORD_STMT_WHILE, stmt->offset);
+            write_expr(writer, stmt->data.while_stmt->condition);
+            write_stmt(writer, stmt->data.while_stmt->block);
+            break;
+        case STMT_FOR: {
+            stmt_for_t *for_stmt = stmt->data.for_stmt;
+            record = writer_emit(writer, AST_RECORD_STMT_FOR, stmt->offset);
+            record->op = for_stmt->parallel ? 1 : 0;
+            write_for_init(writer, for_stmt->init);
+            write_expr(writer, for_stmt->condition);
+            if (for_stmt->increment) {
+                record = writer_emit(writer, AST_RECORD_FOR_INCREMENT, writer->last_offset);
+                record->value = writer_intern(writer, for_stmt->increment->name);
+                record->op = (uint8_t)for_stmt->increment->operator;
+                write_expr(writer, for_stmt->increment->value);
+            } else {
+                write_none(writer);
+            }
+            write_stmt(writer, for_stmt->block);
+            break;
+        }
+        case STMT_EXPR:
+            writer_emit(writer, AST_RECORD_STMT_EXPR, stmt->offset);
+            write_expr(writer, stmt->data.expr_stmt->expression);
+            break;
+        case STMT_BLOCK:
+            record = writer_emit(writer, AST_RECORD_STMT_BLOCK, stmt->offset);
+            record->count = (uint32_t)stmt->data.block_stmt->statement_count;
+            for (size_t i = 0; i < stmt->data.block_stmt->statement_count; ++i) {
+                write_stmt(writer, stmt->data.block_stmt->statements[i]);
+            }
+            break;
+    }
+}
+
+static void write_decl(ast_writer_t *writer, const ast_decl_node_t *decl) {
+    switch (decl->type) {
+        case DECL_FUNCTION: {
+            decl_function_t *function = decl->data.function_decl;
+            ast_record_t *record = writer_emit(writer, AST_RECORD_DECL_FUNCTION, decl->offset);
+            record->value = writer_intern(writer, function->name);
+            record->op = (uint8_t)function->return_type;
+            record->count = (uint32_t)function->body_count;
+            record->flags = function->is_async ? AST_RECORD_FLAG_ASYNC : 0;
+
+            param_list_t *param_list = function->param_list;
+            record = writer_emit(writer, AST_RECORD_PARAM_LIST, param_list->offset);
+            record->count = (uint32_t)param_list->param_count;
+            for (size_t i = 0; i < param_list->param_count; ++i) {
+                param_t *param = &param_list->params[i];
+                record = writer_emit(writer, AST_RECORD_PARAM, param->offset);
+                record->value = writer_intern(writer, param->name);
+                record->op = (uint8_t)param->type;
+            }
+
+            for (size_t i = 0; i < function->body_count; ++i) {
+                write_stmt(writer, function->body[i]);
+            }
+            break;
+        }
+    }
+}
+
+static void write_ast_node(ast_writer_t *writer, const ast_node_t *node) {
+    switch (node->type) {
+        case AST_NODE_CATEGORY_EXPR:
+            writer_emit(writer, AST_RECORD_NODE_EXPR, node->offset);
+            write_expr(writer, node->data.expr_node);
+            break;
+        case AST_NODE_CATEGORY_STMT:
+            writer_emit(writer, AST_RECORD_NODE_STMT, node->offset);
+            write_stmt(writer, node->data.stmt_node);
+            break;
+        case AST_NODE_CATEGORY_DECL:
+            writer_emit(writer, AST_RECORD_NODE_DECL, node->offset);
+            write_decl(writer, node->data.decl_node);
+            break;
+    }
+}
+
+static bool write_all(int fd, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+bool ast_serialize_fd(const ast_t *ast, uint64_t source_hash, int fd) {
+    ast_writer_t writer = {0};
+    for (size_t i = 0; i < ast->node_count; ++i) {
+        write_ast_node(&writer, ast->nodes[i]);
+    }
+
+    // Keep the tables 8 byte aligned so the mapped file can be read in place.
+    size_t strings_padded = (writer.strings_size + 7) & ~(size_t)7;
+
+    ast_file_header_t header = {0};
+    memcpy(header.magic, AST_FILE_MAGIC, 4);
+    header.version = AST_FILE_VERSION;
+    header.source_hash = source_hash;
+    header.string_table_offset = sizeof(ast_file_header_t);
+    header.string_table_size = (uint32_t)writer.strings_size;
+    header.node_table_offset = (uint32_t)(header.string_table_offset + strings_padded);
+    header.node_count = (uint32_t)writer.record_count;
+    header.position_table_offset = (uint32_t)(header.node_table_offset + writer.record_count * sizeof(ast_record_t));
+    header.position_table_size = (uint32_t)writer.positions_size;
+    header.root_count = (uint32_t)ast->node_count;
+
+    static const char padding[8] = {0};
+    bool ok = write_all(fd, &header, sizeof(header))
+        && write_all(fd, writer.strings, writer.strings_size)
+        && write_all(fd, padding, strings_padded - writer.strings_size)
+        && write_all(fd, writer.records, writer.record_count * sizeof(ast_record_t))
+        && write_all(fd, writer.positions, writer.positions_size);
+
+    free(writer.strings);
+    free(writer.string_slots);
+    free(writer.records);
+    free(writer.positions);
+    return ok;
+}
+
+bool ast_serialize(const ast_t *ast, uint64_t source_hash, const char *path) {
+    size_t path_length = strlen(path);
+    char *tmp_path = malloc(path_length + 32);
+    CHECK_MEM_ALLOC_ERROR(tmp_path);
+    snprintf(tmp_path, path_length + 32, "%s.%ld.tmp", path, (long)getpid());
+
+    bool ok = false;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        ok = ast_serialize_fd(ast, source_hash, fd);
+        ok = (close(fd) == 0) && ok;
+        ok = ok && rename(tmp_path, path) == 0;
+        if (!ok) {
+            unlink(tmp_path);
+        }
+    }
+
+    free(tmp_path);
+    return ok;
+}
+
+//--------------------------------------- Reader ------------------------------------------------------------------------------------
+
+typedef struct ast_reader_struct {
+    const char *strings;
+    size_t strings_size;
+    const ast_record_t *records;
+    size_t record_count;
+    size_t index;
+    const uint8_t *positions;
+    size_t positions_size;
+    size_t position_at;
+    uint32_t offset;
+    size_t expr_depth;
+    size_t stmt_depth;
+    bool failed;
+} ast_reader_t;
+
+/**
+ * @brief Decodes the offset of the next record, undoing writer_position().
+ */
+static bool reader_position(ast_reader_t *reader) {
+    uint64_t zigzag = 0;
+    for (unsigned shift = 0; shift < 7 * AST_POSITION_MAX_BYTES; shift += 7) {
+        if (reader->position_at >= reader->positions_size) break;
+        uint8_t byte = reader->positions[reader->position_at++];
+        zigzag |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            int64_t delta = (zigzag & 1) ? -(int64_t)(zigzag >> 1) - 1 : (int64_t)(zigzag >> 1);
+            int64_t offset = (int64_t)reader->offset + delta;
+            if (offset < 0 || offset > (int64_t)UINT32_MAX) return false;
+            reader->offset = (uint32_t)offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const ast_record_t *reader_next(ast_reader_t *reader, uint32_t *offset) {
+    if (reader->failed || reader->index >= reader->record_count || !reader_position(reader)) {
+        reader->failed = true;
+        return NULL;
+    }
+    *offset = reader->offset;
+    return &reader->records[reader->index++];
+}
+
+static const char *reader_string(ast_reader_t *reader, uint32_t offset) {
+    if (offset >= reader->strings_size) {
+        reader->failed = true;
+        return "";
+    }
+    return reader->strings + offset;
+}
+
+/**
+ * @brief Checks a list length read from the file before anything is allocated
+ * for it: each element takes at least `records_each` of the records left, so
+ * a larger count is damage, and fails the read rather than allocating for it.
+ *
+ * @return `count`, or 0 once the read has failed.
+ */
+static uint32_t reader_count(ast_reader_t *reader, uint32_t count, size_t records_each) {
+    if (reader->failed || (uint64_t)count * records_each > reader->record_count - reader->index) {
+        reader->failed = true;
+        return 0;
+    }
+    return count;
+}
+
+static ast_expr_node_t *read_expr(ast_reader_t *reader);
+static ast_stmt_node_t *read_stmt(ast_reader_t *reader);
+
+static expr_arg_list_t *read_arg_list(ast_reader_t *reader, uint32_t count) {
+    count = reader_count(reader, count, 1);
+    expr_arg_list_t *arg_list = malloc(sizeof(expr_arg_list_t));
+    CHECK_MEM_ALLOC_ERROR(arg_list);
+    arg_list->args = malloc(sizeof(ast_expr_node_t *) * (count ? count : 1));
+    CHECK_MEM_ALLOC_ERROR(arg_list->args);
+    arg_list->arg_count = 0;
+    for (uint32_t i = 0; i < count && !reader->failed; ++i) {
+        arg_list->args[arg_list->arg_count++] = read_expr(reader);
+    }
+    return arg_list;
+}
+
+/**
+ * @brief Reads back the literal record_set_bits() stored.
+ */
+static void record_bits(const ast_record_t *record, void *literal) {
+    uint64_t bits = (uint64_t)record->count << 32 | record->value;
+    memcpy(literal, &bits, sizeof(bits));
+}
+
+static ast_expr_node_t *read_expr_record(ast_reader_t *reader) {
+    uint32_t offset;
+    const ast_record_t *record = reader_next(reader, &offset);
+    if (!record) return NULL;
+
+    switch ((ast_record_kind_t)record->kind) {
+        case AST_RECORD_NONE:
+            return NULL;
+        case AST_RECORD_EXPR_LITERAL_INT: {
+            int64_t value;
+            record_bits(record, &value);
+            return init_expr_literal_int(value, offset);
+        }
+        case AST_RECORD_EXPR_LITERAL_FLOAT: {
+            double value;
+            record_bits(record, &value);
+            return init_expr_literal_float(value, offset);
+        }
+        case AST_RECORD_EXPR_LITERAL_STRING:
+            return init_expr_literal_string(reader_string(reader, record->value), offset);
+        case AST_RECORD_EXPR_LITERAL_BOOL:
+            return init_expr_literal_bool(record->value != 0, offset);
+        case AST_RECORD_EXPR_LITERAL_NULL:
+            return init_expr_literal_null(offset);
+        case AST_RECORD_EXPR_IDENTIFIER:
+            return init_expr_identifier(reader_string(reader, record->value), offset);
+        case AST_RECORD_EXPR_BINARY: {
+            ast_expr_node_t *left = read_expr(reader);
+            ast_expr_node_t *right = read_expr(reader);
+            return init_expr_binary((token_type_t)record->op, left, right, offset);
+        }
+        case AST_RECORD_EXPR_UNARY: {
+            ast_expr_node_t *operand = read_expr(reader);
+            return init_expr_unary((token_type_t)record->op, operand, offset);
+        }
+        case AST_RECORD_EXPR_ASSIGNMENT: {
+            const char *name = reader_string(reader, record->value);
+            ast_expr_node_t *value = read_expr(reader);
+            return init_expr_assignment(name, value, offset);
+        }
+        case AST_RECORD_EXPR_ARG_LIST: {
+            expr_arg_list_t *arg_list = read_arg_list(reader, record->count);
+            ast_expr_node_t *node = init_expr_arg_list(arg_list->args, arg_list->arg_count, offset);
+            free(arg_list);
+            return node;
+        }
+        case AST_RECORD_EXPR_CALL: {
+            const char *name = reader_string(reader, record->value);
+            return init_expr_call(name, read_arg_list(reader, record->count), offset);
+        }
+        case AST_RECORD_EXPR_INDEX: {
+            ast_expr_node_t *array = read_expr(reader);
+            ast_expr_node_t *index = read_expr(reader);
+            return init_expr_index(array, index, offset);
+        }
+        default:
+            reader->failed = true;
+            return NULL;
+    }
+}
+
+/**
+ * @brief Reads an expression, failing on one higher than the parser allows:
+ * a damaged file must not overflow the stack of the passes after.
+ */
+static ast_expr_node_t *read_expr(ast_reader_t *reader) {
+    if (reader->expr_depth >= AST_MAX_HEIGHT) {
+        reader->failed = true;
+        return NULL;
+    }
+    reader->expr_depth++;
+    ast_expr_node_t *expr = read_expr_record(reader);
+    reader->expr_depth--;
+    return expr;
+}
+
+static stmt_for_init_t *read_for_init(ast_reader_t *reader) {
+    uint32_t offset;
+    const ast_record_t *record = reader_next(reader, &offset);
+    if (!record || record->kind == AST_RECORD_NONE) return NULL;
+    if (record->kind != AST_RECORD_FOR_INIT) {
+        reader->failed = true;
+        return NULL;
+    }
+
+    switch ((for_init_kind_t)record->op) {
+        case FOR_INIT_VAR_DECL: {
+            const char *name = reader_string(reader, record->value);
+            return init_stmt_for_init_var_decl(name, (data_type_t)record->count, read_expr(reader), offset);
+        }
+        case FOR_INIT_ASSIGN: {
+            const char *name = reader_string(reader, record->value);
+            return init_stmt_for_init_assign(name, read_expr(reader), offset);
+        }
+        case FOR_INIT_EXPR:
+            return init_stmt_for_init_expr(read_expr(reader), offset);
+        case FOR_INIT_NONE: {
+            stmt_for_init_t *init = malloc(sizeof(stmt_for_init_t));
+            CHECK_MEM_ALLOC_ERROR(init);
+            init->kind = FOR_INIT_NONE;
+            init->offset = offset;
+            return init;
+        }
+    }
+    reader->failed = true;
+    return NULL;
+}
+
+static stmt_assign_t *read_for_increment(ast_reader_t *reader) {
+    uint32_t offset;
+    const ast_record_t *record = reader_next(reader, &offset);
+    if (!record || record->kind == AST_RECORD_NONE) return NULL;
+    if (record->kind != AST_RECORD_FOR_INCREMENT) {
+        reader->failed = true;
+        return NULL;
+    }
+
+    stmt_assign_t *increment = malloc(sizeof(stmt_assign_t));
+    CHECK_MEM_ALLOC_ERROR(increment);
+    increment->name = strdup(reader_string(reader, record->value));
+    increment->operator = (token_type_t)record->op;
+    increment->value = read_expr(reader);
+    increment->index = NULL;
+    return increment;
+}
+
+/**
+ * @brief Reads `count` statements, a count the caller has put through reader_count().
+ */
+static ast_stmt_node_t **read_stmt_list(ast_reader_t *reader, uint32_t count) {
+    ast_stmt_node_t **statements = malloc(sizeof(ast_stmt_node_t *) * (count ? count : 1));
+    CHECK_MEM_ALLOC_ERROR(statements);
+    for (uint32_t i = 0; i < count; ++i) {
+        statements[i] = reader->failed ? NULL : read_stmt(reader);
+    }
+    return statements;
+}
+
+static ast_stmt_node_t *read_stmt_record(ast_reader_t *reader) {
+    uint32_t offset;
+    const ast_record_t *record = reader_next(reader, &offset);
+    if (!record) return NULL;
+
+    switch ((ast_record_kind_t)record->kind) {
+        case AST_RECORD_NONE:
+            return NULL;
+        case AST_RECORD_STMT_VAR_DECL: {
+            const char *name = reader_string(reader, record->value);
+            return init_stmt_var_decl(name, (data_type_t)record->op, read_expr(reader), offset);
+        }
+        case AST_RECORD_STMT_ASSIGN: {
+            const char *name = reader_string(reader, record->value);
+            ast_expr_node_t *index = read_expr(reader);
+            return init_stmt_index_assign(name, index, (token_type_t)record->op, read_expr(reader), offset);
+        }
+        case AST_RECORD_STMT_RETURN:
+            return init_stmt_return(read_expr(reader), offset);
+        case AST_RECORD_STMT_PRINT:
+            return init_stmt_print(read_arg_list(reader, record->count), offset);
+        case AST_RECORD_STMT_BREAK:
+            return init_stmt_break(offset);
+        case AST_RECORD_STMT_CONTINUE:
+            return init_stmt_continue(offset);
+        case AST_RECORD_STMT_IF: {
+            uint32_t elif_count = record->count;
+            ast_expr_node_t *if_condition = read_expr(reader);
+            ast_stmt_node_t *if_block = read_stmt(reader);
+            elif_count = reader_count(reader, elif_count, 2);
+            ast_expr_node_t **elif_conditions = malloc(sizeof(ast_expr_node_t *) * (elif_count ? elif_count : 1));
+            CHECK_MEM_ALLOC_ERROR(elif_conditions);
+            ast_stmt_node_t **elif_blocks = malloc(sizeof(ast_stmt_node_t *) * (elif_count ? elif_count : 1));
+            CHECK_MEM_ALLOC_ERROR(elif_blocks);
+            for (uint32_t i = 0; i < elif_count; ++i) {
+                elif_conditions[i] = reader->failed ? NULL : read_expr(reader);
+                elif_blocks[i] = reader->failed ? NULL : read_stmt(reader);
+            }
+            ast_stmt_node_t *else_block = read_stmt(reader);
+            return init_stmt_if(if_condition, if_block, elif_conditions, elif_count, elif_blocks, else_block, offset);
+        }
+        case AST_RECORD_STMT_WHILE: {
+            ast_expr_node_t *condition = read_expr(reader);
+            ast_stmt_node_t *block = read_stmt(reader);
+            return init_stmt_while(condition, block, offset);
+        }
+        case AST_RECORD_STMT_FOR: {
+            bool parallel = record->op != 0;
+            stmt_for_init_t *init = read_for_init(reader);
+            ast_expr_node_t *condition = read_expr(reader);
+            stmt_assign_t *increment = read_for_increment(reader);
+            ast_stmt_node_t *block = read_stmt(reader);
+            ast_stmt_node_t *stmt = init_stmt_for(init, condition, increment, block, offset);
+            stmt->data.for_stmt->parallel = parallel;
+            return stmt;
+        }
+        case AST_RECORD_STMT_EXPR:
+            return init_stmt_expr(read_expr(reader), offset);
+        case AST_RECORD_STMT_BLOCK: {
+            uint32_t count = reader_count(reader, record->count, 1);
+            return init_stmt_block(read_stmt_list(reader, count), count, offset);
+        }
+        default:
+            reader->failed = true;
+            return NULL;
+    }
+}
+
+/**
+ * @brief Reads a statement, failing as read_expr() does. Each block the
+ * parser allows may sit in an if, for or while statement, two levels here.
+ */
+static ast_stmt_node_t *read_stmt(ast_reader_t *reader) {
+    if (reader->stmt_depth > 2 * AST_MAX_DEPTH) {
+        reader->failed = true;
+        return NULL;
+    }
+    reader->stmt_depth++;
+    ast_stmt_node_t *stmt = read_stmt_record(reader);
+    reader->stmt_depth--;
+    return stmt;
+}
+
+static ast_decl_node_t *read_decl(ast_reader_t *reader) {
+    uint32_t offset;
+    const ast_record_t *record = reader_next(reader, &offset);
+    if (!record || record->kind != AST_RECORD_DECL_FUNCTION) {
+        reader->failed = true;
+        return NULL;
+    }
+    const char *name = reader_string(reader, record->value);
+    data_type_t return_type = (data_type_t)record->op;
+    uint32_t body_count = record->count;
+    bool is_async = (record->flags & AST_RECORD_FLAG_ASYNC) != 0;
+
+    uint32_t list_offset;
+    const ast_record_t *list_record = reader_next(reader, &list_offset);
+    if (!list_record || list_record->kind != AST_RECORD_PARAM_LIST) {
+        reader->failed = true;
+        return NULL;
+    }
+    uint32_t param_count = reader_count(reader, list_record->count, 1);
+    param_t *params = malloc(sizeof(param_t) * (param_count ? param_count : 1));
+    CHECK_MEM_ALLOC_ERROR(params);
+    for (uint32_t i = 0; i < param_count; ++i) {
+        uint32_t param_offset;
+        const ast_record_t *param_record = reader_next(reader, &param_offset);
+        if (!param_record || param_record->kind != AST_RECORD_PARAM) {
+            reader->failed = true;
+            param_count = i;
+            break;
+        }
+        params[i].name = strdup(reader_string(reader, param_record->value));
+        params[i].type = (data_type_t)param_record->op;
+        params[i].offset = param_offset;
+    }
+    param_list_t *param_list = init_decl_param_list(params, param_count, list_offset);
+
+    body_count = reader_count(reader, body_count, 1);
+    ast_stmt_node_t **body = read_stmt_list(reader, body_count);
+    ast_decl_node_t *decl = init_decl_function(name, return_type, param_list, body, body_count, offset);
+    decl->data.function_decl->is_async = is_async;
+    return decl;
+}
+
+static ast_node_t *read_ast_node(ast_reader_t *reader) {
+    uint32_t offset;
+    const ast_record_t *record = reader_next(reader, &offset);
+    if (!record) return NULL;
+
+    ast_node_t *node;
+    switch ((ast_record_kind_t)record->kind) {
+        case AST_RECORD_NODE_EXPR:
+            node = init_ast_node(AST_NODE_CATEGORY_EXPR, offset);
+            node->data.expr_node = read_expr(reader);
+            return node;
+        case AST_RECORD_NODE_STMT:
+            node = init_ast_node(AST_NODE_CATEGORY_STMT, offset);
+            node->data.stmt_node = read_stmt(reader);
+            return node;
+        case AST_RECORD_NODE_DECL:
+            node = init_ast_node(AST_NODE_CATEGORY_DECL, offset);
+            node->data.decl_node = read_decl(reader);
+            return node;
+        default:
+            reader->failed = true;
+            return NULL;
+    }
+}
+
+ast_t *ast_deserialize(const char *path, uint64_t expected_hash) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ast_file_header_t)) {
+        close(fd);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return NULL;
+
+    const char *base = mapping;
+    const ast_file_header_t *header = mapping;
+    bool valid = memcmp(header->magic, AST_FILE_MAGIC, 4) == 0
+        && header->version == AST_FILE_VERSION
+        && (expected_hash == 0 || header->source_hash == expected_hash)
+        && (size_t)header->string_table_offset + header->string_table_size <= size
+        && (header->string_table_size == 0 || base[header->string_table_offset + header->string_table_size - 1] == '\0')
+        && header->node_table_offset % 4 == 0
+        && (size_t)header->node_table_offset + (size_t)header->node_count * sizeof(ast_record_t) <= size
+        && (size_t)header->position_table_offset + header->position_table_size <= size;
+    if (!valid) {
+        munmap(mapping, size);
+        return NULL;
+    }
+
+    ast_reader_t reader = {
+        .strings = base + header->string_table_offset,
+        .strings_size = header->string_table_size,
+        .records = (const ast_record_t *)(base + header->node_table_offset),
+        .record_count = header->node_count,
+        .index = 0,
+        .positions = (const uint8_t *)(base + header->position_table_offset),
+        .positions_size = header->position_table_size,
+        .position_at = 0,
+        .offset = 0,
+        .failed = false,
+    };
+
+    ast_t *ast = init_ast();
+    for (uint32_t i = 0; i < header->root_count && !reader.failed; ++i) {
+        ast_node_t *node = read_ast_node(&reader);
+        if (!node) break;
+        if (ast->node_count >= ast->nodes_capacity) {
+            ast->nodes_capacity *= 2;
+            ast_node_t **new_nodes = realloc(ast->nodes, ast->nodes_capacity * sizeof(ast_node_t *));
+            CHECK_MEM_ALLOC_ERROR(new_nodes);
+            ast->nodes = new_nodes;
+        }
+        ast->nodes[ast->node_count++] = node;
+    }
+
+    bool failed = reader.failed || reader.index != reader.record_count;
+    munmap(mapping, size);
+    if (failed) {
+        free_ast(ast);
+        return NULL;
+    }
+    return ast;
+}
+
+//--------------------------------------- Cache -------------------------------------------------------------------------------------
+
+static char *read_source_file(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+    if (file_size < 0) {
+        fclose(file);
+        return NULL;
+    }
+    char *buffer = malloc((size_t)file_size + 1);
+    CHECK_MEM_ALLOC_ERROR(buffer);
+    *length = fread(buffer, 1, (size_t)file_size, file);
+    buffer[*length] = '\0';
+    fclose(file);
+    return buffer;
+}
+
+static char *cache_entry_path(const char *cache_dir, uint64_t hash) {
+    size_t size = strlen(cache_dir) + 1 + 16 + sizeof(AST_CACHE_EXTENSION);
+    char *path = malloc(size);
+    CHECK_MEM_ALLOC_ERROR(path);
+    snprintf(path, size, "%s/%016llx%s", cache_dir, (unsigned long long)hash, AST_CACHE_EXTENSION);
+    return path;
+}
+
+static bool source_hash_of(const char *source_path, uint64_t *hash) {
+    size_t length = 0;
+    char *source = read_source_file(source_path, &length);
+    if (!source) return false;
+    *hash = ast_source_hash(source, length);
+    free(source);
+    return true;
+}
+
+ast_t *ast_cache_load(const char *cache_dir, const char *source_path) {
+    size_t length = 0;
+    char *source = read_source_file(source_path, &length);
+    if (!source) return NULL;
+    if (length > SOURCE_MAX_LENGTH) {
+        free(source);
+        return NULL;
+    }
+
+    uint64_t hash = ast_source_hash(source, length);
+    char *path = cache_entry_path(cache_dir, hash);
+    ast_t *ast = ast_deserialize(path, hash);
+    free(path);
+    if (!ast) {
+        free(source);
+        return NULL;
+    }
+    ast->source_map = init_source_map(source, length);
+    return ast;
+}
+
+bool ast_cache_store(const char *cache_dir, const char *source_path, const ast_t *ast) {
+    uint64_t hash;
+    if (!source_hash_of(source_path, &hash)) return false;
+
+    if (mkdir(cache_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Could not create cache directory: %s\n", cache_dir);
+        return false;
+    }
+
+    char *path = cache_entry_path(cache_dir, hash);
+    bool ok = ast_serialize(ast, hash, path);
+    free(path);
+    return ok;
+}
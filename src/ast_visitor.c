@@ -0,0 +1,230 @@
+/**
+ * File Name: ast_visitor.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include "include/ast_visitor.h"
+#include "include/utils.h"
+
+ast_visitor_t *init_ast_visitor(void) {
+    ast_visitor_t *visitor = calloc(1, sizeof(ast_visitor_t));
+    CHECK_MEM_ALLOC_ERROR(visitor);
+    return visitor;
+}
+
+void free_ast_visitor(ast_visitor_t *visitor) {
+    free(visitor);
+}
+
+//--------------------------------------- Adding Passes -----------------------------------------------------------------------------
+
+static void add_expr_hook(ast_expr_hook_entry_t *entries, unsigned char *count, ast_expr_hook_t hook, void *context) {
+    if (hook) entries[(*count)++] = (ast_expr_hook_entry_t){ hook, context };
+}
+
+static void add_stmt_hook(ast_stmt_hook_entry_t *entries, unsigned char *count, ast_stmt_hook_t hook, void *context) {
+    if (hook) entries[(*count)++] = (ast_stmt_hook_entry_t){ hook, context };
+}
+
+static void add_decl_hook(ast_decl_hook_entry_t *entries, unsigned char *count, ast_decl_hook_t hook, void *context) {
+    if (hook) entries[(*count)++] = (ast_decl_hook_entry_t){ hook, context };
+}
+
+#define ADD_KIND_HOOKS(category, kind, name) \
+    add_##category##_hook(visitor->pre_##category[kind], &visitor->pre_##category##_count[kind], \
+                          pass->pre_##category, pass->context); \
+    add_##category##_hook(visitor->pre_##category[kind], &visitor->pre_##category##_count[kind], \
+                          pass->pre_##name, pass->context); \
+    add_##category##_hook(visitor->post_##category[kind], &visitor->post_##category##_count[kind], \
+                          pass->post_##name, pass->context); \
+    add_##category##_hook(visitor->post_##category[kind], &visitor->post_##category##_count[kind], \
+                          pass->post_##category, pass->context);
+
+#define ADD_EXPR_HOOKS(kind, name, description) ADD_KIND_HOOKS(expr, kind, name)
+#define ADD_STMT_HOOKS(kind, name, description) ADD_KIND_HOOKS(stmt, kind, name)
+#define ADD_DECL_HOOKS(kind, name, description) ADD_KIND_HOOKS(decl, kind, name)
+
+bool ast_visitor_add_pass(ast_visitor_t *visitor, const ast_pass_t *pass) {
+    if (visitor->pass_count == AST_VISITOR_MAX_PASSES) return false;
+    visitor->pass_count++;
+
+    AST_EXPR_KINDS(ADD_EXPR_HOOKS)
+    AST_STMT_KINDS(ADD_STMT_HOOKS)
+    AST_DECL_KINDS(ADD_DECL_HOOKS)
+    return true;
+}
+
+#undef ADD_EXPR_HOOKS
+#undef ADD_STMT_HOOKS
+#undef ADD_DECL_HOOKS
+#undef ADD_KIND_HOOKS
+
+//--------------------------------------- Walking -----------------------------------------------------------------------------------
+
+static void walk_expr_if_set(const ast_visitor_t *visitor, ast_expr_node_t *expr) {
+    if (expr) ast_visitor_walk_expr(visitor, expr);
+}
+
+static void walk_stmt_if_set(const ast_visitor_t *visitor, ast_stmt_node_t *stmt) {
+    if (stmt) ast_visitor_walk_stmt(visitor, stmt);
+}
+
+static void walk_arg_list(const ast_visitor_t *visitor, expr_arg_list_t *args) {
+    if (!args) return;
+    for (size_t i = 0; i < args->arg_count; ++i) {
+        walk_expr_if_set(visitor, args->args[i]);
+    }
+}
+
+static void walk_assign(const ast_visitor_t *visitor, stmt_assign_t *assign) {
+    if (!assign) return;
+    walk_expr_if_set(visitor, assign->index);
+    walk_expr_if_set(visitor, assign->value);
+}
+
+static void walk_for_init(const ast_visitor_t *visitor, stmt_for_init_t *init) {
+    if (!init) return;
+    switch (init->kind) {
+        case FOR_INIT_VAR_DECL:
+            if (init->data.var_decl) walk_expr_if_set(visitor, init->data.var_decl->initializer);
+            break;
+        case FOR_INIT_ASSIGN:
+            walk_assign(visitor, init->data.assign);
+            break;
+        case FOR_INIT_EXPR:
+            if (init->data.expr) walk_expr_if_set(visitor, init->data.expr->expression);
+            break;
+        case FOR_INIT_NONE:
+            break;
+    }
+}
+
+void ast_visitor_walk_expr(const ast_visitor_t *visitor, ast_expr_node_t *expr) {
+    expr_type_t kind = expr->type;
+    for (unsigned i = 0; i < visitor->pre_expr_count[kind]; ++i) {
+        visitor->pre_expr[kind][i].hook(expr, visitor->pre_expr[kind][i].context);
+    }
+
+    switch (kind) {
+        case EXPR_BINARY:
+            walk_expr_if_set(visitor, expr->data.binary->left);
+            walk_expr_if_set(visitor, expr->data.binary->right);
+            break;
+        case EXPR_UNARY:
+            walk_expr_if_set(visitor, expr->data.unary->operand);
+            break;
+        case EXPR_ASSIGNMENT:
+            walk_expr_if_set(visitor, expr->data.assignment->value);
+            break;
+        case EXPR_ARG_LIST:
+            walk_arg_list(visitor, expr->data.arg_list);
+            break;
+        case EXPR_CALL:
+            walk_arg_list(visitor, expr->data.call->args);
+            break;
+        case EXPR_INDEX:
+            walk_expr_if_set(visitor, expr->data.index->array);
+            walk_expr_if_set(visitor, expr->data.index->index);
+            break;
+        default:
+            break;
+    }
+
+    for (unsigned i = 0; i < visitor->post_expr_count[kind]; ++i) {
+        visitor->post_expr[kind][i].hook(expr, visitor->post_expr[kind][i].context);
+    }
+}
+
+void ast_visitor_walk_stmt(const ast_visitor_t *visitor, ast_stmt_node_t *stmt) {
+    stmt_type_t kind = stmt->type;
+    for (unsigned i = 0; i < visitor->pre_stmt_count[kind]; ++i) {
+        visitor->pre_stmt[kind][i].hook(stmt, visitor->pre_stmt[kind][i].context);
+    }
+
+    switch (kind) {
+        case STMT_VAR_DECL:
+            walk_expr_if_set(visitor, stmt->data.var_decl->initializer);
+            break;
+        case STMT_ASSIGN:
+            walk_assign(visitor, stmt->data.assign);
+            break;
+        case STMT_RETURN:
+            walk_expr_if_set(visitor, stmt->data.return_stmt->value);
+            break;
+        case STMT_PRINT:
+            walk_arg_list(visitor, stmt->data.print_stmt->args);
+            break;
+        case STMT_IF: {
+            stmt_if_t *if_stmt = stmt->data.if_stmt;
+            walk_expr_if_set(visitor, if_stmt->if_condition);
+            walk_stmt_if_set(visitor, if_stmt->if_block);
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                walk_expr_if_set(visitor, if_stmt->elif_conditions[i]);
+                walk_stmt_if_set(visitor, if_stmt->elif_blocks[i]);
+            }
+            walk_stmt_if_set(visitor, if_stmt->else_block);
+            break;
+        }
+        case STMT_WHILE:
+            walk_expr_if_set(visitor, stmt->data.while_stmt->condition);
+            walk_stmt_if_set(visitor, stmt->data.while_stmt->block);
+            break;
+        case STMT_FOR:
+            walk_for_init(visitor, stmt->data.for_stmt->init);
+            walk_expr_if_set(visitor, stmt->data.for_stmt->condition);
+            walk_assign(visitor, stmt->data.for_stmt->increment);
+            walk_stmt_if_set(visitor, stmt->data.for_stmt->block);
+            break;
+        case STMT_EXPR:
+            walk_expr_if_set(visitor, stmt->data.expr_stmt->expression);
+            break;
+        case STMT_BLOCK:
+            for (size_t i = 0; i < stmt->data.block_stmt->statement_count; ++i) {
+                walk_stmt_if_set(visitor, stmt->data.block_stmt->statements[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+
+    for (unsigned i = 0; i < visitor->post_stmt_count[kind]; ++i) {
+        visitor->post_stmt[kind][i].hook(stmt, visitor->post_stmt[kind][i].context);
+    }
+}
+
+void ast_visitor_walk_decl(const ast_visitor_t *visitor, ast_decl_node_t *decl) {
+    decl_type_t kind = decl->type;
+    for (unsigned i = 0; i < visitor->pre_decl_count[kind]; ++i) {
+        visitor->pre_decl[kind][i].hook(decl, visitor->pre_decl[kind][i].context);
+    }
+
+    switch (kind) {
+        case DECL_FUNCTION:
+            for (size_t i = 0; i < decl->data.function_decl->body_count; ++i) {
+                walk_stmt_if_set(visitor, decl->data.function_decl->body[i]);
+            }
+            break;
+    }
+
+    for (unsigned i = 0; i < visitor->post_decl_count[kind]; ++i) {
+        visitor->post_decl[kind][i].hook(decl, visitor->post_decl[kind][i].context);
+    }
+}
+
+void ast_visitor_walk(const ast_visitor_t *visitor, ast_t *ast) {
+    for (size_t i = 0; i < ast->node_count; ++i) {
+        ast_node_t *node = ast->nodes[i];
+        switch (node->type) {
+            case AST_NODE_CATEGORY_EXPR:
+                ast_visitor_walk_expr(visitor, node->data.expr_node);
+                break;
+            case AST_NODE_CATEGORY_STMT:
+                ast_visitor_walk_stmt(visitor, node->data.stmt_node);
+                break;
+            case AST_NODE_CATEGORY_DECL:
+                ast_visitor_walk_decl(visitor, node->data.decl_node);
+                break;
+        }
+    }
+}
@@ -0,0 +1,3969 @@
+/**
+ * File Name: compiler.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "include/compiler.h"
+#include "include/opcode.h"
+#include "include/trace.h"
+#include "include/value.h"
+#include "include/utils.h"
+
+#define COMPILER_MAX_LOCALS UINT16_MAX
+#define COMPILER_MAX_ARGS UINT8_MAX
+
+#define INLINE_COLD_DIVISOR 4       // outside loops, only callees this many times below the threshold are inlined
+#define INLINE_GROWTH_FACTOR 8      // a function may take in this many thresholds' worth of inlined nodes
+
+#define UNROLL_MAX_TRIPS 16         // counted loops of at most this many iterations are unrolled
+#define UNROLL_MAX_NODES 192        // if their bodies, copied once per iteration, stay this small
+#define REDUCE_MAX_FACTOR (1 << 15) // `i * K` is strength reduced for |K| up to this, so it cannot overflow
+#define COUNTED_MAX_VALUE ((int64_t)1 << 40) // nor start, bound or step beyond this
+
+static size_t inline_threshold = COMPILER_DEFAULT_INLINE_THRESHOLD;
+static FILE *inline_report = NULL;
+static bool hoisting = true;
+static bool counted_loops = true;
+static bool typed_opcodes = true;
+static bool superinstructions = true;
+
+void compiler_set_inline_threshold(size_t threshold) {
+    inline_threshold = threshold;
+}
+
+void compiler_set_inline_report(FILE *out) {
+    inline_report = out;
+}
+
+void compiler_set_hoisting(bool enabled) {
+    hoisting = enabled;
+}
+
+void compiler_set_counted_loops(bool enabled) {
+    counted_loops = enabled;
+}
+
+void compiler_set_typed_opcodes(bool enabled) {
+    typed_opcodes = enabled;
+}
+
+void compiler_set_superinstructions(bool enabled) {
+    superinstructions = enabled;
+}
+
+//--------------------------------------- Name Table --------------------------------------------------------------------------------
+
+/**
+ * Open addressing map from a name to an index, used for functions, globals
+ * and the string table. Keys are borrowed, not copied.
+ */
+typedef struct name_table_struct {
+    const char **keys;
+    uint32_t *values;
+    size_t capacity;
+    size_t count;
+} name_table_t;
+
+static uint64_t hash_name(const char *name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char *p = (const unsigned char *)name; *p; ++p) {
+        hash ^= *p;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static bool name_table_find(const name_table_t *table, const char *name, uint32_t *value) {
+    if (table->capacity == 0) return false;
+    size_t index = hash_name(name) & (table->capacity - 1);
+    while (table->keys[index]) {
+        if (strcmp(table->keys[index], name) == 0) {
+            *value = table->values[index];
+            return true;
+        }
+        index = (index + 1) & (table->capacity - 1);
+    }
+    return false;
+}
+
+static void name_table_insert(name_table_t *table, const char *name, uint32_t value) {
+    if ((table->count + 1) * 2 > table->capacity) {
+        size_t old_capacity = table->capacity;
+        const char **old_keys = table->keys;
+        uint32_t *old_values = table->values;
+        table->capacity = old_capacity ? old_capacity * 2 : 32;
+        table->keys = calloc(table->capacity, sizeof(const char *));
+        CHECK_MEM_ALLOC_ERROR(table->keys);
+        table->values = malloc(table->capacity * sizeof(uint32_t));
+        CHECK_MEM_ALLOC_ERROR(table->values);
+        table->count = 0;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_keys[i]) name_table_insert(table, old_keys[i], old_values[i]);
+        }
+        free(old_keys);
+        free(old_values);
+    }
+    size_t index = hash_name(name) & (table->capacity - 1);
+    while (table->keys[index]) {
+        index = (index + 1) & (table->capacity - 1);
+    }
+    table->keys[index] = name;
+    table->values[index] = value;
+    table->count++;
+}
+
+/**
+ * @brief Replaces the value of `name`, or inserts it.
+ */
+static void name_table_set(name_table_t *table, const char *name, uint32_t value) {
+    if (table->capacity > 0) {
+        size_t index = hash_name(name) & (table->capacity - 1);
+        while (table->keys[index]) {
+            if (strcmp(table->keys[index], name) == 0) {
+                table->values[index] = value;
+                return;
+            }
+            index = (index + 1) & (table->capacity - 1);
+        }
+    }
+    name_table_insert(table, name, value);
+}
+
+static void free_name_table(name_table_t *table) {
+    free(table->keys);
+    free(table->values);
+}
+
+//--------------------------------------- Key Set -----------------------------------------------------------------------------------
+
+#define KEY_SET_EMPTY UINT64_MAX
+
+/**
+ * Open addressing set of 64-bit keys, none of them KEY_SET_EMPTY.
+ */
+typedef struct key_set_struct {
+    uint64_t *keys;
+    size_t capacity;
+    size_t count;
+} key_set_t;
+
+static size_t hash_key(uint64_t key, size_t capacity) {
+    return (size_t)((key * 11400714819323198485ull) >> 32) & (capacity - 1);
+}
+
+/**
+ * @brief Adds `key`, returning false if it was there already.
+ */
+static bool key_set_add(key_set_t *set, uint64_t key) {
+    if ((set->count + 1) * 2 > set->capacity) {
+        size_t old_capacity = set->capacity;
+        uint64_t *old_keys = set->keys;
+        set->capacity = old_capacity ? old_capacity * 2 : 32;
+        set->keys = malloc(set->capacity * sizeof(uint64_t));
+        CHECK_MEM_ALLOC_ERROR(set->keys);
+        memset(set->keys, 0xff, set->capacity * sizeof(uint64_t));
+        set->count = 0;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_keys[i] != KEY_SET_EMPTY) key_set_add(set, old_keys[i]);
+        }
+        free(old_keys);
+    }
+    size_t index = hash_key(key, set->capacity);
+    while (set->keys[index] != KEY_SET_EMPTY) {
+        if (set->keys[index] == key) return false;
+        index = (index + 1) & (set->capacity - 1);
+    }
+    set->keys[index] = key;
+    set->count++;
+    return true;
+}
+
+//--------------------------------------- Compiler State ----------------------------------------------------------------------------
+
+typedef struct compiler_local_struct {
+    const char *name;
+    int depth;
+    uint16_t slot;
+    data_type_t type;           // declared type, DATA_TYPE_VOID for the compiler's temporaries
+} compiler_local_t;
+
+typedef struct patch_list_struct {
+    size_t *positions;
+    size_t count;
+    size_t capacity;
+} patch_list_t;
+
+typedef struct compiler_loop_struct {
+    patch_list_t breaks;
+    patch_list_t continues;
+} compiler_loop_t;
+
+typedef struct parallel_reduction_struct {
+    const char *name;
+    uint16_t slot;
+    opcode_t op;                // OP_ADD for +=, OP_MUL for *=
+} parallel_reduction_t;
+
+/**
+ * The body of a `parallel for` being compiled into its worker function. The
+ * worker's first capture_count slots are copies of the enclosing function's
+ * locals, followed by the loop index and the end of the chunk.
+ */
+typedef struct parallel_body_struct {
+    size_t capture_count;
+    uint16_t index_slot;
+    size_t loop_depth;          // loop_count inside the parallel loop itself
+    bool *capture_reads;        // per capture: read somewhere in the body
+    parallel_reduction_t reductions[PARALLEL_MAX_REDUCTIONS];
+    size_t reduction_count;
+} parallel_body_t;
+
+/**
+ * What is known about a declared function before any code is compiled: its
+ * size and whether it can be inlined, and what it touches besides its own
+ * locals, for hoisting calls out of loops.
+ */
+typedef struct function_summary_struct {
+    const decl_function_t *decl;
+    size_t size;                // AST nodes in the body
+    uint32_t *callees;          // declared functions it calls, with repeats
+    size_t callee_count;
+    size_t callee_capacity;
+    const char *reason;         // why it is never inlined, NULL if it may be
+    bool impure;                // prints, assigns globals, stores into or allocates arrays, or waits, itself or in a callee
+    bool reads_globals;
+    bool reads_arrays;
+    name_table_t local_types;   // parameter and local name -> declared type, see infer_types()
+    bool typed_return;          // every call returns a value of the declared return type
+} function_summary_t;
+
+/**
+ * An expression of an enclosing loop that was computed once, before the
+ * loop, into a slot of its own.
+ */
+typedef struct hoisted_expr_struct {
+    const ast_expr_node_t *expr;
+    uint16_t slot;
+} hoisted_expr_t;
+
+/**
+ * A call whose callee body is being compiled in place. Returns in the body
+ * jump to its end with their value on the stack.
+ */
+typedef struct inline_expansion_struct {
+    patch_list_t returns;
+    int result_depth;           // stack depth at the end, with the result pushed
+} inline_expansion_t;
+
+/**
+ * Worker code is compiled into buffers of its own while the enclosing
+ * function is still open, and appended to the code section at the end.
+ */
+typedef struct pending_body_struct {
+    uint32_t function;
+    uint8_t *code;
+    size_t code_size;
+    image_line_t *lines;
+    size_t line_count;
+} pending_body_t;
+
+typedef struct COMPILER_STRUCT {
+    // image sections
+    uint8_t *code;
+    size_t code_size;
+    size_t code_capacity;
+
+    image_function_t *functions;
+    size_t function_count;
+    size_t function_capacity;
+
+    image_constant_t *constants;
+    size_t constant_count;
+    size_t constant_capacity;
+
+    image_global_t *globals;
+    size_t global_count;
+    size_t global_capacity;
+
+    image_line_t *lines;
+    size_t line_count;
+    size_t line_capacity;
+
+    char *strings;
+    size_t strings_size;
+    size_t strings_capacity;
+
+    name_table_t function_names;
+    name_table_t global_names;
+    name_table_t string_offsets;
+    char **owned_strings;       // unescaped string literals, keys of string_offsets
+    size_t owned_string_count;
+    size_t owned_string_capacity;
+
+    // current function
+    image_function_t *function;
+    compiler_local_t *locals;
+    size_t local_count;
+    size_t local_capacity;
+    size_t max_locals;
+    int scope_depth;
+    int stack_depth;
+    int max_stack;
+    compiler_loop_t *loops;
+    size_t loop_count;
+    size_t loop_capacity;
+    parallel_body_t *parallel;  // set while compiling a parallel for body
+
+    pending_body_t *pending_bodies;
+    size_t pending_body_count;
+    size_t pending_body_capacity;
+
+    function_summary_t *summaries;          // one per declared function
+    size_t summary_count;
+
+    // static types
+    bool *typed_globals;                    // per global: only ever holds values of its declared type
+    const function_summary_t *typing;       // the function whose body is being compiled, NULL for globals
+
+    // inlining
+    inline_expansion_t *inlining;           // set while a callee body is compiled in place
+    size_t local_floor;                     // locals below it belong to the caller of that body
+    size_t outer_loop_depth;                // loops around the call being expanded
+    size_t inline_budget;                   // AST nodes the current function may still take in
+    int muted;                              // errors are counted but not printed
+    key_set_t inline_reported;              // call sites in the inline report, by function and source offset
+
+    // loop invariant code motion
+    hoisted_expr_t *hoisted;
+    size_t hoisted_count;
+    size_t hoisted_capacity;
+
+    // counted loops
+    bool induction_constant;                // set while a copy of an unrolled loop is compiled
+    uint16_t induction_slot;                // reads of it are then induction_value
+    int64_t induction_value;
+
+    size_t error_count;
+    source_map_t *source_map;               // of the program, for the lines of errors and of the line table
+} compiler_t;
+
+static void compiler_error(compiler_t *compiler, uint32_t offset, const char *format, ...) {
+    if (compiler->muted) {
+        // A trial expansion, see expand_inline(); the caller undoes it.
+        compiler->error_count++;
+        return;
+    }
+    size_t line, column;
+    source_map_locate(compiler->source_map, offset, &line, &column);
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "[%zu:%zu] Error: ", line, column);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    compiler->error_count++;
+}
+
+//--------------------------------------- Emission ----------------------------------------------------------------------------------
+
+static uint32_t current_pc(compiler_t *compiler) {
+    return (uint32_t)(compiler->code_size - compiler->function->code_offset);
+}
+
+static void emit_byte(compiler_t *compiler, uint8_t byte) {
+    if (compiler->code_size >= compiler->code_capacity) {
+        compiler->code_capacity = compiler->code_capacity ? compiler->code_capacity * 2 : 1024;
+        compiler->code = realloc(compiler->code, compiler->code_capacity);
+        CHECK_MEM_ALLOC_ERROR(compiler->code);
+    }
+    compiler->code[compiler->code_size++] = byte;
+}
+
+static void emit_u16(compiler_t *compiler, uint16_t value) {
+    emit_byte(compiler, (uint8_t)(value & 0xff));
+    emit_byte(compiler, (uint8_t)(value >> 8));
+}
+
+static void emit_u32(compiler_t *compiler, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        emit_byte(compiler, (uint8_t)(value >> (8 * i)));
+    }
+}
+
+static void adjust_stack(compiler_t *compiler, int delta) {
+    compiler->stack_depth += delta;
+    if (compiler->stack_depth > compiler->max_stack) {
+        compiler->max_stack = compiler->stack_depth;
+    }
+}
+
+static int stack_effect(opcode_t op) {
+    switch (op) {
+        case OP_CONST: case OP_NULL: case OP_TRUE: case OP_FALSE: case OP_DUP:
+        case OP_GET_LOCAL: case OP_GET_GLOBAL:
+            return 1;
+        case OP_POP: case OP_SET_LOCAL: case OP_SET_GLOBAL:
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_EQ: case OP_NEQ: case OP_LT: case OP_LEQ: case OP_GT: case OP_GEQ:
+        case OP_ADD_INT: case OP_SUB_INT: case OP_MUL_INT: case OP_DIV_INT: case OP_MOD_INT:
+        case OP_EQ_INT: case OP_NEQ_INT: case OP_LT_INT: case OP_LEQ_INT: case OP_GT_INT: case OP_GEQ_INT:
+        case OP_ADD_FLOAT: case OP_SUB_FLOAT: case OP_MUL_FLOAT: case OP_DIV_FLOAT:
+        case OP_EQ_FLOAT: case OP_NEQ_FLOAT: case OP_LT_FLOAT: case OP_LEQ_FLOAT: case OP_GT_FLOAT: case OP_GEQ_FLOAT:
+        case OP_JUMP_IF_FALSE: case OP_RETURN: case OP_REDUCE:
+        case OP_INDEX: case OP_DOT:
+            return -1;
+        case OP_SET_INDEX:
+            return -3;
+        // OP_NEG_INT, OP_NEG_FLOAT, OP_TO_FLOAT, OP_AWAIT, OP_SLEEP, OP_WAIT_FD,
+        // OP_NEW_ARRAY, OP_LEN and OP_SUM replace their operand.
+        default:
+            return 0;
+    }
+}
+
+static void emit_op(compiler_t *compiler, opcode_t op) {
+    emit_byte(compiler, (uint8_t)op);
+    adjust_stack(compiler, stack_effect(op));
+}
+
+static void emit_op_u16(compiler_t *compiler, opcode_t op, uint16_t operand) {
+    emit_op(compiler, op);
+    emit_u16(compiler, operand);
+}
+
+/**
+ * @brief Emits a jump with a placeholder target.
+ *
+ * @return Position of the target operand, to be filled in by patch_jump().
+ */
+static size_t emit_jump(compiler_t *compiler, opcode_t op) {
+    emit_op(compiler, op);
+    size_t position = compiler->code_size;
+    emit_u32(compiler, 0);
+    return position;
+}
+
+static void patch_jump_to(compiler_t *compiler, size_t position, uint32_t target) {
+    for (int i = 0; i < 4; ++i) {
+        compiler->code[position + i] = (uint8_t)(target >> (8 * i));
+    }
+}
+
+static void patch_jump(compiler_t *compiler, size_t position) {
+    patch_jump_to(compiler, position, current_pc(compiler));
+}
+
+static void emit_jump_back(compiler_t *compiler, uint32_t target) {
+    emit_op(compiler, OP_JUMP);
+    emit_u32(compiler, target);
+}
+
+static void mark_position(compiler_t *compiler, uint32_t offset) {
+    size_t line, column;
+    source_map_locate(compiler->source_map, offset, &line, &column);
+    uint32_t pc = current_pc(compiler);
+    image_function_t *function = compiler->function;
+    if (function->line_count > 0) {
+        image_line_t *last = &compiler->lines[compiler->line_count - 1];
+        if (last->line == line && last->column == column) return;
+        if (last->pc == pc) {
+            last->line = (uint32_t)line;
+            last->column = (uint32_t)column;
+            return;
+        }
+    }
+    if (compiler->line_count >= compiler->line_capacity) {
+        compiler->line_capacity = compiler->line_capacity ? compiler->line_capacity * 2 : 256;
+        compiler->lines = realloc(compiler->lines, compiler->line_capacity * sizeof(image_line_t));
+        CHECK_MEM_ALLOC_ERROR(compiler->lines);
+    }
+    compiler->lines[compiler->line_count++] = (image_line_t){ pc, (uint32_t)line, (uint32_t)column };
+    function->line_count++;
+}
+
+//--------------------------------------- Constants and Strings ---------------------------------------------------------------------
+
+static uint32_t intern_string(compiler_t *compiler, const char *s) {
+    uint32_t offset;
+    if (name_table_find(&compiler->string_offsets, s, &offset)) {
+        return offset;
+    }
+    size_t length = strlen(s);
+    while (compiler->strings_size + length + 1 > compiler->strings_capacity) {
+        compiler->strings_capacity = compiler->strings_capacity ? compiler->strings_capacity * 2 : 256;
+        compiler->strings = realloc(compiler->strings, compiler->strings_capacity);
+        CHECK_MEM_ALLOC_ERROR(compiler->strings);
+    }
+    offset = (uint32_t)compiler->strings_size;
+    memcpy(compiler->strings + offset, s, length + 1);
+    compiler->strings_size += length + 1;
+    name_table_insert(&compiler->string_offsets, s, offset);
+    return offset;
+}
+
+static uint16_t add_constant(compiler_t *compiler, image_constant_t constant, uint32_t offset) {
+    for (size_t i = 0; i < compiler->constant_count; ++i) {
+        if (compiler->constants[i].kind == constant.kind && compiler->constants[i].payload == constant.payload) {
+            return (uint16_t)i;
+        }
+    }
+    if (compiler->constant_count > UINT16_MAX) {
+        compiler_error(compiler, offset, "Too many constants in one program");
+        return 0;
+    }
+    if (compiler->constant_count >= compiler->constant_capacity) {
+        compiler->constant_capacity = compiler->constant_capacity ? compiler->constant_capacity * 2 : 64;
+        compiler->constants = realloc(compiler->constants, compiler->constant_capacity * sizeof(image_constant_t));
+        CHECK_MEM_ALLOC_ERROR(compiler->constants);
+    }
+    compiler->constants[compiler->constant_count] = constant;
+    return (uint16_t)compiler->constant_count++;
+}
+
+static void emit_int_constant(compiler_t *compiler, int64_t value, uint32_t offset) {
+    image_constant_t constant = { IMAGE_CONST_INT, 0, (uint64_t)value };
+    emit_op_u16(compiler, OP_CONST, add_constant(compiler, constant, offset));
+}
+
+static void emit_float_constant(compiler_t *compiler, double value, uint32_t offset) {
+    image_constant_t constant = { IMAGE_CONST_FLOAT, 0, 0 };
+    memcpy(&constant.payload, &value, sizeof(value));
+    emit_op_u16(compiler, OP_CONST, add_constant(compiler, constant, offset));
+}
+
+/**
+ * @brief Whether the code from `from` to `to` is a single int constant, for
+ * folding it into the operation that uses it.
+ */
+static bool emitted_int_constant(const compiler_t *compiler, size_t from, size_t to, int64_t *value) {
+    if (to != from + 3 || compiler->code[from] != OP_CONST) return false;
+    uint16_t index = (uint16_t)(compiler->code[from + 1] | (compiler->code[from + 2] << 8));
+    if (index >= compiler->constant_count || compiler->constants[index].kind != IMAGE_CONST_INT) return false;
+    *value = (int64_t)compiler->constants[index].payload;
+    return true;
+}
+
+static char *unescape_string(const char *raw) {
+    size_t length = strlen(raw);
+    char *out = malloc(length + 1);
+    CHECK_MEM_ALLOC_ERROR(out);
+    size_t j = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (raw[i] == '\\' && i + 1 < length) {
+            char next = raw[++i];
+            switch (next) {
+                case 'n':  out[j++] = '\n'; break;
+                case 't':  out[j++] = '\t'; break;
+                case 'r':  out[j++] = '\r'; break;
+                case '0':  out[j++] = '\0'; break;
+                default:   out[j++] = next; break;
+            }
+        } else {
+            out[j++] = raw[i];
+        }
+    }
+    out[j] = '\0';
+    return out;
+}
+
+/**
+ * @brief Interns a malloc'd string, taking ownership of it.
+ */
+static uint32_t intern_owned_string(compiler_t *compiler, char *value) {
+    uint32_t offset;
+    if (name_table_find(&compiler->string_offsets, value, &offset)) {
+        free(value);
+        return offset;
+    }
+    if (compiler->owned_string_count >= compiler->owned_string_capacity) {
+        compiler->owned_string_capacity = compiler->owned_string_capacity ? compiler->owned_string_capacity * 2 : 16;
+        compiler->owned_strings = realloc(compiler->owned_strings, compiler->owned_string_capacity * sizeof(char *));
+        CHECK_MEM_ALLOC_ERROR(compiler->owned_strings);
+    }
+    compiler->owned_strings[compiler->owned_string_count++] = value;
+    return intern_string(compiler, value);
+}
+
+static uint16_t add_string_constant(compiler_t *compiler, const char *raw, uint32_t offset) {
+    uint32_t string = intern_owned_string(compiler, unescape_string(raw));
+    image_constant_t constant = { IMAGE_CONST_STRING, (uint32_t)strlen(compiler->strings + string), string };
+    return add_constant(compiler, constant, offset);
+}
+
+//--------------------------------------- Scopes ------------------------------------------------------------------------------------
+
+static void begin_scope(compiler_t *compiler) {
+    compiler->scope_depth++;
+}
+
+static void end_scope(compiler_t *compiler) {
+    compiler->scope_depth--;
+    while (compiler->local_count > 0 && compiler->locals[compiler->local_count - 1].depth > compiler->scope_depth) {
+        compiler->local_count--;
+    }
+}
+
+static bool resolve_local(compiler_t *compiler, const char *name, uint16_t *slot) {
+    for (size_t i = compiler->local_count; i > compiler->local_floor; --i) {
+        if (strcmp(compiler->locals[i - 1].name, name) == 0) {
+            *slot = compiler->locals[i - 1].slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Takes the next slot for `name` without looking for a clash. The
+ * compiler's own temporaries use the empty name, which no identifier has.
+ */
+static uint16_t add_local(compiler_t *compiler, const char *name, uint32_t offset) {
+    if (compiler->local_count >= COMPILER_MAX_LOCALS) {
+        compiler_error(compiler, offset, "Too many local variables in one function");
+        return 0;
+    }
+    if (compiler->local_count >= compiler->local_capacity) {
+        compiler->local_capacity = compiler->local_capacity ? compiler->local_capacity * 2 : 16;
+        compiler->locals = realloc(compiler->locals, compiler->local_capacity * sizeof(compiler_local_t));
+        CHECK_MEM_ALLOC_ERROR(compiler->locals);
+    }
+    uint16_t slot = (uint16_t)compiler->local_count;
+    compiler->locals[compiler->local_count++] = (compiler_local_t){ name, compiler->scope_depth, slot, DATA_TYPE_VOID };
+    if (compiler->local_count > compiler->max_locals) {
+        compiler->max_locals = compiler->local_count;
+    }
+    return slot;
+}
+
+static uint16_t declare_local(compiler_t *compiler, const char *name, data_type_t type, uint32_t offset) {
+    for (size_t i = compiler->local_count; i > 0; --i) {
+        compiler_local_t *local = &compiler->locals[i - 1];
+        if (local->depth < compiler->scope_depth) break;
+        if (strcmp(local->name, name) == 0) {
+            compiler_error(compiler, offset, "Variable '%s' is already declared in this scope", name);
+            return local->slot;
+        }
+    }
+    size_t count = compiler->local_count;
+    uint16_t slot = add_local(compiler, name, offset);
+    if (compiler->local_count > count) {
+        compiler->locals[count].type = type;
+    }
+    return slot;
+}
+
+static void patch_list_add(patch_list_t *list, size_t position) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 4;
+        list->positions = realloc(list->positions, list->capacity * sizeof(size_t));
+        CHECK_MEM_ALLOC_ERROR(list->positions);
+    }
+    list->positions[list->count++] = position;
+}
+
+static void begin_loop(compiler_t *compiler) {
+    if (compiler->loop_count >= compiler->loop_capacity) {
+        compiler->loop_capacity = compiler->loop_capacity ? compiler->loop_capacity * 2 : 4;
+        compiler->loops = realloc(compiler->loops, compiler->loop_capacity * sizeof(compiler_loop_t));
+        CHECK_MEM_ALLOC_ERROR(compiler->loops);
+    }
+    memset(&compiler->loops[compiler->loop_count++], 0, sizeof(compiler_loop_t));
+}
+
+static void patch_continues(compiler_t *compiler) {
+    compiler_loop_t *loop = &compiler->loops[compiler->loop_count - 1];
+    for (size_t i = 0; i < loop->continues.count; ++i) {
+        patch_jump(compiler, loop->continues.positions[i]);
+    }
+}
+
+static void end_loop(compiler_t *compiler) {
+    compiler_loop_t *loop = &compiler->loops[--compiler->loop_count];
+    for (size_t i = 0; i < loop->breaks.count; ++i) {
+        patch_jump(compiler, loop->breaks.positions[i]);
+    }
+    free(loop->breaks.positions);
+    free(loop->continues.positions);
+}
+
+static void compile_expr(compiler_t *compiler, const ast_expr_node_t *expr);
+static void compile_stmt(compiler_t *compiler, const ast_stmt_node_t *stmt);
+static void compile_parallel_for(compiler_t *compiler, const stmt_for_t *for_stmt, uint32_t offset);
+
+//--------------------------------------- Function Summaries ------------------------------------------------------------------------
+
+static bool is_global_name(const compiler_t *compiler, const char *name) {
+    uint32_t index;
+    return name_table_find(&compiler->global_names, name, &index);
+}
+
+static void scan_stmt(compiler_t *compiler, function_summary_t *summary, const ast_stmt_node_t *stmt, size_t loop_depth);
+
+static void scan_expr(compiler_t *compiler, function_summary_t *summary, const ast_expr_node_t *expr) {
+    if (!expr) return;
+    summary->size++;
+    switch (expr->type) {
+        case EXPR_IDENTIFIER:
+            // A local of the same name makes this an overestimate, which is safe.
+            if (is_global_name(compiler, expr->data.identifier->name)) {
+                summary->reads_globals = true;
+            }
+            break;
+        case EXPR_BINARY:
+            scan_expr(compiler, summary, expr->data.binary->left);
+            scan_expr(compiler, summary, expr->data.binary->right);
+            break;
+        case EXPR_UNARY: {
+            const expr_unary_t *unary = expr->data.unary;
+            bool increment = unary->operator == TOKEN_PLUSPLUS || unary->operator == TOKEN_MINUSMINUS;
+            if (unary->operator == TOKEN_AWAIT ||
+                (increment && unary->operand && unary->operand->type == EXPR_IDENTIFIER &&
+                 is_global_name(compiler, unary->operand->data.identifier->name))) {
+                summary->impure = true;
+            }
+            scan_expr(compiler, summary, unary->operand);
+            break;
+        }
+        case EXPR_ASSIGNMENT:
+            if (is_global_name(compiler, expr->data.assignment->name)) {
+                summary->impure = true;
+            }
+            scan_expr(compiler, summary, expr->data.assignment->value);
+            break;
+        case EXPR_ARG_LIST:
+            for (size_t i = 0; i < expr->data.arg_list->arg_count; ++i) {
+                scan_expr(compiler, summary, expr->data.arg_list->args[i]);
+            }
+            break;
+        case EXPR_CALL: {
+            const expr_call_t *call = expr->data.call;
+            for (size_t i = 0; call->args && i < call->args->arg_count; ++i) {
+                scan_expr(compiler, summary, call->args->args[i]);
+            }
+            uint32_t index;
+            if (!name_table_find(&compiler->function_names, call->name, &index)) {
+                if (strcmp(call->name, "sum") == 0 || strcmp(call->name, "dot") == 0) {
+                    summary->reads_arrays = true;
+                } else if (strcmp(call->name, "len") != 0) {
+                    summary->impure = true;     // sleep(), readable(), writable() or a new array
+                }
+                break;
+            }
+            if (compiler->functions[index].flags & IMAGE_FUNCTION_ASYNC) {
+                summary->reason = "starts a task";
+                summary->impure = true;
+            }
+            if (summary->callee_count >= summary->callee_capacity) {
+                summary->callee_capacity = summary->callee_capacity ? summary->callee_capacity * 2 : 4;
+                summary->callees = realloc(summary->callees, summary->callee_capacity * sizeof(uint32_t));
+                CHECK_MEM_ALLOC_ERROR(summary->callees);
+            }
+            summary->callees[summary->callee_count++] = index;
+            break;
+        }
+        case EXPR_INDEX:
+            summary->reads_arrays = true;
+            scan_expr(compiler, summary, expr->data.index->array);
+            scan_expr(compiler, summary, expr->data.index->index);
+            break;
+        default:
+            break;
+    }
+}
+
+static void scan_assign(compiler_t *compiler, function_summary_t *summary, const stmt_assign_t *assign) {
+    if (!assign) return;
+    summary->size++;
+    if (assign->index || is_global_name(compiler, assign->name)) {
+        summary->impure = true;
+    }
+    scan_expr(compiler, summary, assign->index);
+    scan_expr(compiler, summary, assign->value);
+}
+
+static void scan_stmt(compiler_t *compiler, function_summary_t *summary, const ast_stmt_node_t *stmt, size_t loop_depth) {
+    if (!stmt) return;
+    summary->size++;
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            scan_expr(compiler, summary, stmt->data.var_decl->initializer);
+            break;
+        case STMT_ASSIGN:
+            scan_assign(compiler, summary, stmt->data.assign);
+            break;
+        case STMT_RETURN:
+            scan_expr(compiler, summary, stmt->data.return_stmt->value);
+            break;
+        case STMT_PRINT:
+            summary->impure = true;
+            for (size_t i = 0; stmt->data.print_stmt->args && i < stmt->data.print_stmt->args->arg_count; ++i) {
+                scan_expr(compiler, summary, stmt->data.print_stmt->args->args[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            if (loop_depth == 0) {
+                summary->reason = "break or continue outside a loop";
+            }
+            break;
+        case STMT_IF: {
+            const stmt_if_t *if_stmt = stmt->data.if_stmt;
+            scan_expr(compiler, summary, if_stmt->if_condition);
+            scan_stmt(compiler, summary, if_stmt->if_block, loop_depth);
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                scan_expr(compiler, summary, if_stmt->elif_conditions[i]);
+                scan_stmt(compiler, summary, if_stmt->elif_blocks[i], loop_depth);
+            }
+            scan_stmt(compiler, summary, if_stmt->else_block, loop_depth);
+            break;
+        }
+        case STMT_WHILE:
+            scan_expr(compiler, summary, stmt->data.while_stmt->condition);
+            scan_stmt(compiler, summary, stmt->data.while_stmt->block, loop_depth + 1);
+            break;
+        case STMT_FOR: {
+            const stmt_for_t *for_stmt = stmt->data.for_stmt;
+            if (for_stmt->parallel) {
+                summary->reason = "contains a parallel for";
+                summary->impure = true;
+            }
+            if (for_stmt->init) {
+                switch (for_stmt->init->kind) {
+                    case FOR_INIT_VAR_DECL:
+                        scan_expr(compiler, summary, for_stmt->init->data.var_decl->initializer);
+                        break;
+                    case FOR_INIT_ASSIGN:
+                        scan_assign(compiler, summary, for_stmt->init->data.assign);
+                        break;
+                    case FOR_INIT_EXPR:
+                        scan_expr(compiler, summary, for_stmt->init->data.expr->expression);
+                        break;
+                    case FOR_INIT_NONE:
+                        break;
+                }
+            }
+            scan_expr(compiler, summary, for_stmt->condition);
+            scan_assign(compiler, summary, for_stmt->increment);
+            scan_stmt(compiler, summary, for_stmt->block, loop_depth + 1);
+            break;
+        }
+        case STMT_EXPR:
+            scan_expr(compiler, summary, stmt->data.expr_stmt->expression);
+            break;
+        case STMT_BLOCK:
+            for (size_t i = 0; i < stmt->data.block_stmt->statement_count; ++i) {
+                scan_stmt(compiler, summary, stmt->data.block_stmt->statements[i], loop_depth);
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Marks every function that can reach itself through calls, with
+ * Tarjan's strongly connected components algorithm run iteratively.
+ */
+static void mark_recursive(compiler_t *compiler) {
+    size_t count = compiler->summary_count;
+    size_t *order = malloc(count * sizeof(size_t));      // discovery order + 1, 0 while unvisited
+    size_t *low = malloc(count * sizeof(size_t));
+    bool *on_stack = calloc(count, sizeof(bool));
+    uint32_t *stack = malloc(count * sizeof(uint32_t));
+    uint32_t *path = malloc(count * sizeof(uint32_t));   // the depth first path
+    size_t *next_edge = malloc(count * sizeof(size_t));
+    CHECK_MEM_ALLOC_ERROR(order);
+    CHECK_MEM_ALLOC_ERROR(low);
+    CHECK_MEM_ALLOC_ERROR(on_stack);
+    CHECK_MEM_ALLOC_ERROR(stack);
+    CHECK_MEM_ALLOC_ERROR(path);
+    CHECK_MEM_ALLOC_ERROR(next_edge);
+    memset(order, 0, count * sizeof(size_t));
+
+    size_t visited = 0;
+    size_t stack_count = 0;
+    for (uint32_t root = 0; root < count; ++root) {
+        if (order[root]) continue;
+        size_t depth = 0;
+        path[depth++] = root;
+        order[root] = low[root] = ++visited;
+        next_edge[root] = 0;
+        stack[stack_count++] = root;
+        on_stack[root] = true;
+
+        while (depth > 0) {
+            uint32_t node = path[depth - 1];
+            const function_summary_t *summary = &compiler->summaries[node];
+            if (next_edge[node] < summary->callee_count) {
+                uint32_t callee = summary->callees[next_edge[node]++];
+                if (callee == node) {
+                    compiler->summaries[node].reason = "recursive";
+                } else if (!order[callee]) {
+                    order[callee] = low[callee] = ++visited;
+                    next_edge[callee] = 0;
+                    stack[stack_count++] = callee;
+                    on_stack[callee] = true;
+                    path[depth++] = callee;
+                } else if (on_stack[callee] && order[callee] < low[node]) {
+                    low[node] = order[callee];
+                }
+                continue;
+            }
+            depth--;
+            if (depth > 0 && low[node] < low[path[depth - 1]]) {
+                low[path[depth - 1]] = low[node];
+            }
+            if (low[node] != order[node]) continue;
+            // node is the root of a component; more than one member means mutual recursion.
+            bool cycle = stack[stack_count - 1] != node;
+            uint32_t member;
+            do {
+                member = stack[--stack_count];
+                on_stack[member] = false;
+                if (cycle) {
+                    compiler->summaries[member].reason = "recursive";
+                }
+            } while (member != node);
+        }
+    }
+    free(order);
+    free(low);
+    free(on_stack);
+    free(stack);
+    free(path);
+    free(next_edge);
+}
+
+/**
+ * @brief Spreads the effects of callees to their callers until nothing changes.
+ */
+static void propagate_effects(compiler_t *compiler) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < compiler->summary_count; ++i) {
+            function_summary_t *summary = &compiler->summaries[i];
+            for (size_t j = 0; j < summary->callee_count; ++j) {
+                const function_summary_t *callee = &compiler->summaries[summary->callees[j]];
+                bool impure = summary->impure || callee->impure;
+                bool reads_globals = summary->reads_globals || callee->reads_globals;
+                bool reads_arrays = summary->reads_arrays || callee->reads_arrays;
+                if (impure != summary->impure || reads_globals != summary->reads_globals ||
+                    reads_arrays != summary->reads_arrays) {
+                    summary->impure = impure;
+                    summary->reads_globals = reads_globals;
+                    summary->reads_arrays = reads_arrays;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Measures every declared function, finds the ones that can never
+ * be inlined and works out their effects, before any body is compiled.
+ */
+static void summarize_functions(compiler_t *compiler, const ast_t *ast) {
+    if (compiler->function_count == 0) return;
+    compiler->summary_count = compiler->function_count;
+    compiler->summaries = calloc(compiler->function_count, sizeof(function_summary_t));
+    CHECK_MEM_ALLOC_ERROR(compiler->summaries);
+
+    for (size_t i = 0; i < ast->node_count; ++i) {
+        const ast_node_t *node = ast->nodes[i];
+        if (node->type != AST_NODE_CATEGORY_DECL) continue;
+        const decl_function_t *function = node->data.decl_node->data.function_decl;
+        uint32_t index;
+        if (!name_table_find(&compiler->function_names, function->name, &index)) continue;
+        function_summary_t *summary = &compiler->summaries[index];
+        if (summary->decl) continue; // duplicate, already reported
+        summary->decl = function;
+        for (size_t j = 0; j < function->body_count; ++j) {
+            scan_stmt(compiler, summary, function->body[j], 0);
+        }
+        if (function->is_async) {
+            summary->reason = "async";
+            summary->impure = true;
+        }
+    }
+    mark_recursive(compiler);
+    propagate_effects(compiler);
+}
+
+//--------------------------------------- Static Types ------------------------------------------------------------------------------
+
+/*
+ * Declared types are not enforced, so a variable may end up holding anything.
+ * A name is proven to hold only values of its declared type when every store
+ * into it provably does. infer_types() works this out optimistically: every
+ * name starts out proven, and a store that may not fit unproves its target,
+ * until nothing changes. Names are per function, like the summaries: a local
+ * declared twice with different types, or named like a global, is never
+ * proven, nor is that global.
+ */
+
+#define LOCAL_UNPROVEN 0x100u       // or'ed into a local_types value
+
+static bool is_number_type(data_type_t type) {
+    return type == DATA_TYPE_INT || type == DATA_TYPE_FLOAT;
+}
+
+/**
+ * @brief Opcode of a binary operator, OP_COUNT for && and || and for any
+ * operator without one.
+ */
+static opcode_t binary_opcode(token_type_t operator) {
+    switch (operator) {
+        case TOKEN_PLUS:     return OP_ADD;
+        case TOKEN_MINUS:    return OP_SUB;
+        case TOKEN_ASTERISK: return OP_MUL;
+        case TOKEN_SLASH:    return OP_DIV;
+        case TOKEN_PERCENT:  return OP_MOD;
+        case TOKEN_EQEQ:     return OP_EQ;
+        case TOKEN_NEQ:      return OP_NEQ;
+        case TOKEN_LT:       return OP_LT;
+        case TOKEN_LEQ:      return OP_LEQ;
+        case TOKEN_GT:       return OP_GT;
+        case TOKEN_GEQ:      return OP_GEQ;
+        default:             return OP_COUNT;
+    }
+}
+
+static opcode_t compound_opcode(token_type_t operator) {
+    switch (operator) {
+        case TOKEN_PLUSEQ:     return OP_ADD;
+        case TOKEN_MINUSEQ:    return OP_SUB;
+        case TOKEN_ASTERISKEQ: return OP_MUL;
+        case TOKEN_SLASHEQ:    return OP_DIV;
+        default:               return OP_MOD;
+    }
+}
+
+/**
+ * @brief Type of the result of OP_ADD..OP_GEQ on operands of the given
+ * types, DATA_TYPE_VOID when it cannot be told.
+ */
+static data_type_t arithmetic_type(opcode_t op, data_type_t left, data_type_t right) {
+    if (op >= OP_EQ && op <= OP_GEQ) return DATA_TYPE_BOOL;
+    if (left == DATA_TYPE_INT && right == DATA_TYPE_INT) return DATA_TYPE_INT;
+    if (is_number_type(left) && is_number_type(right)) return DATA_TYPE_FLOAT;
+    if (op == OP_ADD && left == DATA_TYPE_STRING && right == DATA_TYPE_STRING) return DATA_TYPE_STRING;
+    return DATA_TYPE_VOID;
+}
+
+/**
+ * @brief Type of what a store of a `value` into a `target` variable leaves
+ * there: ints stored into floats are converted, see emit_conversion().
+ */
+static data_type_t stored_type(data_type_t target, data_type_t value) {
+    return target == DATA_TYPE_FLOAT && value == DATA_TYPE_INT ? DATA_TYPE_FLOAT : value;
+}
+
+/**
+ * @brief Declared type of a variable as seen from `typing`'s body, proven
+ * or not, DATA_TYPE_VOID if there is none.
+ */
+static data_type_t declared_type(const compiler_t *compiler, const function_summary_t *typing, const char *name) {
+    uint32_t value;
+    if (typing && name_table_find(&typing->local_types, name, &value)) {
+        return (data_type_t)(value & ~LOCAL_UNPROVEN);
+    }
+    if (name_table_find(&compiler->global_names, name, &value)) {
+        return (data_type_t)compiler->globals[value].type;
+    }
+    return DATA_TYPE_VOID;
+}
+
+/**
+ * @brief Proven type of a variable, DATA_TYPE_VOID if it may hold other values.
+ */
+static data_type_t proven_type(const compiler_t *compiler, const function_summary_t *typing, const char *name) {
+    uint32_t value;
+    if (typing && name_table_find(&typing->local_types, name, &value)) {
+        return value & LOCAL_UNPROVEN ? DATA_TYPE_VOID : (data_type_t)value;
+    }
+    if (name_table_find(&compiler->global_names, name, &value) && compiler->typed_globals[value]) {
+        return (data_type_t)compiler->globals[value].type;
+    }
+    return DATA_TYPE_VOID;
+}
+
+/**
+ * @brief Type every value of the expression has, from the proven types of
+ * the variables it reads, DATA_TYPE_VOID when it cannot be told.
+ */
+static data_type_t expr_type(const compiler_t *compiler, const function_summary_t *typing, const ast_expr_node_t *expr) {
+    if (!expr) return DATA_TYPE_VOID;
+    switch (expr->type) {
+        case EXPR_LITERAL_INT:    return DATA_TYPE_INT;
+        case EXPR_LITERAL_FLOAT:  return DATA_TYPE_FLOAT;
+        case EXPR_LITERAL_STRING: return DATA_TYPE_STRING;
+        case EXPR_LITERAL_BOOL:   return DATA_TYPE_BOOL;
+        case EXPR_IDENTIFIER:
+            return proven_type(compiler, typing, expr->data.identifier->name);
+        case EXPR_BINARY: {
+            const expr_binary_t *binary = expr->data.binary;
+            if (binary->operator == TOKEN_AND || binary->operator == TOKEN_OR) return DATA_TYPE_BOOL;
+            opcode_t op = binary_opcode(binary->operator);
+            if (op == OP_COUNT) return DATA_TYPE_VOID;
+            return arithmetic_type(op, expr_type(compiler, typing, binary->left), expr_type(compiler, typing, binary->right));
+        }
+        case EXPR_UNARY: {
+            const expr_unary_t *unary = expr->data.unary;
+            data_type_t operand = expr_type(compiler, typing, unary->operand);
+            switch (unary->operator) {
+                case TOKEN_NOT:
+                    return DATA_TYPE_BOOL;
+                case TOKEN_PLUS:
+                    return operand;
+                case TOKEN_MINUS:
+                case TOKEN_PLUSPLUS:
+                case TOKEN_MINUSMINUS:
+                    return is_number_type(operand) ? operand : DATA_TYPE_VOID;
+                default:
+                    return DATA_TYPE_VOID;
+            }
+        }
+        case EXPR_ASSIGNMENT: {
+            const expr_assignment_t *assignment = expr->data.assignment;
+            return stored_type(declared_type(compiler, typing, assignment->name),
+                expr_type(compiler, typing, assignment->value));
+        }
+        case EXPR_CALL: {
+            const expr_call_t *call = expr->data.call;
+            uint32_t index;
+            if (name_table_find(&compiler->function_names, call->name, &index)) {
+                if (index >= compiler->summary_count || !compiler->summaries[index].typed_return) return DATA_TYPE_VOID;
+                return compiler->summaries[index].decl->return_type;
+            }
+            size_t argc = call->args ? call->args->arg_count : 0;
+            data_type_t first = argc > 0 ? expr_type(compiler, typing, call->args->args[0]) : DATA_TYPE_VOID;
+            data_type_t element = first == DATA_TYPE_INT_ARRAY ? DATA_TYPE_INT :
+                first == DATA_TYPE_FLOAT_ARRAY ? DATA_TYPE_FLOAT : DATA_TYPE_VOID;
+            if (strcmp(call->name, "len") == 0 && argc == 1) return DATA_TYPE_INT;
+            if (strcmp(call->name, "sum") == 0 && argc == 1) return element;
+            if (strcmp(call->name, "dot") == 0 && argc == 2 &&
+                expr_type(compiler, typing, call->args->args[1]) == first) return element;
+            if (strcmp(call->name, "int_array") == 0 && argc == 1) return DATA_TYPE_INT_ARRAY;
+            if (strcmp(call->name, "float_array") == 0 && argc == 1) return DATA_TYPE_FLOAT_ARRAY;
+            return DATA_TYPE_VOID;
+        }
+        case EXPR_INDEX: {
+            data_type_t array = expr_type(compiler, typing, expr->data.index->array);
+            return array == DATA_TYPE_INT_ARRAY ? DATA_TYPE_INT :
+                array == DATA_TYPE_FLOAT_ARRAY ? DATA_TYPE_FLOAT : DATA_TYPE_VOID;
+        }
+        default:
+            return DATA_TYPE_VOID;
+    }
+}
+
+/**
+ * @brief Whether running the statement always ends in a return.
+ */
+static bool always_returns(const ast_stmt_node_t *stmt) {
+    if (!stmt) return false;
+    switch (stmt->type) {
+        case STMT_RETURN:
+            return true;
+        case STMT_BLOCK: {
+            size_t count = stmt->data.block_stmt->statement_count;
+            return count > 0 && always_returns(stmt->data.block_stmt->statements[count - 1]);
+        }
+        case STMT_IF: {
+            const stmt_if_t *if_stmt = stmt->data.if_stmt;
+            if (!always_returns(if_stmt->if_block) || !always_returns(if_stmt->else_block)) return false;
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                if (!always_returns(if_stmt->elif_blocks[i])) return false;
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Records the declared type of a parameter or local. A second
+ * declaration with another type, or a global of the same name, unproves it.
+ */
+static void declare_local_type(compiler_t *compiler, function_summary_t *summary, const char *name, data_type_t type) {
+    uint32_t existing;
+    uint32_t global;
+    if (name_table_find(&summary->local_types, name, &existing)) {
+        if ((existing & ~LOCAL_UNPROVEN) != (uint32_t)type) {
+            name_table_set(&summary->local_types, name, existing | LOCAL_UNPROVEN);
+        }
+        return;
+    }
+    uint32_t value = (uint32_t)type;
+    if (name_table_find(&compiler->global_names, name, &global)) {
+        compiler->typed_globals[global] = false;
+        value |= LOCAL_UNPROVEN;
+    }
+    name_table_insert(&summary->local_types, name, value);
+}
+
+static void declare_stmt_types(compiler_t *compiler, function_summary_t *summary, const ast_stmt_node_t *stmt) {
+    if (!stmt) return;
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            declare_local_type(compiler, summary, stmt->data.var_decl->name, stmt->data.var_decl->type);
+            break;
+        case STMT_IF: {
+            const stmt_if_t *if_stmt = stmt->data.if_stmt;
+            declare_stmt_types(compiler, summary, if_stmt->if_block);
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                declare_stmt_types(compiler, summary, if_stmt->elif_blocks[i]);
+            }
+            declare_stmt_types(compiler, summary, if_stmt->else_block);
+            break;
+        }
+        case STMT_WHILE:
+            declare_stmt_types(compiler, summary, stmt->data.while_stmt->block);
+            break;
+        case STMT_FOR: {
+            const stmt_for_t *for_stmt = stmt->data.for_stmt;
+            if (for_stmt->init && for_stmt->init->kind == FOR_INIT_VAR_DECL) {
+                const stmt_var_decl_t *var_decl = for_stmt->init->data.var_decl;
+                declare_local_type(compiler, summary, var_decl->name, var_decl->type);
+            }
+            declare_stmt_types(compiler, summary, for_stmt->block);
+            break;
+        }
+        case STMT_BLOCK:
+            for (size_t i = 0; i < stmt->data.block_stmt->statement_count; ++i) {
+                declare_stmt_types(compiler, summary, stmt->data.block_stmt->statements[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * The state of one pass of infer_types() over a function body, or over the
+ * global initializers when `summary` is NULL.
+ */
+typedef struct type_pass_struct {
+    compiler_t *compiler;
+    function_summary_t *summary;
+    bool changed;
+} type_pass_t;
+
+static void unprove(type_pass_t *pass, function_summary_t *summary, const char *name) {
+    uint32_t value;
+    if (summary && name_table_find(&summary->local_types, name, &value)) {
+        if (!(value & LOCAL_UNPROVEN)) {
+            name_table_set(&summary->local_types, name, value | LOCAL_UNPROVEN);
+            pass->changed = true;
+        }
+        return;
+    }
+    if (name_table_find(&pass->compiler->global_names, name, &value) && pass->compiler->typed_globals[value]) {
+        pass->compiler->typed_globals[value] = false;
+        pass->changed = true;
+    }
+}
+
+/**
+ * @brief Unproves the variable `name` of `summary`'s body unless a value of
+ * type `value` stored into it has its declared type.
+ */
+static void check_store(type_pass_t *pass, function_summary_t *summary, const char *name, data_type_t value) {
+    data_type_t declared = declared_type(pass->compiler, summary, name);
+    if (declared == DATA_TYPE_VOID || stored_type(declared, value) != declared) {
+        unprove(pass, summary, name);
+    }
+}
+
+static void check_expr_types(type_pass_t *pass, const ast_expr_node_t *expr) {
+    if (!expr) return;
+    compiler_t *compiler = pass->compiler;
+    switch (expr->type) {
+        case EXPR_BINARY:
+            check_expr_types(pass, expr->data.binary->left);
+            check_expr_types(pass, expr->data.binary->right);
+            break;
+        case EXPR_UNARY: {
+            const expr_unary_t *unary = expr->data.unary;
+            check_expr_types(pass, unary->operand);
+            if ((unary->operator == TOKEN_PLUSPLUS || unary->operator == TOKEN_MINUSMINUS) &&
+                unary->operand && unary->operand->type == EXPR_IDENTIFIER) {
+                check_store(pass, pass->summary, unary->operand->data.identifier->name,
+                    expr_type(compiler, pass->summary, expr));
+            }
+            break;
+        }
+        case EXPR_ASSIGNMENT:
+            check_expr_types(pass, expr->data.assignment->value);
+            check_store(pass, pass->summary, expr->data.assignment->name,
+                expr_type(compiler, pass->summary, expr->data.assignment->value));
+            break;
+        case EXPR_CALL: {
+            const expr_call_t *call = expr->data.call;
+            size_t argc = call->args ? call->args->arg_count : 0;
+            for (size_t i = 0; i < argc; ++i) {
+                check_expr_types(pass, call->args->args[i]);
+            }
+            uint32_t index;
+            if (!name_table_find(&compiler->function_names, call->name, &index) || index >= compiler->summary_count) break;
+            function_summary_t *callee = &compiler->summaries[index];
+            if (!callee->decl || argc != callee->decl->param_list->param_count) break;
+            for (size_t i = 0; i < argc; ++i) {
+                check_store(pass, callee, callee->decl->param_list->params[i].name,
+                    expr_type(compiler, pass->summary, call->args->args[i]));
+            }
+            break;
+        }
+        case EXPR_INDEX:
+            check_expr_types(pass, expr->data.index->array);
+            check_expr_types(pass, expr->data.index->index);
+            break;
+        case EXPR_ARG_LIST:
+            for (size_t i = 0; i < expr->data.arg_list->arg_count; ++i) {
+                check_expr_types(pass, expr->data.arg_list->args[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Checks an assignment statement. Inside a parallel for, `+=` and
+ * `*=` may fold partial results of any type into their target.
+ */
+static void check_assign_types(type_pass_t *pass, const stmt_assign_t *assign, bool parallel) {
+    if (!assign) return;
+    check_expr_types(pass, assign->index);
+    check_expr_types(pass, assign->value);
+    if (assign->index) return;
+    compiler_t *compiler = pass->compiler;
+    data_type_t value = expr_type(compiler, pass->summary, assign->value);
+    if (assign->operator != TOKEN_EQ) {
+        if (parallel) {
+            unprove(pass, pass->summary, assign->name);
+            return;
+        }
+        value = arithmetic_type(compound_opcode(assign->operator),
+            proven_type(compiler, pass->summary, assign->name), value);
+    }
+    check_store(pass, pass->summary, assign->name, value);
+}
+
+static void check_stmt_types(type_pass_t *pass, const ast_stmt_node_t *stmt, bool parallel) {
+    if (!stmt) return;
+    compiler_t *compiler = pass->compiler;
+    switch (stmt->type) {
+        case STMT_VAR_DECL: {
+            const stmt_var_decl_t *var_decl = stmt->data.var_decl;
+            check_expr_types(pass, var_decl->initializer);
+            check_store(pass, pass->summary, var_decl->name, expr_type(compiler, pass->summary, var_decl->initializer));
+            break;
+        }
+        case STMT_ASSIGN:
+            check_assign_types(pass, stmt->data.assign, parallel);
+            break;
+        case STMT_RETURN: {
+            const ast_expr_node_t *value = stmt->data.return_stmt->value;
+            check_expr_types(pass, value);
+            function_summary_t *summary = pass->summary;
+            if (summary && summary->typed_return) {
+                data_type_t declared = summary->decl->return_type;
+                if (stored_type(declared, expr_type(compiler, summary, value)) != declared) {
+                    summary->typed_return = false;
+                    pass->changed = true;
+                }
+            }
+            break;
+        }
+        case STMT_PRINT:
+            for (size_t i = 0; stmt->data.print_stmt->args && i < stmt->data.print_stmt->args->arg_count; ++i) {
+                check_expr_types(pass, stmt->data.print_stmt->args->args[i]);
+            }
+            break;
+        case STMT_IF: {
+            const stmt_if_t *if_stmt = stmt->data.if_stmt;
+            check_expr_types(pass, if_stmt->if_condition);
+            check_stmt_types(pass, if_stmt->if_block, parallel);
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                check_expr_types(pass, if_stmt->elif_conditions[i]);
+                check_stmt_types(pass, if_stmt->elif_blocks[i], parallel);
+            }
+            check_stmt_types(pass, if_stmt->else_block, parallel);
+            break;
+        }
+        case STMT_WHILE:
+            check_expr_types(pass, stmt->data.while_stmt->condition);
+            check_stmt_types(pass, stmt->data.while_stmt->block, parallel);
+            break;
+        case STMT_FOR: {
+            const stmt_for_t *for_stmt = stmt->data.for_stmt;
+            const stmt_for_init_t *init = for_stmt->init;
+            if (init) {
+                switch (init->kind) {
+                    case FOR_INIT_VAR_DECL:
+                        check_expr_types(pass, init->data.var_decl->initializer);
+                        check_store(pass, pass->summary, init->data.var_decl->name,
+                            expr_type(compiler, pass->summary, init->data.var_decl->initializer));
+                        break;
+                    case FOR_INIT_ASSIGN:
+                        check_assign_types(pass, init->data.assign, parallel);
+                        break;
+                    case FOR_INIT_EXPR:
+                        check_expr_types(pass, init->data.expr->expression);
+                        break;
+                    case FOR_INIT_NONE:
+                        break;
+                }
+            }
+            check_expr_types(pass, for_stmt->condition);
+            check_assign_types(pass, for_stmt->increment, parallel);
+            check_stmt_types(pass, for_stmt->block, parallel || for_stmt->parallel);
+            break;
+        }
+        case STMT_EXPR:
+            check_expr_types(pass, stmt->data.expr_stmt->expression);
+            break;
+        case STMT_BLOCK:
+            for (size_t i = 0; i < stmt->data.block_stmt->statement_count; ++i) {
+                check_stmt_types(pass, stmt->data.block_stmt->statements[i], parallel);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Proves which variables only ever hold values of their declared
+ * types, and which functions always return their declared return type.
+ */
+static void infer_types(compiler_t *compiler, const ast_t *ast) {
+    compiler->typed_globals = malloc((compiler->global_count ? compiler->global_count : 1) * sizeof(bool));
+    CHECK_MEM_ALLOC_ERROR(compiler->typed_globals);
+    for (size_t i = 0; i < compiler->global_count; ++i) {
+        compiler->typed_globals[i] = true;
+    }
+    for (size_t i = 0; i < compiler->summary_count; ++i) {
+        function_summary_t *summary = &compiler->summaries[i];
+        const decl_function_t *function = summary->decl;
+        if (!function) continue;
+        for (size_t j = 0; j < function->param_list->param_count; ++j) {
+            const param_t *param = &function->param_list->params[j];
+            declare_local_type(compiler, summary, param->name, param->type);
+        }
+        for (size_t j = 0; j < function->body_count; ++j) {
+            declare_stmt_types(compiler, summary, function->body[j]);
+        }
+        summary->typed_return = function->return_type != DATA_TYPE_VOID && !function->is_async &&
+            function->body_count > 0 && always_returns(function->body[function->body_count - 1]);
+    }
+
+    type_pass_t pass = { compiler, NULL, true };
+    while (pass.changed) {
+        pass.changed = false;
+        for (size_t i = 0; i < compiler->summary_count; ++i) {
+            pass.summary = &compiler->summaries[i];
+            if (!pass.summary->decl) continue;
+            for (size_t j = 0; j < pass.summary->decl->body_count; ++j) {
+                check_stmt_types(&pass, pass.summary->decl->body[j], false);
+            }
+        }
+        // Globals start out null, so one read by a function an initializer
+        // calls before its own initializer has run is not proven either.
+        pass.summary = NULL;
+        bool called = false;
+        for (size_t i = 0; i < ast->node_count; ++i) {
+            const ast_node_t *node = ast->nodes[i];
+            if (node->type != AST_NODE_CATEGORY_STMT || !node->data.stmt_node ||
+                node->data.stmt_node->type != STMT_VAR_DECL) {
+                continue;
+            }
+            const ast_stmt_node_t *stmt = node->data.stmt_node;
+            function_summary_t probe = {0};
+            scan_expr(compiler, &probe, stmt->data.var_decl->initializer);
+            free(probe.callees);
+            called = called || probe.callee_count > 0;
+            if (called) {
+                unprove(&pass, NULL, stmt->data.var_decl->name);
+            }
+            check_stmt_types(&pass, stmt, false);
+        }
+    }
+}
+
+static data_type_t type_of(const compiler_t *compiler, const ast_expr_node_t *expr) {
+    return expr_type(compiler, compiler->typing, expr);
+}
+
+/**
+ * @brief Converts the value on the stack, of type `value`, when it is stored
+ * into a float variable, parameter or return value. Ints become floats there
+ * whether typed opcodes are on or not, so proofs never depend on the switch.
+ */
+static void emit_conversion(compiler_t *compiler, data_type_t target, data_type_t value) {
+    if (target == DATA_TYPE_FLOAT && value != DATA_TYPE_FLOAT) {
+        emit_op(compiler, OP_TO_FLOAT);
+    }
+}
+
+//--------------------------------------- Inlining ----------------------------------------------------------------------------------
+
+/**
+ * @brief Decides whether a call may be compiled in place. Small callees are
+ * inlined inside loops, where calls are frequent, and only tiny ones outside.
+ *
+ * @return NULL to inline, otherwise the reason not to.
+ */
+static const char *inline_verdict(const compiler_t *compiler, uint32_t index, size_t loop_depth) {
+    const function_summary_t *summary = &compiler->summaries[index];
+    if (summary->reason) {
+        return summary->reason;
+    }
+    size_t limit = loop_depth > 0 ? inline_threshold : inline_threshold / INLINE_COLD_DIVISOR;
+    if (summary->size > limit) {
+        return "too large";
+    }
+    if (summary->size > compiler->inline_budget) {
+        return "growth budget spent";
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reports the decision at a call site the first time that site is
+ * compiled into the current function: the copies of an unrolled loop, say,
+ * compile the same calls again.
+ */
+static void report_inline(compiler_t *compiler, const ast_expr_node_t *expr, uint32_t index,
+    size_t loop_depth, const char *reason) {
+    if (!inline_report) return;
+    uint64_t caller = (uint64_t)(compiler->function - compiler->functions);
+    if (!key_set_add(&compiler->inline_reported, caller << 32 | expr->offset)) return;
+    size_t line, column;
+    source_map_locate(compiler->source_map, expr->offset, &line, &column);
+    fprintf(inline_report, "[%zu:%zu] inline %s -> %s (size %zu, loop depth %zu): %s\n", line, column,
+        compiler->strings + compiler->function->name, compiler->summaries[index].decl->name,
+        compiler->summaries[index].size, loop_depth, reason ? reason : "inlined");
+}
+
+/**
+ * @brief Compiles the body of a call in place, its arguments already on
+ * the stack. The callee's parameters and locals get fresh slots and cannot
+ * see the caller's locals, so names never resolve to the wrong variable.
+ *
+ * The body is compiled as a trial: if it does not compile in place, the
+ * code is dropped and the caller emits a call instead.
+ *
+ * @return true if the call was inlined.
+ */
+static bool expand_inline(compiler_t *compiler, const ast_expr_node_t *expr, uint32_t index, size_t loop_depth) {
+    const function_summary_t *summary = &compiler->summaries[index];
+    const decl_function_t *callee = summary->decl;
+    size_t argc = callee->param_list->param_count;
+
+    // Everything a failed trial has to undo.
+    size_t code_size = compiler->code_size;
+    size_t line_count = compiler->line_count;
+    uint32_t function_line_count = compiler->function->line_count;
+    image_line_t last_line = line_count > 0 ? compiler->lines[line_count - 1] : (image_line_t){ 0, 0, 0 };
+    int stack_depth = compiler->stack_depth;
+    size_t error_count = compiler->error_count;
+    size_t inline_budget = compiler->inline_budget;
+
+    // The body sees none of the caller's loops and is not itself a parallel body.
+    compiler_loop_t *loops = compiler->loops;
+    size_t loop_count = compiler->loop_count;
+    size_t loop_capacity = compiler->loop_capacity;
+    parallel_body_t *parallel = compiler->parallel;
+    inline_expansion_t *outer = compiler->inlining;
+    size_t local_floor = compiler->local_floor;
+    size_t outer_loop_depth = compiler->outer_loop_depth;
+    const function_summary_t *typing = compiler->typing;
+    compiler->loops = NULL;
+    compiler->loop_count = compiler->loop_capacity = 0;
+    compiler->parallel = NULL;
+    compiler->outer_loop_depth = loop_depth;
+    compiler->inline_budget -= summary->size;
+    compiler->typing = summary;
+
+    inline_expansion_t expansion = { { NULL, 0, 0 }, stack_depth - (int)argc + 1 };
+    compiler->inlining = &expansion;
+    compiler->muted++;
+
+    begin_scope(compiler);
+    compiler->local_floor = compiler->local_count;
+    uint16_t slots[COMPILER_MAX_ARGS];
+    for (size_t i = 0; i < argc; ++i) {
+        const param_t *param = &callee->param_list->params[i];
+        slots[i] = declare_local(compiler, param->name, param->type, param->offset);
+    }
+    for (size_t i = argc; i > 0; --i) {
+        emit_op_u16(compiler, OP_SET_LOCAL, slots[i - 1]);
+    }
+    size_t body_count = callee->body_count;
+    const ast_stmt_node_t *last = body_count > 0 ? callee->body[body_count - 1] : NULL;
+    bool falls_through = !last || last->type != STMT_RETURN;
+    if (!falls_through) {
+        body_count--;
+    }
+    for (size_t i = 0; i < body_count; ++i) {
+        compile_stmt(compiler, callee->body[i]);
+    }
+    if (falls_through) {
+        // Falling off the end yields null, like end_function().
+        emit_op(compiler, OP_NULL);
+    } else {
+        // The final return needs no jump; its value is the result.
+        mark_position(compiler, last->offset);
+        compile_expr(compiler, last->data.return_stmt->value);
+        emit_conversion(compiler, callee->return_type, type_of(compiler, last->data.return_stmt->value));
+    }
+    for (size_t i = 0; i < expansion.returns.count; ++i) {
+        patch_jump(compiler, expansion.returns.positions[i]);
+    }
+    compiler->stack_depth = expansion.result_depth;
+    end_scope(compiler);
+
+    compiler->muted--;
+    free(expansion.returns.positions);
+    free(compiler->loops);
+    compiler->loops = loops;
+    compiler->loop_count = loop_count;
+    compiler->loop_capacity = loop_capacity;
+    compiler->parallel = parallel;
+    compiler->inlining = outer;
+    compiler->local_floor = local_floor;
+    compiler->outer_loop_depth = outer_loop_depth;
+    compiler->typing = typing;
+
+    if (compiler->error_count == error_count) {
+        mark_position(compiler, expr->offset);
+        return true;
+    }
+    compiler->code_size = code_size;
+    compiler->line_count = line_count;
+    compiler->function->line_count = function_line_count;
+    if (line_count > 0) {
+        compiler->lines[line_count - 1] = last_line;
+    }
+    compiler->stack_depth = stack_depth;
+    compiler->error_count = error_count;
+    compiler->inline_budget = inline_budget;
+    return false;
+}
+
+//--------------------------------------- Loop Invariants ---------------------------------------------------------------------------
+
+/**
+ * Everything a loop may change while it runs: its condition, body and
+ * increment, and whatever the functions they call change.
+ */
+typedef struct loop_effects_struct {
+    const char **assigned;      // names assigned or declared in the loop
+    size_t assigned_count;
+    size_t assigned_capacity;
+    bool stores_arrays;
+    bool assigns_globals;
+} loop_effects_t;
+
+typedef struct expr_list_struct {
+    const ast_expr_node_t **exprs;
+    size_t count;
+    size_t capacity;
+} expr_list_t;
+
+static void expr_list_add(expr_list_t *list, const ast_expr_node_t *expr) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 4;
+        list->exprs = realloc(list->exprs, list->capacity * sizeof(const ast_expr_node_t *));
+        CHECK_MEM_ALLOC_ERROR(list->exprs);
+    }
+    list->exprs[list->count++] = expr;
+}
+
+static void note_assigned(compiler_t *compiler, loop_effects_t *effects, const char *name) {
+    if (is_global_name(compiler, name)) {
+        effects->assigns_globals = true;
+    }
+    if (effects->assigned_count >= effects->assigned_capacity) {
+        effects->assigned_capacity = effects->assigned_capacity ? effects->assigned_capacity * 2 : 8;
+        effects->assigned = realloc(effects->assigned, effects->assigned_capacity * sizeof(const char *));
+        CHECK_MEM_ALLOC_ERROR(effects->assigned);
+    }
+    effects->assigned[effects->assigned_count++] = name;
+}
+
+static bool is_assigned(const loop_effects_t *effects, const char *name) {
+    for (size_t i = 0; i < effects->assigned_count; ++i) {
+        if (strcmp(effects->assigned[i], name) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Anything that may run other code behind the loop's back: an impure
+ * call, an await or a parallel for.
+ */
+static void note_impure(loop_effects_t *effects) {
+    effects->stores_arrays = true;
+    effects->assigns_globals = true;
+}
+
+static void collect_stmt_effects(compiler_t *compiler, loop_effects_t *effects, const ast_stmt_node_t *stmt);
+
+static void collect_expr_effects(compiler_t *compiler, loop_effects_t *effects, const ast_expr_node_t *expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_BINARY:
+            collect_expr_effects(compiler, effects, expr->data.binary->left);
+            collect_expr_effects(compiler, effects, expr->data.binary->right);
+            break;
+        case EXPR_UNARY: {
+            const expr_unary_t *unary = expr->data.unary;
+            if (unary->operator == TOKEN_AWAIT) {
+                note_impure(effects);
+            } else if ((unary->operator == TOKEN_PLUSPLUS || unary->operator == TOKEN_MINUSMINUS) &&
+                unary->operand && unary->operand->type == EXPR_IDENTIFIER) {
+                note_assigned(compiler, effects, unary->operand->data.identifier->name);
+            }
+            collect_expr_effects(compiler, effects, unary->operand);
+            break;
+        }
+        case EXPR_ASSIGNMENT:
+            note_assigned(compiler, effects, expr->data.assignment->name);
+            collect_expr_effects(compiler, effects, expr->data.assignment->value);
+            break;
+        case EXPR_ARG_LIST:
+            for (size_t i = 0; i < expr->data.arg_list->arg_count; ++i) {
+                collect_expr_effects(compiler, effects, expr->data.arg_list->args[i]);
+            }
+            break;
+        case EXPR_CALL: {
+            const expr_call_t *call = expr->data.call;
+            for (size_t i = 0; call->args && i < call->args->arg_count; ++i) {
+                collect_expr_effects(compiler, effects, call->args->args[i]);
+            }
+            uint32_t index;
+            if (name_table_find(&compiler->function_names, call->name, &index)) {
+                if (index >= compiler->summary_count || compiler->summaries[index].impure) {
+                    note_impure(effects);
+                }
+            } else if (strcmp(call->name, "sleep") == 0 || strcmp(call->name, "readable") == 0 ||
+                strcmp(call->name, "writable") == 0) {
+                note_impure(effects);
+            }
+            break;
+        }
+        case EXPR_INDEX:
+            collect_expr_effects(compiler, effects, expr->data.index->array);
+            collect_expr_effects(compiler, effects, expr->data.index->index);
+            break;
+        default:
+            break;
+    }
+}
+
+static void collect_assign_effects(compiler_t *compiler, loop_effects_t *effects, const stmt_assign_t *assign) {
+    if (!assign) return;
+    if (assign->index) {
+        effects->stores_arrays = true;
+    } else {
+        note_assigned(compiler, effects, assign->name);
+    }
+    collect_expr_effects(compiler, effects, assign->index);
+    collect_expr_effects(compiler, effects, assign->value);
+}
+
+static void collect_stmt_effects(compiler_t *compiler, loop_effects_t *effects, const ast_stmt_node_t *stmt) {
+    if (!stmt) return;
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            note_assigned(compiler, effects, stmt->data.var_decl->name);
+            collect_expr_effects(compiler, effects, stmt->data.var_decl->initializer);
+            break;
+        case STMT_ASSIGN:
+            collect_assign_effects(compiler, effects, stmt->data.assign);
+            break;
+        case STMT_RETURN:
+            collect_expr_effects(compiler, effects, stmt->data.return_stmt->value);
+            break;
+        case STMT_PRINT:
+            for (size_t i = 0; stmt->data.print_stmt->args && i < stmt->data.print_stmt->args->arg_count; ++i) {
+                collect_expr_effects(compiler, effects, stmt->data.print_stmt->args->args[i]);
+            }
+            break;
+        case STMT_IF: {
+            const stmt_if_t *if_stmt = stmt->data.if_stmt;
+            collect_expr_effects(compiler, effects, if_stmt->if_condition);
+            collect_stmt_effects(compiler, effects, if_stmt->if_block);
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                collect_expr_effects(compiler, effects, if_stmt->elif_conditions[i]);
+                collect_stmt_effects(compiler, effects, if_stmt->elif_blocks[i]);
+            }
+            collect_stmt_effects(compiler, effects, if_stmt->else_block);
+            break;
+        }
+        case STMT_WHILE:
+            collect_expr_effects(compiler, effects, stmt->data.while_stmt->condition);
+            collect_stmt_effects(compiler, effects, stmt->data.while_stmt->block);
+            break;
+        case STMT_FOR: {
+            const stmt_for_t *for_stmt = stmt->data.for_stmt;
+            if (for_stmt->parallel) {
+                note_impure(effects);
+            }
+            if (for_stmt->init) {
+                switch (for_stmt->init->kind) {
+                    case FOR_INIT_VAR_DECL:
+                        note_assigned(compiler, effects, for_stmt->init->data.var_decl->name);
+                        collect_expr_effects(compiler, effects, for_stmt->init->data.var_decl->initializer);
+                        break;
+                    case FOR_INIT_ASSIGN:
+                        collect_assign_effects(compiler, effects, for_stmt->init->data.assign);
+                        break;
+                    case FOR_INIT_EXPR:
+                        collect_expr_effects(compiler, effects, for_stmt->init->data.expr->expression);
+                        break;
+                    case FOR_INIT_NONE:
+                        break;
+                }
+            }
+            collect_expr_effects(compiler, effects, for_stmt->condition);
+            collect_assign_effects(compiler, effects, for_stmt->increment);
+            collect_stmt_effects(compiler, effects, for_stmt->block);
+            break;
+        }
+        case STMT_EXPR:
+            collect_expr_effects(compiler, effects, stmt->data.expr_stmt->expression);
+            break;
+        case STMT_BLOCK:
+            for (size_t i = 0; i < stmt->data.block_stmt->statement_count; ++i) {
+                collect_stmt_effects(compiler, effects, stmt->data.block_stmt->statements[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static bool is_invariant(compiler_t *compiler, const loop_effects_t *effects, const ast_expr_node_t *expr);
+
+/**
+ * @brief A call is invariant if its arguments are and it is pure: it has no
+ * effects and reads nothing the loop changes.
+ */
+static bool is_invariant_call(compiler_t *compiler, const loop_effects_t *effects, const expr_call_t *call) {
+    if (!call->args) return false;
+    for (size_t i = 0; i < call->args->arg_count; ++i) {
+        if (!is_invariant(compiler, effects, call->args->args[i])) return false;
+    }
+    uint32_t index;
+    if (name_table_find(&compiler->function_names, call->name, &index)) {
+        if (index >= compiler->summary_count) return false;
+        const function_summary_t *summary = &compiler->summaries[index];
+        return summary->decl && !summary->impure && call->args->arg_count == summary->decl->param_list->param_count &&
+            !(summary->reads_globals && effects->assigns_globals) && !(summary->reads_arrays && effects->stores_arrays);
+    }
+    // Arrays never change length, only contents.
+    if (strcmp(call->name, "len") == 0) return call->args->arg_count == 1;
+    if (strcmp(call->name, "sum") == 0) return call->args->arg_count == 1 && !effects->stores_arrays;
+    if (strcmp(call->name, "dot") == 0) return call->args->arg_count == 2 && !effects->stores_arrays;
+    return false;
+}
+
+static bool is_invariant(compiler_t *compiler, const loop_effects_t *effects, const ast_expr_node_t *expr) {
+    if (!expr) return false;
+    switch (expr->type) {
+        case EXPR_LITERAL_INT:
+        case EXPR_LITERAL_FLOAT:
+        case EXPR_LITERAL_STRING:
+        case EXPR_LITERAL_BOOL:
+        case EXPR_LITERAL_NULL:
+            return true;
+        case EXPR_IDENTIFIER: {
+            const char *name = expr->data.identifier->name;
+            uint16_t slot;
+            if (is_assigned(effects, name)) return false;
+            return resolve_local(compiler, name, &slot) || !effects->assigns_globals;
+        }
+        case EXPR_BINARY:
+            return is_invariant(compiler, effects, expr->data.binary->left) &&
+                is_invariant(compiler, effects, expr->data.binary->right);
+        case EXPR_UNARY: {
+            token_type_t operator = expr->data.unary->operator;
+            return (operator == TOKEN_MINUS || operator == TOKEN_NOT || operator == TOKEN_PLUS) &&
+                is_invariant(compiler, effects, expr->data.unary->operand);
+        }
+        case EXPR_CALL:
+            return is_invariant_call(compiler, effects, expr->data.call);
+        case EXPR_INDEX:
+            return !effects->stores_arrays && is_invariant(compiler, effects, expr->data.index->array) &&
+                is_invariant(compiler, effects, expr->data.index->index);
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Walks `expr` in evaluation order, collecting its largest invariant
+ * subexpressions that are worth a slot. Hoisting one moves its evaluation,
+ * and any runtime error in it, ahead of what the walk has passed, so the
+ * walk stops at the first thing that can fail or has an effect.
+ *
+ * @return false once the walk has stopped.
+ */
+static bool find_invariants(compiler_t *compiler, const loop_effects_t *effects, const ast_expr_node_t *expr,
+    expr_list_t *found) {
+    if (!expr) return true;
+    switch (expr->type) {
+        case EXPR_LITERAL_INT:
+        case EXPR_LITERAL_FLOAT:
+        case EXPR_LITERAL_STRING:
+        case EXPR_LITERAL_BOOL:
+        case EXPR_LITERAL_NULL:
+        case EXPR_IDENTIFIER:
+            return true;
+        default:
+            break;
+    }
+    if (is_invariant(compiler, effects, expr)) {
+        expr_list_add(found, expr);
+        return true;
+    }
+    switch (expr->type) {
+        case EXPR_BINARY: {
+            const expr_binary_t *binary = expr->data.binary;
+            if (!find_invariants(compiler, effects, binary->left, found)) return false;
+            // The right operand of `and` and `or` does not always run.
+            if (binary->operator == TOKEN_AND || binary->operator == TOKEN_OR) return false;
+            if (!find_invariants(compiler, effects, binary->right, found)) return false;
+            return binary->operator == TOKEN_EQEQ || binary->operator == TOKEN_NEQ;
+        }
+        case EXPR_UNARY: {
+            const expr_unary_t *unary = expr->data.unary;
+            if (unary->operator == TOKEN_NOT || unary->operator == TOKEN_PLUS) {
+                return find_invariants(compiler, effects, unary->operand, found);
+            }
+            if (unary->operator == TOKEN_MINUS) {
+                find_invariants(compiler, effects, unary->operand, found);
+            }
+            return false;
+        }
+        case EXPR_ASSIGNMENT: {
+            uint16_t slot;
+            return find_invariants(compiler, effects, expr->data.assignment->value, found) &&
+                resolve_local(compiler, expr->data.assignment->name, &slot);
+        }
+        case EXPR_CALL: {
+            const expr_call_t *call = expr->data.call;
+            for (size_t i = 0; call->args && i < call->args->arg_count; ++i) {
+                if (!find_invariants(compiler, effects, call->args->args[i], found)) return false;
+            }
+            return false;
+        }
+        case EXPR_INDEX:
+            if (find_invariants(compiler, effects, expr->data.index->array, found)) {
+                find_invariants(compiler, effects, expr->data.index->index, found);
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Like find_invariants(), over the statements a loop body starts
+ * with, up to the first one that branches, prints or may fail.
+ */
+static bool find_stmt_invariants(compiler_t *compiler, const loop_effects_t *effects, const ast_stmt_node_t *stmt,
+    expr_list_t *found) {
+    if (!stmt) return true;
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            return find_invariants(compiler, effects, stmt->data.var_decl->initializer, found);
+        case STMT_ASSIGN: {
+            const stmt_assign_t *assign = stmt->data.assign;
+            if (assign->index) {
+                if (find_invariants(compiler, effects, assign->index, found)) {
+                    find_invariants(compiler, effects, assign->value, found);
+                }
+                return false;
+            }
+            uint16_t slot;
+            return find_invariants(compiler, effects, assign->value, found) && assign->operator == TOKEN_EQ &&
+                resolve_local(compiler, assign->name, &slot);
+        }
+        case STMT_EXPR:
+            return find_invariants(compiler, effects, stmt->data.expr_stmt->expression, found);
+        case STMT_BLOCK:
+            for (size_t i = 0; i < stmt->data.block_stmt->statement_count; ++i) {
+                if (!find_stmt_invariants(compiler, effects, stmt->data.block_stmt->statements[i], found)) return false;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Finds the invariant expressions of a loop: those its condition
+ * computes before anything that may fail, and those its body starts with.
+ * Each is computed once, before the loop, instead of on every iteration.
+ * Must run inside the loop's own scope, which owns their slots.
+ */
+static void find_loop_invariants(compiler_t *compiler, const ast_expr_node_t *condition, const stmt_assign_t *increment,
+    const ast_stmt_node_t *body, expr_list_t *in_condition, expr_list_t *in_body) {
+    if (!hoisting) return;
+    loop_effects_t effects = {0};
+    collect_expr_effects(compiler, &effects, condition);
+    collect_assign_effects(compiler, &effects, increment);
+    collect_stmt_effects(compiler, &effects, body);
+    find_invariants(compiler, &effects, condition, in_condition);
+    find_stmt_invariants(compiler, &effects, body, in_body);
+    free(effects.assigned);
+}
+
+/**
+ * @brief Has compile_expr() read `expr` from `slot` until the loop ends.
+ */
+static void push_hoisted(compiler_t *compiler, const ast_expr_node_t *expr, uint16_t slot) {
+    if (compiler->hoisted_count >= compiler->hoisted_capacity) {
+        compiler->hoisted_capacity = compiler->hoisted_capacity ? compiler->hoisted_capacity * 2 : 8;
+        compiler->hoisted = realloc(compiler->hoisted, compiler->hoisted_capacity * sizeof(hoisted_expr_t));
+        CHECK_MEM_ALLOC_ERROR(compiler->hoisted);
+    }
+    compiler->hoisted[compiler->hoisted_count++] = (hoisted_expr_t){ expr, slot };
+}
+
+/**
+ * @brief Computes each expression into a fresh slot, where the loop's code
+ * reads it from then on.
+ */
+static void hoist_invariants(compiler_t *compiler, const expr_list_t *invariants) {
+    for (size_t i = 0; i < invariants->count; ++i) {
+        const ast_expr_node_t *expr = invariants->exprs[i];
+        mark_position(compiler, expr->offset);
+        compile_expr(compiler, expr);
+        uint16_t slot = add_local(compiler, "", expr->offset);
+        emit_op_u16(compiler, OP_SET_LOCAL, slot);
+
+        push_hoisted(compiler, expr, slot);
+    }
+}
+
+static const hoisted_expr_t *find_hoisted(const compiler_t *compiler, const ast_expr_node_t *expr) {
+    for (size_t i = compiler->hoisted_count; i > 0; --i) {
+        if (compiler->hoisted[i - 1].expr == expr) return &compiler->hoisted[i - 1];
+    }
+    return NULL;
+}
+
+static bool load_hoisted(compiler_t *compiler, const ast_expr_node_t *expr) {
+    const hoisted_expr_t *hoisted = find_hoisted(compiler, expr);
+    if (!hoisted) return false;
+    emit_op_u16(compiler, OP_GET_LOCAL, hoisted->slot);
+    return true;
+}
+
+//--------------------------------------- Counted Loops -----------------------------------------------------------------------------
+
+/**
+ * A for loop that counts a variable of its own from a constant, by a
+ * constant step, towards a bound the loop does not change:
+ * `for (i : int = a; i < b; i += c)` and the like.
+ */
+typedef struct counted_loop_struct {
+    const char *name;
+    int64_t start;
+    int64_t step;
+    token_type_t comparison;        // `i <comparison> bound`, mirrored if the loop has it the other way round
+    const ast_expr_node_t *bound;
+    bool constant_bound;
+    int64_t bound_value;
+    int64_t trip_count;             // with a constant bound, -1 if too large to count
+
+    // Strength reduction: the body uses `i` only in products `i * factor`,
+    // so the loop counts `i * factor` instead and never computes `i`.
+    bool reduced;
+    expr_list_t products;
+    int64_t factor;
+    uint16_t product_slot;
+    uint16_t bound_slot;            // bound * factor, unless the bound is constant
+} counted_loop_t;
+
+static bool is_name(const ast_expr_node_t *expr, const char *name) {
+    return expr && expr->type == EXPR_IDENTIFIER && strcmp(expr->data.identifier->name, name) == 0;
+}
+
+/**
+ * @brief Reads the value of an int literal, possibly negated.
+ */
+static bool int_literal(const ast_expr_node_t *expr, int64_t *value) {
+    if (!expr) return false;
+    if (expr->type == EXPR_LITERAL_INT) {
+        *value = expr->data.literal_int->value;
+        return true;
+    }
+    if (expr->type == EXPR_UNARY && expr->data.unary->operator == TOKEN_MINUS &&
+        int_literal(expr->data.unary->operand, value)) {
+        *value = -*value;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Like int_literal(), also reading the counter of an enclosing
+ * unrolled loop, which is constant in each copy.
+ */
+static bool constant_start(compiler_t *compiler, const ast_expr_node_t *expr, int64_t *value) {
+    uint16_t slot;
+    if (expr && expr->type == EXPR_IDENTIFIER && compiler->induction_constant &&
+        resolve_local(compiler, expr->data.identifier->name, &slot) && slot == compiler->induction_slot) {
+        *value = compiler->induction_value;
+        return true;
+    }
+    return int_literal(expr, value);
+}
+
+static token_type_t mirror_comparison(token_type_t comparison) {
+    switch (comparison) {
+        case TOKEN_LT:  return TOKEN_GT;
+        case TOKEN_LEQ: return TOKEN_GEQ;
+        case TOKEN_GT:  return TOKEN_LT;
+        default:        return TOKEN_LEQ;
+    }
+}
+
+/**
+ * @brief Reads the step of `i += c`, `i -= c`, `i = i + c`, `i = c + i`
+ * or `i = i - c`.
+ */
+static bool counted_step(const stmt_assign_t *increment, const char *name, int64_t *step) {
+    if (!increment || increment->index || strcmp(increment->name, name) != 0) return false;
+    if (increment->operator == TOKEN_PLUSEQ || increment->operator == TOKEN_MINUSEQ) {
+        if (!int_literal(increment->value, step)) return false;
+        if (increment->operator == TOKEN_MINUSEQ) *step = -*step;
+        return true;
+    }
+    const ast_expr_node_t *value = increment->value;
+    if (increment->operator != TOKEN_EQ || !value || value->type != EXPR_BINARY) return false;
+    const expr_binary_t *binary = value->data.binary;
+    if (binary->operator == TOKEN_PLUS) {
+        return (is_name(binary->left, name) && int_literal(binary->right, step)) ||
+            (is_name(binary->right, name) && int_literal(binary->left, step));
+    }
+    if (binary->operator == TOKEN_MINUS && is_name(binary->left, name) && int_literal(binary->right, step)) {
+        *step = -*step;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Iterations of a loop with a constant bound, or -1 if there are
+ * too many to count exactly.
+ */
+static int64_t trip_count(int64_t start, int64_t bound, int64_t step, token_type_t comparison) {
+    if (start < -COUNTED_MAX_VALUE || start > COUNTED_MAX_VALUE || bound < -COUNTED_MAX_VALUE || bound > COUNTED_MAX_VALUE) {
+        return -1;
+    }
+    int64_t distance = step > 0 ? bound - start : start - bound;
+    int64_t stride = step > 0 ? step : -step;
+    if (comparison == TOKEN_LEQ || comparison == TOKEN_GEQ) {
+        return distance < 0 ? 0 : distance / stride + 1;
+    }
+    return distance <= 0 ? 0 : (distance + stride - 1) / stride;
+}
+
+static bool find_stmt_products(counted_loop_t *counted, const ast_stmt_node_t *stmt);
+
+/**
+ * @brief Collects the products `i * K` and `K * i` of `expr`.
+ *
+ * @return false if `i` is used any other way or K differs between them.
+ */
+static bool find_products(counted_loop_t *counted, const ast_expr_node_t *expr) {
+    if (!expr) return true;
+    switch (expr->type) {
+        case EXPR_IDENTIFIER:
+            return strcmp(expr->data.identifier->name, counted->name) != 0;
+        case EXPR_BINARY: {
+            const expr_binary_t *binary = expr->data.binary;
+            int64_t factor;
+            if (binary->operator == TOKEN_ASTERISK &&
+                ((is_name(binary->left, counted->name) && int_literal(binary->right, &factor)) ||
+                 (is_name(binary->right, counted->name) && int_literal(binary->left, &factor)))) {
+                if (factor == 0 || factor > REDUCE_MAX_FACTOR || factor < -REDUCE_MAX_FACTOR) return false;
+                if (counted->products.count > 0 && factor != counted->factor) return false;
+                counted->factor = factor;
+                expr_list_add(&counted->products, expr);
+                return true;
+            }
+            return find_products(counted, binary->left) && find_products(counted, binary->right);
+        }
+        case EXPR_UNARY:
+            return find_products(counted, expr->data.unary->operand);
+        case EXPR_ASSIGNMENT:
+            return strcmp(expr->data.assignment->name, counted->name) != 0 &&
+                find_products(counted, expr->data.assignment->value);
+        case EXPR_ARG_LIST:
+            for (size_t i = 0; i < expr->data.arg_list->arg_count; ++i) {
+                if (!find_products(counted, expr->data.arg_list->args[i])) return false;
+            }
+            return true;
+        case EXPR_CALL:
+            for (size_t i = 0; expr->data.call->args && i < expr->data.call->args->arg_count; ++i) {
+                if (!find_products(counted, expr->data.call->args->args[i])) return false;
+            }
+            return true;
+        case EXPR_INDEX:
+            return find_products(counted, expr->data.index->array) && find_products(counted, expr->data.index->index);
+        default:
+            return true;
+    }
+}
+
+static bool find_assign_products(counted_loop_t *counted, const stmt_assign_t *assign) {
+    return !assign || (strcmp(assign->name, counted->name) != 0 && find_products(counted, assign->index) &&
+        find_products(counted, assign->value));
+}
+
+static bool find_stmt_products(counted_loop_t *counted, const ast_stmt_node_t *stmt) {
+    if (!stmt) return true;
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            return strcmp(stmt->data.var_decl->name, counted->name) != 0 &&
+                find_products(counted, stmt->data.var_decl->initializer);
+        case STMT_ASSIGN:
+            return find_assign_products(counted, stmt->data.assign);
+        case STMT_RETURN:
+            return find_products(counted, stmt->data.return_stmt->value);
+        case STMT_PRINT:
+            for (size_t i = 0; stmt->data.print_stmt->args && i < stmt->data.print_stmt->args->arg_count; ++i) {
+                if (!find_products(counted, stmt->data.print_stmt->args->args[i])) return false;
+            }
+            return true;
+        case STMT_IF: {
+            const stmt_if_t *if_stmt = stmt->data.if_stmt;
+            if (!find_products(counted, if_stmt->if_condition) || !find_stmt_products(counted, if_stmt->if_block)) {
+                return false;
+            }
+            for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+                if (!find_products(counted, if_stmt->elif_conditions[i]) ||
+                    !find_stmt_products(counted, if_stmt->elif_blocks[i])) {
+                    return false;
+                }
+            }
+            return find_stmt_products(counted, if_stmt->else_block);
+        }
+        case STMT_WHILE:
+            return find_products(counted, stmt->data.while_stmt->condition) &&
+                find_stmt_products(counted, stmt->data.while_stmt->block);
+        case STMT_FOR: {
+            // A parallel body is a function of its own and cannot share the slot.
+            const stmt_for_t *for_stmt = stmt->data.for_stmt;
+            if (for_stmt->parallel) return false;
+            const stmt_for_init_t *init = for_stmt->init;
+            if (init && init->kind == FOR_INIT_VAR_DECL &&
+                (strcmp(init->data.var_decl->name, counted->name) == 0 ||
+                 !find_products(counted, init->data.var_decl->initializer))) {
+                return false;
+            }
+            if (init && init->kind == FOR_INIT_ASSIGN && !find_assign_products(counted, init->data.assign)) return false;
+            if (init && init->kind == FOR_INIT_EXPR && !find_products(counted, init->data.expr->expression)) return false;
+            return find_products(counted, for_stmt->condition) && find_assign_products(counted, for_stmt->increment) &&
+                find_stmt_products(counted, for_stmt->block);
+        }
+        case STMT_EXPR:
+            return find_products(counted, stmt->data.expr_stmt->expression);
+        case STMT_BLOCK:
+            for (size_t i = 0; i < stmt->data.block_stmt->statement_count; ++i) {
+                if (!find_stmt_products(counted, stmt->data.block_stmt->statements[i])) return false;
+            }
+            return true;
+        default:
+            return true;
+    }
+}
+
+/**
+ * @brief Whether the bound is an int whenever the loop runs, and small
+ * enough that scaling it cannot overflow: array lengths and constants,
+ * added, subtracted or divided by a positive constant.
+ */
+static bool is_int_bound(compiler_t *compiler, const ast_expr_node_t *bound) {
+    int64_t value;
+    if (int_literal(bound, &value)) return value >= -COUNTED_MAX_VALUE && value <= COUNTED_MAX_VALUE;
+    if (bound->type == EXPR_CALL) {
+        uint32_t index;
+        return strcmp(bound->data.call->name, "len") == 0 && !name_table_find(&compiler->function_names, "len", &index);
+    }
+    if (bound->type != EXPR_BINARY) return false;
+    const expr_binary_t *binary = bound->data.binary;
+    switch (binary->operator) {
+        case TOKEN_PLUS:
+        case TOKEN_MINUS:
+            return is_int_bound(compiler, binary->left) && is_int_bound(compiler, binary->right);
+        case TOKEN_SLASH:
+            return is_int_bound(compiler, binary->left) && int_literal(binary->right, &value) && value > 0;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Recognizes a counted loop from the init, condition and increment
+ * of a for loop.
+ */
+static bool recognize_counted_loop(compiler_t *compiler, const stmt_for_t *for_stmt, counted_loop_t *counted) {
+    memset(counted, 0, sizeof(*counted));
+    const stmt_for_init_t *init = for_stmt->init;
+    if (!counted_loops || for_stmt->parallel || !init || init->kind != FOR_INIT_VAR_DECL ||
+        init->data.var_decl->type != DATA_TYPE_INT) {
+        return false;
+    }
+    counted->name = init->data.var_decl->name;
+    if (!constant_start(compiler, init->data.var_decl->initializer, &counted->start)) return false;
+    if (!counted_step(for_stmt->increment, counted->name, &counted->step) || counted->step == 0) return false;
+    if (counted->step > COUNTED_MAX_VALUE || counted->step < -COUNTED_MAX_VALUE) return false;
+
+    const ast_expr_node_t *condition = for_stmt->condition;
+    if (!condition || condition->type != EXPR_BINARY) return false;
+    const expr_binary_t *binary = condition->data.binary;
+    token_type_t comparison = binary->operator;
+    if (comparison != TOKEN_LT && comparison != TOKEN_LEQ && comparison != TOKEN_GT && comparison != TOKEN_GEQ) return false;
+    if (is_name(binary->left, counted->name)) {
+        counted->bound = binary->right;
+    } else if (is_name(binary->right, counted->name)) {
+        counted->bound = binary->left;
+        comparison = mirror_comparison(comparison);
+    } else {
+        return false;
+    }
+    counted->comparison = comparison;
+    bool upwards = comparison == TOKEN_LT || comparison == TOKEN_LEQ;
+    if (upwards != (counted->step > 0)) return false;
+
+    // The body may not change the counter, nor anything the bound reads.
+    loop_effects_t effects = {0};
+    collect_stmt_effects(compiler, &effects, for_stmt->block);
+    bool assigned = is_assigned(&effects, counted->name);
+    collect_expr_effects(compiler, &effects, condition);
+    collect_assign_effects(compiler, &effects, for_stmt->increment);
+    bool invariant = is_invariant(compiler, &effects, counted->bound);
+    free(effects.assigned);
+    if (assigned || !invariant) return false;
+
+    counted->constant_bound = int_literal(counted->bound, &counted->bound_value);
+    counted->trip_count = counted->constant_bound ?
+        trip_count(counted->start, counted->bound_value, counted->step, comparison) : -1;
+    return true;
+}
+
+/**
+ * @brief Whether to copy the body once per iteration instead of looping.
+ */
+static bool should_unroll(compiler_t *compiler, const stmt_for_t *for_stmt, const counted_loop_t *counted) {
+    if (counted->trip_count < 0 || counted->trip_count > UNROLL_MAX_TRIPS) return false;
+    function_summary_t body = {0};
+    scan_stmt(compiler, &body, for_stmt->block, 1);
+    free(body.callees);
+    return !body.reason && body.size * (size_t)counted->trip_count <= UNROLL_MAX_NODES;
+}
+
+/**
+ * @brief Decides on strength reduction: every use of the counter in the
+ * body must be a product with the same constant, and the bound an int.
+ */
+static bool should_reduce(compiler_t *compiler, const stmt_for_t *for_stmt, counted_loop_t *counted) {
+    // Keeps start, bound and step times the factor far from overflowing.
+    if (counted->start < -COUNTED_MAX_VALUE || counted->start > COUNTED_MAX_VALUE ||
+        !is_int_bound(compiler, counted->bound)) {
+        return false;
+    }
+    if (!find_stmt_products(counted, for_stmt->block) || counted->products.count == 0) {
+        free(counted->products.exprs);
+        counted->products = (expr_list_t){0};
+        return false;
+    }
+    counted->reduced = true;
+    return true;
+}
+
+//--------------------------------------- Expressions -------------------------------------------------------------------------------
+
+static const parallel_reduction_t *find_reduction(const parallel_body_t *parallel, uint16_t slot) {
+    for (size_t i = 0; i < parallel->reduction_count; ++i) {
+        if (parallel->reductions[i].slot == slot) return &parallel->reductions[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Records a read of a captured local. A reduction variable only holds
+ * the running chunk's partial result, so reading it is an error.
+ */
+static void note_capture_read(compiler_t *compiler, parallel_body_t *parallel, uint16_t slot, const char *name,
+    uint32_t offset) {
+    if (slot >= parallel->capture_count) return;
+    if (find_reduction(parallel, slot)) {
+        compiler_error(compiler, offset, "Cannot read '%s' inside the parallel for that reduces it", name);
+        return;
+    }
+    parallel->capture_reads[slot] = true;
+}
+
+/**
+ * @brief Makes a captured local a `+=` or `*=` reduction of the parallel body.
+ */
+static bool claim_reduction(compiler_t *compiler, parallel_body_t *parallel, uint16_t slot, opcode_t op,
+    const char *name, uint32_t offset) {
+    const parallel_reduction_t *existing = find_reduction(parallel, slot);
+    if (existing) {
+        if (existing->op == op) return true;
+        compiler_error(compiler, offset, "Reduction '%s' mixes += and *= inside a parallel for", name);
+        return false;
+    }
+    if (parallel->capture_reads[slot]) {
+        compiler_error(compiler, offset, "Cannot read '%s' inside the parallel for that reduces it", name);
+        return false;
+    }
+    if (parallel->reduction_count >= PARALLEL_MAX_REDUCTIONS) {
+        compiler_error(compiler, offset, "Too many reductions in one parallel for");
+        return false;
+    }
+    parallel->reductions[parallel->reduction_count++] = (parallel_reduction_t){ name, slot, op };
+    return true;
+}
+
+/**
+ * @brief Rejects assignments a parallel body cannot make: chunks run
+ * concurrently, so captured locals, the loop index and globals are read-only.
+ */
+static bool check_parallel_assign(compiler_t *compiler, const char *name, bool local, uint16_t slot,
+    uint32_t offset) {
+    parallel_body_t *parallel = compiler->parallel;
+    if (!parallel) return true;
+    if (!local) {
+        compiler_error(compiler, offset, "Cannot assign global '%s' inside a parallel for", name);
+        return false;
+    }
+    if (slot < parallel->capture_count) {
+        compiler_error(compiler, offset,
+            "Cannot assign '%s' inside a parallel for; only += and *= reductions of outer variables are allowed", name);
+        return false;
+    }
+    if (slot == parallel->index_slot) {
+        compiler_error(compiler, offset, "Cannot assign the index '%s' of a parallel for", name);
+        return false;
+    }
+    return true;
+}
+
+static void emit_get_variable(compiler_t *compiler, const char *name, uint32_t offset) {
+    uint16_t slot;
+    uint32_t global;
+    if (resolve_local(compiler, name, &slot)) {
+        if (compiler->induction_constant && slot == compiler->induction_slot) {
+            emit_int_constant(compiler, compiler->induction_value, offset);
+            return;
+        }
+        if (compiler->parallel) {
+            note_capture_read(compiler, compiler->parallel, slot, name, offset);
+        }
+        emit_op_u16(compiler, OP_GET_LOCAL, slot);
+    } else if (name_table_find(&compiler->global_names, name, &global)) {
+        emit_op_u16(compiler, OP_GET_GLOBAL, (uint16_t)global);
+    } else {
+        compiler_error(compiler, offset, "Undefined variable '%s'", name);
+        emit_op(compiler, OP_NULL);
+    }
+}
+
+static void emit_set_variable(compiler_t *compiler, const char *name, uint32_t offset) {
+    uint16_t slot;
+    uint32_t global;
+    if (resolve_local(compiler, name, &slot)) {
+        check_parallel_assign(compiler, name, true, slot, offset);
+        emit_op_u16(compiler, OP_SET_LOCAL, slot);
+    } else if (name_table_find(&compiler->global_names, name, &global)) {
+        check_parallel_assign(compiler, name, false, 0, offset);
+        emit_op_u16(compiler, OP_SET_GLOBAL, (uint16_t)global);
+    } else {
+        compiler_error(compiler, offset, "Undefined variable '%s'", name);
+        emit_op(compiler, OP_POP);
+    }
+}
+
+/**
+ * @brief Operand type of the typed form of OP_ADD..OP_GEQ for operands of
+ * the given types, DATA_TYPE_VOID to use the generic opcode. An int operand
+ * of a float operation is converted first; float % has no typed form.
+ */
+static data_type_t operand_type(opcode_t op, data_type_t left, data_type_t right) {
+    if (!typed_opcodes) return DATA_TYPE_VOID;
+    if (left == DATA_TYPE_INT && right == DATA_TYPE_INT) return DATA_TYPE_INT;
+    if (is_number_type(left) && is_number_type(right) && op != OP_MOD) return DATA_TYPE_FLOAT;
+    return DATA_TYPE_VOID;
+}
+
+/**
+ * @brief Converts an int operand of a float operation, the code from `from`
+ * on. An int constant, such as the counter of an unrolled loop, becomes a
+ * float constant instead.
+ */
+static void convert_operand(compiler_t *compiler, data_type_t operand, data_type_t type, size_t from,
+    const ast_expr_node_t *expr) {
+    if (operand != DATA_TYPE_FLOAT || type != DATA_TYPE_INT) return;
+    int64_t value;
+    if (emitted_int_constant(compiler, from, compiler->code_size, &value)) {
+        compiler->code_size = from;
+        adjust_stack(compiler, -1);
+        emit_float_constant(compiler, (double)value, expr->offset);
+        return;
+    }
+    emit_op(compiler, OP_TO_FLOAT);
+}
+
+static void emit_typed_op(compiler_t *compiler, opcode_t op, data_type_t operand) {
+    bool comparison = op >= OP_EQ && op <= OP_GEQ;
+    if (operand == DATA_TYPE_INT) {
+        op = comparison ? (opcode_t)(OP_EQ_INT + (op - OP_EQ)) : (opcode_t)(OP_ADD_INT + (op - OP_ADD));
+    } else if (operand == DATA_TYPE_FLOAT) {
+        op = comparison ? (opcode_t)(OP_EQ_FLOAT + (op - OP_EQ)) : (opcode_t)(OP_ADD_FLOAT + (op - OP_ADD));
+    }
+    emit_op(compiler, op);
+}
+
+static void compile_logical(compiler_t *compiler, const expr_binary_t *binary) {
+    // a && b  ->  a; JIF false; b; JIF false; TRUE; JUMP end; false: FALSE; end:
+    // a || b  ->  a; JIF rhs; TRUE; JUMP end; rhs: b; JIF false; TRUE; JUMP end; false: FALSE; end:
+    size_t to_false[2];
+    size_t to_end[2];
+    size_t false_count = 0, end_count = 0;
+
+    compile_expr(compiler, binary->left);
+    if (binary->operator == TOKEN_AND) {
+        to_false[false_count++] = emit_jump(compiler, OP_JUMP_IF_FALSE);
+    } else {
+        size_t to_rhs = emit_jump(compiler, OP_JUMP_IF_FALSE);
+        emit_op(compiler, OP_TRUE);
+        to_end[end_count++] = emit_jump(compiler, OP_JUMP);
+        adjust_stack(compiler, -1);
+        patch_jump(compiler, to_rhs);
+    }
+    compile_expr(compiler, binary->right);
+    to_false[false_count++] = emit_jump(compiler, OP_JUMP_IF_FALSE);
+    emit_op(compiler, OP_TRUE);
+    to_end[end_count++] = emit_jump(compiler, OP_JUMP);
+    adjust_stack(compiler, -1);
+    for (size_t i = 0; i < false_count; ++i) {
+        patch_jump(compiler, to_false[i]);
+    }
+    emit_op(compiler, OP_FALSE);
+    for (size_t i = 0; i < end_count; ++i) {
+        patch_jump(compiler, to_end[i]);
+    }
+}
+
+/**
+ * @brief Whether `expr` is an operation compile_binary() compiles in the same
+ * loop as the one it is the left operand of.
+ */
+static bool continues_chain(const compiler_t *compiler, const ast_expr_node_t *expr) {
+    return expr && expr->type == EXPR_BINARY
+        && expr->data.binary->operator != TOKEN_AND && expr->data.binary->operator != TOKEN_OR
+        && !find_hoisted(compiler, expr);
+}
+
+/**
+ * One operation of a chain like `a + b - c`, lowest first, with the types
+ * of its operands.
+ */
+typedef struct chain_link_struct {
+    const ast_expr_node_t *expr;
+    data_type_t left;
+    data_type_t right;
+} chain_link_t;
+
+/**
+ * @brief Compiles a binary operation and the ones down its left spine in one
+ * loop, typing each from the type of the one below it, so a chain as long as
+ * the parser allows takes neither deep recursion nor time quadratic in its length.
+ */
+static void compile_binary(compiler_t *compiler, const ast_expr_node_t *expr) {
+    const expr_binary_t *binary = expr->data.binary;
+    if (binary->operator == TOKEN_AND || binary->operator == TOKEN_OR) {
+        compile_logical(compiler, binary);
+        return;
+    }
+
+    size_t count = 1;
+    const ast_expr_node_t *bottom = binary->left;
+    for (; continues_chain(compiler, bottom); bottom = bottom->data.binary->left) {
+        count++;
+    }
+    chain_link_t *links = malloc(count * sizeof(chain_link_t));
+    CHECK_MEM_ALLOC_ERROR(links);
+    const ast_expr_node_t *node = expr;
+    for (size_t i = count; i > 0; --i, node = node->data.binary->left) {
+        links[i - 1].expr = node;
+    }
+    // Each operation's left operand has the type expr_type() gives the one below it.
+    data_type_t type = type_of(compiler, bottom);
+    for (size_t i = 0; i < count; ++i) {
+        const expr_binary_t *link = links[i].expr->data.binary;
+        opcode_t op = binary_opcode(link->operator);
+        links[i].left = type;
+        links[i].right = type_of(compiler, link->right);
+        type = op == OP_COUNT ? DATA_TYPE_VOID : arithmetic_type(op, links[i].left, links[i].right);
+    }
+
+    size_t left_at = compiler->code_size;
+    compile_expr(compiler, bottom);
+    for (size_t i = 0; i < count; ++i) {
+        const ast_expr_node_t *operation = links[i].expr;
+        const expr_binary_t *link = operation->data.binary;
+        opcode_t op = binary_opcode(link->operator);
+        data_type_t operand = operand_type(op, links[i].left, links[i].right);
+        convert_operand(compiler, operand, links[i].left, left_at, operation);
+        size_t right_at = compiler->code_size;
+        compile_expr(compiler, link->right);
+        convert_operand(compiler, operand, links[i].right, right_at, operation);
+
+        // Int arithmetic on constants, such as the counter of an unrolled loop,
+        // is done here, wrapping around as the VM does.
+        int64_t a, b;
+        bool fold = link->operator == TOKEN_PLUS || link->operator == TOKEN_MINUS || link->operator == TOKEN_ASTERISK;
+        if (fold && emitted_int_constant(compiler, left_at, right_at, &a) &&
+            emitted_int_constant(compiler, right_at, compiler->code_size, &b)) {
+            uint64_t x = (uint64_t)a, y = (uint64_t)b;
+            uint64_t result = link->operator == TOKEN_PLUS ? x + y : link->operator == TOKEN_MINUS ? x - y : x * y;
+            compiler->code_size = left_at;
+            adjust_stack(compiler, -2);
+            emit_int_constant(compiler, (int64_t)result, operation->offset);
+            continue;
+        }
+        if (op == OP_COUNT) {
+            compiler_error(compiler, operation->offset, "Unsupported binary operator %s", token_type_to_string(link->operator));
+            emit_op(compiler, OP_POP);
+            continue;
+        }
+        emit_typed_op(compiler, op, operand);
+    }
+    free(links);
+}
+
+static void compile_unary(compiler_t *compiler, const ast_expr_node_t *expr) {
+    const expr_unary_t *unary = expr->data.unary;
+    switch (unary->operator) {
+        case TOKEN_MINUS: {
+            size_t operand_at = compiler->code_size;
+            int64_t value;
+            compile_expr(compiler, unary->operand);
+            if (emitted_int_constant(compiler, operand_at, compiler->code_size, &value)) {
+                compiler->code_size = operand_at;
+                adjust_stack(compiler, -1);
+                emit_int_constant(compiler, (int64_t)(0 - (uint64_t)value), expr->offset);
+                break;
+            }
+            data_type_t type = typed_opcodes ? type_of(compiler, unary->operand) : DATA_TYPE_VOID;
+            emit_op(compiler, type == DATA_TYPE_INT ? OP_NEG_INT : type == DATA_TYPE_FLOAT ? OP_NEG_FLOAT : OP_NEG);
+            break;
+        }
+        case TOKEN_NOT:
+            compile_expr(compiler, unary->operand);
+            emit_op(compiler, OP_NOT);
+            break;
+        case TOKEN_PLUS:
+            compile_expr(compiler, unary->operand);
+            break;
+        case TOKEN_PLUSPLUS:
+        case TOKEN_MINUSMINUS: {
+            if (!unary->operand || unary->operand->type != EXPR_IDENTIFIER) {
+                compiler_error(compiler, expr->offset, "Operand of %s must be a variable", token_type_to_string(unary->operator));
+                emit_op(compiler, OP_NULL);
+                break;
+            }
+            const char *name = unary->operand->data.identifier->name;
+            data_type_t type = operand_type(OP_ADD, type_of(compiler, unary->operand), DATA_TYPE_INT);
+            emit_get_variable(compiler, name, expr->offset);
+            if (type == DATA_TYPE_FLOAT) {
+                emit_float_constant(compiler, 1.0, expr->offset);
+            } else {
+                image_constant_t one = { IMAGE_CONST_INT, 0, 1 };
+                emit_op_u16(compiler, OP_CONST, add_constant(compiler, one, expr->offset));
+            }
+            emit_typed_op(compiler, unary->operator == TOKEN_PLUSPLUS ? OP_ADD : OP_SUB, type);
+            emit_op(compiler, OP_DUP);
+            emit_set_variable(compiler, name, expr->offset);
+            break;
+        }
+        case TOKEN_AWAIT:
+            if (compiler->parallel) {
+                compiler_error(compiler, expr->offset, "Cannot await inside a parallel for");
+            } else if (!(compiler->function->flags & IMAGE_FUNCTION_ASYNC)) {
+                compiler_error(compiler, expr->offset, "'await' outside of an async function");
+            }
+            compile_expr(compiler, unary->operand);
+            emit_op(compiler, OP_AWAIT);
+            break;
+        default:
+            compiler_error(compiler, expr->offset, "Unsupported unary operator %s", token_type_to_string(unary->operator));
+            emit_op(compiler, OP_NULL);
+            break;
+    }
+}
+
+typedef struct builtin_struct {
+    const char *name;
+    size_t arg_count;
+    opcode_t op;
+    int operand;                // u8 operand of `op`, or -1 for none
+} builtin_t;
+
+static const builtin_t builtins[] = {
+    { "sleep",       1, OP_SLEEP,     -1 },
+    { "readable",    1, OP_WAIT_FD,    1 },
+    { "writable",    1, OP_WAIT_FD,    2 },
+    { "int_array",   1, OP_NEW_ARRAY, VALUE_INT },
+    { "float_array", 1, OP_NEW_ARRAY, VALUE_FLOAT },
+    { "len",         1, OP_LEN,       -1 },
+    { "sum",         1, OP_SUM,       -1 },
+    { "dot",         2, OP_DOT,       -1 },
+};
+
+/**
+ * @brief Compiles a call of a builtin: the task builtins sleep(ms),
+ * readable(fd) and writable(fd), and the array builtins. A user function of
+ * the same name takes precedence.
+ *
+ * @return false if `call` does not name a builtin.
+ */
+static bool compile_builtin_call(compiler_t *compiler, const ast_expr_node_t *expr) {
+    const expr_call_t *call = expr->data.call;
+    const builtin_t *builtin = NULL;
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); ++i) {
+        if (strcmp(call->name, builtins[i].name) == 0) {
+            builtin = &builtins[i];
+            break;
+        }
+    }
+    if (!builtin) {
+        return false;
+    }
+
+    if (call->args->arg_count != builtin->arg_count) {
+        compiler_error(compiler, expr->offset, "Function '%s' expects %zu arguments but got %zu",
+            call->name, builtin->arg_count, call->args->arg_count);
+        emit_op(compiler, OP_NULL);
+        return true;
+    }
+    for (size_t i = 0; i < call->args->arg_count; ++i) {
+        compile_expr(compiler, call->args->args[i]);
+    }
+    emit_op(compiler, builtin->op);
+    if (builtin->operand >= 0) {
+        emit_byte(compiler, (uint8_t)builtin->operand);
+    }
+    return true;
+}
+
+/**
+ * @brief Compiles a call. With `tail` set, the call is the value of a return
+ * statement and, when it can be, becomes an OP_TAIL_CALL that replaces the
+ * running frame; async functions and calls that start tasks keep their frames.
+ *
+ * @return true if it emitted an OP_TAIL_CALL, which also returns; otherwise
+ * the call leaves its result on the stack.
+ */
+static bool compile_call(compiler_t *compiler, const ast_expr_node_t *expr, bool tail) {
+    const expr_call_t *call = expr->data.call;
+    uint32_t index;
+    if (!name_table_find(&compiler->function_names, call->name, &index)) {
+        if (compile_builtin_call(compiler, expr)) {
+            return false;
+        }
+        compiler_error(compiler, expr->offset, "Undefined function '%s'", call->name);
+        emit_op(compiler, OP_NULL);
+        return false;
+    }
+    const image_function_t *callee = &compiler->functions[index];
+    if (call->args->arg_count != callee->param_count) {
+        compiler_error(compiler, expr->offset, "Function '%s' expects %u arguments but got %zu",
+            call->name, callee->param_count, call->args->arg_count);
+        emit_op(compiler, OP_NULL);
+        return false;
+    }
+
+    // Calling an async function starts a task and yields it without running any of its body.
+    bool async = (callee->flags & IMAGE_FUNCTION_ASYNC) != 0;
+    if (async && compiler->parallel) {
+        compiler_error(compiler, expr->offset, "Cannot start async function '%s' inside a parallel for", call->name);
+    }
+
+    const decl_function_t *decl = index < compiler->summary_count ? compiler->summaries[index].decl : NULL;
+    for (size_t i = 0; i < call->args->arg_count; ++i) {
+        compile_expr(compiler, call->args->args[i]);
+        if (decl) {
+            emit_conversion(compiler, decl->param_list->params[i].type, type_of(compiler, call->args->args[i]));
+        }
+    }
+    if (!async && inline_threshold > 0 && index < compiler->summary_count) {
+        size_t loop_depth = compiler->outer_loop_depth + compiler->loop_count + (compiler->parallel ? 1 : 0);
+        const char *reason = inline_verdict(compiler, index, loop_depth);
+        if (!reason && !expand_inline(compiler, expr, index, loop_depth)) {
+            reason = "does not compile in place";
+        }
+        report_inline(compiler, expr, index, loop_depth, reason);
+        if (!reason) {
+            return false;
+        }
+    }
+    tail = tail && !async && !(compiler->function->flags & IMAGE_FUNCTION_ASYNC);
+    emit_byte(compiler, tail ? OP_TAIL_CALL : async ? OP_SPAWN : OP_CALL);
+    emit_u16(compiler, (uint16_t)index);
+    emit_byte(compiler, (uint8_t)call->args->arg_count);
+    adjust_stack(compiler, (tail ? 0 : 1) - (int)call->args->arg_count);
+    return tail;
+}
+
+static void compile_expr(compiler_t *compiler, const ast_expr_node_t *expr) {
+    if (!expr) {
+        emit_op(compiler, OP_NULL);
+        return;
+    }
+    if (compiler->hoisted_count > 0 && load_hoisted(compiler, expr)) {
+        return;
+    }
+
+    switch (expr->type) {
+        case EXPR_LITERAL_INT: {
+            image_constant_t constant = { IMAGE_CONST_INT, 0, (uint64_t)(int64_t)expr->data.literal_int->value };
+            emit_op_u16(compiler, OP_CONST, add_constant(compiler, constant, expr->offset));
+            break;
+        }
+        case EXPR_LITERAL_FLOAT:
+            emit_float_constant(compiler, expr->data.literal_float->value, expr->offset);
+            break;
+        case EXPR_LITERAL_STRING:
+            emit_op_u16(compiler, OP_CONST, add_string_constant(compiler, expr->data.literal_string->value, expr->offset));
+            break;
+        case EXPR_LITERAL_BOOL:
+            emit_op(compiler, expr->data.literal_bool->value ? OP_TRUE : OP_FALSE);
+            break;
+        case EXPR_LITERAL_NULL:
+            emit_op(compiler, OP_NULL);
+            break;
+        case EXPR_IDENTIFIER:
+            emit_get_variable(compiler, expr->data.identifier->name, expr->offset);
+            break;
+        case EXPR_BINARY:
+            compile_binary(compiler, expr);
+            break;
+        case EXPR_UNARY:
+            compile_unary(compiler, expr);
+            break;
+        case EXPR_ASSIGNMENT:
+            compile_expr(compiler, expr->data.assignment->value);
+            emit_conversion(compiler, declared_type(compiler, compiler->typing, expr->data.assignment->name),
+                type_of(compiler, expr->data.assignment->value));
+            emit_op(compiler, OP_DUP);
+            emit_set_variable(compiler, expr->data.assignment->name, expr->offset);
+            break;
+        case EXPR_CALL:
+            compile_call(compiler, expr, false);
+            break;
+        case EXPR_INDEX:
+            compile_expr(compiler, expr->data.index->array);
+            compile_expr(compiler, expr->data.index->index);
+            emit_op(compiler, OP_INDEX);
+            break;
+        case EXPR_ARG_LIST:
+            compiler_error(compiler, expr->offset, "Argument list used as a value");
+            emit_op(compiler, OP_NULL);
+            break;
+    }
+}
+
+//--------------------------------------- Statements --------------------------------------------------------------------------------
+
+static void compile_var_decl(compiler_t *compiler, const stmt_var_decl_t *var_decl, uint32_t offset) {
+    compile_expr(compiler, var_decl->initializer);
+    emit_conversion(compiler, var_decl->type, type_of(compiler, var_decl->initializer));
+    uint16_t slot = declare_local(compiler, var_decl->name, var_decl->type, offset);
+    emit_op_u16(compiler, OP_SET_LOCAL, slot);
+}
+
+static void compile_block_body(compiler_t *compiler, const ast_stmt_node_t *block) {
+    if (block && block->type == STMT_BLOCK) {
+        for (size_t i = 0; i < block->data.block_stmt->statement_count; ++i) {
+            compile_stmt(compiler, block->data.block_stmt->statements[i]);
+        }
+    } else {
+        compile_stmt(compiler, block);
+    }
+}
+
+static void compile_if(compiler_t *compiler, const stmt_if_t *if_stmt) {
+    size_t end_count = 0;
+    size_t *to_end = malloc(sizeof(size_t) * (if_stmt->elif_blocks_count + 1));
+    CHECK_MEM_ALLOC_ERROR(to_end);
+
+    compile_expr(compiler, if_stmt->if_condition);
+    size_t to_next = emit_jump(compiler, OP_JUMP_IF_FALSE);
+    compile_stmt(compiler, if_stmt->if_block);
+
+    for (size_t i = 0; i < if_stmt->elif_blocks_count; ++i) {
+        to_end[end_count++] = emit_jump(compiler, OP_JUMP);
+        patch_jump(compiler, to_next);
+        compile_expr(compiler, if_stmt->elif_conditions[i]);
+        to_next = emit_jump(compiler, OP_JUMP_IF_FALSE);
+        compile_stmt(compiler, if_stmt->elif_blocks[i]);
+    }
+
+    if (if_stmt->else_block) {
+        to_end[end_count++] = emit_jump(compiler, OP_JUMP);
+        patch_jump(compiler, to_next);
+        compile_stmt(compiler, if_stmt->else_block);
+    } else {
+        patch_jump(compiler, to_next);
+    }
+
+    for (size_t i = 0; i < end_count; ++i) {
+        patch_jump(compiler, to_end[i]);
+    }
+    free(to_end);
+}
+
+/**
+ * @brief Computes a loop's invariants ahead of it, see find_loop_invariants().
+ * Those of the body are computed only once the condition has held, by a
+ * first test of the condition that then jumps into the body:
+ *
+ *     condition invariants
+ *     condition; JUMP_IF_FALSE exit
+ *     body invariants; JUMP body
+ *     start: ...
+ *
+ * The caller compiles the loop at `start`, calls enter_loop_body() where the
+ * body begins and end_preheader() where the loop ends.
+ */
+/**
+ * @brief Compiles a loop's condition, which for a strength reduced loop
+ * compares the scaled counter with the scaled bound instead.
+ */
+static void compile_loop_condition(compiler_t *compiler, const ast_expr_node_t *condition, const counted_loop_t *counted) {
+    if (!counted || !counted->reduced) {
+        compile_expr(compiler, condition);
+        return;
+    }
+    emit_op_u16(compiler, OP_GET_LOCAL, counted->product_slot);
+    if (counted->constant_bound) {
+        emit_int_constant(compiler, counted->bound_value * counted->factor, condition->offset);
+    } else {
+        emit_op_u16(compiler, OP_GET_LOCAL, counted->bound_slot);
+    }
+    // Both are ints, see is_int_bound().
+    token_type_t comparison = counted->factor < 0 ? mirror_comparison(counted->comparison) : counted->comparison;
+    emit_typed_op(compiler, binary_opcode(comparison), operand_type(OP_LT, DATA_TYPE_INT, DATA_TYPE_INT));
+}
+
+typedef struct loop_preheader_struct {
+    size_t hoisted_count;       // compiler->hoisted_count before the loop
+    bool first_test;
+    size_t to_exit;
+    size_t to_body;
+} loop_preheader_t;
+
+static void begin_preheader(compiler_t *compiler, loop_preheader_t *preheader, const ast_expr_node_t *condition,
+    const counted_loop_t *counted, const stmt_assign_t *increment, const ast_stmt_node_t *body, uint32_t offset) {
+    expr_list_t in_condition = {0};
+    expr_list_t in_body = {0};
+    bool reduced = counted && counted->reduced;
+    find_loop_invariants(compiler, reduced ? NULL : condition, increment, body, &in_condition, &in_body);
+    preheader->hoisted_count = compiler->hoisted_count;
+    preheader->first_test = in_body.count > 0;
+    hoist_invariants(compiler, &in_condition);
+    if (preheader->first_test) {
+        mark_position(compiler, offset);
+        if (condition) {
+            compile_loop_condition(compiler, condition, counted);
+            preheader->to_exit = emit_jump(compiler, OP_JUMP_IF_FALSE);
+        }
+        hoist_invariants(compiler, &in_body);
+        preheader->to_body = emit_jump(compiler, OP_JUMP);
+    }
+    if (in_condition.count > 0 || in_body.count > 0) {
+        mark_position(compiler, offset);
+    }
+    free(in_condition.exprs);
+    free(in_body.exprs);
+}
+
+static void enter_loop_body(compiler_t *compiler, const loop_preheader_t *preheader) {
+    if (preheader->first_test) {
+        patch_jump(compiler, preheader->to_body);
+    }
+}
+
+static void end_preheader(compiler_t *compiler, loop_preheader_t *preheader, bool has_exit) {
+    if (preheader->first_test && has_exit) {
+        patch_jump(compiler, preheader->to_exit);
+    }
+    compiler->hoisted_count = preheader->hoisted_count;
+}
+
+static void compile_while(compiler_t *compiler, const stmt_while_t *while_stmt, uint32_t offset) {
+    begin_scope(compiler);
+    loop_preheader_t preheader;
+    begin_preheader(compiler, &preheader, while_stmt->condition, NULL, NULL, while_stmt->block, offset);
+
+    uint32_t start = current_pc(compiler);
+    compile_expr(compiler, while_stmt->condition);
+    size_t to_exit = emit_jump(compiler, OP_JUMP_IF_FALSE);
+    enter_loop_body(compiler, &preheader);
+
+    begin_loop(compiler);
+    compile_stmt(compiler, while_stmt->block);
+    patch_continues(compiler);
+    emit_jump_back(compiler, start);
+    patch_jump(compiler, to_exit);
+    end_preheader(compiler, &preheader, true);
+    end_loop(compiler);
+    end_scope(compiler);
+}
+
+/**
+ * @brief Compiles `name = value` or a compound assignment such as `name += value`.
+ *
+ * Inside a parallel for, `+=` and `*=` on a captured local accumulate into
+ * the partial result of the running chunk instead.
+ */
+static void compile_assign(compiler_t *compiler, const char *name, token_type_t operator, const ast_expr_node_t *value,
+    uint32_t offset) {
+    data_type_t declared = declared_type(compiler, compiler->typing, name);
+    if (operator == TOKEN_EQ) {
+        compile_expr(compiler, value);
+        emit_conversion(compiler, declared, type_of(compiler, value));
+        emit_set_variable(compiler, name, offset);
+        return;
+    }
+
+    opcode_t op = compound_opcode(operator);
+    parallel_body_t *parallel = compiler->parallel;
+    uint16_t slot;
+    if (parallel && (op == OP_ADD || op == OP_MUL) && resolve_local(compiler, name, &slot) && slot < parallel->capture_count) {
+        claim_reduction(compiler, parallel, slot, op, name, offset);
+        emit_op_u16(compiler, OP_GET_LOCAL, slot);
+        compile_expr(compiler, value);
+        emit_op(compiler, op);
+        emit_op_u16(compiler, OP_SET_LOCAL, slot);
+        return;
+    }
+    data_type_t left = proven_type(compiler, compiler->typing, name);
+    data_type_t right = type_of(compiler, value);
+    data_type_t operand = operand_type(op, left, right);
+    size_t variable_at = compiler->code_size;
+    emit_get_variable(compiler, name, offset);
+    convert_operand(compiler, operand, left, variable_at, value);
+    size_t value_at = compiler->code_size;
+    compile_expr(compiler, value);
+    convert_operand(compiler, operand, right, value_at, value);
+    emit_typed_op(compiler, op, operand);
+    emit_conversion(compiler, declared, arithmetic_type(op, left, right));
+    emit_set_variable(compiler, name, offset);
+}
+
+/**
+ * @brief Compiles the body once per iteration, with the counter's value
+ * known in each copy. A `continue` goes on to the next copy.
+ */
+static void compile_unrolled_for(compiler_t *compiler, const stmt_for_t *for_stmt, const counted_loop_t *counted) {
+    const stmt_for_init_t *init = for_stmt->init;
+    compile_var_decl(compiler, init->data.var_decl, init->offset);
+    uint16_t slot = 0;
+    resolve_local(compiler, counted->name, &slot);
+
+    bool saved_constant = compiler->induction_constant;
+    uint16_t saved_slot = compiler->induction_slot;
+    int64_t saved_value = compiler->induction_value;
+
+    begin_loop(compiler);
+    int64_t value = counted->start;
+    for (int64_t trip = 0; trip < counted->trip_count; ++trip, value += counted->step) {
+        if (trip > 0) {
+            // Later reads that are not replaced by the constant, e.g. in inner loops, still see the counter.
+            emit_int_constant(compiler, value, init->offset);
+            emit_op_u16(compiler, OP_SET_LOCAL, slot);
+        }
+        compiler->induction_constant = true;
+        compiler->induction_slot = slot;
+        compiler->induction_value = value;
+        compile_stmt(compiler, for_stmt->block);
+        compiler->induction_constant = saved_constant;
+        compiler->induction_slot = saved_slot;
+        compiler->induction_value = saved_value;
+
+        patch_continues(compiler);
+        compiler->loops[compiler->loop_count - 1].continues.count = 0;
+    }
+    end_loop(compiler);
+}
+
+/**
+ * @brief Declares the scaled counter of a strength reduced loop in place of
+ * the counter, along with the scaled bound, and has the loop's products read it.
+ */
+static void begin_reduced_for(compiler_t *compiler, const stmt_for_t *for_stmt, counted_loop_t *counted) {
+    const stmt_for_init_t *init = for_stmt->init;
+    emit_int_constant(compiler, counted->start * counted->factor, init->offset);
+    counted->product_slot = add_local(compiler, "", init->offset);
+    emit_op_u16(compiler, OP_SET_LOCAL, counted->product_slot);
+
+    if (!counted->constant_bound) {
+        const ast_expr_node_t *bound = counted->bound;
+        mark_position(compiler, bound->offset);
+        compile_expr(compiler, bound);
+        emit_int_constant(compiler, counted->factor, bound->offset);
+        emit_typed_op(compiler, OP_MUL, operand_type(OP_MUL, DATA_TYPE_INT, DATA_TYPE_INT));
+        counted->bound_slot = add_local(compiler, "", bound->offset);
+        emit_op_u16(compiler, OP_SET_LOCAL, counted->bound_slot);
+    }
+
+    for (size_t i = 0; i < counted->products.count; ++i) {
+        push_hoisted(compiler, counted->products.exprs[i], counted->product_slot);
+    }
+}
+
+static void compile_for(compiler_t *compiler, const stmt_for_t *for_stmt, uint32_t offset) {
+    begin_scope(compiler);
+    size_t hoisted_count = compiler->hoisted_count;
+
+    counted_loop_t counted;
+    bool is_counted = recognize_counted_loop(compiler, for_stmt, &counted);
+    if (is_counted && should_unroll(compiler, for_stmt, &counted)) {
+        compile_unrolled_for(compiler, for_stmt, &counted);
+        end_scope(compiler);
+        return;
+    }
+
+    const stmt_for_init_t *init = for_stmt->init;
+    if (is_counted && should_reduce(compiler, for_stmt, &counted)) {
+        begin_reduced_for(compiler, for_stmt, &counted);
+    } else if (init) {
+        switch (init->kind) {
+            case FOR_INIT_VAR_DECL:
+                compile_var_decl(compiler, init->data.var_decl, init->offset);
+                break;
+            case FOR_INIT_ASSIGN:
+                compile_assign(compiler, init->data.assign->name, TOKEN_EQ, init->data.assign->value, init->offset);
+                break;
+            case FOR_INIT_EXPR:
+                compile_expr(compiler, init->data.expr->expression);
+                emit_op(compiler, OP_POP);
+                break;
+            case FOR_INIT_NONE:
+                break;
+        }
+    }
+    const counted_loop_t *reduced = is_counted && counted.reduced ? &counted : NULL;
+
+    loop_preheader_t preheader;
+    begin_preheader(compiler, &preheader, for_stmt->condition, reduced, for_stmt->increment, for_stmt->block, offset);
+
+    uint32_t start = current_pc(compiler);
+    size_t to_exit = 0;
+    bool has_exit = for_stmt->condition != NULL;
+    if (has_exit) {
+        compile_loop_condition(compiler, for_stmt->condition, reduced);
+        to_exit = emit_jump(compiler, OP_JUMP_IF_FALSE);
+    }
+    enter_loop_body(compiler, &preheader);
+
+    begin_loop(compiler);
+    compile_stmt(compiler, for_stmt->block);
+    patch_continues(compiler);
+    if (reduced) {
+        emit_op_u16(compiler, OP_GET_LOCAL, reduced->product_slot);
+        emit_int_constant(compiler, reduced->step * reduced->factor, offset);
+        emit_typed_op(compiler, OP_ADD, operand_type(OP_ADD, DATA_TYPE_INT, DATA_TYPE_INT));
+        emit_op_u16(compiler, OP_SET_LOCAL, reduced->product_slot);
+    } else if (for_stmt->increment) {
+        const stmt_assign_t *increment = for_stmt->increment;
+        compile_assign(compiler, increment->name, increment->operator, increment->value, offset);
+    }
+    emit_jump_back(compiler, start);
+    if (has_exit) {
+        patch_jump(compiler, to_exit);
+    }
+    end_preheader(compiler, &preheader, has_exit);
+    end_loop(compiler);
+
+    if (is_counted) {
+        free(counted.products.exprs);
+    }
+    compiler->hoisted_count = hoisted_count;
+    end_scope(compiler);
+}
+
+static void compile_stmt(compiler_t *compiler, const ast_stmt_node_t *stmt) {
+    if (!stmt) return;
+    mark_position(compiler, stmt->offset);
+
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            compile_var_decl(compiler, stmt->data.var_decl, stmt->offset);
+            break;
+        case STMT_ASSIGN: {
+            const stmt_assign_t *assign = stmt->data.assign;
+            if (assign->index) {
+                // Storing into an element reads the array variable; it does not assign it.
+                emit_get_variable(compiler, assign->name, stmt->offset);
+                compile_expr(compiler, assign->index);
+                compile_expr(compiler, assign->value);
+                emit_op(compiler, OP_SET_INDEX);
+                emit_byte(compiler, assign->operator == TOKEN_EQ ? 0 : (uint8_t)compound_opcode(assign->operator));
+                break;
+            }
+            compile_assign(compiler, assign->name, assign->operator, assign->value, stmt->offset);
+            break;
+        }
+        case STMT_RETURN: {
+            const ast_expr_node_t *value = stmt->data.return_stmt->value;
+            data_type_t return_type = compiler->typing ? compiler->typing->decl->return_type : DATA_TYPE_VOID;
+            if (compiler->inlining) {
+                // Leaves the inlined body with the value, see expand_inline().
+                compile_expr(compiler, value);
+                emit_conversion(compiler, return_type, type_of(compiler, value));
+                patch_list_add(&compiler->inlining->returns, emit_jump(compiler, OP_JUMP));
+                adjust_stack(compiler, -1);
+                break;
+            }
+            if (compiler->parallel) {
+                compiler_error(compiler, stmt->offset, "Cannot return from inside a parallel for");
+            }
+            // `return f(...)` reuses the frame, so recursion in tail position runs in constant stack,
+            // unless the result still has to be converted.
+            if (value && value->type == EXPR_CALL) {
+                uint32_t callee;
+                bool convert = return_type == DATA_TYPE_FLOAT &&
+                    (!name_table_find(&compiler->function_names, value->data.call->name, &callee) ||
+                     compiler->functions[callee].return_type != DATA_TYPE_FLOAT);
+                if (!compile_call(compiler, value, !convert)) {
+                    emit_conversion(compiler, return_type, type_of(compiler, value));
+                    emit_op(compiler, OP_RETURN);
+                }
+                break;
+            }
+            compile_expr(compiler, value);
+            emit_conversion(compiler, return_type, type_of(compiler, value));
+            emit_op(compiler, OP_RETURN);
+            break;
+        }
+        case STMT_PRINT: {
+            expr_arg_list_t *args = stmt->data.print_stmt->args;
+            if (args->arg_count > COMPILER_MAX_ARGS) {
+                compiler_error(compiler, stmt->offset, "Too many arguments to print");
+                break;
+            }
+            for (size_t i = 0; i < args->arg_count; ++i) {
+                compile_expr(compiler, args->args[i]);
+            }
+            emit_byte(compiler, OP_PRINT);
+            emit_byte(compiler, (uint8_t)args->arg_count);
+            adjust_stack(compiler, -(int)args->arg_count);
+            break;
+        }
+        case STMT_BREAK:
+        case STMT_CONTINUE: {
+            if (compiler->loop_count == 0) {
+                compiler_error(compiler, stmt->offset, "'%s' outside of a loop",
+                    stmt->type == STMT_BREAK ? "break" : "continue");
+                break;
+            }
+            if (stmt->type == STMT_BREAK && compiler->parallel && compiler->loop_count == compiler->parallel->loop_depth) {
+                compiler_error(compiler, stmt->offset, "Cannot break out of a parallel for");
+            }
+            compiler_loop_t *loop = &compiler->loops[compiler->loop_count - 1];
+            size_t position = emit_jump(compiler, OP_JUMP);
+            patch_list_add(stmt->type == STMT_BREAK ? &loop->breaks : &loop->continues, position);
+            break;
+        }
+        case STMT_IF:
+            compile_if(compiler, stmt->data.if_stmt);
+            break;
+        case STMT_WHILE:
+            compile_while(compiler, stmt->data.while_stmt, stmt->offset);
+            break;
+        case STMT_FOR:
+            if (stmt->data.for_stmt->parallel) {
+                compile_parallel_for(compiler, stmt->data.for_stmt, stmt->offset);
+            } else {
+                compile_for(compiler, stmt->data.for_stmt, stmt->offset);
+            }
+            break;
+        case STMT_EXPR:
+            compile_expr(compiler, stmt->data.expr_stmt->expression);
+            emit_op(compiler, OP_POP);
+            break;
+        case STMT_BLOCK:
+            begin_scope(compiler);
+            compile_block_body(compiler, stmt);
+            end_scope(compiler);
+            break;
+    }
+}
+
+//--------------------------------------- Functions ---------------------------------------------------------------------------------
+
+/**
+ * @brief Appends a zeroed function entry, keeping `compiler->function` valid.
+ */
+static uint32_t add_function(compiler_t *compiler) {
+    if (compiler->function_count >= compiler->function_capacity) {
+        size_t current = compiler->function ? (size_t)(compiler->function - compiler->functions) : 0;
+        compiler->function_capacity = compiler->function_capacity ? compiler->function_capacity * 2 : 16;
+        compiler->functions = realloc(compiler->functions, compiler->function_capacity * sizeof(image_function_t));
+        CHECK_MEM_ALLOC_ERROR(compiler->functions);
+        if (compiler->function) {
+            compiler->function = &compiler->functions[current];
+        }
+    }
+    memset(&compiler->functions[compiler->function_count], 0, sizeof(image_function_t));
+    return (uint32_t)compiler->function_count++;
+}
+
+static void begin_function(compiler_t *compiler, uint32_t index) {
+    compiler->function = &compiler->functions[index];
+    compiler->function->code_offset = (uint32_t)compiler->code_size;
+    compiler->function->line_offset = (uint32_t)compiler->line_count;
+    compiler->function->line_count = 0;
+    compiler->local_count = 0;
+    compiler->max_locals = 0;
+    compiler->scope_depth = 0;
+    compiler->stack_depth = 0;
+    compiler->max_stack = 0;
+}
+
+static void end_function(compiler_t *compiler) {
+    // Falling off the end returns null.
+    emit_op(compiler, OP_NULL);
+    emit_op(compiler, OP_RETURN);
+
+    image_function_t *function = compiler->function;
+    function->code_size = (uint32_t)(compiler->code_size - function->code_offset);
+    function->local_count = (uint16_t)compiler->max_locals;
+    function->max_stack = (uint16_t)(compiler->max_stack > 0 ? compiler->max_stack : 1);
+    compiler->function = NULL;
+}
+
+static void compile_function(compiler_t *compiler, uint32_t index, const ast_decl_node_t *decl) {
+    const decl_function_t *function = decl->data.function_decl;
+    begin_function(compiler, index);
+    compiler->inline_budget = inline_threshold * INLINE_GROWTH_FACTOR;
+    compiler->typing = &compiler->summaries[index];
+    mark_position(compiler, decl->offset);
+
+    begin_scope(compiler);
+    for (size_t i = 0; i < function->param_list->param_count; ++i) {
+        param_t *param = &function->param_list->params[i];
+        declare_local(compiler, param->name, param->type, param->offset);
+    }
+    for (size_t i = 0; i < function->body_count; ++i) {
+        compile_stmt(compiler, function->body[i]);
+    }
+    end_scope(compiler);
+
+    end_function(compiler);
+    compiler->typing = NULL;
+}
+
+//--------------------------------------- Parallel For ------------------------------------------------------------------------------
+
+/**
+ * Everything begin_function() resets, saved while a parallel body is
+ * compiled into its worker function in the middle of the enclosing one.
+ */
+typedef struct function_state_struct {
+    uint8_t *code;
+    size_t code_size;
+    size_t code_capacity;
+    image_line_t *lines;
+    size_t line_count;
+    size_t line_capacity;
+    size_t function;
+    compiler_local_t *locals;
+    size_t local_count;
+    size_t local_capacity;
+    size_t max_locals;
+    int scope_depth;
+    int stack_depth;
+    int max_stack;
+    compiler_loop_t *loops;
+    size_t loop_count;
+    size_t loop_capacity;
+    parallel_body_t *parallel;
+} function_state_t;
+
+static void save_function_state(compiler_t *compiler, function_state_t *state) {
+    *state = (function_state_t){
+        compiler->code, compiler->code_size, compiler->code_capacity,
+        compiler->lines, compiler->line_count, compiler->line_capacity,
+        (size_t)(compiler->function - compiler->functions),
+        compiler->locals, compiler->local_count, compiler->local_capacity, compiler->max_locals,
+        compiler->scope_depth, compiler->stack_depth, compiler->max_stack,
+        compiler->loops, compiler->loop_count, compiler->loop_capacity,
+        compiler->parallel
+    };
+    compiler->code = NULL;
+    compiler->code_size = compiler->code_capacity = 0;
+    compiler->lines = NULL;
+    compiler->line_count = compiler->line_capacity = 0;
+    compiler->locals = NULL;
+    compiler->local_count = compiler->local_capacity = 0;
+    compiler->loops = NULL;
+    compiler->loop_count = compiler->loop_capacity = 0;
+}
+
+static void restore_function_state(compiler_t *compiler, const function_state_t *state) {
+    compiler->code = state->code;
+    compiler->code_size = state->code_size;
+    compiler->code_capacity = state->code_capacity;
+    compiler->lines = state->lines;
+    compiler->line_count = state->line_count;
+    compiler->line_capacity = state->line_capacity;
+    compiler->function = &compiler->functions[state->function];
+    compiler->locals = state->locals;
+    compiler->local_count = state->local_count;
+    compiler->local_capacity = state->local_capacity;
+    compiler->max_locals = state->max_locals;
+    compiler->scope_depth = state->scope_depth;
+    compiler->stack_depth = state->stack_depth;
+    compiler->max_stack = state->max_stack;
+    compiler->loops = state->loops;
+    compiler->loop_count = state->loop_count;
+    compiler->loop_capacity = state->loop_capacity;
+    compiler->parallel = state->parallel;
+}
+
+static bool is_variable(const ast_expr_node_t *expr, const char *name) {
+    return expr && expr->type == EXPR_IDENTIFIER && strcmp(expr->data.identifier->name, name) == 0;
+}
+
+/**
+ * @brief Step of `i += c` or `i = i + c` with c an int literal, 0 for any other increment.
+ */
+static int64_t parallel_step(const stmt_assign_t *increment, const char *index) {
+    const ast_expr_node_t *value = increment->value;
+    if (increment->operator == TOKEN_EQ && value && value->type == EXPR_BINARY
+        && value->data.binary->operator == TOKEN_PLUS && is_variable(value->data.binary->left, index)) {
+        value = value->data.binary->right;
+    } else if (increment->operator != TOKEN_PLUSEQ) {
+        return 0;
+    }
+    return value && value->type == EXPR_LITERAL_INT ? value->data.literal_int->value : 0;
+}
+
+static void add_pending_body(compiler_t *compiler, uint32_t function) {
+    if (compiler->pending_body_count >= compiler->pending_body_capacity) {
+        compiler->pending_body_capacity = compiler->pending_body_capacity ? compiler->pending_body_capacity * 2 : 4;
+        compiler->pending_bodies = realloc(compiler->pending_bodies, compiler->pending_body_capacity * sizeof(pending_body_t));
+        CHECK_MEM_ALLOC_ERROR(compiler->pending_bodies);
+    }
+    compiler->pending_bodies[compiler->pending_body_count++] = (pending_body_t){
+        function, compiler->code, compiler->code_size, compiler->lines, compiler->line_count
+    };
+}
+
+/**
+ * @brief Compiles the body of a parallel for into a worker function
+ * `worker(captured locals..., lo, hi)` that runs the iterations in [lo, hi)
+ * and hands every reduction's partial result to the VM:
+ *
+ *         JUMP init
+ *   loop: i < hi; JIF exit; body; i += step; JUMP loop
+ *   exit: REDUCE each reduction; return null
+ *   init: each reduction = 0 (+=) or 1 (*=); JUMP loop
+ *
+ * The enclosing function evaluates start and end once, runs PARALLEL_FOR and
+ * folds the combined results into its own variables.
+ */
+static void compile_parallel_for(compiler_t *compiler, const stmt_for_t *for_stmt, uint32_t offset) {
+    const stmt_for_init_t *init = for_stmt->init;
+    const ast_expr_node_t *condition = for_stmt->condition;
+    const stmt_assign_t *increment = for_stmt->increment;
+    const char *index_name = NULL;
+    if (init && init->kind == FOR_INIT_VAR_DECL && init->data.var_decl->type == DATA_TYPE_INT) {
+        index_name = init->data.var_decl->name;
+    }
+    int64_t step = 0;
+    if (index_name && condition && condition->type == EXPR_BINARY
+        && (condition->data.binary->operator == TOKEN_LT || condition->data.binary->operator == TOKEN_LEQ)
+        && is_variable(condition->data.binary->left, index_name)
+        && increment && strcmp(increment->name, index_name) == 0) {
+        step = parallel_step(increment, index_name);
+    }
+    if (step <= 0) {
+        compiler_error(compiler, offset,
+            "A parallel for must have the form 'for (i : int = start; i < end; i += step)' with a positive int literal step");
+        return;
+    }
+    uint32_t index = add_function(compiler);
+    if (index > UINT16_MAX) {
+        compiler_error(compiler, offset, "Too many functions in one program");
+        return;
+    }
+
+    // Bounds are evaluated once, in the enclosing function.
+    compile_expr(compiler, init->data.var_decl->initializer);
+    compile_expr(compiler, condition->data.binary->right);
+    if (condition->data.binary->operator == TOKEN_LEQ) {
+        image_constant_t one = { IMAGE_CONST_INT, 0, 1 };
+        emit_op_u16(compiler, OP_CONST, add_constant(compiler, one, offset));
+        emit_op(compiler, OP_ADD);
+    }
+
+    const char *outer_name = compiler->strings + compiler->function->name;
+    size_t name_size = strlen(outer_name) + 32;
+    char *name = malloc(name_size);
+    CHECK_MEM_ALLOC_ERROR(name);
+    size_t line, column;
+    source_map_locate(compiler->source_map, offset, &line, &column);
+    snprintf(name, name_size, "%s/parallel@%zu", outer_name, line);
+    uint32_t name_offset = intern_owned_string(compiler, name);
+
+    size_t capture_count = compiler->local_count;
+    parallel_body_t body = {0};
+    body.capture_count = capture_count;
+    body.capture_reads = calloc(capture_count ? capture_count : 1, sizeof(bool));
+    CHECK_MEM_ALLOC_ERROR(body.capture_reads);
+    compiler_local_t *captures = malloc((capture_count ? capture_count : 1) * sizeof(compiler_local_t));
+    CHECK_MEM_ALLOC_ERROR(captures);
+    if (capture_count) {
+        memcpy(captures, compiler->locals, capture_count * sizeof(compiler_local_t));
+    }
+
+    function_state_t saved;
+    save_function_state(compiler, &saved);
+    begin_function(compiler, index);
+    compiler->function->name = name_offset;
+    compiler->function->param_count = (uint16_t)(capture_count + 2);
+    compiler->function->return_type = (uint8_t)DATA_TYPE_VOID;
+    compiler->function->line = (uint32_t)line;
+    compiler->function->column = (uint32_t)column;
+    compiler->locals = captures;
+    compiler->local_count = compiler->local_capacity = compiler->max_locals = capture_count;
+    compiler->scope_depth = saved.scope_depth;
+    compiler->parallel = &body;
+    mark_position(compiler, offset);
+
+    begin_scope(compiler);
+    body.index_slot = declare_local(compiler, index_name, DATA_TYPE_INT, init->offset);
+    uint16_t end_slot = declare_local(compiler, "", DATA_TYPE_INT, offset);
+
+    size_t to_init = emit_jump(compiler, OP_JUMP);
+    uint32_t loop_start = current_pc(compiler);
+    emit_op_u16(compiler, OP_GET_LOCAL, body.index_slot);
+    emit_op_u16(compiler, OP_GET_LOCAL, end_slot);
+    emit_typed_op(compiler, OP_LT, operand_type(OP_LT, DATA_TYPE_INT, DATA_TYPE_INT));
+    size_t to_exit = emit_jump(compiler, OP_JUMP_IF_FALSE);
+
+    begin_loop(compiler);
+    body.loop_depth = compiler->loop_count;
+    compile_stmt(compiler, for_stmt->block);
+    patch_continues(compiler);
+    mark_position(compiler, offset);
+    image_constant_t step_constant = { IMAGE_CONST_INT, 0, (uint64_t)step };
+    emit_op_u16(compiler, OP_GET_LOCAL, body.index_slot);
+    emit_op_u16(compiler, OP_CONST, add_constant(compiler, step_constant, offset));
+    emit_typed_op(compiler, OP_ADD, operand_type(OP_ADD, DATA_TYPE_INT, DATA_TYPE_INT));
+    emit_op_u16(compiler, OP_SET_LOCAL, body.index_slot);
+    emit_jump_back(compiler, loop_start);
+    patch_jump(compiler, to_exit);
+    end_loop(compiler);
+
+    for (size_t k = 0; k < body.reduction_count; ++k) {
+        emit_op_u16(compiler, OP_GET_LOCAL, body.reductions[k].slot);
+        emit_byte(compiler, OP_REDUCE);
+        emit_byte(compiler, (uint8_t)k);
+        adjust_stack(compiler, -1);
+    }
+    emit_op(compiler, OP_NULL);
+    emit_op(compiler, OP_RETURN);
+
+    patch_jump(compiler, to_init);
+    for (size_t k = 0; k < body.reduction_count; ++k) {
+        image_constant_t identity = { IMAGE_CONST_INT, 0, body.reductions[k].op == OP_MUL ? 1 : 0 };
+        emit_op_u16(compiler, OP_CONST, add_constant(compiler, identity, offset));
+        emit_op_u16(compiler, OP_SET_LOCAL, body.reductions[k].slot);
+    }
+    emit_jump_back(compiler, loop_start);
+
+    image_function_t *worker = compiler->function;
+    worker->reduction_count = (uint8_t)body.reduction_count;
+    worker->code_size = (uint32_t)compiler->code_size;
+    worker->local_count = (uint16_t)compiler->max_locals;
+    worker->max_stack = (uint16_t)(compiler->max_stack > 0 ? compiler->max_stack : 1);
+    add_pending_body(compiler, index);
+    free(compiler->locals);
+    free(compiler->loops);
+    restore_function_state(compiler, &saved);
+
+    // Reads inside the worker are reads of the enclosing parallel body too.
+    if (compiler->parallel) {
+        for (size_t slot = 0; slot < capture_count; ++slot) {
+            if (body.capture_reads[slot]) {
+                note_capture_read(compiler, compiler->parallel, (uint16_t)slot, compiler->locals[slot].name, offset);
+            }
+        }
+    }
+    free(body.capture_reads);
+
+    uint32_t multiply_mask = 0;
+    for (size_t k = 0; k < body.reduction_count; ++k) {
+        if (body.reductions[k].op == OP_MUL) multiply_mask |= 1u << k;
+    }
+    emit_byte(compiler, OP_PARALLEL_FOR);
+    emit_u16(compiler, (uint16_t)index);
+    emit_u32(compiler, (uint32_t)step);
+    emit_byte(compiler, (uint8_t)body.reduction_count);
+    emit_u32(compiler, multiply_mask);
+    adjust_stack(compiler, (int)body.reduction_count - 2);
+
+    // The combined results are on the stack, the last reduction on top.
+    for (size_t k = body.reduction_count; k > 0; --k) {
+        const parallel_reduction_t *reduction = &body.reductions[k - 1];
+        if (compiler->parallel && reduction->slot < compiler->parallel->capture_count) {
+            claim_reduction(compiler, compiler->parallel, reduction->slot, reduction->op, reduction->name, offset);
+        } else {
+            check_parallel_assign(compiler, reduction->name, true, reduction->slot, offset);
+        }
+        emit_op_u16(compiler, OP_GET_LOCAL, reduction->slot);
+        emit_op(compiler, reduction->op);
+        emit_op_u16(compiler, OP_SET_LOCAL, reduction->slot);
+    }
+}
+
+/**
+ * @brief Moves the worker functions of parallel loops into the code section,
+ * after every other function.
+ */
+static void append_parallel_bodies(compiler_t *compiler) {
+    for (size_t i = 0; i < compiler->pending_body_count; ++i) {
+        pending_body_t *body = &compiler->pending_bodies[i];
+        image_function_t *function = &compiler->functions[body->function];
+        function->code_offset = (uint32_t)compiler->code_size;
+        function->line_offset = (uint32_t)compiler->line_count;
+        for (size_t j = 0; j < body->code_size; ++j) {
+            emit_byte(compiler, body->code[j]);
+        }
+        while (compiler->line_count + body->line_count > compiler->line_capacity) {
+            compiler->line_capacity = compiler->line_capacity ? compiler->line_capacity * 2 : 256;
+            compiler->lines = realloc(compiler->lines, compiler->line_capacity * sizeof(image_line_t));
+            CHECK_MEM_ALLOC_ERROR(compiler->lines);
+        }
+        if (body->line_count) {
+            memcpy(compiler->lines + compiler->line_count, body->lines, body->line_count * sizeof(image_line_t));
+        }
+        compiler->line_count += body->line_count;
+        free(body->code);
+        free(body->lines);
+    }
+    compiler->pending_body_count = 0;
+}
+
+static void compile_globals_initializer(compiler_t *compiler, uint32_t index, const ast_t *ast) {
+    begin_function(compiler, index);
+    compiler->inline_budget = inline_threshold * INLINE_GROWTH_FACTOR;
+    for (size_t i = 0; i < ast->node_count; ++i) {
+        const ast_node_t *node = ast->nodes[i];
+        if (node->type != AST_NODE_CATEGORY_STMT || !node->data.stmt_node) continue;
+        const ast_stmt_node_t *stmt = node->data.stmt_node;
+        uint32_t global;
+        if (stmt->type != STMT_VAR_DECL) continue;
+        mark_position(compiler, stmt->offset);
+        compile_expr(compiler, stmt->data.var_decl->initializer);
+        emit_conversion(compiler, stmt->data.var_decl->type, type_of(compiler, stmt->data.var_decl->initializer));
+        name_table_find(&compiler->global_names, stmt->data.var_decl->name, &global);
+        emit_op_u16(compiler, OP_SET_GLOBAL, (uint16_t)global);
+    }
+    end_function(compiler);
+}
+
+/**
+ * @brief Registers every function and global before any body is compiled,
+ * so that declarations can be used before they appear in the file.
+ */
+static void declare_top_level(compiler_t *compiler, const ast_t *ast) {
+    size_t function_count = 0;
+    for (size_t i = 0; i < ast->node_count; ++i) {
+        if (ast->nodes[i]->type == AST_NODE_CATEGORY_DECL) function_count++;
+    }
+    compiler->function_capacity = function_count + 1;
+    compiler->functions = calloc(compiler->function_capacity, sizeof(image_function_t));
+    CHECK_MEM_ALLOC_ERROR(compiler->functions);
+
+    for (size_t i = 0; i < ast->node_count; ++i) {
+        const ast_node_t *node = ast->nodes[i];
+        uint32_t existing;
+        switch (node->type) {
+            case AST_NODE_CATEGORY_DECL: {
+                const ast_decl_node_t *decl = node->data.decl_node;
+                const decl_function_t *function = decl->data.function_decl;
+                if (name_table_find(&compiler->function_names, function->name, &existing)) {
+                    compiler_error(compiler, decl->offset, "Function '%s' is already declared", function->name);
+                    break;
+                }
+                if (function->param_list->param_count > COMPILER_MAX_ARGS) {
+                    compiler_error(compiler, decl->offset, "Function '%s' has too many parameters", function->name);
+                    break;
+                }
+                uint32_t index = (uint32_t)compiler->function_count++;
+                image_function_t *entry = &compiler->functions[index];
+                entry->name = intern_string(compiler, function->name);
+                entry->param_count = (uint16_t)function->param_list->param_count;
+                entry->return_type = (uint8_t)function->return_type;
+                entry->flags = function->is_async ? IMAGE_FUNCTION_ASYNC : 0;
+                size_t line, column;
+                source_map_locate(compiler->source_map, decl->offset, &line, &column);
+                entry->line = (uint32_t)line;
+                entry->column = (uint32_t)column;
+                name_table_insert(&compiler->function_names, function->name, index);
+                break;
+            }
+            case AST_NODE_CATEGORY_STMT: {
+                const ast_stmt_node_t *stmt = node->data.stmt_node;
+                if (!stmt || stmt->type != STMT_VAR_DECL) {
+                    compiler_error(compiler, node->offset, "Only variable declarations are allowed at the top level");
+                    break;
+                }
+                const char *name = stmt->data.var_decl->name;
+                if (name_table_find(&compiler->global_names, name, &existing)) {
+                    compiler_error(compiler, stmt->offset, "Global '%s' is already declared", name);
+                    break;
+                }
+                if (compiler->global_count >= UINT16_MAX) {
+                    compiler_error(compiler, stmt->offset, "Too many globals");
+                    break;
+                }
+                if (compiler->global_count >= compiler->global_capacity) {
+                    compiler->global_capacity = compiler->global_capacity ? compiler->global_capacity * 2 : 16;
+                    compiler->globals = realloc(compiler->globals, compiler->global_capacity * sizeof(image_global_t));
+                    CHECK_MEM_ALLOC_ERROR(compiler->globals);
+                }
+                compiler->globals[compiler->global_count] = (image_global_t){
+                    intern_string(compiler, name), (uint32_t)stmt->data.var_decl->type
+                };
+                name_table_insert(&compiler->global_names, name, (uint32_t)compiler->global_count++);
+                break;
+            }
+            case AST_NODE_CATEGORY_EXPR:
+                compiler_error(compiler, node->offset, "Expressions are not allowed at the top level");
+                break;
+        }
+    }
+}
+
+//--------------------------------------- Superinstructions -------------------------------------------------------------------------
+
+typedef struct superinstruction_struct {
+    opcode_t op;
+    opcode_t components[OP_MAX_COMPONENTS];
+} superinstruction_t;
+
+/** The last entry matches nothing; it keeps the table from being empty. */
+static const superinstruction_t superinstruction_table[] = {
+#define SUPERINSTRUCTION(name, first, second, third) { name, { first, second, third } },
+#include "include/superinstructions.h"
+#undef SUPERINSTRUCTION
+    { OP_COUNT, { OP_COUNT, OP_COUNT, OP_COUNT } }
+};
+
+#define SUPERINSTRUCTION_COUNT (sizeof(superinstruction_table) / sizeof(superinstruction_table[0]))
+
+/**
+ * @brief Length in bytes of the sequence starting at `pc` if it is the one
+ * `super` fuses, else 0.
+ */
+static uint32_t match_superinstruction(const superinstruction_t *super, const uint8_t *code, uint32_t pc, uint32_t size) {
+    uint32_t at = pc;
+    for (size_t i = 0; i < OP_MAX_COMPONENTS && super->components[i] != OP_COUNT; ++i) {
+        if (at >= size || code[at] != super->components[i]) return 0;
+        at += 1 + (uint32_t)opcode_operand_size(super->components[i]);
+    }
+    return at - pc;
+}
+
+/**
+ * @brief Replaces the first opcode of every listed sequence by its
+ * superinstruction, scanning each function once from the start. Only that
+ * byte changes, so jump targets and the line table stay valid.
+ */
+static void fuse_superinstructions(compiler_t *compiler) {
+    for (size_t f = 0; f < compiler->function_count; ++f) {
+        const image_function_t *function = &compiler->functions[f];
+        uint8_t *code = compiler->code + function->code_offset;
+        uint32_t pc = 0;
+        while (pc < function->code_size) {
+            // The longest sequence wins.
+            uint32_t length = 0;
+            opcode_t fused = OP_COUNT;
+            for (size_t i = 0; i < SUPERINSTRUCTION_COUNT; ++i) {
+                uint32_t match = match_superinstruction(&superinstruction_table[i], code, pc, function->code_size);
+                if (match > length) {
+                    length = match;
+                    fused = superinstruction_table[i].op;
+                }
+            }
+            if (fused != OP_COUNT) {
+                code[pc] = (uint8_t)fused;
+            } else {
+                length = 1 + (uint32_t)opcode_operand_size((opcode_t)code[pc]);
+            }
+            pc += length;
+        }
+    }
+}
+
+//--------------------------------------- Image Layout ------------------------------------------------------------------------------
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static image_t *build_image(compiler_t *compiler, uint32_t entry, uint32_t init) {
+    image_header_t header = {0};
+    memcpy(header.magic, IMAGE_MAGIC, 4);
+    header.version = IMAGE_VERSION;
+    header.function_count = (uint32_t)compiler->function_count;
+    header.constant_count = (uint32_t)compiler->constant_count;
+    header.global_count = (uint32_t)compiler->global_count;
+    header.line_count = (uint32_t)compiler->line_count;
+    header.code_size = (uint32_t)compiler->code_size;
+    header.string_table_size = (uint32_t)compiler->strings_size;
+    header.entry_function = entry;
+    header.init_function = init;
+
+    size_t offset = align8(sizeof(image_header_t));
+    header.function_table_offset = (uint32_t)offset;
+    offset = align8(offset + compiler->function_count * sizeof(image_function_t));
+    header.constant_table_offset = (uint32_t)offset;
+    offset = align8(offset + compiler->constant_count * sizeof(image_constant_t));
+    header.global_table_offset = (uint32_t)offset;
+    offset = align8(offset + compiler->global_count * sizeof(image_global_t));
+    header.line_table_offset = (uint32_t)offset;
+    offset = align8(offset + compiler->line_count * sizeof(image_line_t));
+    header.code_offset = (uint32_t)offset;
+    offset = align8(offset + compiler->code_size);
+    header.string_table_offset = (uint32_t)offset;
+    offset += compiler->strings_size;
+    if (offset > UINT32_MAX) {
+        compiler_error(compiler, 0, 0, "Program too large for a bytecode image");
+        return NULL;
+    }
+    header.image_size = (uint32_t)offset;
+
+    uint8_t *buffer = calloc(1, offset);
+    CHECK_MEM_ALLOC_ERROR(buffer);
+    memcpy(buffer, &header, sizeof(header));
+    if (compiler->function_count) memcpy(buffer + header.function_table_offset, compiler->functions, compiler->function_count * sizeof(image_function_t));
+    if (compiler->constant_count) memcpy(buffer + header.constant_table_offset, compiler->constants, compiler->constant_count * sizeof(image_constant_t));
+    if (compiler->global_count) memcpy(buffer + header.global_table_offset, compiler->globals, compiler->global_count * sizeof(image_global_t));
+    if (compiler->line_count) memcpy(buffer + header.line_table_offset, compiler->lines, compiler->line_count * sizeof(image_line_t));
+    if (compiler->code_size) memcpy(buffer + header.code_offset, compiler->code, compiler->code_size);
+    memcpy(buffer + header.string_table_offset, compiler->strings, compiler->strings_size);
+
+    image_t *image = image_from_buffer(buffer, offset);
+    if (!image) {
+        compiler_error(compiler, 0, 0, "Internal error: generated image failed verification");
+    }
+    return image;
+}
+
+static void free_compiler(compiler_t *compiler) {
+    free(compiler->code);
+    free(compiler->functions);
+    free(compiler->constants);
+    free(compiler->globals);
+    free(compiler->lines);
+    free(compiler->strings);
+    free_name_table(&compiler->function_names);
+    free_name_table(&compiler->global_names);
+    free_name_table(&compiler->string_offsets);
+    for (size_t i = 0; i < compiler->owned_string_count; ++i) {
+        free(compiler->owned_strings[i]);
+    }
+    free(compiler->owned_strings);
+    free(compiler->locals);
+    free(compiler->loops);
+    free(compiler->pending_bodies);
+    for (size_t i = 0; i < compiler->summary_count; ++i) {
+        free(compiler->summaries[i].callees);
+        free_name_table(&compiler->summaries[i].local_types);
+    }
+    free(compiler->summaries);
+    free(compiler->typed_globals);
+    free(compiler->hoisted);
+    free(compiler->inline_reported.keys);
+}
+
+image_t *compile_program(const ast_t *ast) {
+    compiler_t compiler = {0};
+    compiler.source_map = ast->source_map;
+    intern_string(&compiler, "");
+
+    declare_top_level(&compiler, ast);
+    summarize_functions(&compiler, ast);
+    infer_types(&compiler, ast);
+
+    size_t function_index = 0;
+    for (size_t i = 0; i < ast->node_count; ++i) {
+        const ast_node_t *node = ast->nodes[i];
+        if (node->type != AST_NODE_CATEGORY_DECL) continue;
+        uint32_t index;
+        const decl_function_t *function = node->data.decl_node->data.function_decl;
+        if (!name_table_find(&compiler.function_names, function->name, &index) || index != function_index) {
+            continue; // duplicate, already reported
+        }
+        TRACE_BEGIN("compile func", function->name);
+        compile_function(&compiler, index, node->data.decl_node);
+        TRACE_END("compile func");
+        function_index++;
+    }
+
+    uint32_t init = add_function(&compiler);
+    compiler.functions[init].name = intern_string(&compiler, "<init>");
+    TRACE_BEGIN("compile globals", NULL);
+    compile_globals_initializer(&compiler, init, ast);
+    TRACE_END("compile globals");
+    append_parallel_bodies(&compiler);
+
+    uint32_t entry = IMAGE_NO_FUNCTION;
+    name_table_find(&compiler.function_names, "main", &entry);
+
+    image_t *image = NULL;
+    if (compiler.error_count == 0) {
+        if (superinstructions) {
+            fuse_superinstructions(&compiler);
+        }
+        TRACE_BEGIN("build image", NULL);
+        image = build_image(&compiler, entry, init);
+        TRACE_END("build image");
+    }
+    if (compiler.error_count > 0) {
+        fprintf(stderr, "%zu error%s, compilation failed\n", compiler.error_count, compiler.error_count == 1 ? "" : "s");
+    }
+    free_compiler(&compiler);
+    return image;
+}
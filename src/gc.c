@@ -0,0 +1,543 @@
+/**
+ * File Name: gc.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "include/gc.h"
+#include "include/array.h"
+#include "include/str.h"
+#include "include/task.h"
+#include "include/trace.h"
+#include "include/vm.h"
+#include "include/utils.h"
+
+#define GC_ALIGNMENT 16
+#define GC_ALIGN(n) (((n) + GC_ALIGNMENT - 1) & ~(size_t)(GC_ALIGNMENT - 1))
+#define GC_LARGE_OBJECT(heap) ((heap)->nursery_size / 8)   /**< Larger objects start out old */
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void init_gc_heap(gc_heap_t *heap) {
+    memset(heap, 0, sizeof(*heap));
+    heap->nursery_size = GC_DEFAULT_NURSERY_SIZE;
+    heap->old_limit = GC_MIN_OLD_LIMIT;
+}
+
+void gc_set_limits(gc_heap_t *heap, size_t nursery_size, size_t max_heap) {
+    if (!heap->nursery && nursery_size >= GC_ALIGNMENT * 4) {
+        heap->nursery_size = GC_ALIGN(nursery_size);
+    }
+    heap->max_heap = max_heap;
+    if (max_heap && heap->old_limit > max_heap) {
+        heap->old_limit = max_heap;
+    }
+}
+
+//------------------------------------------------------------------------------
+// objects
+//------------------------------------------------------------------------------
+
+static size_t object_size(const gc_object_t *object) {
+    switch ((gc_kind_t)object->kind) {
+        case GC_STRING: return sizeof(string_t);
+        case GC_ARRAY:  return sizeof(array_t);
+        default:        return sizeof(boxed_int_t);
+    }
+}
+
+/**
+ * @brief Size of the object plus the array elements or string buffer it owns.
+ */
+static size_t object_bytes(const gc_object_t *object) {
+    size_t bytes = object_size(object);
+    if (object->kind == GC_ARRAY) {
+        bytes += array_storage_bytes(((const array_t *)object)->length);
+    } else if (object->kind == GC_STRING) {
+        bytes += string_external_bytes((const string_t *)object);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Frees what the object owns outside the heap.
+ *
+ * @return The size of the object plus the bytes actually released.
+ */
+static size_t free_object_storage(gc_object_t *object) {
+    size_t bytes = object_size(object);
+    if (object->kind == GC_ARRAY) {
+        bytes += array_storage_bytes(((array_t *)object)->length);
+        array_free_storage((array_t *)object);
+    } else if (object->kind == GC_STRING) {
+        bytes += string_free_storage((string_t *)object);
+    }
+    return bytes;
+}
+
+/**
+ * @brief The heap object a value refers to, or NULL for values that are not
+ * heap objects and for strings of the image.
+ */
+static gc_object_t *object_of(value_t value) {
+    switch (VALUE_TAG(value)) {
+        case VALUE_TAG_STRING:
+        case VALUE_TAG_ARRAY:
+        case VALUE_TAG_BOXED_INT: {
+            // Each of them starts with its gc_object_t.
+            gc_object_t *object = AS_POINTER(value);
+            return (object->flags & GC_FLAG_CONSTANT) ? NULL : object;
+        }
+        default:
+            return NULL;
+    }
+}
+
+bool gc_in_nursery(const gc_heap_t *heap, const gc_object_t *object) {
+    uintptr_t address = (uintptr_t)object;
+    uintptr_t start = (uintptr_t)heap->nursery;
+    return address >= start && address < start + heap->nursery_used;
+}
+
+static void grow_old(gc_heap_t *heap, size_t bytes) {
+    heap->old_bytes += bytes;
+    if (heap->old_bytes > heap->stats.peak_old_bytes) {
+        heap->stats.peak_old_bytes = heap->old_bytes;
+    }
+    if (heap->old_bytes > heap->old_limit) {
+        heap->major_pending = true;
+    }
+}
+
+static void link_old(gc_heap_t *heap, gc_object_t *object) {
+    object->flags = GC_FLAG_OLD;
+    object->next = heap->old;
+    heap->old = object;
+}
+
+/**
+ * @brief Bump allocates in the nursery. A full nursery schedules a minor
+ * collection and the object starts out old, as do large objects.
+ */
+gc_object_t *gc_allocate(gc_heap_t *heap, gc_kind_t kind, size_t size, size_t external) {
+    if (!heap->nursery) {
+        heap->nursery = malloc(heap->nursery_size);
+        CHECK_MEM_ALLOC_ERROR(heap->nursery);
+    }
+
+    gc_object_t *object;
+    size_t step = GC_ALIGN(size);
+    bool large = step + external > GC_LARGE_OBJECT(heap);
+    if (!large && step <= heap->nursery_size - heap->nursery_used) {
+        object = (gc_object_t *)(heap->nursery + heap->nursery_used);
+        heap->nursery_used += step;
+        object->flags = 0;
+        object->next = NULL;
+    } else {
+        if (!large) {
+            heap->minor_pending = true;
+        }
+        object = malloc(size);
+        CHECK_MEM_ALLOC_ERROR(object);
+        link_old(heap, object);
+        grow_old(heap, size);
+    }
+    object->kind = (uint8_t)kind;
+    heap->stats.allocated_bytes += size;
+    gc_note_external(heap, object, external);
+    return object;
+}
+
+void gc_note_external(gc_heap_t *heap, const gc_object_t *object, size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+    heap->stats.allocated_bytes += bytes;
+    if (object->flags & GC_FLAG_OLD) {
+        grow_old(heap, bytes);
+    } else {
+        // Storage outside the nursery still counts towards filling it.
+        heap->nursery_external += bytes;
+        if (heap->nursery_external > heap->nursery_size) {
+            heap->minor_pending = true;
+        }
+    }
+}
+
+array_t *gc_new_array(gc_heap_t *heap, value_type_t element_type, size_t length) {
+    array_t *array = (array_t *)gc_allocate(heap, GC_ARRAY, sizeof(array_t), array_storage_bytes(length));
+    array_init_storage(array, element_type, length);
+    return array;
+}
+
+value_t gc_box_int(gc_heap_t *heap, int64_t integer) {
+    boxed_int_t *boxed = (boxed_int_t *)gc_allocate(heap, GC_BOXED_INT, sizeof(boxed_int_t), 0);
+    boxed->value = integer;
+    return BOXED_INT_VALUE(boxed);
+}
+
+int64_t boxed_int_value(const boxed_int_t *boxed) {
+    return boxed->value;
+}
+
+void gc_note_allocation(gc_heap_t *heap, size_t bytes) {
+    heap->stats.allocated_bytes += bytes;
+    grow_old(heap, bytes);
+}
+
+//------------------------------------------------------------------------------
+// minor collection
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Old objects whose references still have to be evacuated; only
+ * ropes have any.
+ */
+typedef struct gc_worklist_struct {
+    gc_object_t **objects;
+    size_t count;
+    size_t capacity;
+} gc_worklist_t;
+
+static void worklist_push(gc_worklist_t *worklist, gc_object_t *object) {
+    if (worklist->count >= worklist->capacity) {
+        worklist->capacity = worklist->capacity ? worklist->capacity * 2 : 64;
+        worklist->objects = realloc(worklist->objects, worklist->capacity * sizeof(gc_object_t *));
+        CHECK_MEM_ALLOC_ERROR(worklist->objects);
+    }
+    worklist->objects[worklist->count++] = object;
+}
+
+#define IS_ROPE(object) ((object)->kind == GC_STRING && ((const string_t *)(object))->kind == STRING_ROPE)
+
+/**
+ * @brief Moves a nursery object into the old generation, once.
+ *
+ * @return Where the object lives now.
+ */
+static gc_object_t *forward(gc_heap_t *heap, gc_worklist_t *worklist, gc_object_t *object) {
+    if (!gc_in_nursery(heap, object)) {
+        return object;
+    }
+    if (!(object->flags & GC_FLAG_FORWARDED)) {
+        size_t size = object_size(object);
+        gc_object_t *copy = malloc(size);
+        CHECK_MEM_ALLOC_ERROR(copy);
+        memcpy(copy, object, size);
+        link_old(heap, copy);
+        size_t bytes = object_bytes(copy);
+        heap->stats.promoted_bytes += bytes;
+        grow_old(heap, bytes);
+        object->flags |= GC_FLAG_FORWARDED;
+        object->next = copy;
+        if (IS_ROPE(copy)) {
+            worklist_push(worklist, copy);
+        }
+    }
+    return object->next;
+}
+
+static void evacuate(gc_heap_t *heap, gc_worklist_t *worklist, value_t *slot) {
+    gc_object_t *object = object_of(*slot);
+    if (!object) {
+        return;
+    }
+    object = forward(heap, worklist, object);
+    *slot = VALUE_MAKE(VALUE_TAG(*slot), (uintptr_t)object);
+}
+
+static void evacuate_range(gc_heap_t *heap, gc_worklist_t *worklist, value_t *values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        evacuate(heap, worklist, &values[i]);
+    }
+}
+
+static string_t *forward_string(gc_heap_t *heap, gc_worklist_t *worklist, string_t *string) {
+    if (string->object.flags & GC_FLAG_CONSTANT) {
+        return string;
+    }
+    return (string_t *)forward(heap, worklist, &string->object);
+}
+
+/**
+ * @brief Frees what the objects left in the nursery own and empties it.
+ */
+static void release_nursery(gc_heap_t *heap) {
+    size_t offset = 0;
+    while (offset < heap->nursery_used) {
+        gc_object_t *object = (gc_object_t *)(heap->nursery + offset);
+        size_t size = object_size(object);
+        if (!(object->flags & GC_FLAG_FORWARDED)) {
+            heap->stats.freed_bytes += free_object_storage(object);
+        }
+        offset += GC_ALIGN(size);
+    }
+    heap->nursery_used = 0;
+    heap->nursery_external = 0;
+}
+
+/**
+ * @brief Roots are the VM stack, the globals and the task frames and
+ * results written since the last collection; no other old object can refer
+ * to the nursery. A rope is never older than its children, see
+ * string_concat().
+ */
+static void collect_minor(vm_t *vm) {
+    gc_heap_t *heap = &vm->heap;
+    gc_worklist_t worklist = { NULL, 0, 0 };
+    evacuate_range(heap, &worklist, vm->stack, vm->stack_top);
+    if (!vm->region) {
+        // Workers share the parent's globals and cannot assign them.
+        evacuate_range(heap, &worklist, vm->globals, vm->image->header->global_count);
+    }
+
+    event_loop_t *loop = &vm->loop;
+    while (loop->remembered) {
+        task_t *task = loop->remembered;
+        loop->remembered = task->remembered_next;
+        task->remembered = 0;
+        task->remembered_next = NULL;
+        if (task->frame) {
+            evacuate_range(heap, &worklist, task->frame, task->saved_count);
+        }
+        evacuate(heap, &worklist, &task->result);
+    }
+
+    // Promoted ropes still point at their children in the nursery.
+    while (worklist.count > 0) {
+        string_t *rope = (string_t *)worklist.objects[--worklist.count];
+        rope->as.rope.left = forward_string(heap, &worklist, rope->as.rope.left);
+        rope->as.rope.right = forward_string(heap, &worklist, rope->as.rope.right);
+    }
+    free(worklist.objects);
+
+    release_nursery(heap);
+    heap->minor_pending = false;
+}
+
+//------------------------------------------------------------------------------
+// major collection
+//------------------------------------------------------------------------------
+
+typedef struct gc_mark_stack_struct {
+    task_t **tasks;
+    size_t count;
+    size_t capacity;
+    gc_worklist_t ropes;
+} gc_mark_stack_t;
+
+static void mark_object(gc_mark_stack_t *stack, gc_object_t *object) {
+    if (object->flags & (GC_FLAG_MARKED | GC_FLAG_CONSTANT)) {
+        return;
+    }
+    object->flags |= GC_FLAG_MARKED;
+    if (IS_ROPE(object)) {
+        worklist_push(&stack->ropes, object);
+    }
+}
+
+static void mark_value(gc_mark_stack_t *stack, value_t value) {
+    if (IS_TASK(value)) {
+        task_t *task = AS_TASK(value);
+        if (task->marked) return;
+        task->marked = 1;
+        if (stack->count >= stack->capacity) {
+            stack->capacity = stack->capacity ? stack->capacity * 2 : 64;
+            stack->tasks = realloc(stack->tasks, stack->capacity * sizeof(task_t *));
+            CHECK_MEM_ALLOC_ERROR(stack->tasks);
+        }
+        stack->tasks[stack->count++] = task;
+        return;
+    }
+    gc_object_t *object = object_of(value);
+    if (object) {
+        mark_object(stack, object);
+    }
+}
+
+static void mark_range(gc_mark_stack_t *stack, const value_t *values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        mark_value(stack, values[i]);
+    }
+}
+
+/**
+ * @brief Marks from the roots, then frees the unmarked old objects and the
+ * finished tasks nothing refers to. Runs right after a minor collection,
+ * so every object is old.
+ */
+static void collect_major(vm_t *vm) {
+    gc_heap_t *heap = &vm->heap;
+    event_loop_t *loop = &vm->loop;
+    gc_mark_stack_t stack = { NULL, 0, 0, { NULL, 0, 0 } };
+
+    mark_range(&stack, vm->stack, vm->stack_top);
+    mark_range(&stack, vm->globals, vm->image->header->global_count);
+    for (task_t *task = loop->tasks; task; task = task->all_next) {
+        if (task->state != TASK_DONE) {
+            // The event loop refers to every unfinished task.
+            mark_value(&stack, TASK_VALUE(task));
+        }
+    }
+    while (stack.count > 0 || stack.ropes.count > 0) {
+        if (stack.ropes.count > 0) {
+            string_t *rope = (string_t *)stack.ropes.objects[--stack.ropes.count];
+            mark_object(&stack, &rope->as.rope.left->object);
+            mark_object(&stack, &rope->as.rope.right->object);
+            continue;
+        }
+        task_t *task = stack.tasks[--stack.count];
+        if (task->frame) {
+            mark_range(&stack, task->frame, task->saved_count);
+        }
+        mark_value(&stack, task->result);
+    }
+    free(stack.tasks);
+    free(stack.ropes.objects);
+
+    size_t live = 0;
+    gc_object_t **link = &heap->old;
+    while (*link) {
+        gc_object_t *object = *link;
+        if (object->flags & GC_FLAG_MARKED) {
+            object->flags &= (uint8_t)~GC_FLAG_MARKED;
+            live += object_bytes(object);
+            link = &object->next;
+            continue;
+        }
+        *link = object->next;
+        heap->stats.freed_bytes += free_object_storage(object);
+        free(object);
+    }
+    heap->stats.freed_bytes += event_loop_sweep(loop);
+
+    heap->old_bytes = live + event_loop_bytes(loop);
+    heap->old_limit = heap->old_bytes * GC_OLD_GROWTH;
+    if (heap->old_limit < GC_MIN_OLD_LIMIT) {
+        heap->old_limit = GC_MIN_OLD_LIMIT;
+    }
+    if (heap->max_heap && heap->old_limit > heap->max_heap) {
+        heap->old_limit = heap->max_heap;
+    }
+    heap->major_pending = false;
+}
+
+//------------------------------------------------------------------------------
+// collection
+//------------------------------------------------------------------------------
+
+static void record_pause(gc_pauses_t *pauses, uint64_t ns) {
+    uint64_t us = ns / 1000;
+    size_t bucket = 0;
+    while (bucket + 1 < GC_PAUSE_BUCKETS && ((uint64_t)1 << bucket) <= us) {
+        bucket++;
+    }
+    pauses->buckets[bucket]++;
+    pauses->count++;
+    pauses->total_ns += ns;
+    if (ns > pauses->max_ns) {
+        pauses->max_ns = ns;
+    }
+}
+
+bool gc_collect(vm_t *vm) {
+    gc_heap_t *heap = &vm->heap;
+    if (vm->region) {
+        // A worker's old objects are all freed by gc_reset() before its next chunk.
+        heap->major_pending = false;
+    }
+    TRACE_BEGIN("gc", NULL);
+    uint64_t start = monotonic_ns();
+
+    // Promotion can push the old generation over its limit, so decide after the minor collection.
+    collect_minor(vm);
+    bool major = heap->major_pending;
+    if (major) {
+        collect_major(vm);
+    }
+
+    record_pause(major ? &heap->stats.major : &heap->stats.minor, monotonic_ns() - start);
+    TRACE_END("gc");
+    return !major || !heap->max_heap || heap->old_bytes <= heap->max_heap;
+}
+
+void gc_reset(gc_heap_t *heap) {
+    release_nursery(heap);
+    while (heap->old) {
+        gc_object_t *object = heap->old;
+        heap->old = object->next;
+        heap->stats.freed_bytes += free_object_storage(object);
+        free(object);
+    }
+    heap->old_bytes = 0;
+    heap->minor_pending = false;
+    heap->major_pending = false;
+}
+
+void free_gc_heap(gc_heap_t *heap) {
+    gc_reset(heap);
+    free(heap->nursery);
+    heap->nursery = NULL;
+}
+
+//------------------------------------------------------------------------------
+// statistics
+//------------------------------------------------------------------------------
+
+uint64_t gc_pause_percentile(const gc_pauses_t *pauses, double fraction) {
+    if (pauses->count == 0) {
+        return 0;
+    }
+    uint64_t wanted = (uint64_t)(fraction * (double)pauses->count + 0.999999);
+    if (wanted == 0) wanted = 1;
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < GC_PAUSE_BUCKETS; ++bucket) {
+        seen += pauses->buckets[bucket];
+        if (seen >= wanted) {
+            return (uint64_t)1 << bucket;
+        }
+    }
+    return (uint64_t)1 << (GC_PAUSE_BUCKETS - 1);
+}
+
+static void report_pauses(FILE *out, const char *name, const gc_pauses_t *pauses) {
+    if (pauses->count == 0) {
+        fprintf(out, "%s collections: 0\n", name);
+        return;
+    }
+    fprintf(out, "%s collections: %llu, total %.3f ms, p50 < %llu us, p99 < %llu us, max %.1f us\n", name,
+        (unsigned long long)pauses->count, (double)pauses->total_ns / 1e6,
+        (unsigned long long)gc_pause_percentile(pauses, 0.50), (unsigned long long)gc_pause_percentile(pauses, 0.99),
+        (double)pauses->max_ns / 1e3);
+    for (size_t bucket = 0; bucket < GC_PAUSE_BUCKETS; ++bucket) {
+        if (pauses->buckets[bucket]) {
+            fprintf(out, "  < %8llu us %12llu\n", (unsigned long long)1 << bucket,
+                (unsigned long long)pauses->buckets[bucket]);
+        }
+    }
+}
+
+void gc_report(FILE *out, const gc_heap_t *heap) {
+    const gc_stats_t *stats = &heap->stats;
+    fprintf(out, "== gc ==\n");
+    fprintf(out, "nursery: %zu KiB, heap limit: ", heap->nursery_size / 1024);
+    if (heap->max_heap) {
+        fprintf(out, "%zu KiB\n", heap->max_heap / 1024);
+    } else {
+        fprintf(out, "none\n");
+    }
+    fprintf(out, "allocated: %.1f MiB, promoted: %.1f MiB, freed: %.1f MiB, peak old generation: %.1f MiB\n",
+        (double)stats->allocated_bytes / (1024.0 * 1024.0), (double)stats->promoted_bytes / (1024.0 * 1024.0),
+        (double)stats->freed_bytes / (1024.0 * 1024.0), (double)stats->peak_old_bytes / (1024.0 * 1024.0));
+    report_pauses(out, "minor", &stats->minor);
+    report_pauses(out, "major", &stats->major);
+}
@@ -0,0 +1,499 @@
+/**
+ * File Name: image.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "include/image.h"
+#include "include/opcode.h"
+#include "include/value.h"
+#include "include/utils.h"
+
+static uint16_t read_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Whether a table of `count` elements at `offset` lies inside the image
+ * and starts aligned for its element type, so it can be read in place.
+ */
+static bool section_fits(size_t size, uint32_t offset, uint64_t count, size_t element_size, size_t alignment) {
+    return offset % alignment == 0 && (uint64_t)offset + count * element_size <= size;
+}
+
+/**
+ * @brief Walks every reachable instruction of a function, checking operands and
+ * that the operand stack depth is consistent and within max_stack.
+ */
+static bool verify_function(const image_t *image, const image_function_t *function) {
+    const image_header_t *header = image->header;
+    const uint8_t *code = image->code + function->code_offset;
+    uint32_t size = function->code_size;
+    if (size == 0 || function->param_count > function->local_count) return false;
+
+    int32_t *depth_at = malloc(sizeof(int32_t) * size);
+    uint32_t *worklist = malloc(sizeof(uint32_t) * size);
+    CHECK_MEM_ALLOC_ERROR(depth_at);
+    CHECK_MEM_ALLOC_ERROR(worklist);
+    for (uint32_t i = 0; i < size; ++i) depth_at[i] = -1;
+
+    bool ok = true;
+    size_t pending = 0;
+    depth_at[0] = 0;
+    worklist[pending++] = 0;
+
+    while (ok && pending > 0) {
+        uint32_t pc = worklist[--pending];
+        int32_t depth = depth_at[pc];
+        opcode_t op = (opcode_t)code[pc];
+        if (op >= OP_COUNT || pc + 1 + opcode_operand_size(op) > size) {
+            ok = false;
+            break;
+        }
+        const uint8_t *operands = code + pc + 1;
+        uint32_t next = pc + 1 + (uint32_t)opcode_operand_size(op);
+        opcode_t components[OP_MAX_COMPONENTS];
+        size_t component_count = opcode_components(op, components);
+        if (component_count) {
+            // The components must follow as plain instructions, which the walk
+            // then checks one by one; this one checks as the first of them.
+            uint32_t at = pc;
+            for (size_t i = 0; ok && i < component_count; ++i) {
+                opcode_t component = i == 0 ? components[0] : (opcode_t)code[at];
+                ok = opcode_fusible(components[i], i, component_count) && component == components[i]
+                    && at + 1 + opcode_operand_size(component) <= size;
+                at += 1 + (uint32_t)opcode_operand_size(component);
+            }
+            if (!ok) break;
+            op = components[0];
+        }
+        int32_t pops = 0, pushes = 0;
+        uint32_t targets[2];
+        size_t target_count = 0;
+        bool falls_through = true;
+
+        switch (op) {
+            case OP_CONST:
+                ok = read_u16(operands) < header->constant_count;
+                pushes = 1;
+                break;
+            case OP_NULL: case OP_TRUE: case OP_FALSE:
+                pushes = 1;
+                break;
+            case OP_POP:
+                pops = 1;
+                break;
+            case OP_DUP:
+                pops = 1; pushes = 2;
+                break;
+            case OP_GET_LOCAL:
+                ok = read_u16(operands) < function->local_count;
+                pushes = 1;
+                break;
+            case OP_SET_LOCAL:
+                ok = read_u16(operands) < function->local_count;
+                pops = 1;
+                break;
+            case OP_GET_GLOBAL:
+                ok = read_u16(operands) < header->global_count;
+                pushes = 1;
+                break;
+            case OP_SET_GLOBAL:
+                ok = read_u16(operands) < header->global_count;
+                pops = 1;
+                break;
+            case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+            case OP_EQ: case OP_NEQ: case OP_LT: case OP_LEQ: case OP_GT: case OP_GEQ:
+                pops = 2; pushes = 1;
+                break;
+            // The compiler's proof of the operand types is not in the image, so the VM
+            // checks the tags of typed int operands off its fast paths.
+            case OP_ADD_INT: case OP_SUB_INT: case OP_MUL_INT: case OP_DIV_INT: case OP_MOD_INT:
+            case OP_EQ_INT: case OP_NEQ_INT: case OP_LT_INT: case OP_LEQ_INT: case OP_GT_INT: case OP_GEQ_INT:
+            case OP_ADD_FLOAT: case OP_SUB_FLOAT: case OP_MUL_FLOAT: case OP_DIV_FLOAT:
+            case OP_EQ_FLOAT: case OP_NEQ_FLOAT: case OP_LT_FLOAT: case OP_LEQ_FLOAT: case OP_GT_FLOAT: case OP_GEQ_FLOAT:
+                pops = 2; pushes = 1;
+                break;
+            case OP_NEG: case OP_NOT: case OP_NEG_INT: case OP_NEG_FLOAT: case OP_TO_FLOAT:
+                pops = 1; pushes = 1;
+                break;
+            case OP_JUMP:
+                targets[target_count++] = read_u32(operands);
+                falls_through = false;
+                break;
+            case OP_JUMP_IF_FALSE:
+                targets[target_count++] = read_u32(operands);
+                pops = 1;
+                break;
+            case OP_CALL:
+            case OP_SPAWN: {
+                // Async functions only run as tasks, so OP_AWAIT always suspends a task's bottom frame.
+                uint16_t callee = read_u16(operands);
+                bool callee_async = callee < header->function_count
+                    && (image->functions[callee].flags & IMAGE_FUNCTION_ASYNC);
+                ok = callee < header->function_count
+                    && image->functions[callee].param_count == operands[2]
+                    && callee_async == (op == OP_SPAWN);
+                pops = operands[2]; pushes = 1;
+                break;
+            }
+            case OP_TAIL_CALL: {
+                // A task's frame is sized for its own function, so tasks never replace it.
+                uint16_t callee = read_u16(operands);
+                ok = callee < header->function_count
+                    && image->functions[callee].param_count == operands[2]
+                    && !(image->functions[callee].flags & IMAGE_FUNCTION_ASYNC)
+                    && !(function->flags & IMAGE_FUNCTION_ASYNC);
+                pops = operands[2];
+                falls_through = false;
+                break;
+            }
+            case OP_AWAIT:
+                ok = (function->flags & IMAGE_FUNCTION_ASYNC) != 0;
+                pops = 1; pushes = 1;
+                break;
+            case OP_SLEEP:
+                pops = 1; pushes = 1;
+                break;
+            case OP_WAIT_FD:
+                ok = operands[0] == 1 || operands[0] == 2;
+                pops = 1; pushes = 1;
+                break;
+            case OP_NEW_ARRAY:
+                ok = operands[0] == VALUE_INT || operands[0] == VALUE_FLOAT;
+                pops = 1; pushes = 1;
+                break;
+            case OP_LEN: case OP_SUM:
+                pops = 1; pushes = 1;
+                break;
+            case OP_INDEX: case OP_DOT:
+                pops = 2; pushes = 1;
+                break;
+            case OP_SET_INDEX:
+                ok = operands[0] == 0 || (operands[0] >= OP_ADD && operands[0] <= OP_MOD);
+                pops = 3;
+                break;
+            case OP_RETURN:
+                pops = 1;
+                falls_through = false;
+                break;
+            case OP_PRINT:
+                pops = operands[0];
+                break;
+            case OP_PARALLEL_FOR: {
+                // The worker takes the caller's first locals, then the bounds of its chunk.
+                uint16_t worker = read_u16(operands);
+                ok = worker < header->function_count
+                    && image->functions[worker].param_count >= 2
+                    && image->functions[worker].param_count - 2u <= function->local_count
+                    && read_u32(operands + 2) > 0
+                    && operands[6] == image->functions[worker].reduction_count;
+                pops = 2; pushes = operands[6];
+                break;
+            }
+            case OP_REDUCE:
+                // Partials are allocated per region for the worker's own reductions only.
+                ok = operands[0] < function->reduction_count;
+                pops = 1;
+                break;
+            default:
+                ok = false;
+                break;
+        }
+
+        if (!ok || depth < pops) {
+            ok = false;
+            break;
+        }
+        int32_t new_depth = depth - pops + pushes;
+        if (new_depth > function->max_stack) {
+            ok = false;
+            break;
+        }
+        if (falls_through) {
+            targets[target_count++] = next;
+        }
+        for (size_t i = 0; i < target_count && ok; ++i) {
+            uint32_t target = targets[i];
+            if (target >= size) {
+                ok = false;
+            } else if (depth_at[target] == -1) {
+                depth_at[target] = new_depth;
+                worklist[pending++] = target;
+            } else if (depth_at[target] != new_depth) {
+                ok = false;
+            }
+        }
+    }
+
+    free(depth_at);
+    free(worklist);
+    return ok;
+}
+
+static bool image_validate(image_t *image) {
+    if (image->size < sizeof(image_header_t)) return false;
+    const image_header_t *header = (const image_header_t *)image->base;
+    if (memcmp(header->magic, IMAGE_MAGIC, 4) != 0 || header->version != IMAGE_VERSION) return false;
+    if (header->image_size != image->size) return false;
+
+    size_t size = image->size;
+    if (!section_fits(size, header->function_table_offset, header->function_count, sizeof(image_function_t), _Alignof(image_function_t))
+        || !section_fits(size, header->constant_table_offset, header->constant_count, sizeof(image_constant_t), _Alignof(image_constant_t))
+        || !section_fits(size, header->global_table_offset, header->global_count, sizeof(image_global_t), _Alignof(image_global_t))
+        || !section_fits(size, header->line_table_offset, header->line_count, sizeof(image_line_t), _Alignof(image_line_t))
+        || (uint64_t)header->code_offset + header->code_size > size
+        || (uint64_t)header->string_table_offset + header->string_table_size > size
+        || header->string_table_size == 0
+        || image->base[header->string_table_offset + header->string_table_size - 1] != '\0') {
+        return false;
+    }
+
+    image->header = header;
+    image->functions = (const image_function_t *)(image->base + header->function_table_offset);
+    image->constants = (const image_constant_t *)(image->base + header->constant_table_offset);
+    image->globals = (const image_global_t *)(image->base + header->global_table_offset);
+    image->lines = (const image_line_t *)(image->base + header->line_table_offset);
+    image->code = image->base + header->code_offset;
+    image->strings = (const char *)(image->base + header->string_table_offset);
+
+    if (header->init_function >= header->function_count) return false;
+    if (header->entry_function != IMAGE_NO_FUNCTION && header->entry_function >= header->function_count) return false;
+
+    for (uint32_t i = 0; i < header->constant_count; ++i) {
+        const image_constant_t *constant = &image->constants[i];
+        if (constant->kind > IMAGE_CONST_STRING) return false;
+        if (constant->kind == IMAGE_CONST_STRING
+            && (constant->payload > header->string_table_size
+                || constant->length >= header->string_table_size - constant->payload)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->global_count; ++i) {
+        if (image->globals[i].name >= header->string_table_size) return false;
+    }
+    for (uint32_t i = 0; i < header->function_count; ++i) {
+        const image_function_t *function = &image->functions[i];
+        if (function->name >= header->string_table_size
+            || (uint64_t)function->code_offset + function->code_size > header->code_size
+            || (uint64_t)function->line_offset + function->line_count > header->line_count
+            || function->reduction_count > PARALLEL_MAX_REDUCTIONS) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->function_count; ++i) {
+        if (!verify_function(image, &image->functions[i])) return false;
+    }
+    return true;
+}
+
+image_t *image_from_buffer(uint8_t *buffer, size_t size) {
+    image_t *image = malloc(sizeof(image_t));
+    CHECK_MEM_ALLOC_ERROR(image);
+    memset(image, 0, sizeof(*image));
+    image->base = buffer;
+    image->size = size;
+    image->mapped = false;
+    if (!image_validate(image)) {
+        free(buffer);
+        free(image);
+        return NULL;
+    }
+    return image;
+}
+
+image_t *image_map_file(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening image: %s\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        fprintf(stderr, "Invalid image: %s\n", path);
+        return NULL;
+    }
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Error mapping image: %s\n", path);
+        return NULL;
+    }
+
+    image_t *image = malloc(sizeof(image_t));
+    CHECK_MEM_ALLOC_ERROR(image);
+    memset(image, 0, sizeof(*image));
+    image->base = mapping;
+    image->size = (size_t)st.st_size;
+    image->mapped = true;
+    if (!image_validate(image)) {
+        fprintf(stderr, "Invalid image: %s\n", path);
+        munmap(mapping, image->size);
+        free(image);
+        return NULL;
+    }
+    return image;
+}
+
+bool image_write_file(const image_t *image, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error opening file: %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(image->base, 1, image->size, file) == image->size;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "Error writing image: %s\n", path);
+    }
+    return ok;
+}
+
+void free_image(image_t *image) {
+    if (!image) return;
+    if (image->mapped) {
+        munmap((void *)image->base, image->size);
+    } else {
+        free((void *)image->base);
+    }
+    free(image);
+}
+
+const char *image_string(const image_t *image, uint32_t offset) {
+    return image->strings + offset;
+}
+
+uint32_t image_find_function(const image_t *image, const char *name) {
+    for (uint32_t i = 0; i < image->header->function_count; ++i) {
+        if (strcmp(image_string(image, image->functions[i].name), name) == 0) {
+            return i;
+        }
+    }
+    return IMAGE_NO_FUNCTION;
+}
+
+bool image_position_for_pc(const image_t *image, uint32_t function, uint32_t pc, uint32_t *line, uint32_t *column) {
+    const image_function_t *fn = &image->functions[function];
+    const image_line_t *lines = image->lines + fn->line_offset;
+    if (fn->line_count == 0 || lines[0].pc > pc) {
+        *line = fn->line;
+        *column = fn->column;
+        return false;
+    }
+
+    // Entries are sorted by pc; find the last one at or before `pc`.
+    uint32_t low = 0, high = fn->line_count;
+    while (high - low > 1) {
+        uint32_t mid = low + (high - low) / 2;
+        if (lines[mid].pc <= pc) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    *line = lines[low].line;
+    *column = lines[low].column;
+    return true;
+}
+
+void image_disassemble(const image_t *image) {
+    const image_header_t *header = image->header;
+    printf("Image: %u functions, %u constants, %u globals, %u bytes of code\n",
+        header->function_count, header->constant_count, header->global_count, header->code_size);
+
+    for (uint32_t i = 0; i < header->global_count; ++i) {
+        printf("  global %u: %s\n", i, image_string(image, image->globals[i].name));
+    }
+
+    for (uint32_t f = 0; f < header->function_count; ++f) {
+        const image_function_t *function = &image->functions[f];
+        const uint8_t *code = image->code + function->code_offset;
+        printf("Function %u: %s%s (params %u, locals %u, stack %u)\n", f,
+            (function->flags & IMAGE_FUNCTION_ASYNC) ? "async " : "", image_string(image, function->name),
+            function->param_count, function->local_count, function->max_stack);
+
+        uint32_t pc = 0;
+        while (pc < function->code_size) {
+            opcode_t op = (opcode_t)code[pc];
+            const uint8_t *operands = code + pc + 1;
+            printf("  %04u  %-14s", pc, opcode_to_string(op));
+            opcode_t components[OP_MAX_COMPONENTS];
+            switch (opcode_components(op, components) ? components[0] : op) {
+                case OP_CONST: {
+                    const image_constant_t *constant = &image->constants[read_u16(operands)];
+                    switch ((image_constant_kind_t)constant->kind) {
+                        case IMAGE_CONST_INT:
+                            printf(" %" PRId64, (int64_t)constant->payload);
+                            break;
+                        case IMAGE_CONST_FLOAT: {
+                            double d;
+                            memcpy(&d, &constant->payload, sizeof(d));
+                            printf(" %g", d);
+                            break;
+                        }
+                        case IMAGE_CONST_STRING:
+                            printf(" \"%s\"", image_string(image, (uint32_t)constant->payload));
+                            break;
+                    }
+                    break;
+                }
+                case OP_GET_LOCAL:
+                case OP_SET_LOCAL:
+                    printf(" %u", read_u16(operands));
+                    break;
+                case OP_GET_GLOBAL:
+                case OP_SET_GLOBAL:
+                    printf(" %s", image_string(image, image->globals[read_u16(operands)].name));
+                    break;
+                case OP_JUMP:
+                case OP_JUMP_IF_FALSE:
+                    printf(" -> %04u", read_u32(operands));
+                    break;
+                case OP_CALL:
+                case OP_TAIL_CALL:
+                case OP_SPAWN:
+                    printf(" %s/%u", image_string(image, image->functions[read_u16(operands)].name), operands[2]);
+                    break;
+                case OP_PRINT:
+                case OP_REDUCE:
+                    printf(" %u", operands[0]);
+                    break;
+                case OP_WAIT_FD:
+                    printf(" %s", operands[0] == 1 ? "readable" : "writable");
+                    break;
+                case OP_NEW_ARRAY:
+                    printf(" %s", value_type_to_string((value_type_t)operands[0]));
+                    break;
+                case OP_SET_INDEX:
+                    if (operands[0] != 0) {
+                        printf(" %s", opcode_to_string((opcode_t)operands[0]));
+                    }
+                    break;
+                case OP_PARALLEL_FOR:
+                    printf(" %s step %u, %u reductions", image_string(image, image->functions[read_u16(operands)].name),
+                        read_u32(operands + 2), operands[6]);
+                    break;
+                default:
+                    break;
+            }
+            printf("\n");
+            pc += 1 + (uint32_t)opcode_operand_size(op);
+        }
+    }
+}
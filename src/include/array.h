@@ -0,0 +1,104 @@
+/**
+ * File Name: array.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Typed numeric arrays (`int[]`, `float[]`) and the element-wise kernels
+ * behind their arithmetic, sum() and dot(). Storage is contiguous and 32
+ * byte aligned. The kernels use AVX2 or SSE2 where the CPU has them and
+ * plain C otherwise; every kernel accumulates sums in the same four lanes,
+ * so float results do not depend on which one ran.
+ */
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "value.h"
+#include "gc.h"
+
+#define ARRAY_ALIGNMENT 32
+#define ARRAY_MAX_LENGTH ((size_t)1 << 40)
+
+typedef enum {
+    ARRAY_ADD,
+    ARRAY_SUB,
+    ARRAY_MUL,
+    ARRAY_DIV       /**< float[] only */
+} array_op_t;
+
+typedef enum {
+    ARRAY_KERNEL_SCALAR,
+    ARRAY_KERNEL_SSE2,
+    ARRAY_KERNEL_AVX2
+} array_kernel_t;
+
+typedef struct array_struct {
+    gc_object_t object;         /**< Unused outside a GC heap */
+    uint8_t element_type;       /**< VALUE_INT or VALUE_FLOAT */
+    size_t length;
+    union {
+        int64_t *ints;
+        double *floats;
+        void *data;
+    } as;                       /**< Separate from the header, so the header can move */
+} array_t;
+
+/**
+ * @brief Allocates a zero filled array outside any GC heap.
+ *
+ * @param element_type VALUE_INT or VALUE_FLOAT.
+ */
+array_t *init_array(value_type_t element_type, size_t length);
+void free_array(array_t *array);
+
+/**
+ * @brief Fills in an array header and allocates its zero filled elements.
+ */
+void array_init_storage(array_t *array, value_type_t element_type, size_t length);
+void array_free_storage(array_t *array);
+
+/**
+ * @brief Bytes allocated for the elements of an array of `length`.
+ */
+size_t array_storage_bytes(size_t length);
+
+/**
+ * @brief "int[]" or "float[]".
+ */
+const char *array_type_to_string(const array_t *array);
+
+/**
+ * @brief out[i] = a[i * a_step] op b[i * b_step] for every element of `out`.
+ * A step of 0 broadcasts a scalar. `a` and `b` point at int64_t or double
+ * data matching the element type of `out`; integer arithmetic wraps.
+ */
+void array_elementwise(array_op_t op, const void *a, size_t a_step, const void *b, size_t b_step, array_t *out);
+
+/**
+ * @brief Sum of the elements; an int sum too wide for a value is boxed in `heap`.
+ */
+value_t array_sum(gc_heap_t *heap, const array_t *array);
+
+/**
+ * @brief Sum of a[i] * b[i]; both arrays must have the same type and length.
+ */
+value_t array_dot(gc_heap_t *heap, const array_t *a, const array_t *b);
+
+/**
+ * @brief The kernels in use: the widest the CPU supports unless lowered by
+ * array_set_kernel().
+ */
+array_kernel_t array_kernel(void);
+
+/**
+ * @brief Selects the kernels to use, capped at what the CPU supports. Meant
+ * for benchmarks; not synchronised with running kernels.
+ */
+void array_set_kernel(array_kernel_t kernel);
+
+const char *array_kernel_to_string(array_kernel_t kernel);
+
+#endif // ARRAY_H
@@ -7,11 +7,28 @@
 #define AST_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
 #include "lexer.h"
+#include "source_map.h"
+
+/**
+ * Deepest tree the parser builds: expressions nested at most this many
+ * levels, blocks at most this many inside one another. The left operand of a
+ * chain of binary operators, or of an index, is not a level of its own, so
+ * `1 + 2 + ...` is two levels however long; AST_MAX_HEIGHT bounds it.
+ */
+#define AST_MAX_DEPTH 1024
+
+/**
+ * Most nodes on any path down one expression, left operands included. Every
+ * pass over the tree recurses, so longer chains are rejected with an error
+ * rather than left to overflow the native stack.
+ */
+#define AST_MAX_HEIGHT 8192
 
 /**
  * @brief Enum representing the category of an AST node.
@@ -30,7 +47,9 @@ typedef enum {
     DATA_TYPE_FLOAT,  /**< Float data type */
     DATA_TYPE_BOOL,   /**< Boolean data type */
     DATA_TYPE_STRING, /**< String data type */
-    DATA_TYPE_VOID    /**< Void data type */
+    DATA_TYPE_VOID,   /**< Void data type */
+    DATA_TYPE_INT_ARRAY,    /**< int[] */
+    DATA_TYPE_FLOAT_ARRAY   /**< float[] */
 } data_type_t;
 
 /**
@@ -46,13 +65,12 @@ char *data_type_to_string(data_type_t type);
 /**
  * struct AST_NODE_STRUCT {
  *     ast_node_category_t type;
+ *     uint32_t offset;
  *     union {
  *         ast_expr_node_t expr_node;
  *         ast_stmt_node_t stmt_node;
  *         ast_decl_node_t decl_node;
  *     } data;
- *     size_t line;
- *     size_t column;
  * };
  */
 typedef struct AST_NODE_STRUCT ast_node_t;
@@ -61,20 +79,20 @@ typedef struct AST_NODE_STRUCT ast_node_t;
 /**
  * struct ast_expr_node_struct {
  *     expr_type_t type;
+ *     uint32_t offset;
  *     union {
  *         expr_literal_int_t literal_int;
  *         expr_literal_float_t literal_float;
  *         expr_literal_string_t literal_string;
+ *         expr_literal_bool_t literal_bool;
  *         expr_identifier_t identifier;
  *         expr_binary_t binary;
  *         expr_unary_t unary;
  *         expr_assignment_t assignment;
  *         expr_call_t call;
  *         expr_arg_list_t arg_list;
+ *         expr_index_t index;
  *     } data;
- * 
- *     size_t line;
- *     size_t column;
  * };
  */
 typedef struct ast_expr_node_struct ast_expr_node_t;
@@ -82,6 +100,7 @@ typedef struct ast_expr_node_struct ast_expr_node_t;
 /**
  * struct ast_stmt_node_struct {
  *     stmt_type_t type;
+ *     uint32_t offset;
  *     union {
  *         stmt_var_decl_t var_decl;
  *         stmt_assign_t assign;
@@ -95,9 +114,6 @@ typedef struct ast_expr_node_struct ast_expr_node_t;
  *         stmt_expr_t expr_stmt;
  *         stmt_block_t block_stmt;
  *     } data;
- * 
- *     size_t line;
- *     size_t column;
  * };
  */
 typedef struct ast_stmt_node_struct ast_stmt_node_t;
@@ -105,33 +121,72 @@ typedef struct ast_stmt_node_struct ast_stmt_node_t;
 /**
  * struct ast_decl_node_struct {
  *     decl_type_t type;
+ *     uint32_t offset;
  *     union {
  *         decl_function_t function_decl;
  *     } data;
- * 
- *     size_t line;
- *     size_t column;
  * };
  */
 typedef struct ast_decl_node_struct ast_decl_node_t;
 
+/**
+ * The kinds of node, each as X(KIND, name, "description"). The enums and
+ * the *_type_to_string() functions are generated from these lists, and so
+ * are the per-kind hooks of a visitor pass (see ast_visitor.h), `name`
+ * giving their field names: pre_binary, post_block_stmt and so on.
+ */
+#define AST_DECL_KINDS(X) \
+    X(DECL_FUNCTION,        function_decl,  "function")
+
+#define AST_EXPR_KINDS(X) \
+    X(EXPR_LITERAL_INT,     literal_int,    "literal int") \
+    X(EXPR_LITERAL_FLOAT,   literal_float,  "literal float") \
+    X(EXPR_LITERAL_STRING,  literal_string, "literal string") \
+    X(EXPR_LITERAL_BOOL,    literal_bool,   "literal bool") \
+    X(EXPR_LITERAL_NULL,    literal_null,   "literal null") \
+    X(EXPR_IDENTIFIER,      identifier,     "identifier") \
+    X(EXPR_BINARY,          binary,         "binary") \
+    X(EXPR_UNARY,           unary,          "unary") \
+    X(EXPR_ASSIGNMENT,      assignment,     "assignment") \
+    X(EXPR_ARG_LIST,        arg_list,       "argument list") \
+    X(EXPR_CALL,            call,           "call") \
+    X(EXPR_INDEX,           index,          "index")
+
+#define AST_STMT_KINDS(X) \
+    X(STMT_VAR_DECL,        var_decl,       "variable declaration") \
+    X(STMT_ASSIGN,          assign,         "assignment") \
+    X(STMT_RETURN,          return_stmt,    "return") \
+    X(STMT_PRINT,           print_stmt,     "print") \
+    X(STMT_BREAK,           break_stmt,     "break") \
+    X(STMT_CONTINUE,        continue_stmt,  "continue") \
+    X(STMT_IF,              if_stmt,        "if") \
+    X(STMT_WHILE,           while_stmt,     "while") \
+    X(STMT_FOR,             for_stmt,       "for") \
+    X(STMT_EXPR,            expr_stmt,      "expression") \
+    X(STMT_BLOCK,           block_stmt,     "block")
+
+#define AST_KIND_ENUM(kind, name, description) kind,
+#define AST_KIND_COUNT(kind, name, description) + 1
+
+#define DECL_TYPE_COUNT (0 AST_DECL_KINDS(AST_KIND_COUNT))
+#define EXPR_TYPE_COUNT (0 AST_EXPR_KINDS(AST_KIND_COUNT))
+#define STMT_TYPE_COUNT (0 AST_STMT_KINDS(AST_KIND_COUNT))
+
 //--------------------------------------- Declaration Node --------------------------------------------------------------------------
 typedef enum {
-    DECL_FUNCTION,
+    AST_DECL_KINDS(AST_KIND_ENUM)
 } decl_type_t;
 
 typedef struct param_struct {
     char *name;
     data_type_t type;
-    size_t line;
-    size_t column;
+    uint32_t offset;
 } param_t;
 
 typedef struct param_list_struct {
     param_t *params;
     size_t param_count;
-    size_t line;
-    size_t column;
+    uint32_t offset;
 } param_list_t;
 
 typedef struct decl_function_struct {
@@ -140,43 +195,39 @@ typedef struct decl_function_struct {
     param_list_t *param_list;
     ast_stmt_node_t **body;
     size_t body_count;
+    bool is_async;              /**< `async func`: calls start a task, the body may `await` */
 } decl_function_t;
 
 struct ast_decl_node_struct {
     decl_type_t type;
+    uint32_t offset;            /**< Byte offset in the source, see source_map.h */
     union {
         decl_function_t *function_decl;
     } data;
-    size_t line;
-    size_t column;
 };
 
 //--------------------------------------- Expression Node ---------------------------------------------------------------------------
 
 typedef enum {
-    EXPR_LITERAL_INT,
-    EXPR_LITERAL_FLOAT,
-    EXPR_LITERAL_STRING,
-    EXPR_IDENTIFIER,
-    EXPR_BINARY,
-    EXPR_UNARY,
-    EXPR_ASSIGNMENT,
-    EXPR_ARG_LIST,
-    EXPR_CALL
+    AST_EXPR_KINDS(AST_KIND_ENUM)
 } expr_type_t;
 
 typedef struct expr_literal_int_struct {
-    int value;
+    int64_t value;
 } expr_literal_int_t;
 
 typedef struct expr_literal_float_struct {
-    float value;
+    double value;
 } expr_literal_float_t;
 
 typedef struct expr_literal_string_struct {
     char *value;
 } expr_literal_string_t;
 
+typedef struct expr_literal_bool_struct {
+    bool value;
+} expr_literal_bool_t;
+
 typedef struct expr_identifier_struct {
     char *name;
 } expr_identifier_t;
@@ -207,37 +258,32 @@ typedef struct expr_call_struct {
     expr_arg_list_t *args;
 } expr_call_t;
 
+typedef struct expr_index_struct {
+    ast_expr_node_t *array;
+    ast_expr_node_t *index;
+} expr_index_t;
+
 struct ast_expr_node_struct {
     expr_type_t type;
+    uint32_t offset;            /**< Byte offset in the source, see source_map.h */
     union {
         expr_literal_int_t *literal_int;
         expr_literal_float_t *literal_float;
         expr_literal_string_t *literal_string;
+        expr_literal_bool_t *literal_bool;
         expr_identifier_t *identifier;
         expr_binary_t *binary;
         expr_unary_t *unary;
         expr_assignment_t *assignment;
         expr_call_t *call;
         expr_arg_list_t *arg_list;
+        expr_index_t *index;
     } data;
-
-    size_t line;
-    size_t column;
 };
 
 //--------------------------------------- Statement Node ----------------------------------------------------------------------------
 typedef enum {
-    STMT_VAR_DECL,
-    STMT_ASSIGN,
-    STMT_RETURN,
-    STMT_PRINT,
-    STMT_BREAK,
-    STMT_CONTINUE,
-    STMT_IF,
-    STMT_WHILE,
-    STMT_FOR,
-    STMT_EXPR,
-    STMT_BLOCK
+    AST_STMT_KINDS(AST_KIND_ENUM)
 } stmt_type_t;
 
 typedef struct stmt_var_decl_struct {
@@ -248,7 +294,9 @@ typedef struct stmt_var_decl_struct {
 
 typedef struct stmt_assign_struct {
     char *name;
+    token_type_t operator;      /**< TOKEN_EQ, or a compound operator such as TOKEN_PLUSEQ */
     ast_expr_node_t *value;
+    ast_expr_node_t *index;     /**< Set for `name[index] = value` */
 } stmt_assign_t;
 
 typedef struct stmt_return_struct {
@@ -297,8 +345,7 @@ typedef enum {
 
 typedef struct stmt_for_init_struct {
     for_init_kind_t kind;
-    size_t line;
-    size_t column;
+    uint32_t offset;
     union {
         stmt_var_decl_t *var_decl;
         stmt_assign_t *assign;
@@ -311,6 +358,7 @@ typedef struct stmt_for_struct {
     ast_expr_node_t *condition;
     stmt_assign_t *increment;
     ast_stmt_node_t *block;
+    bool parallel;              /**< `parallel for`: iterations may run concurrently */
 } stmt_for_t;
 
 typedef struct stmt_block_struct {
@@ -320,6 +368,7 @@ typedef struct stmt_block_struct {
 
 struct ast_stmt_node_struct {
     stmt_type_t type;
+    uint32_t offset;            /**< Byte offset in the source, see source_map.h */
     union {
         stmt_var_decl_t *var_decl;
         stmt_assign_t *assign;
@@ -333,34 +382,34 @@ struct ast_stmt_node_struct {
         stmt_expr_t *expr_stmt;
         stmt_block_t *block_stmt;
     } data;
-
-    size_t line;
-    size_t column;
 };
 
 //--------------------------------------- AST Node ----------------------------------------------------------------------------------
 struct AST_NODE_STRUCT {
     ast_node_category_t type;
+    uint32_t offset;            /**< Byte offset in the source, see source_map.h */
     union {
         ast_expr_node_t *expr_node;
         ast_stmt_node_t *stmt_node;
         ast_decl_node_t *decl_node;
     } data;
-
-    size_t line;
-    size_t column;
 };
 
 typedef struct AST_STRUCT {
     ast_node_t **nodes;
     size_t node_count;
     size_t nodes_capacity;
+    source_map_t *source_map;   /**< Turns node offsets into lines and columns; a reference the tree holds */
 } ast_t;
 //--------------------------------------- Function Prototypes -----------------------------------------------------------------------
 
 void free_ast(ast_t *ast);
 ast_t *init_ast(void);
 
+char *expr_type_to_string(expr_type_t type);
+char *stmt_type_to_string(stmt_type_t type);
+char *decl_type_to_string(decl_type_t type);
+
 // Forward declarations done above
 // typedef struct AST_NODE_STRUCT ast_node_t;
 // typedef struct ast_expr_node_struct ast_expr_node_t;
@@ -368,45 +417,54 @@ ast_t *init_ast(void);
 // typedef struct ast_decl_node_struct ast_decl_node_t;
 
 //--------------------------------------- AST Node Initializers ---------------------------------------------------------------------
-ast_node_t *init_ast_node(ast_node_category_t type, size_t line, size_t column);
+ast_node_t *init_ast_node(ast_node_category_t type, uint32_t offset);
 
 //-------------------- Expression Node Initializers ---------------------------------------------------------------------------------
-ast_expr_node_t *init_expr_literal_int(int value, size_t line, size_t column);
-ast_expr_node_t *init_expr_literal_float(float value, size_t line, size_t column);
-ast_expr_node_t *init_expr_literal_string(const char * const value, size_t line, size_t column);
-ast_expr_node_t *init_expr_identifier(const char *name, size_t line, size_t column);
-ast_expr_node_t *init_expr_binary(token_type_t operator, ast_expr_node_t *left, ast_expr_node_t *right, size_t line, size_t column);
-ast_expr_node_t *init_expr_unary(token_type_t operator, ast_expr_node_t *operand, size_t line, size_t column);
-ast_expr_node_t *init_expr_assignment(const char *name, ast_expr_node_t *value, size_t line, size_t column);
-ast_expr_node_t *init_expr_call(const char *name, expr_arg_list_t *arg_list, size_t line, size_t column);
-ast_expr_node_t *init_expr_arg_list(ast_expr_node_t **args, size_t arg_count, size_t line, size_t column);
+ast_expr_node_t *init_expr_literal_int(int64_t value, uint32_t offset);
+ast_expr_node_t *init_expr_literal_float(double value, uint32_t offset);
+ast_expr_node_t *init_expr_literal_string(const char * const value, uint32_t offset);
+ast_expr_node_t *init_expr_literal_bool(bool value, uint32_t offset);
+ast_expr_node_t *init_expr_literal_null(uint32_t offset);
+ast_expr_node_t *init_expr_identifier(const char *name, uint32_t offset);
+ast_expr_node_t *init_expr_binary(token_type_t operator, ast_expr_node_t *left, ast_expr_node_t *right, uint32_t offset);
+ast_expr_node_t *init_expr_unary(token_type_t operator, ast_expr_node_t *operand, uint32_t offset);
+ast_expr_node_t *init_expr_assignment(const char *name, ast_expr_node_t *value, uint32_t offset);
+ast_expr_node_t *init_expr_call(const char *name, expr_arg_list_t *arg_list, uint32_t offset);
+ast_expr_node_t *init_expr_arg_list(ast_expr_node_t **args, size_t arg_count, uint32_t offset);
+ast_expr_node_t *init_expr_index(ast_expr_node_t *array, ast_expr_node_t *index, uint32_t offset);
 
 //-------------------- Statement Node Initializers ----------------------------------------------------------------------------------
-ast_stmt_node_t *init_stmt_var_decl(const char *name, data_type_t type, ast_expr_node_t *initializer, size_t line, size_t column);
-ast_stmt_node_t *init_stmt_assign(const char *name, ast_expr_node_t *value, size_t line, size_t column);
-ast_stmt_node_t *init_stmt_return(ast_expr_node_t *value, size_t line, size_t column);
-ast_stmt_node_t *init_stmt_print(expr_arg_list_t *args, size_t line, size_t column);
-ast_stmt_node_t *init_stmt_break(size_t line, size_t column);
-ast_stmt_node_t *init_stmt_continue(size_t line, size_t column);
+ast_stmt_node_t *init_stmt_var_decl(const char *name, data_type_t type, ast_expr_node_t *initializer, uint32_t offset);
+ast_stmt_node_t *init_stmt_assign(const char *name, ast_expr_node_t *value, uint32_t offset);
+ast_stmt_node_t *init_stmt_compound_assign(const char *name, token_type_t operator, ast_expr_node_t *value, uint32_t offset);
+
+/**
+ * @brief Creates `name[index] operator value`.
+ */
+ast_stmt_node_t *init_stmt_index_assign(const char *name, ast_expr_node_t *index, token_type_t operator, ast_expr_node_t *value, uint32_t offset);
+ast_stmt_node_t *init_stmt_return(ast_expr_node_t *value, uint32_t offset);
+ast_stmt_node_t *init_stmt_print(expr_arg_list_t *args, uint32_t offset);
+ast_stmt_node_t *init_stmt_break(uint32_t offset);
+ast_stmt_node_t *init_stmt_continue(uint32_t offset);
 ast_stmt_node_t *init_stmt_if(ast_expr_node_t *if_condition, ast_stmt_node_t *if_block, 
                               ast_expr_node_t **elif_conditions, size_t elif_blocks_count, 
                               ast_stmt_node_t **elif_blocks, ast_stmt_node_t *else_block,
-                              size_t line, size_t column);
-ast_stmt_node_t *init_stmt_while(ast_expr_node_t *condition, ast_stmt_node_t *block, size_t line, size_t column);
+                              uint32_t offset);
+ast_stmt_node_t *init_stmt_while(ast_expr_node_t *condition, ast_stmt_node_t *block, uint32_t offset);
 
-stmt_for_init_t *init_stmt_for_init_var_decl(const char *name, data_type_t type, ast_expr_node_t *expr, size_t line, size_t column);
-stmt_for_init_t *init_stmt_for_init_assign(const char *name, ast_expr_node_t *value, size_t line, size_t column);
-stmt_for_init_t *init_stmt_for_init_expr(ast_expr_node_t *expression, size_t line, size_t column);
-ast_stmt_node_t *init_stmt_for(stmt_for_init_t *init, ast_expr_node_t *condition, stmt_assign_t *increment, ast_stmt_node_t *block, size_t line, size_t column);
+stmt_for_init_t *init_stmt_for_init_var_decl(const char *name, data_type_t type, ast_expr_node_t *expr, uint32_t offset);
+stmt_for_init_t *init_stmt_for_init_assign(const char *name, ast_expr_node_t *value, uint32_t offset);
+stmt_for_init_t *init_stmt_for_init_expr(ast_expr_node_t *expression, uint32_t offset);
+ast_stmt_node_t *init_stmt_for(stmt_for_init_t *init, ast_expr_node_t *condition, stmt_assign_t *increment, ast_stmt_node_t *block, uint32_t offset);
 
-ast_stmt_node_t *init_stmt_expr(ast_expr_node_t *expression, size_t line, size_t column);
-ast_stmt_node_t *init_stmt_block(ast_stmt_node_t **statements, size_t statement_count, size_t line, size_t column);
+ast_stmt_node_t *init_stmt_expr(ast_expr_node_t *expression, uint32_t offset);
+ast_stmt_node_t *init_stmt_block(ast_stmt_node_t **statements, size_t statement_count, uint32_t offset);
 
 //-------------------- Declaration Node Initializers --------------------------------------------------------------------------------
-param_t *init_decl_param(const char *name, data_type_t type, size_t line, size_t column);
-param_list_t *init_decl_param_list(param_t *params, size_t param_count, size_t line, size_t column);
+param_t *init_decl_param(const char *name, data_type_t type, uint32_t offset);
+param_list_t *init_decl_param_list(param_t *params, size_t param_count, uint32_t offset);
 ast_decl_node_t *init_decl_function(const char *name, data_type_t return_type, param_list_t *params, 
-                            ast_stmt_node_t **body, size_t body_count, size_t line, size_t column);
+                            ast_stmt_node_t **body, size_t body_count, uint32_t offset);
 
 
 //-------------------- Free Functions -----------------------------------------------------------------------------------------------
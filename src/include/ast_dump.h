@@ -0,0 +1,47 @@
+/**
+ * File Name: ast_dump.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Dumps a parsed tree for --dump-ast. The text and JSON forms are formatted
+ * into one growing buffer, numbers by hand, and written with a single
+ * write() at the end; the binary form is the AST cache format of
+ * ast_serialize.h. The text form is exactly what print_ast() prints.
+ */
+#ifndef AST_DUMP_H
+#define AST_DUMP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ast.h"
+
+typedef enum {
+    AST_DUMP_TEXT,      /**< The indented listing of print_ast() */
+    AST_DUMP_JSON,      /**< One object per node, without whitespace */
+    AST_DUMP_BIN        /**< An AST file, see ast_serialize.h */
+} ast_dump_format_t;
+
+/**
+ * @brief Parses "text", "json" or "bin".
+ *
+ * @return false if `name` is none of them.
+ */
+bool ast_dump_format_from_string(const char *name, ast_dump_format_t *format);
+
+/**
+ * @brief Formats the tree as text or JSON into a buffer.
+ *
+ * @param length Set to the length of the result, which is also NUL terminated.
+ * @return The buffer, to be released with free(), or NULL for AST_DUMP_BIN.
+ */
+char *ast_dump_to_string(const ast_t *ast, ast_dump_format_t format, size_t *length);
+
+/**
+ * @brief Writes the tree in `format` to the file descriptor.
+ *
+ * @return true on success, false on I/O error.
+ */
+bool ast_dump(const ast_t *ast, ast_dump_format_t format, int fd);
+
+#endif // AST_DUMP_H
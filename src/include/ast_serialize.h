@@ -0,0 +1,152 @@
+/**
+ * File Name: ast_serialize.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#ifndef AST_SERIALIZE_H
+#define AST_SERIALIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ast.h"
+
+/**
+ * Binary AST file layout (all integers little endian, offsets from file start):
+ *
+ *   ast_file_header_t
+ *   string table    : NUL terminated strings, referenced by byte offset
+ *   node table      : ast_record_t[node_count], pre-order walk of the tree
+ *   position table  : the source offset of each record, in node table order, as
+ *                     the zigzag LEB128 varint of its difference from the one
+ *                     before (starting from 0); mostly one byte a record
+ *
+ * Bump AST_FILE_VERSION whenever a record layout or record kind changes,
+ * stale files (and cache entries) are then rejected instead of misread.
+ */
+#define AST_FILE_MAGIC "JFFA"
+#define AST_FILE_VERSION 7u
+#define AST_CACHE_EXTENSION ".jffast"
+
+typedef enum {
+    AST_RECORD_NONE,            /**< Placeholder for an optional child that is NULL */
+
+    AST_RECORD_NODE_EXPR,       /**< Top level ast_node_t wrappers */
+    AST_RECORD_NODE_STMT,
+    AST_RECORD_NODE_DECL,
+
+    AST_RECORD_EXPR_LITERAL_INT,
+    AST_RECORD_EXPR_LITERAL_FLOAT,
+    AST_RECORD_EXPR_LITERAL_STRING,
+    AST_RECORD_EXPR_LITERAL_BOOL,
+    AST_RECORD_EXPR_LITERAL_NULL,
+    AST_RECORD_EXPR_IDENTIFIER,
+    AST_RECORD_EXPR_BINARY,
+    AST_RECORD_EXPR_UNARY,
+    AST_RECORD_EXPR_ASSIGNMENT,
+    AST_RECORD_EXPR_ARG_LIST,
+    AST_RECORD_EXPR_CALL,
+    AST_RECORD_EXPR_INDEX,      /**< Followed by the array and the index expression */
+
+    AST_RECORD_STMT_VAR_DECL,
+    AST_RECORD_STMT_ASSIGN,     /**< value = name, op = assignment operator, followed by the index (or none) and the value */
+    AST_RECORD_STMT_RETURN,
+    AST_RECORD_STMT_PRINT,
+    AST_RECORD_STMT_BREAK,
+    AST_RECORD_STMT_CONTINUE,
+    AST_RECORD_STMT_IF,
+    AST_RECORD_STMT_WHILE,
+    AST_RECORD_STMT_FOR,        /**< op = 1 for `parallel for` */
+    AST_RECORD_STMT_EXPR,
+    AST_RECORD_STMT_BLOCK,
+
+    AST_RECORD_FOR_INIT,        /**< op = for_init_kind_t, value = name, count = data_type_t */
+    AST_RECORD_FOR_INCREMENT,   /**< value = name, op = assignment operator, followed by the value expression */
+
+    AST_RECORD_DECL_FUNCTION,   /**< value = name, op = return type, count = body_count, flags = AST_RECORD_FLAG_ASYNC */
+    AST_RECORD_PARAM_LIST,      /**< count = param_count */
+    AST_RECORD_PARAM            /**< value = name, op = type */
+} ast_record_kind_t;
+
+typedef struct ast_file_header_struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_hash;
+    uint32_t string_table_offset;
+    uint32_t string_table_size;
+    uint32_t node_table_offset;
+    uint32_t node_count;
+    uint32_t position_table_offset;
+    uint32_t position_table_size;
+    uint32_t root_count;
+} ast_file_header_t;
+
+#define AST_RECORD_FLAG_ASYNC 0x1u  /**< DECL_FUNCTION of an `async func` */
+#define AST_POSITION_MAX_BYTES 5    /**< Longest varint of the position table, a 33 bit zigzag */
+
+/**
+ * @brief One node of the flattened tree.
+ *
+ * `value` holds a string table offset, or the low 32 bits of an int64_t or
+ * double literal, whose high 32 bits are in `count`.
+ * `op` holds an operator token, a data type or a for-init kind depending on `kind`.
+ * `count` holds the number of variable-length children that follow the record.
+ */
+typedef struct ast_record_struct {
+    uint8_t kind;
+    uint8_t op;
+    uint16_t flags;             /**< AST_RECORD_FLAG_* */
+    uint32_t value;
+    uint32_t count;
+} ast_record_t;
+
+/**
+ * @brief Writes the AST to `path` in the binary format described above.
+ *
+ * @param ast The tree to write.
+ * @param source_hash Hash of the source the tree was parsed from (0 if unknown).
+ * @param path Destination file, replaced atomically.
+ * @return true on success, false on I/O error.
+ */
+bool ast_serialize(const ast_t *ast, uint64_t source_hash, const char *path);
+
+/**
+ * @brief Writes the AST in the same format to an open file descriptor, such
+ * as stdout for --dump-ast=bin.
+ *
+ * @return true on success, false on I/O error.
+ */
+bool ast_serialize_fd(const ast_t *ast, uint64_t source_hash, int fd);
+
+/**
+ * @brief Maps a binary AST file and rebuilds the tree from it.
+ *
+ * @param path File written by ast_serialize().
+ * @param expected_hash If non-zero, the file is rejected unless its source hash matches.
+ * @return A freshly allocated tree (release with free_ast()), or NULL if the
+ *         file is missing, truncated, of another version or does not match.
+ *         The file holds no text, so the tree has no source map to turn its
+ *         offsets into lines until the caller attaches one.
+ */
+ast_t *ast_deserialize(const char *path, uint64_t expected_hash);
+
+/**
+ * @brief 64-bit FNV-1a hash of a source buffer, salted with AST_FILE_VERSION.
+ */
+uint64_t ast_source_hash(const char *source, size_t length);
+
+/**
+ * @brief Looks up `source_path` in `cache_dir` by content hash.
+ *
+ * @return The cached tree, with a source map over the text just read, or
+ *         NULL on a cache miss.
+ */
+ast_t *ast_cache_load(const char *cache_dir, const char *source_path);
+
+/**
+ * @brief Stores the tree parsed from `source_path` into `cache_dir`, creating the directory if needed.
+ */
+bool ast_cache_store(const char *cache_dir, const char *source_path, const ast_t *ast);
+
+#endif // AST_SERIALIZE_H
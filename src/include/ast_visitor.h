@@ -0,0 +1,117 @@
+/**
+ * File Name: ast_visitor.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Runs several passes over a tree in one walk. A pass is a set of hooks
+ * called before (pre_) and after (post_) the children of a node, one pair
+ * per kind of node, generated from the kind lists in ast.h, plus a pair
+ * for every expression, statement and declaration. Adding passes to a
+ * visitor and walking once touches each node a single time and calls the
+ * hooks of all the passes on it while it is still in cache.
+ */
+#ifndef AST_VISITOR_H
+#define AST_VISITOR_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "ast.h"
+
+#define AST_VISITOR_MAX_PASSES 16   /**< Passes one visitor runs together */
+
+typedef void (*ast_expr_hook_t)(ast_expr_node_t *expr, void *context);
+typedef void (*ast_stmt_hook_t)(ast_stmt_node_t *stmt, void *context);
+typedef void (*ast_decl_hook_t)(ast_decl_node_t *decl, void *context);
+
+#define AST_PASS_EXPR_HOOKS(kind, name, description) ast_expr_hook_t pre_##name, post_##name;
+#define AST_PASS_STMT_HOOKS(kind, name, description) ast_stmt_hook_t pre_##name, post_##name;
+#define AST_PASS_DECL_HOOKS(kind, name, description) ast_decl_hook_t pre_##name, post_##name;
+
+/**
+ * @brief One pass over the tree. Hooks left NULL are not called; a node's
+ * generic hook runs before its kind's hook in pre order and after it in
+ * post order.
+ *
+ * Children are visited in source order: a for loop's initializer,
+ * condition and increment come before its block, and each elif condition
+ * before its block. The operands of an if, for or while are not wrapped in
+ * a statement, so they get only their expression hooks.
+ */
+typedef struct ast_pass_struct {
+    const char *name;
+    void *context;              /**< Passed to every hook */
+
+    ast_expr_hook_t pre_expr, post_expr;
+    ast_stmt_hook_t pre_stmt, post_stmt;
+    ast_decl_hook_t pre_decl, post_decl;
+
+    AST_EXPR_KINDS(AST_PASS_EXPR_HOOKS)
+    AST_STMT_KINDS(AST_PASS_STMT_HOOKS)
+    AST_DECL_KINDS(AST_PASS_DECL_HOOKS)
+} ast_pass_t;
+
+#undef AST_PASS_EXPR_HOOKS
+#undef AST_PASS_STMT_HOOKS
+#undef AST_PASS_DECL_HOOKS
+
+typedef struct ast_expr_hook_entry_struct {
+    ast_expr_hook_t hook;
+    void *context;
+} ast_expr_hook_entry_t;
+
+typedef struct ast_stmt_hook_entry_struct {
+    ast_stmt_hook_t hook;
+    void *context;
+} ast_stmt_hook_entry_t;
+
+typedef struct ast_decl_hook_entry_struct {
+    ast_decl_hook_t hook;
+    void *context;
+} ast_decl_hook_entry_t;
+
+/**
+ * @brief The hooks of all the passes added, flattened per kind of node so
+ * the walk calls only those that are set, in the order the passes were
+ * added.
+ */
+typedef struct ast_visitor_struct {
+    size_t pass_count;
+
+    ast_expr_hook_entry_t pre_expr[EXPR_TYPE_COUNT][2 * AST_VISITOR_MAX_PASSES];
+    ast_expr_hook_entry_t post_expr[EXPR_TYPE_COUNT][2 * AST_VISITOR_MAX_PASSES];
+    unsigned char pre_expr_count[EXPR_TYPE_COUNT];
+    unsigned char post_expr_count[EXPR_TYPE_COUNT];
+
+    ast_stmt_hook_entry_t pre_stmt[STMT_TYPE_COUNT][2 * AST_VISITOR_MAX_PASSES];
+    ast_stmt_hook_entry_t post_stmt[STMT_TYPE_COUNT][2 * AST_VISITOR_MAX_PASSES];
+    unsigned char pre_stmt_count[STMT_TYPE_COUNT];
+    unsigned char post_stmt_count[STMT_TYPE_COUNT];
+
+    ast_decl_hook_entry_t pre_decl[DECL_TYPE_COUNT][2 * AST_VISITOR_MAX_PASSES];
+    ast_decl_hook_entry_t post_decl[DECL_TYPE_COUNT][2 * AST_VISITOR_MAX_PASSES];
+    unsigned char pre_decl_count[DECL_TYPE_COUNT];
+    unsigned char post_decl_count[DECL_TYPE_COUNT];
+} ast_visitor_t;
+
+ast_visitor_t *init_ast_visitor(void);
+void free_ast_visitor(ast_visitor_t *visitor);
+
+/**
+ * @brief Adds a pass to run in the visitor's walks. The pass is copied.
+ *
+ * @return false if the visitor already runs AST_VISITOR_MAX_PASSES passes.
+ */
+bool ast_visitor_add_pass(ast_visitor_t *visitor, const ast_pass_t *pass);
+
+/**
+ * @brief Walks every top level node of the tree once, calling the hooks of
+ * all the passes added.
+ */
+void ast_visitor_walk(const ast_visitor_t *visitor, ast_t *ast);
+
+void ast_visitor_walk_expr(const ast_visitor_t *visitor, ast_expr_node_t *expr);
+void ast_visitor_walk_stmt(const ast_visitor_t *visitor, ast_stmt_node_t *stmt);
+void ast_visitor_walk_decl(const ast_visitor_t *visitor, ast_decl_node_t *decl);
+
+#endif // AST_VISITOR_H
@@ -0,0 +1,73 @@
+/**
+ * File Name: compiler.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ast.h"
+#include "image.h"
+
+#define COMPILER_DEFAULT_INLINE_THRESHOLD 32
+
+/**
+ * @brief Compiles a parsed program into a bytecode image.
+ *
+ * Top level variable declarations become globals initialized by a generated
+ * `<init>` function; `main`, if present, is recorded as the entry point.
+ * Errors are reported on stderr as `[line:column] Error: ...`.
+ *
+ * @param ast The program to compile.
+ * @return The image (release with free_image()), or NULL if compilation failed.
+ */
+image_t *compile_program(const ast_t *ast);
+
+/**
+ * @brief Sets the largest function body, in AST nodes, that is compiled in
+ * place of a call made inside a loop. Calls outside loops take bodies a
+ * quarter of that size. Recursive and async functions are never inlined.
+ *
+ * @param threshold The size limit; 0 turns inlining off.
+ */
+void compiler_set_inline_threshold(size_t threshold);
+
+/**
+ * @brief Reports each call to a declared function, inlined or not and why,
+ * as one line on `out`. NULL, the default, reports nothing.
+ */
+void compiler_set_inline_report(FILE *out);
+
+/**
+ * @brief Turns loop invariant code motion on or off; it is on by default.
+ * Pure expressions a loop computes the same way on every iteration are
+ * computed once before it.
+ */
+void compiler_set_hoisting(bool enabled);
+
+/**
+ * @brief Turns the counted for loop optimizations on or off; they are on by
+ * default. Loops of a few iterations known at compile time are unrolled, and
+ * a loop that uses its counter only as `i * K` counts in steps of K instead.
+ */
+void compiler_set_counted_loops(bool enabled);
+
+/**
+ * @brief Turns typed opcodes on or off; they are on by default. Arithmetic
+ * and comparisons whose operands are proven ints or floats use forms of
+ * their opcodes that skip the runtime type dispatch.
+ */
+void compiler_set_typed_opcodes(bool enabled);
+
+/**
+ * @brief Turns superinstructions on or off; they are on by default. The
+ * sequences listed in superinstructions.h are fused where they appear in
+ * the code, so the VM dispatches once for the whole sequence.
+ */
+void compiler_set_superinstructions(bool enabled);
+
+#endif // COMPILER_H
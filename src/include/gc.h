@@ -0,0 +1,178 @@
+/**
+ * File Name: gc.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Generational garbage collector for the objects a program creates at run
+ * time: strings, arrays, ints too wide for a value's payload and tasks. New string and array headers are bump
+ * allocated in a fixed size nursery. A minor
+ * collection copies the nursery objects still reachable into the old
+ * generation and frees the rest in one go; a major collection marks from
+ * the roots and sweeps the old generation and the finished tasks.
+ *
+ * Collections only start at safepoints of the VM, between instructions,
+ * where every live value is on the VM stack, in a global or in a task frame.
+ * Ropes refer to strings created before them, so only task frames can
+ * point from old objects to young ones; the VM records every frame it
+ * writes in a remembered set, so a minor collection scans those frames
+ * instead of every task.
+ */
+#ifndef GC_H
+#define GC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "value.h"
+
+#define GC_DEFAULT_NURSERY_SIZE ((size_t)1 << 20)
+#define GC_MIN_OLD_LIMIT        ((size_t)8 << 20)   /**< Old generation size that starts the first major collection */
+#define GC_OLD_GROWTH           2                   /**< The next major collection starts at live bytes * this */
+#define GC_PAUSE_BUCKETS        32                  /**< Bucket i counts pauses under 2^i microseconds */
+
+typedef enum {
+    GC_STRING,
+    GC_ARRAY,
+    GC_BOXED_INT
+} gc_kind_t;
+
+typedef enum {
+    GC_FLAG_OLD = 1,
+    GC_FLAG_MARKED = 2,
+    GC_FLAG_FORWARDED = 4,  /**< Copied out of the nursery; `next` is the new address */
+    GC_FLAG_CONSTANT = 8    /**< Not in any heap, e.g. a string of the image */
+} gc_flag_t;
+
+typedef struct gc_object_struct {
+    uint8_t kind;                       /**< gc_kind_t */
+    uint8_t flags;                      /**< gc_flag_t bits */
+    struct gc_object_struct *next;      /**< Next in the old generation, or the forwarding address */
+} gc_object_t;
+
+/**
+ * @brief An int outside the 48 bits a value holds inline, see value.h.
+ */
+typedef struct boxed_int_struct {
+    gc_object_t object;
+    int64_t value;
+} boxed_int_t;
+
+typedef struct gc_pauses_struct {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[GC_PAUSE_BUCKETS];
+} gc_pauses_t;
+
+typedef struct gc_stats_struct {
+    gc_pauses_t minor;
+    gc_pauses_t major;
+    uint64_t allocated_bytes;           /**< Everything ever allocated, array elements included */
+    uint64_t promoted_bytes;            /**< Copied from the nursery into the old generation */
+    uint64_t freed_bytes;
+    size_t peak_old_bytes;
+} gc_stats_t;
+
+typedef struct gc_heap_struct {
+    uint8_t *nursery;                   /**< Allocated on first use */
+    size_t nursery_size;
+    size_t nursery_used;
+    size_t nursery_external;            /**< Array elements owned by nursery objects */
+
+    gc_object_t *old;
+    size_t old_bytes;                   /**< Old objects, their array elements and every task */
+    size_t old_limit;                   /**< A major collection starts when old_bytes passes this */
+    size_t max_heap;                    /**< 0 for no limit */
+
+    bool worker;                        /**< Belongs to a parallel for worker; other heaps' objects are shared */
+    bool minor_pending;
+    bool major_pending;
+    gc_stats_t stats;
+} gc_heap_t;
+
+struct VM_STRUCT;
+
+void init_gc_heap(gc_heap_t *heap);
+
+/**
+ * @brief Frees every object still in the heap; tasks belong to the event loop.
+ */
+void free_gc_heap(gc_heap_t *heap);
+
+/**
+ * @brief Sets the nursery size and the heap limit (0 for none). Only takes
+ * effect before the first allocation.
+ */
+void gc_set_limits(gc_heap_t *heap, size_t nursery_size, size_t max_heap);
+
+/**
+ * @brief Allocates an object of `size` bytes whose header is set up and
+ * whose body is not. Never collects; a full nursery only schedules a
+ * collection.
+ *
+ * @param external Bytes the object owns outside the heap, e.g. array elements.
+ */
+gc_object_t *gc_allocate(gc_heap_t *heap, gc_kind_t kind, size_t size, size_t external);
+
+/**
+ * @brief Allocates a zero filled array, see gc_allocate().
+ */
+struct array_struct *gc_new_array(gc_heap_t *heap, value_type_t element_type, size_t length);
+
+/**
+ * @brief Boxes an int that does not fit in 48 bits, see gc_allocate().
+ */
+value_t gc_box_int(gc_heap_t *heap, int64_t integer);
+
+/**
+ * @brief The value of any int, boxed in `heap` if it needs more than 48 bits.
+ */
+static inline value_t gc_int_value(gc_heap_t *heap, int64_t integer) {
+    return INT_FITS_SMALL(integer) ? SMALL_INT_VALUE(integer) : gc_box_int(heap, integer);
+}
+
+/**
+ * @brief Counts `bytes` an object took on outside the heap after it was allocated.
+ */
+void gc_note_external(gc_heap_t *heap, const gc_object_t *object, size_t bytes);
+
+bool gc_in_nursery(const gc_heap_t *heap, const gc_object_t *object);
+
+/**
+ * @brief Counts memory allocated outside the heap that a major collection
+ * may free, i.e. tasks and their frames.
+ */
+void gc_note_allocation(gc_heap_t *heap, size_t bytes);
+
+/** True when gc_collect() has work to do. */
+#define GC_PENDING(heap)    ((heap)->minor_pending || (heap)->major_pending)
+
+/**
+ * @brief Runs the pending collections. Only call at a safepoint, with
+ * vm->stack_top covering every live stack slot. Worker VMs of a parallel
+ * for only ever collect their nursery.
+ *
+ * @return false if the live heap exceeds the limit even after a full collection.
+ */
+bool gc_collect(struct VM_STRUCT *vm);
+
+/**
+ * @brief Frees every object at once; for worker VMs between chunks, when
+ * nothing can refer to them any more.
+ */
+void gc_reset(gc_heap_t *heap);
+
+/**
+ * @brief Upper bound in microseconds of the pause at `fraction` (e.g. 0.99)
+ * of the histogram, 0 when there were no pauses.
+ */
+uint64_t gc_pause_percentile(const gc_pauses_t *pauses, double fraction);
+
+/**
+ * @brief Prints the collection counts, pause percentiles and histograms.
+ */
+void gc_report(FILE *out, const gc_heap_t *heap);
+
+#endif // GC_H
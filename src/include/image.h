@@ -0,0 +1,150 @@
+/**
+ * File Name: image.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Bytecode image layout (little endian, every offset relative to the image start):
+ *
+ *   image_header_t
+ *   function table  : image_function_t[function_count]
+ *   constant pool   : image_constant_t[constant_count]
+ *   global table    : image_global_t[global_count]     (symbol table of globals)
+ *   line table      : image_line_t[line_count]         (pc -> source position)
+ *   code            : bytecode of every function, back to back
+ *   string table    : NUL terminated names and string constants
+ *
+ * The image holds no pointers, so the VM executes it in place, whether it was
+ * produced by the compiler in memory or mapped from a file.
+ */
+#define IMAGE_MAGIC "JFFI"
+#define IMAGE_VERSION 7u
+
+#define IMAGE_FUNCTION_ASYNC 0x1u  /**< Entered through OP_SPAWN only; may contain OP_AWAIT */
+#define IMAGE_NO_FUNCTION UINT32_MAX
+
+typedef struct image_header_struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t image_size;
+    uint32_t function_count;
+    uint32_t function_table_offset;
+    uint32_t constant_count;
+    uint32_t constant_table_offset;
+    uint32_t global_count;
+    uint32_t global_table_offset;
+    uint32_t line_count;
+    uint32_t line_table_offset;
+    uint32_t code_size;
+    uint32_t code_offset;
+    uint32_t string_table_size;
+    uint32_t string_table_offset;
+    uint32_t entry_function;    /**< `main`, or IMAGE_NO_FUNCTION */
+    uint32_t init_function;     /**< Initializer of the global variables */
+} image_header_t;
+
+typedef struct image_function_struct {
+    uint32_t name;              /**< String table offset */
+    uint32_t code_offset;       /**< Relative to the code section */
+    uint32_t code_size;
+    uint32_t line_offset;       /**< First entry of this function in the line table */
+    uint32_t line_count;
+    uint16_t param_count;
+    uint16_t local_count;       /**< Including parameters */
+    uint16_t max_stack;         /**< Operand stack slots needed above the locals */
+    uint8_t return_type;        /**< data_type_t */
+    uint8_t flags;              /**< IMAGE_FUNCTION_* */
+    uint8_t reduction_count;    /**< Of a parallel for worker: the partials its OP_REDUCEs fill */
+    uint8_t reserved[3];
+    uint32_t line;
+    uint32_t column;
+} image_function_t;
+
+typedef enum {
+    IMAGE_CONST_INT,
+    IMAGE_CONST_FLOAT,
+    IMAGE_CONST_STRING
+} image_constant_kind_t;
+
+typedef struct image_constant_struct {
+    uint32_t kind;              /**< image_constant_kind_t */
+    uint32_t length;            /**< String length in bytes */
+    uint64_t payload;           /**< int64 bits, double bits or string table offset */
+} image_constant_t;
+
+typedef struct image_global_struct {
+    uint32_t name;
+    uint32_t type;              /**< data_type_t */
+} image_global_t;
+
+typedef struct image_line_struct {
+    uint32_t pc;                /**< Offset inside the function's code */
+    uint32_t line;
+    uint32_t column;
+} image_line_t;
+
+/**
+ * @brief A validated image, either owned in memory or mapped from disk.
+ */
+typedef struct IMAGE_STRUCT {
+    const uint8_t *base;
+    size_t size;
+    bool mapped;
+
+    const image_header_t *header;
+    const image_function_t *functions;
+    const image_constant_t *constants;
+    const image_global_t *globals;
+    const image_line_t *lines;
+    const uint8_t *code;
+    const char *strings;
+} image_t;
+
+/**
+ * @brief Wraps a malloc'ed buffer holding an image; the image takes ownership.
+ *
+ * @return The image, or NULL (buffer freed) if the buffer is not a valid image.
+ */
+image_t *image_from_buffer(uint8_t *buffer, size_t size);
+
+/**
+ * @brief Maps an image file read-only. Nothing is parsed or copied.
+ *
+ * @return The image, or NULL if the file cannot be mapped or is not a valid image.
+ */
+image_t *image_map_file(const char *path);
+
+/**
+ * @brief Writes the image bytes to `path`.
+ */
+bool image_write_file(const image_t *image, const char *path);
+
+void free_image(image_t *image);
+
+const char *image_string(const image_t *image, uint32_t offset);
+
+/**
+ * @brief Finds a function by name.
+ *
+ * @return Its index, or IMAGE_NO_FUNCTION.
+ */
+uint32_t image_find_function(const image_t *image, const char *name);
+
+/**
+ * @brief Maps a pc inside `function` back to the source position it was compiled from.
+ */
+bool image_position_for_pc(const image_t *image, uint32_t function, uint32_t pc, uint32_t *line, uint32_t *column);
+
+/**
+ * @brief Prints a human readable listing of every function in the image.
+ */
+void image_disassemble(const image_t *image);
+
+#endif // IMAGE_H
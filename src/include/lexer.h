@@ -13,6 +13,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "source_map.h"
+
 typedef enum {
     LEXER_SUCCESS = 0,
     LEXER_ERROR = -1,
@@ -24,12 +26,15 @@ typedef enum {
     TOKEN_KEYWORD,
     // keywords
     TOKEN_FUNC,
+    TOKEN_ASYNC,
+    TOKEN_AWAIT,
     TOKEN_IF,
     TOKEN_ELIF,
     TOKEN_ELSE,
     TOKEN_RETURN,
     TOKEN_PRINT,
     TOKEN_FOR,
+    TOKEN_PARALLEL,
     TOKEN_WHILE,
     TOKEN_BREAK,
     TOKEN_CONTINUE,
@@ -79,6 +84,8 @@ typedef enum {
     TOKEN_RPAREN,
     TOKEN_LBRACE,
     TOKEN_RBRACE,
+    TOKEN_LBRACKET,
+    TOKEN_RBRACKET,
     TOKEN_SEMICOLON,
     TOKEN_COLON,
     TOKEN_COMMA,
@@ -90,13 +97,16 @@ typedef enum {
 
 typedef struct TOKEN_STRUCT {
     token_type_t type;
+    uint32_t offset;            /**< Of the first character, see source_map.h */
     char *value;
     size_t length;
-    size_t line;
-    size_t column;
+    union {
+        int64_t int_value;      /**< Of a TOKEN_LITERAL_INT */
+        double float_value;     /**< Of a TOKEN_LITERAL_FLOAT */
+    } number;                   /**< Converted once by the lexer, see number.h */
 } token_t;
 
-token_t *init_token(token_type_t type, const char *value, size_t length, size_t line, size_t column);
+token_t *init_token(token_type_t type, const char *value, size_t length, uint32_t offset);
 void free_token(token_t *token);
 void print_token(token_t *token);
 void print_token_type(token_type_t type);
@@ -107,13 +117,13 @@ char *token_type_to_string(token_type_t type);
 typedef struct LEXER_STRUCT {
     char *filename;
     char *input;
+    size_t input_length;
     size_t position;
     size_t read_position;
     char current_char;
     lexer_status_t status;
 
-    size_t line;
-    size_t column;
+    source_map_t *source;       /**< Owns `input`; finds the line and column of a token's offset */
 
     token_t current_token;
 
@@ -123,6 +133,16 @@ typedef struct LEXER_STRUCT {
 } lexer_t;
 
 lexer_t *init_lexer(const char *filename);
+
+/**
+ * @brief Creates a lexer over an in-memory copy of `source`.
+ *
+ * @param name Name used in place of a file name.
+ * @param source The program text; it need not be NUL terminated.
+ * @param length Number of bytes in `source`, at most SOURCE_MAX_LENGTH.
+ * @return The lexer, or NULL if `source` is too long.
+ */
+lexer_t *init_lexer_from_source(const char *name, const char *source, size_t length);
 void free_lexer(lexer_t *lexer);
 
 token_t *lexer_next_token(lexer_t *lexer);
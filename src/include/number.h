@@ -0,0 +1,59 @@
+/**
+ * File Name: number.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Scans and converts numeric literals for the lexer:
+ *
+ *   123  1_000_000  0x7fff_ffff  0b1010          int, 64 bits
+ *   1.5  6.02e23  1e-9  2.5E+3  1_000.000_001   float, a double
+ *
+ * `_` may separate two digits anywhere in a literal. An int literal must not
+ * exceed INT64_MAX (a leading `-` is a separate operator), and a float
+ * literal must not round to infinity.
+ *
+ * Floats are converted exactly, i.e. to the nearest double. Up to 19
+ * significant digits with an exponent within +-22 are multiplied or divided
+ * in double precision, which is exact there (Clinger's fast path). Anything
+ * else goes through the Eisel-Lemire algorithm: a single 64 by 128 bit
+ * multiplication against a table of powers of ten, which settles all but a
+ * vanishingly small share of literals; those few go to strtod().
+ */
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    NUMBER_OK,
+    NUMBER_MISSING_DIGITS,      /**< `0x`, `0b` or an exponent without digits */
+    NUMBER_BAD_SEPARATOR,       /**< `_` not between two digits */
+    NUMBER_BAD_DIGIT,           /**< A letter or a digit the base lacks right after the digits */
+    NUMBER_INT_OVERFLOW,        /**< An int literal greater than INT64_MAX */
+    NUMBER_FLOAT_OVERFLOW       /**< A float literal greater than DBL_MAX */
+} number_status_t;
+
+typedef struct number_struct {
+    bool is_float;
+    union {
+        int64_t int_value;
+        double float_value;
+    } value;
+    size_t length;              /**< Characters scanned, separators included */
+} number_t;
+
+/**
+ * @brief Scans the literal at the start of `text` and converts it.
+ *
+ * @param text Starts with a decimal digit.
+ * @param length Characters available in `text`.
+ * @param number Set to the value and length of the literal. On an error the
+ *        length takes in the rest of the malformed literal.
+ */
+number_status_t number_scan(const char *text, size_t length, number_t *number);
+
+const char *number_status_to_string(number_status_t status);
+
+#endif // NUMBER_H
@@ -0,0 +1,150 @@
+/**
+ * File Name: opcode.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#ifndef OPCODE_H
+#define OPCODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PARALLEL_MAX_REDUCTIONS 32  /**< Accumulators one parallel loop may reduce; bits of the multiply mask */
+
+/**
+ * @brief Bytecode instructions.
+ *
+ * Every instruction is one opcode byte followed by its operands, little endian.
+ * Jump targets are absolute offsets from the start of the enclosing function,
+ * so code can be mapped anywhere without relocation.
+ */
+typedef enum {
+    OP_CONST,           // u16 constant index         -> value
+    OP_NULL,            //                            -> null
+    OP_TRUE,            //                            -> true
+    OP_FALSE,           //                            -> false
+    OP_POP,             // value                      ->
+    OP_DUP,             // value                      -> value value
+
+    OP_GET_LOCAL,       // u16 slot                   -> value
+    OP_SET_LOCAL,       // u16 slot, value            ->
+    OP_GET_GLOBAL,      // u16 global index           -> value
+    OP_SET_GLOBAL,      // u16 global index, value    ->
+
+    OP_ADD,             // a b                        -> a + b
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_NEG,             // a                          -> -a
+    OP_NOT,             // a                          -> !a
+
+    OP_EQ,              // a b                        -> bool
+    OP_NEQ,
+    OP_LT,
+    OP_LEQ,
+    OP_GT,
+    OP_GEQ,
+
+    // Typed forms of the above, emitted where the compiler has proven the
+    // operand types, see infer_types(). The float forms never look at a
+    // tag; the int forms only check that both ints fit in a value and
+    // otherwise take the generic path, so wide ints and division by zero
+    // behave as before.
+    OP_ADD_INT,         // int int                    -> int
+    OP_SUB_INT,
+    OP_MUL_INT,
+    OP_DIV_INT,
+    OP_MOD_INT,
+    OP_NEG_INT,         // int                        -> int
+    OP_EQ_INT,          // int int                    -> bool
+    OP_NEQ_INT,
+    OP_LT_INT,
+    OP_LEQ_INT,
+    OP_GT_INT,
+    OP_GEQ_INT,
+    OP_ADD_FLOAT,       // float float                -> float
+    OP_SUB_FLOAT,
+    OP_MUL_FLOAT,
+    OP_DIV_FLOAT,
+    OP_NEG_FLOAT,       // float                      -> float
+    OP_EQ_FLOAT,        // float float                -> bool
+    OP_NEQ_FLOAT,
+    OP_LT_FLOAT,
+    OP_LEQ_FLOAT,
+    OP_GT_FLOAT,
+    OP_GEQ_FLOAT,
+    OP_TO_FLOAT,        // value                      -> the value as a float if it is an int, else unchanged
+
+    OP_JUMP,            // u32 target
+    OP_JUMP_IF_FALSE,   // u32 target, condition      ->
+
+    OP_CALL,            // u16 function, u8 argc, args -> result
+    OP_TAIL_CALL,       // u16 function, u8 argc, args -> (to caller, in place of the running frame)
+    OP_RETURN,          // value                      -> (to caller)
+    OP_PRINT,           // u8 argc, args              ->
+
+    // Runs worker(captured locals..., lo, hi) over chunks of [start, end) on the
+    // thread pool. Bit k of the mask makes reduction k a product instead of a sum.
+    OP_PARALLEL_FOR,    // u16 worker, u32 step, u8 reduction count, u32 multiply mask,
+                        // start end                  -> reduced values
+    OP_REDUCE,          // u8 reduction, value        -> (into the running chunk's partial)
+
+    OP_SPAWN,           // u16 async function, u8 argc, args -> task
+    OP_AWAIT,           // task                       -> result (suspends the running task until then)
+    OP_SLEEP,           // milliseconds               -> task
+    OP_WAIT_FD,         // u8 1 = readable 2 = writable, fd -> task
+
+    OP_NEW_ARRAY,       // u8 element value_type_t, length -> zero filled array
+    OP_INDEX,           // array index                -> element
+    OP_SET_INDEX,       // u8 0 or the OP_ADD..OP_MOD of a compound assignment, array index value ->
+    OP_LEN,             // array                      -> int
+    OP_SUM,             // array                      -> sum of the elements
+    OP_DOT,             // a b                        -> sum of a[i] * b[i]
+
+    OP_PLAIN_COUNT,
+    OP_SUPER_BEFORE = OP_PLAIN_COUNT - 1,  // so the first superinstruction takes OP_PLAIN_COUNT
+
+    // Superinstructions, see superinstructions.h. One replaces only the
+    // opcode byte of its first component: the operands and the opcodes of
+    // the others stay in place, so jumps into the middle of a fused sequence
+    // still land on plain instructions, and a handler whose fast path fails
+    // resumes at the plain opcode of the component it stopped at.
+#define SUPERINSTRUCTION(name, first, second, third) name,
+#include "superinstructions.h"
+#undef SUPERINSTRUCTION
+
+    OP_COUNT
+} opcode_t;
+
+#define OP_MAX_COMPONENTS 3     /**< Instructions one superinstruction fuses */
+
+char *opcode_to_string(opcode_t op);
+
+/**
+ * @brief Number of operand bytes that follow the opcode byte. For a
+ * superinstruction, those of its first component.
+ */
+size_t opcode_operand_size(opcode_t op);
+
+static inline bool opcode_is_super(opcode_t op) {
+    return op >= OP_PLAIN_COUNT && op < OP_COUNT;
+}
+
+/**
+ * @brief The plain instructions a superinstruction fuses.
+ *
+ * @return How many, 2 or 3; 0 if `op` is not a superinstruction.
+ */
+size_t opcode_components(opcode_t op, opcode_t components[OP_MAX_COMPONENTS]);
+
+/**
+ * @brief Whether `op` may be component `position` of a superinstruction of
+ * `length` components. The first component must not fall back to the plain
+ * instruction, since its opcode byte is the superinstruction's; the others
+ * may have a fast path to fall back from, and only the last may jump.
+ */
+bool opcode_fusible(opcode_t op, size_t position, size_t length);
+
+#endif // OPCODE_H
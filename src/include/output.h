@@ -0,0 +1,63 @@
+/**
+ * File Name: output.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * The output path of the print statement. Values are formatted straight into
+ * a buffer owned by the printing thread, without stdio, and the buffer goes
+ * to stdout in one writev() call when it fills up, when the program ends or
+ * before the program blocks. Strings too long to be worth copying are passed
+ * to writev() from their own storage. When stdout is a terminal, or with
+ * --line-buffered, every print statement is written out as soon as it ends.
+ */
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "value.h"
+
+#define OUTPUT_BUFFER_SIZE (1u << 16)
+#define OUTPUT_DIRECT_MIN 4096          /**< Longer strings are not copied into the buffer */
+#define OUTPUT_NUMBER_MAX 32            /**< Room needed by output_format_int() and output_format_float() */
+
+typedef enum {
+    OUTPUT_AUTO,                        /**< Line buffered if stdout is a terminal */
+    OUTPUT_LINE_BUFFERED,
+    OUTPUT_FULLY_BUFFERED
+} output_mode_t;
+
+void output_set_mode(output_mode_t mode);
+
+/**
+ * @brief Prints the values separated by spaces and followed by a newline,
+ * as one print statement.
+ */
+void output_print(const value_t *values, size_t count);
+
+/**
+ * @brief Writes out what the calling thread has buffered.
+ */
+void output_flush(void);
+
+/**
+ * @brief Writes out every thread's buffer. Runs at exit.
+ */
+void output_flush_all(void);
+
+/**
+ * @brief Writes `value` in decimal, without a NUL.
+ *
+ * @return The number of characters written, at most OUTPUT_NUMBER_MAX.
+ */
+size_t output_format_int(char *out, int64_t value);
+
+/**
+ * @brief Writes `value` the way printf's "%g" does, without a NUL.
+ *
+ * @return The number of characters written, at most OUTPUT_NUMBER_MAX.
+ */
+size_t output_format_float(char *out, double value);
+
+#endif // OUTPUT_H
@@ -23,6 +23,10 @@ typedef struct PARSER_STRUCT {
     token_t *current;
     token_t *previous;
     ast_t *ast;
+    size_t blocks;      /**< Blocks being parsed inside one another */
+    size_t depth;       /**< Expressions being parsed inside one another */
+    size_t nesting;     /**< Levels of the expression parsed last, left operands not counted */
+    size_t height;      /**< Height of the expression parsed last, in nodes */
 } parser_t;
 
 parser_t *init_parser(lexer_t *lexer);
@@ -45,7 +49,9 @@ param_t *parser_parse_param(parser_t *parser);
 data_type_t parser_parse_type(parser_t *parser);
 ast_stmt_node_t *parser_parse_var_decl(parser_t *parser);
 ast_stmt_node_t *parser_parse_statement(parser_t *parser);
+bool parser_is_assignment_operator(token_type_t type);
 ast_stmt_node_t *parser_parse_assignment(parser_t *parser);
+ast_stmt_node_t *parser_parse_index_statement(parser_t *parser);
 ast_stmt_node_t *parser_parse_print_statement(parser_t *parser);
 ast_stmt_node_t *parser_parse_return_statement(parser_t *parser);
 ast_stmt_node_t *parser_parse_block_statement(parser_t *parser);
@@ -53,13 +59,9 @@ ast_stmt_node_t *parser_parse_if_statement(parser_t *parser);
 ast_stmt_node_t *parser_parse_for_statement(parser_t *parser);
 ast_stmt_node_t *parser_parse_while_statement(parser_t *parser);
 ast_expr_node_t *parser_parse_expression(parser_t *parser);
-ast_expr_node_t *parser_parse_logical_or(parser_t *parser);
-ast_expr_node_t *parser_parse_logical_and(parser_t *parser);
-ast_expr_node_t *parser_parse_equality(parser_t *parser);
-ast_expr_node_t *parser_parse_comparasion(parser_t *parser);
-ast_expr_node_t *parser_parse_term(parser_t *parser);
-ast_expr_node_t *parser_parse_factor(parser_t *parser);
+ast_expr_node_t *parser_parse_binary(parser_t *parser, int min_precedence);
 ast_expr_node_t *parser_parse_unary(parser_t *parser);
+ast_expr_node_t *parser_parse_postfix(parser_t *parser);
 ast_expr_node_t *parser_parse_primary(parser_t *parser);
 expr_arg_list_t *parser_parse_arg_list(parser_t *parser);
 
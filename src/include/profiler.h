@@ -0,0 +1,171 @@
+/**
+ * File Name: profiler.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Sampling profiler for running jff programs. A CPU time interval timer
+ * raises SIGPROF; the handler only sets a flag, and the VM takes the sample
+ * at the next instruction boundary, walking its call frames and mapping
+ * every pc back to the source line and column of the statement (or function
+ * declaration) it was compiled from.
+ *
+ * The opcode profile instead counts every instruction the VM dispatches,
+ * and how often each pair and triple of plain instructions that follow each
+ * other in the code also run one after the other: the input of
+ * bench/gen_superinstructions.
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdatomic.h>
+
+#include "image.h"
+#include "opcode.h"
+
+#define PROFILER_DEFAULT_HZ 997     /**< Prime, so sampling does not beat with periodic code */
+#define PROFILER_MAX_DEPTH 128      /**< Frames kept per folded stack, counted from the innermost */
+
+struct VM_STRUCT;
+
+typedef struct profile_stack_struct {
+    char *stack;                    /**< Folded frames, outermost first, separated by ';' */
+    uint64_t count;
+} profile_stack_t;
+
+typedef struct profile_line_struct {
+    uint32_t function;
+    uint32_t line;
+    uint32_t column;
+    uint64_t self;                  /**< Samples with this line innermost */
+    uint64_t total;                 /**< Samples with this line anywhere on the stack */
+    uint64_t last_sample;           /**< Keeps recursion from counting a line twice per sample */
+    bool used;
+} profile_line_t;
+
+/**
+ * A frame of the VM that started a parallel for, stopped at the instruction
+ * that started it or at a call.
+ */
+typedef struct profile_frame_struct {
+    uint32_t function;
+    uint32_t pc;
+} profile_frame_t;
+
+typedef struct profiler_struct {
+    const image_t *image;
+    unsigned hz;
+    uint64_t samples;
+
+    profile_frame_t *outer;         /**< Of a worker's profiler: the frames its samples sit under, outermost first */
+    size_t outer_count;
+
+    profile_stack_t *stacks;        /**< Open addressing table keyed by the folded stack */
+    size_t stack_count;
+    size_t stack_capacity;
+
+    profile_line_t *lines;          /**< Open addressing table keyed by (function, line, column) */
+    size_t line_count;
+    size_t line_capacity;
+
+    char *scratch;                  /**< Folded stack under construction */
+    size_t scratch_capacity;
+
+    bool running;
+    struct sigaction previous_action;
+} profiler_t;
+
+/**
+ * Counts shared by the VMs of a run, parallel loop workers included, so
+ * they are updated atomically. Sequences are indexed by plain opcodes.
+ */
+typedef struct opcode_profile_struct {
+    _Atomic uint64_t dispatches[OP_COUNT];
+    _Atomic uint64_t pairs[OP_PLAIN_COUNT][OP_PLAIN_COUNT];
+    _Atomic uint64_t triples[OP_PLAIN_COUNT][OP_PLAIN_COUNT][OP_PLAIN_COUNT];
+} opcode_profile_t;
+
+/**
+ * The instructions a VM last dispatched, while they ran straight through
+ * the code.
+ */
+typedef struct opcode_window_struct {
+    const uint8_t *next;            /**< Where the next one starts if nothing jumps */
+    opcode_t previous[2];           /**< Oldest first */
+    size_t length;
+} opcode_window_t;
+
+/**
+ * @brief Set from the SIGPROF handler; the VM polls it between instructions.
+ * Stays set for the whole run while an opcode profile is taken.
+ */
+extern volatile sig_atomic_t profiler_sample_pending;
+
+profiler_t *init_profiler(const image_t *image, unsigned hz);
+void free_profiler(profiler_t *profiler);
+
+/**
+ * @brief Installs the SIGPROF handler and starts the CPU time interval timer.
+ */
+bool profiler_start(profiler_t *profiler);
+void profiler_stop(profiler_t *profiler);
+
+/**
+ * @brief Creates the profiler of a parallel for worker started by `vm`,
+ * which samples into `parent`. Its samples go into tables of its own, with
+ * the frames `vm` is in put outside the worker's, until profiler_merge().
+ */
+profiler_t *init_worker_profiler(const profiler_t *parent, const struct VM_STRUCT *vm);
+
+/**
+ * @brief Adds the samples of a worker's profiler into the one it was created from.
+ */
+void profiler_merge(profiler_t *profiler, const profiler_t *worker);
+
+/**
+ * @brief Records the current call stack of `vm`. Called by the VM, never from the signal handler.
+ *
+ * @param pc Offset of the instruction about to run in the innermost frame.
+ */
+void profiler_sample(profiler_t *profiler, const struct VM_STRUCT *vm, uint32_t pc);
+
+/**
+ * @brief Writes one "frame;frame;frame count" line per distinct stack, the input
+ * format of flamegraph.pl and speedscope. Frames read `function:line`.
+ */
+bool profiler_write_folded(const profiler_t *profiler, const char *path);
+
+/**
+ * @brief Prints the `limit` hottest source lines by self samples.
+ */
+void profiler_report(const profiler_t *profiler, FILE *out, size_t limit);
+
+opcode_profile_t *init_opcode_profile(void);
+void free_opcode_profile(opcode_profile_t *profile);
+
+/**
+ * @brief Makes the VMs call opcode_profile_record() before every
+ * instruction. The sampling profiler cannot run at the same time.
+ */
+void opcode_profile_start(opcode_profile_t *profile);
+void opcode_profile_stop(opcode_profile_t *profile);
+
+/**
+ * @brief Counts the instruction at `instruction` and, if it directly
+ * follows the ones in `window`, the sequences it ends.
+ */
+void opcode_profile_record(opcode_profile_t *profile, opcode_window_t *window, const uint8_t *instruction);
+
+uint64_t opcode_profile_dispatches(const opcode_profile_t *profile);
+
+/**
+ * @brief Writes "dispatch COUNT OP", "pair COUNT A B" and "triple COUNT A B C"
+ * lines, most frequent first within each kind, after a "total COUNT" line.
+ */
+bool opcode_profile_write(const opcode_profile_t *profile, const char *path);
+
+#endif // PROFILER_H
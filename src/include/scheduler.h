@@ -0,0 +1,54 @@
+/**
+ * File Name: scheduler.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Work-stealing thread pool behind `parallel for`. A loop is cut into
+ * chunks and every worker starts with an equal run of them in its own
+ * deque. A worker pops the newest range from the bottom of its deque,
+ * pushes the upper half back until a single chunk is left and runs it;
+ * a worker whose deque is empty steals the oldest, i.e. largest, range
+ * from the top of another worker's deque.
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SCHEDULER_MAX_THREADS 256
+#define SCHEDULER_DEQUE_CAPACITY 64     /**< Ranges per deque; enough for any split depth of a size_t range */
+
+/**
+ * @brief Runs one chunk of a parallel loop.
+ *
+ * @param context The pointer given to scheduler_parallel_for().
+ * @param worker Index of the calling worker, below scheduler_thread_count().
+ * @param chunk Index of the chunk to run.
+ * @return false to cancel the chunks that have not started yet.
+ */
+typedef bool (*scheduler_chunk_fn_t)(void *context, size_t worker, size_t chunk);
+
+/**
+ * @brief Sets the number of threads, the calling thread included, used by
+ * later loops. 0 means one per online CPU, which is also the default.
+ */
+void scheduler_set_thread_count(size_t count);
+
+size_t scheduler_thread_count(void);
+
+/**
+ * @brief Runs chunks [0, chunk_count) on the pool and waits for all of them.
+ *
+ * Loops started from inside a chunk run on the calling thread, in order.
+ *
+ * @return false if a chunk cancelled the loop.
+ */
+bool scheduler_parallel_for(size_t chunk_count, scheduler_chunk_fn_t fn, void *context);
+
+/**
+ * @brief Stops and joins the pool threads. Runs at exit.
+ */
+void scheduler_shutdown(void);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,65 @@
+/**
+ * File Name: source_map.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Positions in the source. Tokens and AST nodes record where they start as a
+ * 32-bit byte offset into the program text; the line and column of an offset
+ * are only worked out when a diagnostic or the image's line table needs them.
+ * The index of line starts that takes is built on the first lookup, by one
+ * pass over the text, and a lookup is then a binary search (or none, when it
+ * falls on the same line as the one before, as lookups made in order do).
+ *
+ * Lines and columns count from 1; a column counts bytes, a tab included.
+ */
+#ifndef SOURCE_MAP_H
+#define SOURCE_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SOURCE_MAX_LENGTH UINT32_MAX    /**< Longest program text an offset can address */
+
+typedef struct source_map_struct {
+    size_t refcount;            /**< The lexer and the trees parsed from the text */
+    char *text;                 /**< NUL terminated program text */
+    size_t length;
+    uint32_t *line_starts;      /**< Offset of the first byte of each line, NULL until the first lookup */
+    size_t line_count;
+    size_t last_line;           /**< Index of the line the previous lookup found */
+} source_map_t;
+
+/**
+ * @brief Wraps program text; the map takes ownership of `text`.
+ *
+ * @param text NUL terminated, `length` bytes long, at most SOURCE_MAX_LENGTH.
+ */
+source_map_t *init_source_map(char *text, size_t length);
+
+/**
+ * @brief Takes another reference to `map`, released with free_source_map().
+ */
+source_map_t *source_map_retain(source_map_t *map);
+
+/**
+ * @brief Drops one reference; the last one frees the text and the index.
+ */
+void free_source_map(source_map_t *map);
+
+/**
+ * @brief Finds the line and column of the byte at `offset`.
+ *
+ * A NULL map, as of a tree built by hand, gives line 0 and column 0.
+ */
+void source_map_locate(source_map_t *map, uint32_t offset, size_t *line, size_t *column);
+
+/**
+ * @brief Returns the offset of the first byte of each line, building the
+ * index if no lookup has yet.
+ *
+ * @param line_count Set to the number of lines, at least 1.
+ */
+const uint32_t *source_map_line_starts(source_map_t *map, size_t *line_count);
+
+#endif // SOURCE_MAP_H
@@ -0,0 +1,95 @@
+/**
+ * File Name: stats.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Front end counters and phase timers behind --stats. They only exist when
+ * built with -DJFF_STATS (the default development build); in release builds
+ * every STATS_* macro expands to nothing.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "lexer.h"
+#include "ast.h"
+
+#define STATS_TOKEN_TYPES   (TOKEN_INVALID + 1)
+#define STATS_EXPR_TYPES    EXPR_TYPE_COUNT
+#define STATS_STMT_TYPES    STMT_TYPE_COUNT
+#define STATS_DECL_TYPES    DECL_TYPE_COUNT
+
+typedef enum {
+    STATS_PHASE_READ,       /**< init_lexer */
+    STATS_PHASE_LEX,        /**< the token loop */
+    STATS_PHASE_PARSE,      /**< parser_parse_program */
+    STATS_PHASE_CACHE,      /**< loading or storing the AST cache */
+    STATS_PHASE_DUMP,       /**< writing the tree out when not compiling it */
+    STATS_PHASE_COMPILE,
+    STATS_PHASE_RUN,
+    STATS_PHASE_FREE,       /**< free_lexer, free_parser, free_ast */
+    STATS_PHASE_COUNT
+} stats_phase_t;
+
+typedef struct stats_phase_struct {
+    uint64_t calls;
+    double wall_seconds;
+    double cpu_seconds;
+    int64_t heap_delta;     /**< Change in bytes of heap in use */
+
+    double wall_start;
+    double cpu_start;
+    int64_t heap_start;
+} stats_phase_info_t;
+
+typedef struct stats_struct {
+    size_t bytes_read;
+    uint64_t tokens[STATS_TOKEN_TYPES];
+    uint64_t exprs[STATS_EXPR_TYPES];
+    uint64_t stmts[STATS_STMT_TYPES];
+    uint64_t decls[STATS_DECL_TYPES];
+    stats_phase_info_t phases[STATS_PHASE_COUNT];
+} stats_t;
+
+char *stats_phase_to_string(stats_phase_t phase);
+
+#ifdef JFF_STATS
+
+extern stats_t global_stats;
+
+void stats_phase_begin(stats_phase_t phase);
+void stats_phase_end(stats_phase_t phase);
+
+#define STATS_ADD_BYTES_READ(n)     (global_stats.bytes_read += (n))
+#define STATS_COUNT_TOKEN(type)     (global_stats.tokens[(type)]++)
+#define STATS_COUNT_EXPR(type)      (global_stats.exprs[(type)]++)
+#define STATS_COUNT_STMT(type)      (global_stats.stmts[(type)]++)
+#define STATS_COUNT_DECL(type)      (global_stats.decls[(type)]++)
+#define STATS_PHASE_BEGIN(phase)    stats_phase_begin(phase)
+#define STATS_PHASE_END(phase)      stats_phase_end(phase)
+
+#else
+
+#define STATS_ADD_BYTES_READ(n)     ((void)0)
+#define STATS_COUNT_TOKEN(type)     ((void)0)
+#define STATS_COUNT_EXPR(type)      ((void)0)
+#define STATS_COUNT_STMT(type)      ((void)0)
+#define STATS_COUNT_DECL(type)      ((void)0)
+#define STATS_PHASE_BEGIN(phase)    ((void)0)
+#define STATS_PHASE_END(phase)      ((void)0)
+
+#endif // JFF_STATS
+
+/**
+ * @brief Prints everything collected so far, plus the peak RSS of the process.
+ *
+ * @param out Where to print.
+ * @param input Name of the input the numbers belong to.
+ */
+void stats_report(FILE *out, const char *input);
+
+#endif // STATS_H
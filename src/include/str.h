@@ -0,0 +1,96 @@
+/**
+ * File Name: str.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Runtime strings. A string is immutable and takes one of four forms:
+ * up to 15 bytes stored inline in the object, a prefix of a shared buffer,
+ * a rope of two other strings, or a constant of the image. Appending to the
+ * string that ends a shared buffer writes into the buffer's spare capacity,
+ * so `s = s + t` in a loop is amortized O(|t|). Other long concatenations
+ * build a rope node, which is flattened into a buffer the first time its
+ * characters are read. Buffers are reference counted by the strings over
+ * them; the strings themselves are garbage collected.
+ */
+#ifndef STR_H
+#define STR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "gc.h"
+
+#define STRING_INLINE_MAX 15
+#define STRING_ROPE_MIN 64      /**< Shorter results are copied instead of building a rope */
+
+typedef enum {
+    STRING_INLINE,
+    STRING_SHARED,
+    STRING_ROPE,
+    STRING_CONSTANT
+} string_kind_t;
+
+typedef struct string_buffer_struct {
+    size_t refcount;            /**< Strings over this buffer */
+    size_t capacity;
+    size_t used;                /**< Length of the longest string over it; only that one may append */
+    char *chars;
+} string_buffer_t;
+
+typedef struct string_struct {
+    gc_object_t object;
+    uint8_t kind;               /**< string_kind_t */
+    size_t length;
+    union {
+        char chars[STRING_INLINE_MAX + 1];
+        string_buffer_t *buffer;
+        struct {
+            struct string_struct *left;
+            struct string_struct *right;
+        } rope;
+        const char *constant;
+    } as;
+} string_t;
+
+/**
+ * @brief Wraps a NUL terminated constant that outlives every value using it.
+ */
+void init_string_constant(string_t *string, const char *chars, size_t length);
+
+/**
+ * @brief `a + b`, allocated in `heap`.
+ */
+string_t *string_concat(gc_heap_t *heap, string_t *a, string_t *b);
+
+/**
+ * @brief The characters of the string, flattening a rope first. They are
+ * not NUL terminated; use the length.
+ */
+const char *string_chars(string_t *string);
+
+bool string_equal(string_t *a, string_t *b);
+
+/**
+ * @brief <0, 0 or >0 in byte order, like memcmp with the shorter string first.
+ */
+int string_compare(string_t *a, string_t *b);
+
+void string_print(FILE *out, string_t *string);
+
+/**
+ * @brief Releases the buffer of a string that is being freed, once no
+ * other string uses it.
+ *
+ * @return The bytes released.
+ */
+size_t string_free_storage(string_t *string);
+
+/**
+ * @brief Bytes the string owns outside its object, shared buffers split
+ * between the strings over them.
+ */
+size_t string_external_bytes(const string_t *string);
+
+#endif // STR_H
@@ -0,0 +1,34 @@
+/**
+ * File Name: superinstructions.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Generated by bench/gen_superinstructions from opcode profiles, see the
+ * README. Included with SUPERINSTRUCTION(name, first, second, third)
+ * defined; the third component is OP_COUNT for a pair.
+ *
+ * 1 profile, 754298059 dispatches. Share of them each sequence saves:
+ */
+SUPERINSTRUCTION(OP_GET_LOCAL_CONST, OP_GET_LOCAL, OP_CONST, OP_COUNT) // 19.53%
+SUPERINSTRUCTION(OP_CONST_EQ_INT_JUMP_IF_FALSE, OP_CONST, OP_EQ_INT, OP_JUMP_IF_FALSE) // 14.04%
+SUPERINSTRUCTION(OP_CONST_ADD_INT_SET_LOCAL, OP_CONST, OP_ADD_INT, OP_SET_LOCAL) // 8.15%
+SUPERINSTRUCTION(OP_EQ_INT_JUMP_IF_FALSE, OP_EQ_INT, OP_JUMP_IF_FALSE, OP_COUNT) // 7.02%
+SUPERINSTRUCTION(OP_CONST_NEQ_INT_JUMP_IF_FALSE, OP_CONST, OP_NEQ_INT, OP_JUMP_IF_FALSE) // 6.14%
+SUPERINSTRUCTION(OP_CONST_MOD_INT_CONST, OP_CONST, OP_MOD_INT, OP_CONST) // 6.08%
+SUPERINSTRUCTION(OP_SET_LOCAL_JUMP, OP_SET_LOCAL, OP_JUMP, OP_COUNT) // 5.10%
+SUPERINSTRUCTION(OP_CONST_SUB_INT, OP_CONST, OP_SUB_INT, OP_COUNT) // 4.16%
+SUPERINSTRUCTION(OP_GET_LOCAL_CONST_SUB_INT, OP_GET_LOCAL, OP_CONST, OP_SUB_INT) // 4.16%
+SUPERINSTRUCTION(OP_CONST_DIV_INT_SET_LOCAL, OP_CONST, OP_DIV_INT, OP_SET_LOCAL) // 4.07%
+SUPERINSTRUCTION(OP_GET_LOCAL_CONST_EQ_INT, OP_GET_LOCAL, OP_CONST, OP_EQ_INT) // 3.98%
+SUPERINSTRUCTION(OP_GET_LOCAL_CONST_ADD_INT, OP_GET_LOCAL, OP_CONST, OP_ADD_INT) // 3.07%
+SUPERINSTRUCTION(OP_GET_LOCAL_CONST_NEQ_INT, OP_GET_LOCAL, OP_CONST, OP_NEQ_INT) // 3.07%
+SUPERINSTRUCTION(OP_NEQ_INT_JUMP_IF_FALSE, OP_NEQ_INT, OP_JUMP_IF_FALSE, OP_COUNT) // 3.07%
+SUPERINSTRUCTION(OP_GET_LOCAL_CONST_MOD_INT, OP_GET_LOCAL, OP_CONST, OP_MOD_INT) // 3.04%
+SUPERINSTRUCTION(OP_GET_LOCAL_GET_LOCAL_ADD_INT, OP_GET_LOCAL, OP_GET_LOCAL, OP_ADD_INT) // 2.65%
+SUPERINSTRUCTION(OP_SET_LOCAL_GET_LOCAL_CONST, OP_SET_LOCAL, OP_GET_LOCAL, OP_CONST) // 2.12%
+SUPERINSTRUCTION(OP_GET_LOCAL_CONST_DIV_INT, OP_GET_LOCAL, OP_CONST, OP_DIV_INT) // 2.03%
+SUPERINSTRUCTION(OP_CONST_GET_LOCAL_MUL_INT, OP_CONST, OP_GET_LOCAL, OP_MUL_INT) // 2.02%
+SUPERINSTRUCTION(OP_GET_LOCAL_MUL_INT_CONST, OP_GET_LOCAL, OP_MUL_INT, OP_CONST) // 2.02%
+SUPERINSTRUCTION(OP_CONST_SUB_INT_GET_LOCAL, OP_CONST, OP_SUB_INT, OP_GET_LOCAL) // 1.33%
+SUPERINSTRUCTION(OP_GET_LOCAL_ADD_INT, OP_GET_LOCAL, OP_ADD_INT, OP_COUNT) // 1.33%
+SUPERINSTRUCTION(OP_CONST_LT_INT_JUMP_IF_FALSE, OP_CONST, OP_LT_INT, OP_JUMP_IF_FALSE) // 0.36%
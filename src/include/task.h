@@ -0,0 +1,147 @@
+/**
+ * File Name: task.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Tasks and the single threaded event loop behind `async func` and `await`.
+ * Calling an async function creates a task whose frame (locals and operand
+ * stack) lives on the heap. The VM copies the frame onto its stack to run
+ * the task and copies it back when the task awaits something unfinished, so
+ * a suspended task costs its frame plus a small header and no OS thread.
+ * Timers and file descriptor waits are tasks too; they finish from the loop
+ * through a timer heap and epoll. Finished tasks stay until the garbage
+ * collector finds no value that refers to them.
+ */
+#ifndef TASK_H
+#define TASK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "value.h"
+
+typedef enum {
+    TASK_COROUTINE,     /**< A call of an async function */
+    TASK_TIMER,         /**< sleep(ms) */
+    TASK_FD             /**< readable(fd) / writable(fd) */
+} task_kind_t;
+
+typedef enum {
+    TASK_READY,         /**< Queued to run */
+    TASK_WAITING,       /**< Suspended in `await`, or a timer / fd wait not yet due */
+    TASK_DONE
+} task_state_t;
+
+typedef struct task_struct {
+    uint8_t kind;                   /**< task_kind_t */
+    uint8_t state;                  /**< task_state_t */
+    uint8_t marked;                 /**< Reached by the current major collection */
+    uint8_t remembered;             /**< In the remembered set */
+    int fd;                         /**< TASK_FD */
+    uint32_t function;              /**< TASK_COROUTINE */
+    uint32_t pc;                    /**< Resume offset in the function */
+    uint32_t frame_size;            /**< Values in the heap frame */
+    uint32_t saved_count;           /**< Locals and operand stack values saved in the frame */
+    value_t *frame;                 /**< Freed when the task finishes */
+    value_t result;
+    struct task_struct *waiters;    /**< Tasks awaiting this one */
+    struct task_struct *next;       /**< Next in the ready queue or in a waiter list */
+    struct task_struct *all_next;   /**< Next in the list of every task */
+    struct task_struct *remembered_next;
+} task_t;
+
+typedef struct task_timer_struct {
+    uint64_t deadline;              /**< CLOCK_MONOTONIC nanoseconds */
+    uint64_t sequence;              /**< Keeps timers with equal deadlines in FIFO order */
+    task_t *task;
+} task_timer_t;
+
+typedef struct event_loop_struct {
+    task_t *ready_head;
+    task_t *ready_tail;
+
+    task_timer_t *timers;           /**< Binary min-heap on (deadline, sequence) */
+    size_t timer_count;
+    size_t timer_capacity;
+    uint64_t timer_sequence;
+
+    int epoll_fd;                   /**< -1 until the first fd wait */
+    size_t fd_wait_count;
+
+    task_t *tasks;                  /**< Every task, finished ones included */
+    task_t *remembered;             /**< Tasks whose frame or result changed since the last collection */
+    size_t task_count;
+    size_t waiting_count;           /**< Coroutines suspended on another task */
+    size_t frame_bytes;             /**< Heap frames currently allocated */
+    size_t peak_bytes;              /**< Peak of task headers plus frames */
+} event_loop_t;
+
+void init_event_loop(event_loop_t *loop);
+void free_event_loop(event_loop_t *loop);
+
+/**
+ * @brief Creates a task for `function` with a frame of `frame_size` values.
+ * The caller fills in the frame, then queues the task with task_schedule().
+ */
+task_t *task_create_coroutine(event_loop_t *loop, uint32_t function, uint32_t frame_size);
+
+void task_schedule(event_loop_t *loop, task_t *task);
+
+/**
+ * @brief Adds a task to the remembered set after its frame or result was
+ * written, so the next minor collection scans it.
+ */
+void task_remember(event_loop_t *loop, task_t *task);
+
+/**
+ * @brief Frees every finished task that is not marked and clears the marks
+ * of the others. Tasks that have not finished are always kept.
+ *
+ * @return The bytes freed.
+ */
+size_t event_loop_sweep(event_loop_t *loop);
+
+/**
+ * @brief Bytes of task headers and frames currently allocated.
+ */
+size_t event_loop_bytes(const event_loop_t *loop);
+
+/**
+ * @brief Suspends `waiter` until `target` finishes; the result of `target`
+ * is then pushed onto the waiter's saved operand stack.
+ */
+void task_await(event_loop_t *loop, task_t *waiter, task_t *target);
+
+/**
+ * @brief Finishes a task, frees its frame and wakes its waiters.
+ */
+void task_complete(event_loop_t *loop, task_t *task, value_t result);
+
+/**
+ * @brief Returns a task that finishes with null after `ms` milliseconds.
+ */
+task_t *event_loop_sleep(event_loop_t *loop, int64_t ms);
+
+/**
+ * @brief Returns a task that finishes when `fd` is readable (`write` false)
+ * or writable, with true, or false on an error or hangup.
+ *
+ * @return NULL with `error` set if the descriptor cannot be waited on.
+ */
+task_t *event_loop_wait_fd(event_loop_t *loop, int fd, bool write, const char **error);
+
+task_t *event_loop_next_ready(event_loop_t *loop);
+
+/**
+ * @brief True while timers or fd waits are outstanding.
+ */
+bool event_loop_pending(const event_loop_t *loop);
+
+/**
+ * @brief Blocks until the next timer is due or a descriptor is ready and
+ * finishes the tasks concerned.
+ */
+void event_loop_poll(event_loop_t *loop);
+
+#endif // TASK_H
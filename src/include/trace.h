@@ -0,0 +1,68 @@
+/**
+ * File Name: trace.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Timeline tracing behind --trace=FILE. Begin/end events go into a ring
+ * buffer owned by the recording thread, so recording takes no lock, and
+ * every buffer is written out as Chrome trace-event JSON (loadable in
+ * chrome://tracing and Perfetto) when the process exits.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_RING_CAPACITY (1u << 16)   /**< Events kept per thread; older ones are overwritten */
+#define TRACE_DETAIL_SIZE 48
+
+typedef struct trace_event_struct {
+    uint64_t timestamp;                 /**< Nanoseconds since trace_open() */
+    const char *name;                   /**< Static string */
+    char detail[TRACE_DETAIL_SIZE];     /**< Copied, e.g. the name of a function */
+    char phase;                         /**< 'B' or 'E' */
+} trace_event_t;
+
+typedef struct trace_buffer_struct {
+    trace_event_t *events;
+    uint64_t recorded;                  /**< Total events ever recorded; the ring holds the last TRACE_RING_CAPACITY */
+    uint32_t thread_id;
+    char thread_name[32];
+    struct trace_buffer_struct *next;
+} trace_buffer_t;
+
+extern bool trace_enabled;
+
+/**
+ * @brief Starts tracing; events are written to `path` at exit.
+ *
+ * @return false if the file cannot be created.
+ */
+bool trace_open(const char *path);
+
+void trace_begin(const char *name, const char *detail);
+void trace_end(const char *name);
+
+/**
+ * @brief Names the calling thread in the timeline.
+ */
+void trace_set_thread_name(const char *name);
+
+/**
+ * @brief Writes out every thread's events and stops tracing. Runs at exit.
+ */
+void trace_flush(void);
+
+#define TRACE_BEGIN(name, detail) \
+    do { \
+        if (trace_enabled) trace_begin((name), (detail)); \
+    } while (0)
+
+#define TRACE_END(name) \
+    do { \
+        if (trace_enabled) trace_end(name); \
+    } while (0)
+
+#endif // TRACE_H
@@ -0,0 +1,162 @@
+/**
+ * File Name: value.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Runtime values, NaN-boxed into one 64-bit word. A double is stored as its
+ * own bits; every other value is a quiet NaN whose sign bit and bits 48-49
+ * say what it is and whose low 48 bits hold the payload:
+ *
+ *     0x7ffc 0000 0000 0001   null
+ *     0x7ffc 0000 0000 000b   bool b + 2
+ *     0x7ffd pppp pppp pppp   int of at most 48 bits, two's complement
+ *     0xfffc pppp pppp pppp   string pointer
+ *     0xfffd pppp pppp pppp   array pointer
+ *     0xfffe pppp pppp pppp   task pointer
+ *     0xffff pppp pppp pppp   pointer to a boxed int, for the wider ones
+ *
+ * NaNs that arithmetic produces are stored as the canonical NaN of their
+ * sign, whose bit 50 is clear, so no double can be mistaken for a tagged
+ * value. User space pointers fit in 48 bits on x86-64 and AArch64.
+ */
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * @brief Enum representing the runtime type of a value.
+ */
+typedef enum {
+    VALUE_NULL,   /**< null */
+    VALUE_BOOL,   /**< true / false */
+    VALUE_INT,    /**< 64-bit signed integer */
+    VALUE_FLOAT,  /**< Double precision float */
+    VALUE_STRING, /**< Immutable string, see str.h */
+    VALUE_TASK,   /**< Running or finished task, owned by the VM's event loop */
+    VALUE_ARRAY   /**< int[] or float[], owned by the VM that created it */
+} value_type_t;
+
+struct string_struct;
+struct task_struct;
+struct array_struct;
+struct boxed_int_struct;
+
+typedef struct VALUE_STRUCT {
+    uint64_t bits;
+} value_t;
+
+#define VALUE_QNAN          0x7ffc000000000000ull
+#define VALUE_PAYLOAD_MASK  0x0000ffffffffffffull
+#define VALUE_CANONICAL_NAN 0x7ff8000000000000ull
+#define VALUE_SIGN_BIT      0x8000000000000000ull
+
+/** Top 16 bits of each kind of tagged value */
+#define VALUE_TAG_SPECIAL   0x7ffcu
+#define VALUE_TAG_INT       0x7ffdu
+#define VALUE_TAG_STRING    0xfffcu
+#define VALUE_TAG_ARRAY     0xfffdu
+#define VALUE_TAG_TASK      0xfffeu
+#define VALUE_TAG_BOXED_INT 0xffffu
+
+#define VALUE_TAG(v)        ((uint32_t)((v).bits >> 48))
+#define VALUE_MAKE(tag, payload) ((value_t){ ((uint64_t)(tag) << 48) | ((uint64_t)(payload) & VALUE_PAYLOAD_MASK) })
+
+#define SMALL_INT_MIN       (-((int64_t)1 << 47))
+#define SMALL_INT_MAX       (((int64_t)1 << 47) - 1)
+#define INT_FITS_SMALL(i)   ((i) >= SMALL_INT_MIN && (i) <= SMALL_INT_MAX)
+
+#define NULL_VALUE          ((value_t){ VALUE_QNAN | 1 })
+#define BOOL_VALUE(b)       ((value_t){ VALUE_QNAN | 2 | ((b) ? 1 : 0) })
+/** Only for ints known to fit in 48 bits; gc_int_value() boxes the others. */
+#define SMALL_INT_VALUE(i)  VALUE_MAKE(VALUE_TAG_INT, (uint64_t)(i))
+#define STRING_VALUE(s)     VALUE_MAKE(VALUE_TAG_STRING, (uintptr_t)(s))
+#define ARRAY_VALUE(a)      VALUE_MAKE(VALUE_TAG_ARRAY, (uintptr_t)(a))
+#define TASK_VALUE(t)       VALUE_MAKE(VALUE_TAG_TASK, (uintptr_t)(t))
+#define BOXED_INT_VALUE(b)  VALUE_MAKE(VALUE_TAG_BOXED_INT, (uintptr_t)(b))
+
+#define IS_NULL(v)          ((v).bits == NULL_VALUE.bits)
+#define IS_BOOL(v)          (((v).bits | 1) == BOOL_VALUE(true).bits)
+#define IS_FLOAT(v)         (((v).bits & VALUE_QNAN) != VALUE_QNAN)
+#define IS_SMALL_INT(v)     (VALUE_TAG(v) == VALUE_TAG_INT)
+#define IS_INT(v)           (IS_SMALL_INT(v) || VALUE_TAG(v) == VALUE_TAG_BOXED_INT)
+#define IS_STRING(v)        (VALUE_TAG(v) == VALUE_TAG_STRING)
+#define IS_ARRAY(v)         (VALUE_TAG(v) == VALUE_TAG_ARRAY)
+#define IS_TASK(v)          (VALUE_TAG(v) == VALUE_TAG_TASK)
+#define IS_NUMBER(v)        (IS_INT(v) || IS_FLOAT(v))
+/** True when both are ints of at most 48 bits: the fast path of int arithmetic. */
+#define BOTH_SMALL_INTS(a, b) \
+    (((((a).bits >> 48) ^ VALUE_TAG_INT) | (((b).bits >> 48) ^ VALUE_TAG_INT)) == 0)
+#define BOTH_FLOATS(a, b)   (IS_FLOAT(a) && IS_FLOAT(b))
+/** + - * of two small ints, wrapping around at 64 bits like every int operation */
+#define SMALL_INT_OP(a, operator, b) ((int64_t)((uint64_t)AS_SMALL_INT(a) operator (uint64_t)AS_SMALL_INT(b)))
+#define FLOAT_OP(a, operator, b)     FLOAT_VALUE(AS_FLOAT(a) operator AS_FLOAT(b))
+
+#define AS_BOOL(v)          ((bool)((v).bits & 1))
+#define AS_SMALL_INT(v)     ((int64_t)((v).bits << 16) >> 16)
+#define AS_POINTER(v)       ((void *)(uintptr_t)((v).bits & VALUE_PAYLOAD_MASK))
+#define AS_STRING(v)        ((struct string_struct *)AS_POINTER(v))
+#define AS_ARRAY(v)         ((struct array_struct *)AS_POINTER(v))
+#define AS_TASK(v)          ((struct task_struct *)AS_POINTER(v))
+#define AS_BOXED_INT(v)     ((struct boxed_int_struct *)AS_POINTER(v))
+#define AS_INT(v)           (IS_SMALL_INT(v) ? AS_SMALL_INT(v) : boxed_int_value(AS_BOXED_INT(v)))
+#define AS_DOUBLE(v)        (IS_FLOAT(v) ? AS_FLOAT(v) : (double)AS_INT(v))
+
+/**
+ * @brief The value of an int too wide for the payload, see gc.h.
+ */
+int64_t boxed_int_value(const struct boxed_int_struct *boxed);
+
+static inline value_t FLOAT_VALUE(double d) {
+    value_t value;
+    memcpy(&value.bits, &d, sizeof(d));
+    if (d != d) {
+        value.bits = VALUE_CANONICAL_NAN | (value.bits & VALUE_SIGN_BIT);
+    }
+    return value;
+}
+
+static inline double AS_FLOAT(value_t value) {
+    double d;
+    memcpy(&d, &value.bits, sizeof(d));
+    return d;
+}
+
+static inline value_type_t value_type(value_t value) {
+    if (IS_FLOAT(value)) return VALUE_FLOAT;
+    switch (VALUE_TAG(value)) {
+        case VALUE_TAG_SPECIAL: return IS_NULL(value) ? VALUE_NULL : VALUE_BOOL;
+        case VALUE_TAG_STRING:  return VALUE_STRING;
+        case VALUE_TAG_ARRAY:   return VALUE_ARRAY;
+        case VALUE_TAG_TASK:    return VALUE_TASK;
+        default:                return VALUE_INT;
+    }
+}
+
+char *value_type_to_string(value_type_t type);
+
+/**
+ * @brief Truthiness of strings, arrays, tasks and boxed ints, which are all
+ * true except "".
+ */
+bool object_is_truthy(value_t value);
+
+/**
+ * @brief Truthiness used by conditions: null, false, 0, 0.0 and "" are false.
+ * Bools, small ints and floats are decided here without a call.
+ */
+static inline bool value_is_truthy(value_t value) {
+    if (IS_FLOAT(value)) return AS_FLOAT(value) != 0.0;
+    if (IS_SMALL_INT(value)) return (value.bits & VALUE_PAYLOAD_MASK) != 0;
+    if (VALUE_TAG(value) == VALUE_TAG_SPECIAL) return value.bits == BOOL_VALUE(true).bits;
+    return object_is_truthy(value);
+}
+
+bool values_equal(value_t a, value_t b);
+
+void print_value(FILE *out, value_t value);
+
+#endif // VALUE_H
@@ -0,0 +1,87 @@
+/**
+ * File Name: vm.h
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#ifndef VM_H
+#define VM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gc.h"
+#include "image.h"
+#include "profiler.h"
+#include "task.h"
+#include "value.h"
+
+#define VM_MAX_FRAMES (1u << 20)
+
+typedef enum {
+    VM_OK = 0,
+    VM_RUNTIME_ERROR = -1,
+    VM_SUSPENDED = 1        /**< The running task awaits an unfinished one; internal to the VM */
+} vm_status_t;
+
+typedef struct call_frame_struct {
+    uint32_t function;
+    uint32_t pc;        /**< Resume offset, valid while a callee is running */
+    size_t base;        /**< Stack index of local slot 0 */
+} call_frame_t;
+
+typedef struct VM_STRUCT {
+    const image_t *image;
+
+    value_t *stack;
+    size_t stack_capacity;
+    size_t stack_top;
+
+    call_frame_t *frames;
+    size_t frame_count;
+    size_t frame_capacity;
+
+    value_t *globals;   /**< Shared with the parent VM on parallel loop workers */
+
+    struct profiler_struct *profiler;  /**< Sampled at instruction boundaries when set */
+    opcode_profile_t *opcode_profile;  /**< Counts every instruction when set */
+    opcode_window_t opcode_window;
+
+    struct parallel_region_struct *region;  /**< Set on the VMs that run `parallel for` chunks */
+    value_t *reductions;                    /**< Partial results of the chunk being run */
+    uint8_t reduction_count;                /**< Entries of `reductions`, 0 outside a chunk */
+    struct boxed_int_struct *reduction_boxes;   /**< Hold the partials that are boxed ints */
+
+    event_loop_t loop;
+    task_t *current_task;                   /**< The task whose bottom frame is running, if any */
+
+    gc_heap_t heap;                         /**< Strings, arrays and boxed ints this VM created */
+    struct string_struct *constants;        /**< One string per constant of the image, unused for numbers */
+    boxed_int_t *boxed_constants;           /**< One per constant, used by the ints too wide for a value */
+    value_t *constant_values;               /**< Every constant of the image, decoded once */
+} vm_t;
+
+vm_t *init_vm(const image_t *image);
+void free_vm(vm_t *vm);
+
+/**
+ * @brief Calls a function of the image and runs it to completion.
+ *
+ * @param vm The virtual machine.
+ * @param function Index of the function in the image.
+ * @param args Arguments, exactly param_count of them.
+ * @param result Receives the return value (may be NULL).
+ * @return VM_OK, or VM_RUNTIME_ERROR after reporting the error on stderr.
+ */
+vm_status_t vm_call(vm_t *vm, uint32_t function, const value_t *args, value_t *result);
+
+/**
+ * @brief Runs the global initializer, then `main` if the image has one,
+ * then the event loop until every task has finished.
+ *
+ * Parameters of `main`, if it declares any, are passed as null. An async
+ * `main` runs as the first task.
+ */
+vm_status_t vm_run(vm_t *vm);
+
+#endif // VM_H
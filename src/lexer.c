@@ -6,25 +6,29 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include <ctype.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 
 #include "include/lexer.h"
+#include "include/number.h"
 #include "include/utils.h"
+#include "include/stats.h"
 
-token_t *init_token(token_type_t type, const char *value, size_t length, size_t line, size_t column) {
+token_t *init_token(token_type_t type, const char *value, size_t length, uint32_t offset) {
     token_t *token = malloc(sizeof(token_t));
     CHECK_MEM_ALLOC_ERROR(token);
+    STATS_COUNT_TOKEN(type);
     token->type = type;
     token->length = length;
     token->value = malloc(length + 1);
     CHECK_MEM_ALLOC_ERROR(token->value);
     memcpy(token->value, value, length);
     token->value[length] = '\0';
-    token->line = line;
-    token->column = column;
+    token->offset = offset;
+    token->number.int_value = 0;
     return token;
 }
 
@@ -39,7 +43,7 @@ void free_token(token_t *token) {
 
 void print_token(token_t *token) {
     if (token) {
-        printf("(%2ld:%-2ld | ", token->line, token->column);
+        printf("(%6" PRIu32 " | ", token->offset);
         print_token_type(token->type);
         printf(" | %-15s )\n", token->value ? token->value : "NULL");
     }
@@ -49,12 +53,18 @@ void print_token_type(token_type_t type) {
     switch (type) {
         case TOKEN_KEYWORD:         printf("KEYWORD       "); break;
         case TOKEN_FUNC:            printf("FUNC          "); break;
+        case TOKEN_ASYNC:           printf("ASYNC         "); break;
+        case TOKEN_AWAIT:           printf("AWAIT         "); break;
         case TOKEN_IF:              printf("IF            "); break;
         case TOKEN_ELIF:            printf("ELIF          "); break;
         case TOKEN_ELSE:            printf("ELSE          "); break;
         case TOKEN_RETURN:          printf("RETURN        "); break;
         case TOKEN_PRINT:           printf("PRINT         "); break;
         case TOKEN_FOR:             printf("FOR           "); break;
+        case TOKEN_PARALLEL:        printf("PARALLEL      "); break;
+        case TOKEN_WHILE:           printf("WHILE         "); break;
+        case TOKEN_BREAK:           printf("BREAK         "); break;
+        case TOKEN_CONTINUE:        printf("CONTINUE      "); break;
         case TOKEN_NULL:            printf("NULL          "); break;
         case TOKEN_TRUE:            printf("TRUE          "); break;
         case TOKEN_FALSE:           printf("FALSE         "); break;
@@ -95,6 +105,8 @@ void print_token_type(token_type_t type) {
         case TOKEN_RPAREN:          printf("RPAREN        "); break;
         case TOKEN_LBRACE:          printf("LBRACE        "); break;
         case TOKEN_RBRACE:          printf("RBRACE        "); break;
+        case TOKEN_LBRACKET:        printf("LBRACKET      "); break;
+        case TOKEN_RBRACKET:        printf("RBRACKET      "); break;
         case TOKEN_SEMICOLON:       printf("SEMICOLON     "); break;
         case TOKEN_COLON:           printf("COLON         "); break;
         case TOKEN_COMMA:           printf("COMMA         "); break;
@@ -118,12 +130,18 @@ char *token_type_to_string(token_type_t type) {
     switch (type) {
         case TOKEN_KEYWORD:         return "KEYWORD";
         case TOKEN_FUNC:            return "FUNC";
+        case TOKEN_ASYNC:           return "ASYNC";
+        case TOKEN_AWAIT:           return "AWAIT";
         case TOKEN_IF:              return "IF";
         case TOKEN_ELIF:            return "ELIF";
         case TOKEN_ELSE:            return "ELSE";
         case TOKEN_RETURN:          return "RETURN";
         case TOKEN_PRINT:           return "PRINT";
         case TOKEN_FOR:             return "FOR";
+        case TOKEN_PARALLEL:        return "PARALLEL";
+        case TOKEN_WHILE:           return "WHILE";
+        case TOKEN_BREAK:           return "BREAK";
+        case TOKEN_CONTINUE:        return "CONTINUE";
         case TOKEN_NULL:            return "NULL";
         case TOKEN_TRUE:            return "TRUE";
         case TOKEN_FALSE:           return "FALSE";
@@ -162,6 +180,8 @@ char *token_type_to_string(token_type_t type) {
         case TOKEN_RPAREN:          return "RIGHT PAREN";
         case TOKEN_LBRACE:          return "LEFT BRACE";
         case TOKEN_RBRACE:          return "RIGHT BRACE";
+        case TOKEN_LBRACKET:        return "LEFT BRACKET";
+        case TOKEN_RBRACKET:        return "RIGHT BRACKET";
         case TOKEN_SEMICOLON:       return "SEMICOLON";
         case TOKEN_COLON:           return "COLON";
         case TOKEN_COMMA:           return "COMMA";
@@ -178,34 +198,24 @@ char *token_type_to_string(token_type_t type) {
 }
 
 
-lexer_t *init_lexer(const char *filename) {
+/**
+ * @brief Builds a lexer over a NUL terminated buffer; the lexer takes ownership of `input`.
+ */
+static lexer_t *init_lexer_with_input(const char *name, char *input, size_t length) {
     lexer_t *lexer = malloc(sizeof(lexer_t));
     CHECK_MEM_ALLOC_ERROR(lexer);
-    lexer->filename = strdup(filename);
-
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Error opening file: %s\n", filename);
-        free(lexer);
-        return NULL;
-    }
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    rewind(file);
-    lexer->input = malloc(file_size + 1);
-    CHECK_MEM_ALLOC_ERROR(lexer->input);
-    fread(lexer->input, 1, file_size, file);
-    lexer->input[file_size] = '\0';
-    fclose(file);
+    lexer->filename = strdup(name);
+    CHECK_MEM_ALLOC_ERROR(lexer->filename);
+    lexer->source = init_source_map(input, length);
+    lexer->input = input;
+    lexer->input_length = length;
+    STATS_ADD_BYTES_READ(length);
 
     lexer->position = 0;
     lexer->read_position = 0;
     lexer->current_char = '\0';
     lexer->status = LEXER_SUCCESS;
 
-    lexer->line = 1;
-    lexer->column = 0;
-
     lexer->current_token.type = TOKEN_EOF;
     lexer->current_token.value = NULL;
     lexer->current_token.length = 0;
@@ -219,9 +229,44 @@ lexer_t *init_lexer(const char *filename) {
     return lexer;
 }
 
+lexer_t *init_lexer(const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening file: %s\n", filename);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+    if (file_size < 0 || (unsigned long)file_size > SOURCE_MAX_LENGTH) {
+        fprintf(stderr, "Error: %s is too large, a program may be at most 4 GiB\n", filename);
+        fclose(file);
+        return NULL;
+    }
+    char *input = malloc(file_size + 1);
+    CHECK_MEM_ALLOC_ERROR(input);
+    size_t length = fread(input, 1, file_size, file);
+    input[length] = '\0';
+    fclose(file);
+
+    return init_lexer_with_input(filename, input, length);
+}
+
+lexer_t *init_lexer_from_source(const char *name, const char *source, size_t length) {
+    if (length > SOURCE_MAX_LENGTH) {
+        fprintf(stderr, "Error: %s is too large, a program may be at most 4 GiB\n", name);
+        return NULL;
+    }
+    char *input = malloc(length + 1);
+    CHECK_MEM_ALLOC_ERROR(input);
+    memcpy(input, source, length);
+    input[length] = '\0';
+    return init_lexer_with_input(name, input, length);
+}
+
 void free_lexer(lexer_t *lexer) {
     if (lexer) {
-        free(lexer->input);
+        free_source_map(lexer->source);
         for (size_t i = 0; i < lexer->token_count; i++) {
             free_token(lexer->tokens[i]);
             lexer->tokens[i] = NULL;
@@ -238,17 +283,10 @@ void free_lexer(lexer_t *lexer) {
 void lexer_advance(lexer_t *lexer) {
     lexer->position = lexer->read_position;
 
-    if (lexer->read_position >= strlen(lexer->input)) {
+    if (lexer->read_position >= lexer->input_length) {
         lexer->current_char = '\0';
     } else {
         lexer->current_char = lexer->input[lexer->read_position];
-
-        if (lexer->current_char == '\n') {
-            lexer->line++;
-            lexer->column = 0;
-        } else {
-            lexer->column++;
-        }
     }
 
     lexer->read_position++;
@@ -256,7 +294,7 @@ void lexer_advance(lexer_t *lexer) {
 
 
 char lexer_peek(lexer_t *lexer) {
-    return lexer->read_position >= strlen(lexer->input) ? '\0' : lexer->input[lexer->read_position];
+    return lexer->read_position >= lexer->input_length ? '\0' : lexer->input[lexer->read_position];
 }
 
 void lexer_skip_whitespace(lexer_t *lexer) {
@@ -271,7 +309,8 @@ void lexer_skip_whitespace(lexer_t *lexer) {
 void lexer_append_token(lexer_t *lexer, token_t *token) {
     if (lexer->token_count >= lexer->tokens_capacity) {
         lexer->tokens_capacity *= 2;
-        lexer->tokens = realloc(lexer->tokens, lexer->tokens_capacity * sizeof(token_t));
+        lexer->tokens = realloc(lexer->tokens, lexer->tokens_capacity * sizeof(token_t *));
+        CHECK_MEM_ALLOC_ERROR(lexer->tokens);
     }
     lexer->tokens[lexer->token_count++] = token;
 }
@@ -283,8 +322,7 @@ token_t *lexer_next_token(lexer_t *lexer) {
         // identifier or keyword
         if (isalpha(lexer->current_char) || lexer->current_char == '_') {
             size_t start = lexer->position;
-            size_t start_line = lexer->line;
-            size_t start_column = lexer->column;
+            uint32_t offset = (uint32_t)lexer->position;
             while (isalnum(lexer->current_char) || lexer->current_char == '_') {
                 lexer_advance(lexer);
             }
@@ -293,85 +331,107 @@ token_t *lexer_next_token(lexer_t *lexer) {
 
             // Check for keywords
             if (length == 4 && strncmp(lexer->input + start, "func", length) == 0) {
-                return init_token(TOKEN_FUNC, "func", length, start_line, start_column);
+                return init_token(TOKEN_FUNC, "func", length, offset);
+            }
+            else if (length == 5 && strncmp(lexer->input + start, "async", length) == 0) {
+                return init_token(TOKEN_ASYNC, "async", length, offset);
+            }
+            else if (length == 5 && strncmp(lexer->input + start, "await", length) == 0) {
+                return init_token(TOKEN_AWAIT, "await", length, offset);
             }
             else if (length == 2 && strncmp(lexer->input + start, "if", length) == 0) {
-                return init_token(TOKEN_IF, "if", length, start_line, start_column);
+                return init_token(TOKEN_IF, "if", length, offset);
             } 
             else if (length == 4 && strncmp(lexer->input + start, "elif", length) == 0) {
-                return init_token(TOKEN_ELIF, "elif", length, start_line, start_column);
+                return init_token(TOKEN_ELIF, "elif", length, offset);
             } 
             else if (length == 4 && strncmp(lexer->input + start, "else", length) == 0) {
-                return init_token(TOKEN_ELSE, "else", length, start_line, start_column);
+                return init_token(TOKEN_ELSE, "else", length, offset);
             } 
             else if (length == 6 && strncmp(lexer->input + start, "return", length) == 0) {
-                return init_token(TOKEN_RETURN, "return", length, start_line, start_column);
+                return init_token(TOKEN_RETURN, "return", length, offset);
             } 
             else if (length == 5 && strncmp(lexer->input + start, "print", length) == 0) {
-                return init_token(TOKEN_PRINT, "print", length, start_line, start_column);
+                return init_token(TOKEN_PRINT, "print", length, offset);
             } 
             else if (length == 3 && strncmp(lexer->input + start, "for", length) == 0) {
-                return init_token(TOKEN_FOR, "for", length, start_line, start_column);
+                return init_token(TOKEN_FOR, "for", length, offset);
+            }
+            else if (length == 8 && strncmp(lexer->input + start, "parallel", length) == 0) {
+                return init_token(TOKEN_PARALLEL, "parallel", length, offset);
             }
             else if (length == 5 && strncmp(lexer->input + start, "while", length) == 0) {
-                return init_token(TOKEN_WHILE, "while", length, start_line, start_column);
+                return init_token(TOKEN_WHILE, "while", length, offset);
             } 
             else if (length == 5 && strncmp(lexer->input + start, "break", length) == 0) {
-                return init_token(TOKEN_BREAK, "break", length, start_line, start_column);
+                return init_token(TOKEN_BREAK, "break", length, offset);
             } 
             else if (length == 8 && strncmp(lexer->input + start, "continue", length) == 0) {
-                return init_token(TOKEN_CONTINUE, "continue", length, start_line, start_column);
+                return init_token(TOKEN_CONTINUE, "continue", length, offset);
             } 
             else if (length == 4 && strncmp(lexer->input + start, "null", length) == 0) {
-                return init_token(TOKEN_NULL, "null", length, start_line, start_column);
+                return init_token(TOKEN_NULL, "null", length, offset);
             }
             else if (length == 4 && strncmp(lexer->input + start, "true", length) == 0) {
-                return init_token(TOKEN_TRUE, "true", length, start_line, start_column);
+                return init_token(TOKEN_TRUE, "true", length, offset);
             } 
             else if (length == 5 && strncmp(lexer->input + start, "false", length) == 0) {
-                return init_token(TOKEN_FALSE, "false", length, start_line, start_column);
+                return init_token(TOKEN_FALSE, "false", length, offset);
             } 
 
 
             // types keywords
             if (length == 3 && strncmp(lexer->input + start, "int", length) == 0) {
-                return init_token(TOKEN_TYPE_INT, "int", length, start_line, start_column);
+                return init_token(TOKEN_TYPE_INT, "int", length, offset);
             } 
             else if (length == 5 && strncmp(lexer->input + start, "float", length) == 0) {
-                return init_token(TOKEN_TYPE_FLOAT, "float", length, start_line, start_column);
+                return init_token(TOKEN_TYPE_FLOAT, "float", length, offset);
             } 
             else if (length == 6 && strncmp(lexer->input + start, "string", length) == 0) {
-                return init_token(TOKEN_TYPE_STRING, "string", length, start_line, start_column);
+                return init_token(TOKEN_TYPE_STRING, "string", length, offset);
             } 
             else if (length == 4 && strncmp(lexer->input + start, "bool", length) == 0) {
-                return init_token(TOKEN_TYPE_BOOL, "bool", length, start_line, start_column);
+                return init_token(TOKEN_TYPE_BOOL, "bool", length, offset);
             } 
             else if (length == 4 && strncmp(lexer->input + start, "void", length) == 0) {
-                return init_token(TOKEN_TYPE_VOID, "void", length, start_line, start_column);
+                return init_token(TOKEN_TYPE_VOID, "void", length, offset);
             }
 
 
-            return init_token(TOKEN_IDENTIFIER, lexer->input + start, length, start_line, start_column);
+            return init_token(TOKEN_IDENTIFIER, lexer->input + start, length, offset);
         }
 
         if (isdigit(lexer->current_char)) {
             size_t start = lexer->position;
-            size_t start_line = lexer->line;
-            size_t start_column = lexer->column;
+            uint32_t offset = (uint32_t)lexer->position;
 
-            while (isdigit(lexer->current_char)) {
+            number_t number;
+            number_status_t status = number_scan(lexer->input + start, lexer->input_length - start, &number);
+            for (size_t i = 0; i < number.length; ++i) {
                 lexer_advance(lexer);
             }
-            size_t length = lexer->position - start;
-            return init_token(TOKEN_LITERAL_INT, lexer->input + start, length, start_line, start_column);
+            if (status != NUMBER_OK) {
+                char message[160];
+                int length = snprintf(message, sizeof(message), "%s: %.*s", number_status_to_string(status),
+                                      number.length > 64 ? 64 : (int)number.length, lexer->input + start);
+                return init_token(TOKEN_INVALID, message, (size_t)length, offset);
+            }
+
+            token_t *token = init_token(number.is_float ? TOKEN_LITERAL_FLOAT : TOKEN_LITERAL_INT,
+                                        lexer->input + start, number.length, offset);
+            if (number.is_float) {
+                token->number.float_value = number.value.float_value;
+            } else {
+                token->number.int_value = number.value.int_value;
+            }
+            return token;
         }
 
 
         if (lexer->current_char == '"') {
             lexer_advance(lexer);
             size_t start = lexer->position;
-            size_t start_line = lexer->line;
-            size_t start_column = lexer->column;
+            uint32_t offset = (uint32_t)lexer->position;
 
             while (lexer->current_char != '"' && lexer->current_char != '\0') {
                 if (lexer->current_char == '\\') {
@@ -383,102 +443,106 @@ token_t *lexer_next_token(lexer_t *lexer) {
             if (lexer->current_char == '"') {
                 size_t length = lexer->position - start;
                 lexer_advance(lexer); 
-                return init_token(TOKEN_LITERAL_STR, lexer->input + start, length, start_line, start_column);
+                return init_token(TOKEN_LITERAL_STR, lexer->input + start, length, offset);
             } else {
-                return init_token(TOKEN_INVALID, "Unterminated string", 18, start_line, start_column);
+                return init_token(TOKEN_INVALID, "Unterminated string", 19, offset);
             }
         }
 
         // Handle single-char tokens
         char ch = lexer->current_char;
-        size_t start_line = lexer->line;
-        size_t start_column = lexer->column;
+        uint32_t offset = (uint32_t)lexer->position;
         if (ch == '=' && lexer_peek(lexer) == '=') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_EQEQ, "==", 2, start_line, start_column);
+            return init_token(TOKEN_EQEQ, "==", 2, offset);
         } else if (ch == '!' && lexer_peek(lexer) == '=') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_NEQ, "!=", 2, start_line, start_column);
+            return init_token(TOKEN_NEQ, "!=", 2, offset);
         } else if (ch == '&' && lexer_peek(lexer) == '&') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_AND, "&&", 2, start_line, start_column);
+            return init_token(TOKEN_AND, "&&", 2, offset);
         } else if (ch == '|' && lexer_peek(lexer) == '|') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_OR, "||", 2, start_line, start_column);
+            return init_token(TOKEN_OR, "||", 2, offset);
         } else if (ch == '!' && lexer_peek(lexer) != '=') {
             lexer_advance(lexer);
-            return init_token(TOKEN_NOT, "!", 1, start_line, start_column);
+            return init_token(TOKEN_NOT, "!", 1, offset);
         } else if (ch == '<' && lexer_peek(lexer) == '=') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_LEQ, "<=", 2, start_line, start_column);
+            return init_token(TOKEN_LEQ, "<=", 2, offset);
         } else if (ch == '>' && lexer_peek(lexer) == '=') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_GEQ, ">=", 2, start_line, start_column);
+            return init_token(TOKEN_GEQ, ">=", 2, offset);
         } 
         // TODO: add parsing support for below
         else if (ch == '+' && lexer_peek(lexer) == '+') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_PLUSPLUS, "++", 2, start_line, start_column);
+            return init_token(TOKEN_PLUSPLUS, "++", 2, offset);
         } else if (ch == '-' && lexer_peek(lexer) == '-') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_MINUSMINUS, "--", 2, start_line, start_column);
+            return init_token(TOKEN_MINUSMINUS, "--", 2, offset);
         } else if (ch == '+' && lexer_peek(lexer) == '=') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_PLUSEQ, "+=", 2, start_line, start_column);
+            return init_token(TOKEN_PLUSEQ, "+=", 2, offset);
         } else if (ch == '-' && lexer_peek(lexer) == '=') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_MINUSEQ, "-=", 2, start_line, start_column);
+            return init_token(TOKEN_MINUSEQ, "-=", 2, offset);
         } else if (ch == '*' && lexer_peek(lexer) == '=') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_ASTERISKEQ, "*=", 2, start_line, start_column);
+            return init_token(TOKEN_ASTERISKEQ, "*=", 2, offset);
         } else if (ch == '/' && lexer_peek(lexer) == '=') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_SLASHEQ, "/=", 2, start_line, start_column);
+            return init_token(TOKEN_SLASHEQ, "/=", 2, offset);
         } else if (ch == '%' && lexer_peek(lexer) == '=') {
             lexer_advance(lexer);
             lexer_advance(lexer);
-            return init_token(TOKEN_PERCENT_EQ, "%=", 2, start_line, start_column);
+            return init_token(TOKEN_PERCENT_EQ, "%=", 2, offset);
         }
 
          // Handle single-char tokens
 
         lexer_advance(lexer);
         switch (ch) {
-            case '+': return init_token(TOKEN_PLUS, "+", 1, start_line, start_column);
-            case '-': return init_token(TOKEN_MINUS, "-", 1, start_line, start_column);
-            case '*': return init_token(TOKEN_ASTERISK, "*", 1, start_line, start_column);
-            case '/': return init_token(TOKEN_SLASH, "/", 1, start_line, start_column);
-            case '%': return init_token(TOKEN_PERCENT, "%", 1, start_line, start_column);
-            case '=': return init_token(TOKEN_EQ, "=", 1, start_line, start_column);
-            case '<': return init_token(TOKEN_LT, "<", 1, start_line, start_column);
-            case '>': return init_token(TOKEN_GT, ">", 1, start_line, start_column);
-            case '(': return init_token(TOKEN_LPAREN, "(", 1, start_line, start_column);
-            case ')': return init_token(TOKEN_RPAREN, ")", 1, start_line, start_column);
-            case '{': return init_token(TOKEN_LBRACE, "{", 1, start_line, start_column);
-            case '}': return init_token(TOKEN_RBRACE, "}", 1, start_line, start_column);
-            case ';': return init_token(TOKEN_SEMICOLON, ";", 1, start_line, start_column);
-            case ':': return init_token(TOKEN_COLON, ":", 1, start_line, start_column);
-            case ',': return init_token(TOKEN_COMMA, ",", 1, start_line, start_column);
+            case '+': return init_token(TOKEN_PLUS, "+", 1, offset);
+            case '-': return init_token(TOKEN_MINUS, "-", 1, offset);
+            case '*': return init_token(TOKEN_ASTERISK, "*", 1, offset);
+            case '/': return init_token(TOKEN_SLASH, "/", 1, offset);
+            case '%': return init_token(TOKEN_PERCENT, "%", 1, offset);
+            case '=': return init_token(TOKEN_EQ, "=", 1, offset);
+            case '<': return init_token(TOKEN_LT, "<", 1, offset);
+            case '>': return init_token(TOKEN_GT, ">", 1, offset);
+            case '(': return init_token(TOKEN_LPAREN, "(", 1, offset);
+            case ')': return init_token(TOKEN_RPAREN, ")", 1, offset);
+            case '{': return init_token(TOKEN_LBRACE, "{", 1, offset);
+            case '}': return init_token(TOKEN_RBRACE, "}", 1, offset);
+            case '[': return init_token(TOKEN_LBRACKET, "[", 1, offset);
+            case ']': return init_token(TOKEN_RBRACKET, "]", 1, offset);
+            case ';': return init_token(TOKEN_SEMICOLON, ";", 1, offset);
+            case ':': return init_token(TOKEN_COLON, ":", 1, offset);
+            case ',': return init_token(TOKEN_COMMA, ",", 1, offset);
             default: {
-                char unknown[2] = {ch, '\0'};
-                return init_token(TOKEN_INVALID, unknown, 1, start_line, start_column);
+                char message[32];
+                int length = isprint((unsigned char)ch)
+                    ? snprintf(message, sizeof(message), "Unexpected character '%c'", ch)
+                    : snprintf(message, sizeof(message), "Unexpected byte 0x%02x", (unsigned char)ch);
+                return init_token(TOKEN_INVALID, message, (size_t)length, offset);
             }
         }
     }
 
-    return init_token(TOKEN_EOF, "EOF", 3, lexer->line, lexer->column);
+    return init_token(TOKEN_EOF, "EOF", 3, (uint32_t)lexer->position);
 }
 
 
@@ -3,14 +3,247 @@
  * Author: Vishank Singh
  * Github: https://github.com/VishankSingh
  */
+#include <ctype.h>
+#include <unistd.h>
 
 #include "include/lexer.h"
 #include "include/parser.h"
+#include "include/ast_serialize.h"
+#include "include/ast_dump.h"
+#include "include/compiler.h"
+#include "include/vm.h"
+#include "include/stats.h"
+#include "include/scheduler.h"
+#include "include/trace.h"
+#include "include/profiler.h"
+#include "include/gc.h"
+#include "include/output.h"
 
+/* A phase shows up in both --stats and the --trace timeline. */
+#define PHASE_BEGIN(phase) \
+    do { \
+        STATS_PHASE_BEGIN(phase); \
+        TRACE_BEGIN(stats_phase_to_string(phase), NULL); \
+    } while (0)
 
-int main(void) {
-    char *filename = "/home/vis/Desk/codes/compilers_1/part_2/examples/e1.jff";
+#define PHASE_END(phase) \
+    do { \
+        TRACE_END(stats_phase_to_string(phase)); \
+        STATS_PHASE_END(phase); \
+    } while (0)
+
+#define PROFILE_REPORT_LINES 20
+
+static const char *profile_path = NULL;
+static const char *opcode_profile_path = NULL;
+static unsigned profile_hz = PROFILER_DEFAULT_HZ;
+static size_t gc_nursery_size = GC_DEFAULT_NURSERY_SIZE;
+static size_t gc_max_heap = 0;
+static bool show_gc_stats = false;
+static ast_dump_format_t dump_format = AST_DUMP_TEXT;
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [options] <file.jff>\n", program);
+    fprintf(stderr, "       %s --run-image=FILE\n", program);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --cache-dir=DIR     reuse parsed ASTs stored in DIR, keyed by source hash\n");
+    fprintf(stderr, "  --run               compile the program to bytecode and run it\n");
+    fprintf(stderr, "  --compile-to=FILE   write the compiled bytecode image to FILE\n");
+    fprintf(stderr, "  --run-image=FILE    map a compiled image and run it, no source needed\n");
+    fprintf(stderr, "  --disassemble       print the bytecode listing of the compiled image\n");
+    fprintf(stderr, "  --dump-ast=FORMAT   print the parsed tree as text (the default without --run),\n");
+    fprintf(stderr, "                      json or bin (an AST cache file)\n");
+    fprintf(stderr, "  --inline-threshold=N  largest function body, in AST nodes, inlined at calls in loops\n");
+    fprintf(stderr, "                      (default %d, 0 turns inlining off)\n", COMPILER_DEFAULT_INLINE_THRESHOLD);
+    fprintf(stderr, "  --inline-report     report every inlining decision on stderr\n");
+    fprintf(stderr, "  --no-hoist          keep loop invariant expressions inside their loops\n");
+    fprintf(stderr, "  --no-unroll         neither unroll counted for loops nor strength reduce them\n");
+    fprintf(stderr, "  --no-typed-ops      use the generic arithmetic and comparison opcodes everywhere\n");
+    fprintf(stderr, "  --no-superinstructions  dispatch every instruction of the fused sequences on its own\n");
+    fprintf(stderr, "  --stats             report per phase times, memory and token/node counts on stderr\n");
+    fprintf(stderr, "  --trace=FILE        write a Chrome trace-event timeline of every phase to FILE\n");
+    fprintf(stderr, "  --profile=FILE      sample the running program, write folded stacks to FILE\n");
+    fprintf(stderr, "                      and print the hottest source lines on stderr\n");
+    fprintf(stderr, "  --profile-rate=HZ   samples per second of CPU time (default %u)\n", PROFILER_DEFAULT_HZ);
+    fprintf(stderr, "  --profile-opcodes=FILE  count every dispatched instruction and the pairs and triples\n");
+    fprintf(stderr, "                      that run straight through, write them to FILE\n");
+    fprintf(stderr, "  --threads=N         threads that run parallel for loops (default: one per CPU)\n");
+    fprintf(stderr, "  --gc-nursery=SIZE   bytes of the young generation, e.g. 256K (default %zuK)\n",
+        (size_t)GC_DEFAULT_NURSERY_SIZE / 1024);
+    fprintf(stderr, "  --gc-max-heap=SIZE  fail with a runtime error once more than SIZE bytes stay live\n");
+    fprintf(stderr, "  --gc-stats          report collections and pause time histograms on stderr\n");
+    fprintf(stderr, "  --line-buffered     write print output line by line even when stdout is not a terminal\n");
+}
+
+/**
+ * @brief Reads a byte count such as 4096, 256K or 64M.
+ */
+static bool parse_size(const char *text, size_t *size) {
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (end == text) return false;
+    switch (toupper((unsigned char)*end)) {
+        case 'G': value <<= 10; // fall through
+        case 'M': value <<= 10; // fall through
+        case 'K': value <<= 10; end++; break;
+        case '\0': break;
+        default: return false;
+    }
+    if (*end == 'B' || *end == 'b') end++;
+    if (*end != '\0') return false;
+    *size = (size_t)value;
+    return true;
+}
+
+/**
+ * @brief Runs an image and returns the process exit status.
+ */
+static int run_image(const image_t *image) {
+    vm_t *vm = init_vm(image);
+    gc_set_limits(&vm->heap, gc_nursery_size, gc_max_heap);
+    profiler_t *profiler = NULL;
+    if (profile_path) {
+        profiler = init_profiler(image, profile_hz);
+        if (!profiler_start(profiler)) {
+            free_profiler(profiler);
+            free_vm(vm);
+            return EXIT_FAILURE;
+        }
+        vm->profiler = profiler;
+    }
+    opcode_profile_t *opcode_profile = NULL;
+    if (opcode_profile_path) {
+        opcode_profile = init_opcode_profile();
+        opcode_profile_start(opcode_profile);
+        vm->opcode_profile = opcode_profile;
+    }
+
+    // print bypasses stdio, so the listing and the tree must be out first.
+    fflush(stdout);
+    PHASE_BEGIN(STATS_PHASE_RUN);
+    vm_status_t status = vm_run(vm);
+    PHASE_END(STATS_PHASE_RUN);
+
+    int exit_status = status == VM_OK ? 0 : EXIT_FAILURE;
+    if (profiler) {
+        profiler_stop(profiler);
+        if (!profiler_write_folded(profiler, profile_path)) {
+            exit_status = EXIT_FAILURE;
+        }
+        profiler_report(profiler, stderr, PROFILE_REPORT_LINES);
+        free_profiler(profiler);
+    }
+    if (opcode_profile) {
+        opcode_profile_stop(opcode_profile);
+        if (!opcode_profile_write(opcode_profile, opcode_profile_path)) {
+            exit_status = EXIT_FAILURE;
+        }
+        uint64_t fused = 0;
+        for (size_t op = OP_PLAIN_COUNT; op < OP_COUNT; ++op) {
+            fused += opcode_profile->dispatches[op];
+        }
+        fprintf(stderr, "== opcode profile: %llu dispatches, %llu of them superinstructions ==\n",
+            (unsigned long long)opcode_profile_dispatches(opcode_profile), (unsigned long long)fused);
+        free_opcode_profile(opcode_profile);
+    }
+    if (show_gc_stats) {
+        gc_report(stderr, &vm->heap);
+    }
+    free_vm(vm);
+    return exit_status;
+}
+
+/**
+ * @brief Compiles the program, then writes, lists and/or runs the image.
+ */
+static int compile_and_run(const ast_t *ast, const char *compile_to, bool run, bool disassemble) {
+    PHASE_BEGIN(STATS_PHASE_COMPILE);
+    image_t *image = compile_program(ast);
+    PHASE_END(STATS_PHASE_COMPILE);
+    if (!image) {
+        return EXIT_FAILURE;
+    }
+    int status = 0;
+    if (compile_to && !image_write_file(image, compile_to)) {
+        fprintf(stderr, "Error: could not write image to %s\n", compile_to);
+        status = EXIT_FAILURE;
+    }
+    if (status == 0 && disassemble) {
+        image_disassemble(image);
+    }
+    if (status == 0 && run) {
+        status = run_image(image);
+    }
+    free_image(image);
+    return status;
+}
+
+/**
+ * @brief Runs a previously compiled image file.
+ */
+static int run_image_file(const char *path, bool disassemble) {
+    TRACE_BEGIN("map image", path);
+    image_t *image = image_map_file(path);
+    TRACE_END("map image");
+    if (!image) {
+        fprintf(stderr, "Error: %s is not a valid jff image\n", path);
+        return EXIT_FAILURE;
+    }
+    if (disassemble) {
+        image_disassemble(image);
+    }
+    int status = run_image(image);
+    free_image(image);
+    return status;
+}
+
+/**
+ * @brief Writes the tree to stdout in the --dump-ast format.
+ */
+static int dump_ast(const ast_t *ast) {
+    PHASE_BEGIN(STATS_PHASE_DUMP);
+    bool ok = ast_dump(ast, dump_format, STDOUT_FILENO);
+    PHASE_END(STATS_PHASE_DUMP);
+    if (!ok) {
+        perror("Error writing the AST");
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lexes and parses `filename` (or loads it from the AST cache), then
+ * prints the tree or compiles it.
+ */
+static int process_source(const char *filename, const char *cache_dir, const char *compile_to, bool run, bool disassemble) {
+    bool execute = run || compile_to || disassemble;
+
+    if (cache_dir) {
+        PHASE_BEGIN(STATS_PHASE_CACHE);
+        ast_t *cached = ast_cache_load(cache_dir, filename);
+        PHASE_END(STATS_PHASE_CACHE);
+        if (cached) {
+            int status = 0;
+            if (execute) {
+                status = compile_and_run(cached, compile_to, run, disassemble);
+            } else {
+                status = dump_ast(cached);
+            }
+            PHASE_BEGIN(STATS_PHASE_FREE);
+            free_ast(cached);
+            PHASE_END(STATS_PHASE_FREE);
+            return status;
+        }
+    }
+
+    PHASE_BEGIN(STATS_PHASE_READ);
     lexer_t *lexer = init_lexer(filename);
+    PHASE_END(STATS_PHASE_READ);
+    if (!lexer) {
+        return EXIT_FAILURE;
+    }
+
+    PHASE_BEGIN(STATS_PHASE_LEX);
     token_t *token;
     while ((token = lexer_next_token(lexer))->type != TOKEN_EOF) {
         lexer_append_token(lexer, token);
@@ -18,17 +251,165 @@ int main(void) {
     }
     lexer_append_token(lexer, token); // EOF token
     // print_token(token);
-    
+    PHASE_END(STATS_PHASE_LEX);
+
     // token_t** tokens = lexer->tokens;
     // for(size_t i = 0; i < lexer->token_count; i++) {
     //     print_token(tokens[i]);
     // }
 
+    PHASE_BEGIN(STATS_PHASE_PARSE);
     parser_t *parser = init_parser(lexer);
     parser_parse_program(parser);
-    print_ast(parser->ast);
-    
+    PHASE_END(STATS_PHASE_PARSE);
+
+    if (cache_dir) {
+        PHASE_BEGIN(STATS_PHASE_CACHE);
+        if (!ast_cache_store(cache_dir, filename, parser->ast)) {
+            fprintf(stderr, "Warning: could not write AST cache entry for %s\n", filename);
+        }
+        PHASE_END(STATS_PHASE_CACHE);
+    }
+    int status = 0;
+    if (execute) {
+        status = compile_and_run(parser->ast, compile_to, run, disassemble);
+    } else {
+        status = dump_ast(parser->ast);
+    }
+
+    PHASE_BEGIN(STATS_PHASE_FREE);
     free_lexer(lexer);
     free_parser(parser);
-    return 0;
-}
\ No newline at end of file
+    PHASE_END(STATS_PHASE_FREE);
+    return status;
+}
+
+int main(int argc, char **argv) {
+    const char *filename = NULL;
+    const char *cache_dir = NULL;
+    const char *compile_to = NULL;
+    const char *run_image_path = NULL;
+    bool run = false;
+    bool disassemble = false;
+    bool dump_requested = false;
+    bool show_stats = false;
+    const char *trace_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--cache-dir=", 12) == 0) {
+            cache_dir = argv[i] + 12;
+        } else if (strncmp(argv[i], "--compile-to=", 13) == 0) {
+            compile_to = argv[i] + 13;
+        } else if (strncmp(argv[i], "--run-image=", 12) == 0) {
+            run_image_path = argv[i] + 12;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            run = true;
+        } else if (strcmp(argv[i], "--disassemble") == 0) {
+            disassemble = true;
+        } else if (strncmp(argv[i], "--dump-ast=", 11) == 0) {
+            if (!ast_dump_format_from_string(argv[i] + 11, &dump_format)) {
+                fprintf(stderr, "Invalid AST dump format: %s (expected text, json or bin)\n", argv[i] + 11);
+                return EXIT_FAILURE;
+            }
+            dump_requested = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = true;
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            trace_path = argv[i] + 8;
+        } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            profile_path = argv[i] + 10;
+        } else if (strncmp(argv[i], "--profile-opcodes=", 18) == 0) {
+            opcode_profile_path = argv[i] + 18;
+        } else if (strncmp(argv[i], "--profile-rate=", 15) == 0) {
+            char *end;
+            unsigned long hz = strtoul(argv[i] + 15, &end, 10);
+            if (*end != '\0' || hz == 0 || hz > 1000000) {
+                fprintf(stderr, "Invalid profile rate: %s\n", argv[i] + 15);
+                return EXIT_FAILURE;
+            }
+            profile_hz = (unsigned)hz;
+        } else if (strncmp(argv[i], "--inline-threshold=", 19) == 0) {
+            char *end;
+            unsigned long threshold = strtoul(argv[i] + 19, &end, 10);
+            if (*end != '\0' || end == argv[i] + 19) {
+                fprintf(stderr, "Invalid inline threshold: %s\n", argv[i] + 19);
+                return EXIT_FAILURE;
+            }
+            compiler_set_inline_threshold((size_t)threshold);
+        } else if (strcmp(argv[i], "--inline-report") == 0) {
+            compiler_set_inline_report(stderr);
+        } else if (strcmp(argv[i], "--no-hoist") == 0) {
+            compiler_set_hoisting(false);
+        } else if (strcmp(argv[i], "--no-unroll") == 0) {
+            compiler_set_counted_loops(false);
+        } else if (strcmp(argv[i], "--no-typed-ops") == 0) {
+            compiler_set_typed_opcodes(false);
+        } else if (strcmp(argv[i], "--no-superinstructions") == 0) {
+            compiler_set_superinstructions(false);
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            char *end;
+            unsigned long threads = strtoul(argv[i] + 10, &end, 10);
+            if (*end != '\0' || threads == 0 || threads > SCHEDULER_MAX_THREADS) {
+                fprintf(stderr, "Invalid thread count: %s\n", argv[i] + 10);
+                return EXIT_FAILURE;
+            }
+            scheduler_set_thread_count((size_t)threads);
+        } else if (strncmp(argv[i], "--gc-nursery=", 13) == 0) {
+            if (!parse_size(argv[i] + 13, &gc_nursery_size) || gc_nursery_size < 4096) {
+                fprintf(stderr, "Invalid nursery size: %s\n", argv[i] + 13);
+                return EXIT_FAILURE;
+            }
+        } else if (strncmp(argv[i], "--gc-max-heap=", 14) == 0) {
+            if (!parse_size(argv[i] + 14, &gc_max_heap) || gc_max_heap == 0) {
+                fprintf(stderr, "Invalid heap limit: %s\n", argv[i] + 14);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--gc-stats") == 0) {
+            show_gc_stats = true;
+        } else if (strcmp(argv[i], "--line-buffered") == 0) {
+            output_set_mode(OUTPUT_LINE_BUFFERED);
+        } else if (argv[i][0] == '-' || filename) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            filename = argv[i];
+        }
+    }
+
+    if (profile_path && !run && !run_image_path) {
+        fprintf(stderr, "--profile needs --run or --run-image\n");
+        return EXIT_FAILURE;
+    }
+    if (opcode_profile_path && ((!run && !run_image_path) || profile_path)) {
+        fprintf(stderr, "--profile-opcodes needs --run or --run-image, and not --profile\n");
+        return EXIT_FAILURE;
+    }
+
+    if (dump_requested && (run || compile_to || disassemble || run_image_path)) {
+        fprintf(stderr, "--dump-ast prints the tree instead of compiling it\n");
+        return EXIT_FAILURE;
+    }
+
+    if (trace_path && !trace_open(trace_path)) {
+        return EXIT_FAILURE;
+    }
+
+    int status;
+    if (run_image_path) {
+        if (filename || compile_to || run || cache_dir) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        status = run_image_file(run_image_path, disassemble);
+    } else if (filename) {
+        status = process_source(filename, cache_dir, compile_to, run, disassemble);
+    } else {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (show_stats) {
+        stats_report(stderr, run_image_path ? run_image_path : filename);
+    }
+    return status;
+}
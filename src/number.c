@@ -0,0 +1,351 @@
+/**
+ * File Name: number.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/number.h"
+#include "include/powers_of_ten.h"
+#include "include/utils.h"
+
+#define MAX_MANTISSA_DIGITS 19      /**< Decimal digits that always fit in a uint64_t */
+#define MAX_EXPONENT_DIGITS 100000  /**< Exponents past this are all the same: zero or infinity */
+
+const char *number_status_to_string(number_status_t status) {
+    switch (status) {
+        case NUMBER_OK: return "ok";
+        case NUMBER_MISSING_DIGITS: return "Numeric literal is missing its digits";
+        case NUMBER_BAD_SEPARATOR: return "'_' in a numeric literal must separate two digits";
+        case NUMBER_BAD_DIGIT: return "Invalid digit in numeric literal";
+        case NUMBER_INT_OVERFLOW: return "Int literal does not fit in 64 bits";
+        case NUMBER_FLOAT_OVERFLOW: return "Float literal is too large for a float";
+        default: return "unknown";
+    }
+}
+
+//--------------------------------------- Float Conversion --------------------------------------------------------------------------
+
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 number_uint128_t;
+#endif
+
+static void multiply(uint64_t a, uint64_t b, uint64_t *high, uint64_t *low) {
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+    number_uint128_t product = (number_uint128_t)a * b;
+    *high = (uint64_t)(product >> 64);
+    *low = (uint64_t)product;
+#else
+    uint64_t a_low = a & 0xffffffffu, a_high = a >> 32;
+    uint64_t b_low = b & 0xffffffffu, b_high = b >> 32;
+    uint64_t low_low = a_low * b_low;
+    uint64_t high_low = a_high * b_low;
+    uint64_t low_high = a_low * b_high;
+    uint64_t middle = (low_low >> 32) + (high_low & 0xffffffffu) + low_high;
+    *high = a_high * b_high + (high_low >> 32) + (middle >> 32);
+    *low = (middle << 32) | (low_low & 0xffffffffu);
+#endif
+}
+
+static int leading_zeros(uint64_t value) {
+#ifdef __GNUC__
+    return __builtin_clzll(value);
+#else
+    int count = 0;
+    while (!(value & (1ull << 63))) {
+        value <<= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+/**
+ * @brief floor(exponent * log2(10)), exact for every exponent in the table.
+ */
+static int64_t binary_exponent(int64_t exponent) {
+    int64_t scaled = 217706 * exponent;
+    return scaled >= 0 ? scaled / 65536 : -((-scaled + 65535) / 65536);
+}
+
+/**
+ * @brief mantissa * 10^exponent rounded to the nearest double, following
+ * Lemire, "Number Parsing at a Gigabyte per Second" (2021).
+ *
+ * @return false when the product is too close to halfway between two
+ *         doubles to tell, or is subnormal or infinite.
+ */
+static bool eisel_lemire(uint64_t mantissa, int64_t exponent, double *result) {
+    if (mantissa == 0) {
+        *result = 0.0;
+        return true;
+    }
+    if (exponent < POWERS_OF_TEN_MIN_EXPONENT || exponent > POWERS_OF_TEN_MAX_EXPONENT) return false;
+
+    int shift = leading_zeros(mantissa);
+    mantissa <<= shift;
+    uint64_t exponent2 = (uint64_t)(binary_exponent(exponent) + 64 + 1023) - (uint64_t)shift;
+
+    const uint64_t *power = powers_of_ten[exponent - POWERS_OF_TEN_MIN_EXPONENT];
+    uint64_t high, low;
+    multiply(mantissa, power[1], &high, &low);
+
+    // The low bits of the high word are all ones, so the truncated half of
+    // the power could carry into them: take it into account.
+    if ((high & 0x1ff) == 0x1ff && low + mantissa < mantissa) {
+        uint64_t extra_high, extra_low;
+        multiply(mantissa, power[0], &extra_high, &extra_low);
+        uint64_t merged_high = high, merged_low = low + extra_high;
+        if (merged_low < low) merged_high++;
+        if ((merged_high & 0x1ff) == 0x1ff && merged_low + 1 == 0 && extra_low + mantissa < mantissa) return false;
+        high = merged_high;
+        low = merged_low;
+    }
+
+    uint64_t top = high >> 63;
+    uint64_t significand = high >> (top + 9);
+    exponent2 -= 1 ^ top;
+
+    // Exactly halfway between two doubles, or too close to know
+    if (low == 0 && (high & 0x1ff) == 0 && (significand & 3) == 1) return false;
+
+    significand += significand & 1;
+    significand >>= 1;
+    if (significand >> 53) {
+        significand >>= 1;
+        exponent2++;
+    }
+    if (exponent2 - 1 >= 0x7ff - 1) return false;
+
+    uint64_t bits = exponent2 << 52 | (significand & 0x000fffffffffffffull);
+    memcpy(result, &bits, sizeof(bits));
+    return true;
+}
+
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * @brief mantissa * 10^exponent as the nearest double. When `truncated`,
+ * digits past the mantissa were dropped, and the value lies between the
+ * mantissa and the mantissa plus one.
+ *
+ * @return false when only strtod() can tell.
+ */
+static bool decimal_to_double(uint64_t mantissa, int64_t exponent, bool truncated, double *result) {
+    if (!truncated) {
+        // Both operands are exact doubles, so one rounding gives the answer
+        if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+            double value = (double)mantissa;
+            *result = exponent < 0 ? value / exact_powers_of_ten[-exponent] : value * exact_powers_of_ten[exponent];
+            return true;
+        }
+        return eisel_lemire(mantissa, exponent, result);
+    }
+    double above;
+    return eisel_lemire(mantissa, exponent, result) && eisel_lemire(mantissa + 1, exponent, &above)
+        && *result == above;
+}
+
+/**
+ * @brief Converts the literal with strtod(), the separators taken out.
+ */
+static double slow_decimal_to_double(const char *text, size_t length) {
+    char inline_digits[128];
+    char *digits = length < sizeof(inline_digits) ? inline_digits : malloc(length + 1);
+    CHECK_MEM_ALLOC_ERROR(digits);
+    size_t count = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (text[i] != '_') digits[count++] = text[i];
+    }
+    digits[count] = '\0';
+    double value = strtod(digits, NULL);
+    if (digits != inline_digits) free(digits);
+    return value;
+}
+
+//--------------------------------------- Scanning ----------------------------------------------------------------------------------
+
+static char peek(const char *text, size_t length, size_t i) {
+    return i < length ? text[i] : '\0';
+}
+
+static int digit_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 16;
+}
+
+static bool is_word_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+/**
+ * @brief Steps past the next digit of `base`, and the separator before it.
+ *
+ * @return The digit, or -1 at the end of the digits, also when a separator
+ *         is out of place, which sets `status`.
+ */
+static int next_digit(const char *text, size_t length, size_t *i, int base, number_status_t *status) {
+    char c = peek(text, length, *i);
+    if (c == '_') {
+        if (*i == 0 || digit_value(text[*i - 1]) >= base || digit_value(peek(text, length, *i + 1)) >= base) {
+            *status = NUMBER_BAD_SEPARATOR;
+            return -1;
+        }
+        c = text[++*i];
+    }
+    int digit = digit_value(c);
+    if (digit >= base) return -1;
+    ++*i;
+    return digit;
+}
+
+/**
+ * @brief Rejects a letter or digit glued to the end of the literal, and on
+ * an error takes the rest of the malformed literal into its length.
+ */
+static number_status_t finish_scan(const char *text, size_t length, size_t i, number_status_t status,
+    number_t *number) {
+    if (status == NUMBER_OK && is_word_char(peek(text, length, i))) status = NUMBER_BAD_DIGIT;
+    if (status != NUMBER_OK) {
+        while (is_word_char(peek(text, length, i))) i++;
+    }
+    number->length = i;
+    return status;
+}
+
+/**
+ * @brief The significant digits of a decimal literal: mantissa * 10^exponent.
+ */
+typedef struct {
+    uint64_t mantissa;          /**< The first MAX_MANTISSA_DIGITS significant digits */
+    int significant;
+    int64_t exponent;
+    bool truncated;             /**< Nonzero digits were dropped from the mantissa */
+} decimal_t;
+
+/**
+ * @brief Adds a run of decimal digits to `decimal`, those after the point
+ * when `fraction`. Plain digits take the short way; only a separator goes
+ * through next_digit().
+ *
+ * @return The number of digits.
+ */
+static size_t scan_decimal_digits(const char *text, size_t length, size_t *i, bool fraction, decimal_t *decimal,
+    number_status_t *status) {
+    decimal_t run = *decimal;       // a copy, so the stores need not wait for loads from `text`
+    size_t digits = 0;
+    size_t at = *i;
+    for (;;) {
+        unsigned digit = at < length ? (unsigned)(unsigned char)text[at] - '0' : 10;
+        if (digit < 10) {
+            at++;
+        } else {
+            if (at >= length || text[at] != '_') break;
+            int separated = next_digit(text, length, &at, 10, status);
+            if (separated < 0) break;
+            digit = (unsigned)separated;
+        }
+        digits++;
+        if (run.significant < MAX_MANTISSA_DIGITS) {
+            run.mantissa = run.mantissa * 10 + digit;
+            run.significant += run.mantissa != 0;
+            run.exponent -= fraction;
+        } else {
+            run.exponent += !fraction;
+            run.truncated |= digit != 0;
+        }
+    }
+    *decimal = run;
+    *i = at;
+    return digits;
+}
+
+/**
+ * @brief Scans `0x...` or `0b...`, `shift` being the bits per digit.
+ */
+static number_status_t scan_prefixed(const char *text, size_t length, int shift, number_t *number) {
+    number_status_t status = NUMBER_OK;
+    size_t i = 2;
+    uint64_t value = 0;
+    size_t digits = 0;
+    bool overflow = false;
+    int digit;
+    while ((digit = next_digit(text, length, &i, 1 << shift, &status)) >= 0) {
+        if (value > (uint64_t)INT64_MAX >> shift) overflow = true;
+        value = value << shift | (uint64_t)digit;
+        digits++;
+    }
+    if (status == NUMBER_OK && digits == 0 && !is_word_char(peek(text, length, i))) status = NUMBER_MISSING_DIGITS;
+    status = finish_scan(text, length, i, status, number);
+    if (status == NUMBER_OK && overflow) status = NUMBER_INT_OVERFLOW;
+    if (status == NUMBER_OK) number->value.int_value = (int64_t)value;
+    return status;
+}
+
+number_status_t number_scan(const char *text, size_t length, number_t *number) {
+    number->is_float = false;
+    number->value.int_value = 0;
+
+    char prefix = (char)(peek(text, length, 1) | 0x20);
+    if (peek(text, length, 0) == '0' && (prefix == 'x' || prefix == 'b')) {
+        return scan_prefixed(text, length, prefix == 'x' ? 4 : 1, number);
+    }
+
+    number_status_t status = NUMBER_OK;
+    size_t i = 0;
+    decimal_t decimal = { 0, 0, 0, false };
+    int digit;
+
+    if (scan_decimal_digits(text, length, &i, false, &decimal, &status) == 0 && status == NUMBER_OK) {
+        return finish_scan(text, length, i, NUMBER_MISSING_DIGITS, number);
+    }
+
+    if (status == NUMBER_OK && peek(text, length, i) == '.' && digit_value(peek(text, length, i + 1)) < 10) {
+        number->is_float = true;
+        i++;
+        scan_decimal_digits(text, length, &i, true, &decimal, &status);
+    }
+
+    if (status == NUMBER_OK && (peek(text, length, i) | 0x20) == 'e') {
+        size_t start = i + 1;
+        bool negative = peek(text, length, start) == '-';
+        if (negative || peek(text, length, start) == '+') start++;
+        i = start;
+        if (digit_value(peek(text, length, i)) >= 10) {
+            status = NUMBER_MISSING_DIGITS;
+        } else {
+            number->is_float = true;
+            int64_t written = 0;
+            while ((digit = next_digit(text, length, &i, 10, &status)) >= 0) {
+                if (written < MAX_EXPONENT_DIGITS) written = written * 10 + digit;
+            }
+            decimal.exponent += negative ? -written : written;
+        }
+    }
+
+    status = finish_scan(text, length, i, status, number);
+    if (status != NUMBER_OK) return status;
+
+    if (!number->is_float) {
+        // Past 19 significant digits the exponent grows, and the value is over INT64_MAX
+        if (decimal.exponent > 0 || decimal.mantissa > (uint64_t)INT64_MAX) return NUMBER_INT_OVERFLOW;
+        number->value.int_value = (int64_t)decimal.mantissa;
+        return NUMBER_OK;
+    }
+
+    double value;
+    if (!decimal_to_double(decimal.mantissa, decimal.exponent, decimal.truncated, &value)) {
+        value = slow_decimal_to_double(text, i);
+    }
+    if (isinf(value)) return NUMBER_FLOAT_OVERFLOW;
+    number->value.float_value = value;
+    return NUMBER_OK;
+}
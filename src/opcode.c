@@ -0,0 +1,186 @@
+/**
+ * File Name: opcode.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include "include/opcode.h"
+
+char *opcode_to_string(opcode_t op) {
+    switch (op) {
+        case OP_CONST:          return "CONST";
+        case OP_NULL:           return "NULL";
+        case OP_TRUE:           return "TRUE";
+        case OP_FALSE:          return "FALSE";
+        case OP_POP:            return "POP";
+        case OP_DUP:            return "DUP";
+        case OP_GET_LOCAL:      return "GET_LOCAL";
+        case OP_SET_LOCAL:      return "SET_LOCAL";
+        case OP_GET_GLOBAL:     return "GET_GLOBAL";
+        case OP_SET_GLOBAL:     return "SET_GLOBAL";
+        case OP_ADD:            return "ADD";
+        case OP_SUB:            return "SUB";
+        case OP_MUL:            return "MUL";
+        case OP_DIV:            return "DIV";
+        case OP_MOD:            return "MOD";
+        case OP_NEG:            return "NEG";
+        case OP_NOT:            return "NOT";
+        case OP_EQ:             return "EQ";
+        case OP_NEQ:            return "NEQ";
+        case OP_LT:             return "LT";
+        case OP_LEQ:            return "LEQ";
+        case OP_GT:             return "GT";
+        case OP_GEQ:            return "GEQ";
+        case OP_ADD_INT:        return "ADD_INT";
+        case OP_SUB_INT:        return "SUB_INT";
+        case OP_MUL_INT:        return "MUL_INT";
+        case OP_DIV_INT:        return "DIV_INT";
+        case OP_MOD_INT:        return "MOD_INT";
+        case OP_NEG_INT:        return "NEG_INT";
+        case OP_EQ_INT:         return "EQ_INT";
+        case OP_NEQ_INT:        return "NEQ_INT";
+        case OP_LT_INT:         return "LT_INT";
+        case OP_LEQ_INT:        return "LEQ_INT";
+        case OP_GT_INT:         return "GT_INT";
+        case OP_GEQ_INT:        return "GEQ_INT";
+        case OP_ADD_FLOAT:      return "ADD_FLOAT";
+        case OP_SUB_FLOAT:      return "SUB_FLOAT";
+        case OP_MUL_FLOAT:      return "MUL_FLOAT";
+        case OP_DIV_FLOAT:      return "DIV_FLOAT";
+        case OP_NEG_FLOAT:      return "NEG_FLOAT";
+        case OP_EQ_FLOAT:       return "EQ_FLOAT";
+        case OP_NEQ_FLOAT:      return "NEQ_FLOAT";
+        case OP_LT_FLOAT:       return "LT_FLOAT";
+        case OP_LEQ_FLOAT:      return "LEQ_FLOAT";
+        case OP_GT_FLOAT:       return "GT_FLOAT";
+        case OP_GEQ_FLOAT:      return "GEQ_FLOAT";
+        case OP_TO_FLOAT:       return "TO_FLOAT";
+        case OP_JUMP:           return "JUMP";
+        case OP_JUMP_IF_FALSE:  return "JUMP_IF_FALSE";
+        case OP_CALL:           return "CALL";
+        case OP_TAIL_CALL:      return "TAIL_CALL";
+        case OP_RETURN:         return "RETURN";
+        case OP_PRINT:          return "PRINT";
+        case OP_PARALLEL_FOR:   return "PARALLEL_FOR";
+        case OP_REDUCE:         return "REDUCE";
+        case OP_SPAWN:          return "SPAWN";
+        case OP_AWAIT:          return "AWAIT";
+        case OP_SLEEP:          return "SLEEP";
+        case OP_WAIT_FD:        return "WAIT_FD";
+        case OP_NEW_ARRAY:      return "NEW_ARRAY";
+        case OP_INDEX:          return "INDEX";
+        case OP_SET_INDEX:      return "SET_INDEX";
+        case OP_LEN:            return "LEN";
+        case OP_SUM:            return "SUM";
+        case OP_DOT:            return "DOT";
+#define SUPERINSTRUCTION(name, first, second, third) \
+        case name:              return #name + 3;
+#include "include/superinstructions.h"
+#undef SUPERINSTRUCTION
+        default:                return "UNKNOWN";
+    }
+}
+
+size_t opcode_operand_size(opcode_t op) {
+    opcode_t components[OP_MAX_COMPONENTS];
+    if (opcode_components(op, components)) {
+        op = components[0];
+    }
+    switch (op) {
+        case OP_CONST:
+        case OP_GET_LOCAL:
+        case OP_SET_LOCAL:
+        case OP_GET_GLOBAL:
+        case OP_SET_GLOBAL:
+            return 2;
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+            return 4;
+        case OP_CALL:
+        case OP_TAIL_CALL:
+        case OP_SPAWN:
+            return 3;
+        case OP_PRINT:
+        case OP_REDUCE:
+        case OP_WAIT_FD:
+        case OP_NEW_ARRAY:
+        case OP_SET_INDEX:
+            return 1;
+        case OP_PARALLEL_FOR:
+            return 11;
+        default:
+            return 0;
+    }
+}
+
+size_t opcode_components(opcode_t op, opcode_t components[OP_MAX_COMPONENTS]) {
+    switch (op) {
+#define SUPERINSTRUCTION(name, first, second, third) \
+        case name: \
+            components[0] = first; \
+            components[1] = second; \
+            components[2] = third; \
+            return third == OP_COUNT ? 2 : 3;
+#include "include/superinstructions.h"
+#undef SUPERINSTRUCTION
+        default:
+            return 0;
+    }
+}
+
+bool opcode_fusible(opcode_t op, size_t position, size_t length) {
+    switch (op) {
+        // Never fall back; typed int comparisons report wrong operands themselves.
+        case OP_CONST:
+        case OP_NULL:
+        case OP_TRUE:
+        case OP_FALSE:
+        case OP_POP:
+        case OP_DUP:
+        case OP_GET_LOCAL:
+        case OP_SET_LOCAL:
+        case OP_GET_GLOBAL:
+        case OP_NOT:
+        case OP_EQ:
+        case OP_NEQ:
+        case OP_EQ_INT:
+        case OP_NEQ_INT:
+        case OP_LT_INT:
+        case OP_LEQ_INT:
+        case OP_GT_INT:
+        case OP_GEQ_INT:
+        case OP_ADD_FLOAT:
+        case OP_SUB_FLOAT:
+        case OP_MUL_FLOAT:
+        case OP_DIV_FLOAT:
+        case OP_NEG_FLOAT:
+        case OP_EQ_FLOAT:
+        case OP_NEQ_FLOAT:
+        case OP_LT_FLOAT:
+        case OP_LEQ_FLOAT:
+        case OP_GT_FLOAT:
+        case OP_GEQ_FLOAT:
+        case OP_TO_FLOAT:
+            return position < length;
+        // Fall back to the plain instruction off their fast path.
+        case OP_SET_GLOBAL:
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_LT:
+        case OP_LEQ:
+        case OP_GT:
+        case OP_GEQ:
+        case OP_ADD_INT:
+        case OP_SUB_INT:
+        case OP_MUL_INT:
+        case OP_DIV_INT:
+        case OP_MOD_INT:
+            return position > 0;
+        // Leave the sequence.
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+            return position > 0 && position + 1 == length;
+        default:
+            return false;
+    }
+}
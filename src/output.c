@@ -0,0 +1,369 @@
+/**
+ * File Name: output.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "include/output.h"
+#include "include/array.h"
+#include "include/str.h"
+#include "include/utils.h"
+
+typedef struct output_buffer_struct {
+    char *data;
+    size_t used;
+    struct output_buffer_struct *next;
+} output_buffer_t;
+
+static output_mode_t output_mode = OUTPUT_AUTO;
+static atomic_int line_buffered = -1;   /**< output_mode resolved on first use */
+
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(output_buffer_t *) output_buffers = NULL;
+static atomic_flag exit_registered = ATOMIC_FLAG_INIT;
+static _Thread_local output_buffer_t *local_buffer = NULL;
+
+void output_set_mode(output_mode_t mode) {
+    output_mode = mode;
+    atomic_store(&line_buffered, -1);
+}
+
+static bool is_line_buffered(void) {
+    int line = atomic_load_explicit(&line_buffered, memory_order_relaxed);
+    if (line < 0) {
+        line = output_mode == OUTPUT_LINE_BUFFERED || (output_mode == OUTPUT_AUTO && isatty(STDOUT_FILENO));
+        atomic_store_explicit(&line_buffered, line, memory_order_relaxed);
+    }
+    return line;
+}
+
+/**
+ * @brief Returns the calling thread's buffer, creating and publishing it on first use.
+ */
+static output_buffer_t *thread_buffer(void) {
+    if (local_buffer) return local_buffer;
+
+    output_buffer_t *buffer = calloc(1, sizeof(output_buffer_t));
+    CHECK_MEM_ALLOC_ERROR(buffer);
+    buffer->data = malloc(OUTPUT_BUFFER_SIZE);
+    CHECK_MEM_ALLOC_ERROR(buffer->data);
+
+    buffer->next = atomic_load(&output_buffers);
+    while (!atomic_compare_exchange_weak(&output_buffers, &buffer->next, buffer)) {
+        // buffer->next was reloaded, retry
+    }
+    if (!atomic_flag_test_and_set(&exit_registered)) {
+        atexit(output_flush_all);
+    }
+    local_buffer = buffer;
+    return buffer;
+}
+
+//------------------------------------------------------------------------------
+// writing
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Writes the pieces to stdout in order, retrying partial writes. The
+ * lock keeps one flush from being interleaved with another thread's.
+ */
+static void write_out(struct iovec *iov, int count) {
+    pthread_mutex_lock(&write_lock);
+    while (count > 0) {
+        ssize_t written = writev(STDOUT_FILENO, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            break;  // e.g. stdout was closed; the output is dropped
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+    pthread_mutex_unlock(&write_lock);
+}
+
+/**
+ * @brief Writes out the buffer followed by `extra`, which is not copied.
+ */
+static void flush_buffer(output_buffer_t *buffer, const char *extra, size_t extra_length) {
+    struct iovec iov[2];
+    int count = 0;
+    if (buffer->used > 0) {
+        iov[count].iov_base = buffer->data;
+        iov[count++].iov_len = buffer->used;
+    }
+    if (extra_length > 0) {
+        iov[count].iov_base = (void *)extra;
+        iov[count++].iov_len = extra_length;
+    }
+    if (count > 0) {
+        write_out(iov, count);
+    }
+    buffer->used = 0;
+}
+
+static void put(output_buffer_t *buffer, const char *chars, size_t length) {
+    if (length > OUTPUT_BUFFER_SIZE - buffer->used) {
+        if (length >= OUTPUT_DIRECT_MIN) {
+            flush_buffer(buffer, chars, length);
+            return;
+        }
+        flush_buffer(buffer, NULL, 0);
+    }
+    memcpy(buffer->data + buffer->used, chars, length);
+    buffer->used += length;
+}
+
+/**
+ * @brief Makes room for `length` more bytes, flushing if needed.
+ */
+static char *reserve(output_buffer_t *buffer, size_t length) {
+    if (length > OUTPUT_BUFFER_SIZE - buffer->used) {
+        flush_buffer(buffer, NULL, 0);
+    }
+    return buffer->data + buffer->used;
+}
+
+void output_flush(void) {
+    if (local_buffer) {
+        flush_buffer(local_buffer, NULL, 0);
+    }
+}
+
+void output_flush_all(void) {
+    for (output_buffer_t *buffer = atomic_load(&output_buffers); buffer; buffer = buffer->next) {
+        flush_buffer(buffer, NULL, 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+// formatting
+//------------------------------------------------------------------------------
+
+static const char digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+size_t output_format_int(char *out, int64_t value) {
+    char digits[20];
+    char *end = digits + sizeof(digits);
+    char *p = end;
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    while (magnitude >= 100) {
+        const char *pair = &digit_pairs[(magnitude % 100) * 2];
+        magnitude /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (magnitude >= 10) {
+        *--p = digit_pairs[magnitude * 2 + 1];
+        *--p = digit_pairs[magnitude * 2];
+    } else {
+        *--p = (char)('0' + magnitude);
+    }
+
+    size_t length = 0;
+    if (value < 0) out[length++] = '-';
+    memcpy(out + length, p, (size_t)(end - p));
+    return length + (size_t)(end - p);
+}
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define FLOAT_DIGITS 6      /**< Significant digits of "%g" */
+#define MAX_EXACT_POWER 22  /**< 10^22 is the largest power of ten a double holds exactly */
+
+/**
+ * @brief Infinities, NaNs, very large or small magnitudes and values that
+ * sit almost exactly halfway between two 6 digit results go through
+ * snprintf(), which rounds from the exact binary value.
+ */
+static size_t format_float_slow(char *out, double value) {
+    char text[OUTPUT_NUMBER_MAX];
+    int length = snprintf(text, sizeof(text), "%g", value);
+    memcpy(out, text, (size_t)length);
+    return (size_t)length;
+}
+
+size_t output_format_float(char *out, double value) {
+    if (value == 0.0) {
+        size_t length = 0;
+        if (signbit(value)) out[length++] = '-';
+        out[length++] = '0';
+        return length;
+    }
+    if (!isfinite(value)) {
+        return format_float_slow(out, value);
+    }
+
+    // Scale to a 6 digit integer with a single exact power of ten, so the
+    // product is off by at most half an ulp, then round it.
+    double magnitude = fabs(value);
+    int exponent = (int)floor(log10(magnitude));
+    uint32_t mantissa = 0;
+    for (int attempt = 0; ; ++attempt) {
+        int shift = FLOAT_DIGITS - 1 - exponent;
+        if (attempt == 3 || shift > MAX_EXACT_POWER || shift < -MAX_EXACT_POWER) {
+            return format_float_slow(out, value);
+        }
+        double scaled = shift >= 0 ? magnitude * powers_of_ten[shift] : magnitude / powers_of_ten[-shift];
+        double whole = floor(scaled);
+        // log10() can be one off next to a power of ten.
+        if (whole >= 1e6) {
+            exponent++;
+            continue;
+        }
+        if (whole < 1e5) {
+            exponent--;
+            continue;
+        }
+        double fraction = scaled - whole;
+        if (fabs(fraction - 0.5) < 1e-6) {
+            return format_float_slow(out, value);
+        }
+        mantissa = (uint32_t)whole + (fraction > 0.5);
+        if (mantissa == 1000000) {
+            mantissa = 100000;
+            exponent++;
+        }
+        break;
+    }
+
+    char digits[FLOAT_DIGITS];
+    for (int i = FLOAT_DIGITS - 1; i >= 0; --i) {
+        digits[i] = (char)('0' + mantissa % 10);
+        mantissa /= 10;
+    }
+    size_t significant = FLOAT_DIGITS;
+    while (significant > 1 && digits[significant - 1] == '0') {
+        significant--;
+    }
+
+    size_t length = 0;
+    if (value < 0) out[length++] = '-';
+    if (exponent < -4 || exponent >= FLOAT_DIGITS) {
+        out[length++] = digits[0];
+        if (significant > 1) {
+            out[length++] = '.';
+            memcpy(out + length, digits + 1, significant - 1);
+            length += significant - 1;
+        }
+        int e = exponent < 0 ? -exponent : exponent;
+        out[length++] = 'e';
+        out[length++] = exponent < 0 ? '-' : '+';
+        out[length++] = digit_pairs[e * 2];
+        out[length++] = digit_pairs[e * 2 + 1];
+    } else if (exponent >= 0) {
+        size_t whole_digits = (size_t)exponent + 1;
+        memcpy(out + length, digits, whole_digits);
+        length += whole_digits;
+        if (significant > whole_digits) {
+            out[length++] = '.';
+            memcpy(out + length, digits + whole_digits, significant - whole_digits);
+            length += significant - whole_digits;
+        }
+    } else {
+        out[length++] = '0';
+        out[length++] = '.';
+        for (int i = -1; i > exponent; --i) {
+            out[length++] = '0';
+        }
+        memcpy(out + length, digits, significant);
+        length += significant;
+    }
+    return length;
+}
+
+//------------------------------------------------------------------------------
+// printing
+//------------------------------------------------------------------------------
+
+#define PUT_LITERAL(buffer, text) put((buffer), (text), sizeof(text) - 1)
+
+static void put_array(output_buffer_t *buffer, const array_t *array) {
+    PUT_LITERAL(buffer, "[");
+    for (size_t i = 0; i < array->length; ++i) {
+        char *out = reserve(buffer, OUTPUT_NUMBER_MAX + 2);
+        size_t length = 0;
+        if (i > 0) {
+            out[length++] = ',';
+            out[length++] = ' ';
+        }
+        if (array->element_type == VALUE_FLOAT) {
+            length += output_format_float(out + length, array->as.floats[i]);
+        } else {
+            length += output_format_int(out + length, array->as.ints[i]);
+        }
+        buffer->used += length;
+    }
+    PUT_LITERAL(buffer, "]");
+}
+
+static void put_value(output_buffer_t *buffer, value_t value) {
+    switch (value_type(value)) {
+        case VALUE_NULL:
+            PUT_LITERAL(buffer, "null");
+            break;
+        case VALUE_BOOL:
+            if (AS_BOOL(value)) {
+                PUT_LITERAL(buffer, "true");
+            } else {
+                PUT_LITERAL(buffer, "false");
+            }
+            break;
+        case VALUE_INT: {
+            char *out = reserve(buffer, OUTPUT_NUMBER_MAX);
+            buffer->used += output_format_int(out, AS_INT(value));
+            break;
+        }
+        case VALUE_FLOAT: {
+            char *out = reserve(buffer, OUTPUT_NUMBER_MAX);
+            buffer->used += output_format_float(out, AS_FLOAT(value));
+            break;
+        }
+        case VALUE_STRING:
+            put(buffer, string_chars(AS_STRING(value)), AS_STRING(value)->length);
+            break;
+        case VALUE_TASK:
+            PUT_LITERAL(buffer, "<task>");
+            break;
+        case VALUE_ARRAY:
+            put_array(buffer, AS_ARRAY(value));
+            break;
+    }
+}
+
+void output_print(const value_t *values, size_t count) {
+    output_buffer_t *buffer = thread_buffer();
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) PUT_LITERAL(buffer, " ");
+        put_value(buffer, values[i]);
+    }
+    PUT_LITERAL(buffer, "\n");
+    if (is_line_buffered()) {
+        flush_buffer(buffer, NULL, 0);
+    }
+}
@@ -6,6 +6,7 @@
 #include "include/parser.h"
 #include "include/ast.h"
 #include "include/utils.h"
+#include "include/trace.h"
 
 parser_t *init_parser(lexer_t *lexer) {
     parser_t *parser = malloc(sizeof(parser_t));
@@ -17,6 +18,11 @@ parser_t *init_parser(lexer_t *lexer) {
     parser->current = lexer->tokens[0];
     parser->previous = lexer->tokens[0];
     parser->ast = init_ast();
+    parser->ast->source_map = source_map_retain(lexer->source);
+    parser->blocks = 0;
+    parser->depth = 0;
+    parser->nesting = 0;
+    parser->height = 0;
     return parser;
 }
 
@@ -55,9 +61,30 @@ token_t *parser_peek_token(parser_t *parser, size_t dist) {
     return NULL;
 }
 
+/**
+ * @brief Starts an error message on stderr with the `[line:column]` of `offset`.
+ */
+static void parser_error_at(const parser_t *parser, uint32_t offset) {
+    size_t line, column;
+    source_map_locate(parser->lexer->source, offset, &line, &column);
+    fprintf(stderr, "[%zu:%zu] ", line, column);
+}
+
+/**
+ * @brief Fails with the lexer's message for the current TOKEN_INVALID, such
+ * as an unterminated string or an int literal out of range.
+ */
+static void parser_invalid_token(parser_t *parser) {
+    parser_error_at(parser, parser->current->offset);
+    fprintf(stderr, "%s\n", parser->current->value);
+    exit(EXIT_FAILURE);
+}
+
 void parser_expect_advance(parser_t *parser, token_type_t type) {
     if (!parser_match(parser, type)) {
-        fprintf(stderr, "[%ld:%ld] Expected token type <%s> but got <%s>\n",parser->current->line, parser->current->column,  token_type_to_string(type), token_type_to_string(parser->current->type));
+        if (parser->current->type == TOKEN_INVALID) parser_invalid_token(parser);
+        parser_error_at(parser, parser->current->offset);
+        fprintf(stderr, "Expected token type <%s> but got <%s>\n", token_type_to_string(type), token_type_to_string(parser->current->type));
         exit(EXIT_FAILURE);
     }
     parser_advance(parser);
@@ -70,9 +97,42 @@ void parser_expect(parser_t *parser, token_type_t type) {
     }
 }
 
+/**
+ * @brief Fails with an error once `levels` is past AST_MAX_DEPTH.
+ */
+static void parser_check_depth(parser_t *parser, size_t levels, const char *what) {
+    if (levels <= AST_MAX_DEPTH) return;
+    parser_error_at(parser, parser->current->offset);
+    fprintf(stderr, "%s nested too deeply, more than %d levels\n", what, AST_MAX_DEPTH);
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Records the shape of the expression just built, failing once it is
+ * nested past AST_MAX_DEPTH or has a path longer than AST_MAX_HEIGHT.
+ */
+static void parser_set_shape(parser_t *parser, size_t nesting, size_t height) {
+    parser_check_depth(parser, nesting, "Expression");
+    if (height > AST_MAX_HEIGHT) {
+        parser_error_at(parser, parser->current->offset);
+        fprintf(stderr, "Expression too long, more than %d nodes on one path\n", AST_MAX_HEIGHT);
+        exit(EXIT_FAILURE);
+    }
+    parser->nesting = nesting;
+    parser->height = height;
+}
+
 void parser_parse_program(parser_t *parser) {
     while (parser->current && parser->current->type != TOKEN_EOF) {
+        bool is_function = parser->current->type == TOKEN_FUNC || parser->current->type == TOKEN_ASYNC;
+        const char *trace_name = is_function ? "parse func" : "parse global";
+        if (trace_enabled) {
+            size_t name_offset = parser->current->type == TOKEN_ASYNC ? 2 : 1;
+            token_t *name = is_function ? parser_peek_token(parser, name_offset) : parser->current;
+            trace_begin(trace_name, name ? name->value : NULL);
+        }
         ast_node_t *node = parser_parse_declaration(parser);
+        TRACE_END(trace_name);
         if (node) {
             if (parser->ast->node_count >= parser->ast->nodes_capacity) {
                 parser->ast->nodes_capacity *= 2;
@@ -87,11 +147,20 @@ void parser_parse_program(parser_t *parser) {
 
 ast_node_t *parser_parse_declaration(parser_t *parser) {
     if (parser_match(parser, TOKEN_FUNC)) {
-        ast_node_t *decl_node = init_ast_node(AST_NODE_CATEGORY_DECL, parser->current->line, parser->current->column);
+        ast_node_t *decl_node = init_ast_node(AST_NODE_CATEGORY_DECL, parser->current->offset);
         decl_node->data.decl_node = parser_parse_function_decl(parser);
         return decl_node;
+    } else if (parser_match(parser, TOKEN_ASYNC)) {
+        ast_node_t *decl_node = init_ast_node(AST_NODE_CATEGORY_DECL, parser->current->offset);
+        uint32_t offset = parser->current->offset;
+        parser_advance(parser);
+        ast_decl_node_t *decl = parser_parse_function_decl(parser);
+        decl->data.function_decl->is_async = true;
+        decl->offset = offset;
+        decl_node->data.decl_node = decl;
+        return decl_node;
     } else if (parser_match(parser, TOKEN_IDENTIFIER)) {
-        ast_node_t *decl_node = init_ast_node(AST_NODE_CATEGORY_STMT, parser->current->line, parser->current->column);
+        ast_node_t *decl_node = init_ast_node(AST_NODE_CATEGORY_STMT, parser->current->offset);
         decl_node->data.stmt_node = parser_parse_var_decl(parser);;
         parser_expect_advance(parser, TOKEN_SEMICOLON);
         return decl_node;
@@ -105,8 +174,7 @@ ast_node_t *parser_parse_declaration(parser_t *parser) {
 }
 
 ast_decl_node_t *parser_parse_function_decl(parser_t *parser) {
-    size_t line = parser->current->line;
-    size_t column = parser->current->column;
+    uint32_t offset = parser->current->offset;
     parser_expect_advance(parser, TOKEN_FUNC);
     char *name = parser->current->value;
     parser_expect_advance(parser, TOKEN_IDENTIFIER);
@@ -146,7 +214,7 @@ ast_decl_node_t *parser_parse_function_decl(parser_t *parser) {
     //--------------------------------------------------------------------------
 
     parser_expect_advance(parser, TOKEN_RBRACE);
-    return init_decl_function(name, return_type, param_list, body, body_count, line, column);
+    return init_decl_function(name, return_type, param_list, body, body_count, offset);
 }
 
 param_list_t *parser_parse_param_list(parser_t *parser) {
@@ -172,8 +240,7 @@ param_list_t *parser_parse_param_list(parser_t *parser) {
     CHECK_MEM_ALLOC_ERROR(param_list);
     param_list->params = params;
     param_list->param_count = param_count;
-    param_list->line = parser->current->line;
-    param_list->column = parser->current->column;
+    param_list->offset = parser->current->offset;
     return param_list;
 }
 
@@ -186,19 +253,30 @@ param_t *parser_parse_param(parser_t *parser) {
     CHECK_MEM_ALLOC_ERROR(param);
     param->name = strdup(name);
     param->type = type;
-    param->line = parser->current->line;
-    param->column = parser->current->column;
+    param->offset = parser->current->offset;
     return param;
 }
 
+/**
+ * @brief Consumes `[]` after an element type if present.
+ */
+static bool parser_parse_array_suffix(parser_t *parser) {
+    if (!parser_match(parser, TOKEN_LBRACKET)) {
+        return false;
+    }
+    parser_advance(parser);
+    parser_expect_advance(parser, TOKEN_RBRACKET);
+    return true;
+}
+
 data_type_t parser_parse_type(parser_t *parser) {
     switch (parser->current->type) {
         case TOKEN_TYPE_INT:
             parser_advance(parser);
-            return DATA_TYPE_INT;
+            return parser_parse_array_suffix(parser) ? DATA_TYPE_INT_ARRAY : DATA_TYPE_INT;
         case TOKEN_TYPE_FLOAT:
             parser_advance(parser);
-            return DATA_TYPE_FLOAT;
+            return parser_parse_array_suffix(parser) ? DATA_TYPE_FLOAT_ARRAY : DATA_TYPE_FLOAT;
         case TOKEN_TYPE_STRING:
             parser_advance(parser);
             return DATA_TYPE_STRING;
@@ -215,15 +293,14 @@ data_type_t parser_parse_type(parser_t *parser) {
 }
 
 ast_stmt_node_t *parser_parse_var_decl(parser_t *parser) {
-    size_t line = parser->current->line;
-    size_t column = parser->current->column;
+    uint32_t offset = parser->current->offset;
     parser_expect_advance(parser, TOKEN_IDENTIFIER);
     char *name = parser->previous->value;
     parser_expect_advance(parser, TOKEN_COLON);
     data_type_t type = parser_parse_type(parser);
     parser_expect_advance(parser, TOKEN_EQ);
     ast_expr_node_t *expr_initializer = parser_parse_expression(parser);
-    ast_stmt_node_t *node = init_stmt_var_decl(name, type, expr_initializer, line, column);
+    ast_stmt_node_t *node = init_stmt_var_decl(name, type, expr_initializer, offset);
     return node;
 }
 
@@ -234,13 +311,17 @@ ast_stmt_node_t *parser_parse_statement(parser_t *parser) {
             ast_stmt_node_t *node = parser_parse_var_decl(parser);
             parser_expect_advance(parser, TOKEN_SEMICOLON);
             return node;
-        } else if (next->type == TOKEN_EQ) {
+        } else if (parser_is_assignment_operator(next->type)) {
             ast_stmt_node_t *node = parser_parse_assignment(parser);
             parser_expect_advance(parser, TOKEN_SEMICOLON);
             return node;
+        } else if (next->type == TOKEN_LBRACKET) {
+            ast_stmt_node_t *node = parser_parse_index_statement(parser);
+            parser_expect_advance(parser, TOKEN_SEMICOLON);
+            return node;
         } else {
             ast_expr_node_t *expr = parser_parse_expression(parser);
-            ast_stmt_node_t *stmt = init_stmt_expr(expr, parser->current->line, parser->current->column);
+            ast_stmt_node_t *stmt = init_stmt_expr(expr, parser->current->offset);
             parser_expect_advance(parser, TOKEN_SEMICOLON);
             return stmt;
         }
@@ -255,12 +336,12 @@ ast_stmt_node_t *parser_parse_statement(parser_t *parser) {
         parser_expect_advance(parser, TOKEN_SEMICOLON);
         return stmt;
     } else if (parser_match(parser, TOKEN_BREAK)) {
-        ast_stmt_node_t *stmt = init_stmt_break(parser->current->line, parser->current->column);
+        ast_stmt_node_t *stmt = init_stmt_break(parser->current->offset);
         parser_advance(parser);
         parser_expect_advance(parser, TOKEN_SEMICOLON);
         return stmt;
     } else if (parser_match(parser, TOKEN_CONTINUE)) {
-        ast_stmt_node_t *stmt = init_stmt_continue(parser->current->line, parser->current->column);
+        ast_stmt_node_t *stmt = init_stmt_continue(parser->current->offset);
         parser_advance(parser);
         parser_expect_advance(parser, TOKEN_SEMICOLON);
         return stmt;
@@ -271,6 +352,13 @@ ast_stmt_node_t *parser_parse_statement(parser_t *parser) {
     } else if (parser_match(parser, TOKEN_FOR)) {
         ast_stmt_node_t *stmt = parser_parse_for_statement(parser);
         return stmt;
+    } else if (parser_match(parser, TOKEN_PARALLEL)) {
+        uint32_t offset = parser->current->offset;
+        parser_advance(parser);
+        ast_stmt_node_t *stmt = parser_parse_for_statement(parser);
+        stmt->data.for_stmt->parallel = true;
+        stmt->offset = offset;
+        return stmt;
     } else if (parser_match(parser, TOKEN_WHILE)) {
         ast_stmt_node_t *stmt = parser_parse_while_statement(parser);
         return stmt;
@@ -278,26 +366,70 @@ ast_stmt_node_t *parser_parse_statement(parser_t *parser) {
         parser_advance(parser);
     } else {
         ast_expr_node_t *expr = parser_parse_expression(parser);
-        ast_stmt_node_t *stmt = init_stmt_expr(expr, parser->current->line, parser->current->column);
+        ast_stmt_node_t *stmt = init_stmt_expr(expr, parser->current->offset);
         parser_expect_advance(parser, TOKEN_SEMICOLON);
         return stmt;
     }
-    ast_expr_node_t *lit_int = init_expr_literal_int(0, parser->current->line, parser->current->column);
-    ast_stmt_node_t *dummy_node = init_stmt_assign("test", lit_int, parser->current->line, parser->current->column);
+    ast_expr_node_t *lit_int = init_expr_literal_int(0, parser->current->offset);
+    ast_stmt_node_t *dummy_node = init_stmt_assign("test", lit_int, parser->current->offset);
     return dummy_node;
 }
 
+bool parser_is_assignment_operator(token_type_t type) {
+    switch (type) {
+        case TOKEN_EQ:
+        case TOKEN_PLUSEQ:
+        case TOKEN_MINUSEQ:
+        case TOKEN_ASTERISKEQ:
+        case TOKEN_SLASHEQ:
+        case TOKEN_PERCENT_EQ:
+            return true;
+        default:
+            return false;
+    }
+}
+
 ast_stmt_node_t *parser_parse_assignment(parser_t *parser) {
     char *name = parser->current->value;
     parser_expect_advance(parser, TOKEN_IDENTIFIER);
-    parser_expect_advance(parser, TOKEN_EQ);
+    token_type_t operator = parser->current->type;
+    if (!parser_is_assignment_operator(operator)) {
+        parser_expect_advance(parser, TOKEN_EQ);
+    }
+    parser_advance(parser);
     ast_expr_node_t *value = parser_parse_expression(parser);
-    return init_stmt_assign(name, value, parser->current->line, parser->current->column);
+    return init_stmt_compound_assign(name, operator, value, parser->current->offset);
+}
+
+/**
+ * @brief Parses `name[index] = value` (or a compound operator), or an
+ * expression statement that starts with `name[index]`.
+ */
+ast_stmt_node_t *parser_parse_index_statement(parser_t *parser) {
+    uint32_t offset = parser->current->offset;
+    ast_expr_node_t *target = parser_parse_expression(parser);
+    if (!parser->current || !parser_is_assignment_operator(parser->current->type)) {
+        return init_stmt_expr(target, offset);
+    }
+    if (target->type != EXPR_INDEX || target->data.index->array->type != EXPR_IDENTIFIER) {
+        parser_error_at(parser, offset);
+        fprintf(stderr, "Only a variable or an element of an array variable can be assigned\n");
+        exit(EXIT_FAILURE);
+    }
+
+    token_type_t operator = parser->current->type;
+    parser_advance(parser);
+    ast_expr_node_t *value = parser_parse_expression(parser);
+    ast_expr_node_t *index = target->data.index->index;
+    target->data.index->index = NULL;
+    ast_stmt_node_t *stmt = init_stmt_index_assign(target->data.index->array->data.identifier->name, index,
+        operator, value, offset);
+    free_expr_node(target);
+    return stmt;
 }
 
 ast_stmt_node_t *parser_parse_if_statement(parser_t *parser) {
-    size_t line = parser->current->line;
-    size_t column = parser->current->column;
+    uint32_t offset = parser->current->offset;
 
     //======================== if block ===========================================
     parser_expect_advance(parser, TOKEN_IF);
@@ -344,13 +476,12 @@ ast_stmt_node_t *parser_parse_if_statement(parser_t *parser) {
     }
     //=============================================================================
 
-    return init_stmt_if(if_condition, if_block, elif_conditions, elif_count, elif_blocks, else_block, line, column);
+    return init_stmt_if(if_condition, if_block, elif_conditions, elif_count, elif_blocks, else_block, offset);
 }
 
 ast_stmt_node_t *parser_parse_for_statement(parser_t *parser) {
     parser_expect_advance(parser, TOKEN_FOR);
-    size_t line = parser->previous->line;
-    size_t column = parser->previous->column;
+    uint32_t offset = parser->previous->offset;
 
     parser_expect_advance(parser, TOKEN_LPAREN);
 
@@ -366,14 +497,17 @@ ast_stmt_node_t *parser_parse_for_statement(parser_t *parser) {
                 data_type_t type = parser_parse_type(parser);
                 parser_expect_advance(parser, TOKEN_EQ);
                 ast_expr_node_t *value = parser_parse_expression(parser);
-                init = init_stmt_for_init_var_decl(identifier->value, type, value, line, column);
+                init = init_stmt_for_init_var_decl(identifier->value, type, value, offset);
             } else if (next->type == TOKEN_EQ) {
-                parser_parse_assignment(parser);
+                parser_advance(parser); // skip identifier
+                parser_expect_advance(parser, TOKEN_EQ);
+                ast_expr_node_t *value = parser_parse_expression(parser);
+                init = init_stmt_for_init_assign(identifier->value, value, offset);
             } else {
-                parser_parse_expression(parser); 
+                init = init_stmt_for_init_expr(parser_parse_expression(parser), offset);
             }
         } else {
-            parser_parse_expression(parser);
+            init = init_stmt_for_init_expr(parser_parse_expression(parser), offset);
         }
     }
     //=============================================================================
@@ -394,12 +528,18 @@ ast_stmt_node_t *parser_parse_for_statement(parser_t *parser) {
         if (parser_match(parser, TOKEN_IDENTIFIER)) {
             token_t *identifier = parser->current;
             parser_advance(parser); // skip identifier
-            parser_expect_advance(parser, TOKEN_EQ);
+            token_type_t operator = parser->current->type;
+            if (!parser_is_assignment_operator(operator)) {
+                parser_expect_advance(parser, TOKEN_EQ);
+            }
+            parser_advance(parser);
             ast_expr_node_t *value = parser_parse_expression(parser);
             increment = malloc(sizeof(stmt_assign_t));
             CHECK_MEM_ALLOC_ERROR(increment);
             increment->name = strdup(identifier->value);
+            increment->operator = operator;
             increment->value = value;
+            increment->index = NULL;
         } else {
             parser_parse_expression(parser);
         }
@@ -410,7 +550,7 @@ ast_stmt_node_t *parser_parse_for_statement(parser_t *parser) {
     //==================== for block ==============================================
     ast_stmt_node_t *block = parser_parse_block_statement(parser);
     //=============================================================================
-    ast_stmt_node_t *stmt = init_stmt_for(init, condition, increment, block, line, column);
+    ast_stmt_node_t *stmt = init_stmt_for(init, condition, increment, block, offset);
     return stmt;
 }
 
@@ -428,7 +568,7 @@ ast_stmt_node_t *parser_parse_while_statement(parser_t *parser) {
     ast_stmt_node_t *block = parser_parse_block_statement(parser);
     //=============================================================================
 
-    ast_stmt_node_t *stmt = init_stmt_while(condition, block, parser->previous->line, parser->previous->column);
+    ast_stmt_node_t *stmt = init_stmt_while(condition, block, parser->previous->offset);
     return stmt;
 }
 
@@ -437,7 +577,7 @@ ast_stmt_node_t *parser_parse_print_statement(parser_t *parser) {
     parser_expect_advance(parser, TOKEN_LPAREN);
     expr_arg_list_t *args = parser_parse_arg_list(parser);
     parser_expect_advance(parser, TOKEN_RPAREN);
-    ast_stmt_node_t *stmt = init_stmt_print(args, parser->current->line, parser->current->column);
+    ast_stmt_node_t *stmt = init_stmt_print(args, parser->current->offset);
     return stmt;
 }
 
@@ -448,14 +588,14 @@ ast_stmt_node_t *parser_parse_return_statement(parser_t *parser) {
         value = parser_parse_expression(parser);
     }
 
-    ast_stmt_node_t *stmt = init_stmt_return(value, parser->current->line, parser->current->column);
+    ast_stmt_node_t *stmt = init_stmt_return(value, parser->current->offset);
     return stmt;
 }
 
 ast_stmt_node_t *parser_parse_block_statement(parser_t *parser) {
-    size_t line = parser->current->line;
-    size_t column = parser->current->column;
+    uint32_t offset = parser->current->offset;
     parser_expect_advance(parser, TOKEN_LBRACE);
+    parser_check_depth(parser, ++parser->blocks, "Blocks");
     size_t body_capacity = 1;
     size_t body_count = 0;
     ast_stmt_node_t **body = malloc(sizeof(ast_stmt_node_t *) * body_capacity);
@@ -469,128 +609,150 @@ ast_stmt_node_t *parser_parse_block_statement(parser_t *parser) {
         body[body_count++] = parser_parse_statement(parser);
     }
     parser_expect_advance(parser, TOKEN_RBRACE);
-    ast_stmt_node_t *stmt = init_stmt_block(body, body_count, line, column);
+    parser->blocks--;
+    ast_stmt_node_t *stmt = init_stmt_block(body, body_count, offset);
     return stmt;
 }
 
-ast_expr_node_t *parser_parse_expression(parser_t *parser) {
-    return parser_parse_logical_or(parser);
-}
-
-ast_expr_node_t *parser_parse_logical_or(parser_t *parser) {
-    ast_expr_node_t *left = parser_parse_logical_and(parser);
-    
-    while (parser_match(parser, TOKEN_OR)) {
-        parser_advance(parser);
-        ast_expr_node_t *right = parser_parse_logical_and(parser);
-        left = init_expr_binary(TOKEN_OR, left, right, parser->current->line, parser->current->column);
-    }
-    return left;
-}
+/**
+ * Binding power of the binary operators, loosest first. Every level is left
+ * associative. Tokens that are not binary operators are 0 and end an operand.
+ */
+enum {
+    PRECEDENCE_NONE,
+    PRECEDENCE_OR,          // ||
+    PRECEDENCE_AND,         // &&
+    PRECEDENCE_EQUALITY,    // == !=
+    PRECEDENCE_COMPARISON,  // < <= > >=
+    PRECEDENCE_TERM,        // + -
+    PRECEDENCE_FACTOR       // * / %
+};
+
+static const uint8_t binary_precedence[TOKEN_INVALID + 1] = {
+    [TOKEN_OR] = PRECEDENCE_OR,
+    [TOKEN_AND] = PRECEDENCE_AND,
+    [TOKEN_EQEQ] = PRECEDENCE_EQUALITY,
+    [TOKEN_NEQ] = PRECEDENCE_EQUALITY,
+    [TOKEN_GT] = PRECEDENCE_COMPARISON,
+    [TOKEN_GEQ] = PRECEDENCE_COMPARISON,
+    [TOKEN_LT] = PRECEDENCE_COMPARISON,
+    [TOKEN_LEQ] = PRECEDENCE_COMPARISON,
+    [TOKEN_PLUS] = PRECEDENCE_TERM,
+    [TOKEN_MINUS] = PRECEDENCE_TERM,
+    [TOKEN_ASTERISK] = PRECEDENCE_FACTOR,
+    [TOKEN_SLASH] = PRECEDENCE_FACTOR,
+    [TOKEN_PERCENT] = PRECEDENCE_FACTOR,
+};
 
-ast_expr_node_t *parser_parse_logical_and(parser_t *parser) {
-    ast_expr_node_t *left = parser_parse_equality(parser);
-    while (parser_match(parser, TOKEN_AND)) {
-        parser_advance(parser);
-        ast_expr_node_t *right = parser_parse_equality(parser);
-        left = init_expr_binary(TOKEN_AND, left, right, parser->current->line, parser->current->column);
-    }
-    return left;
+ast_expr_node_t *parser_parse_expression(parser_t *parser) {
+    parser_check_depth(parser, ++parser->depth, "Expression");
+    ast_expr_node_t *expr = parser_parse_binary(parser, PRECEDENCE_OR);
+    parser->depth--;
+    return expr;
 }
 
-ast_expr_node_t *parser_parse_equality(parser_t *parser) {
-    ast_expr_node_t *left = parser_parse_comparasion(parser);
-    while (parser_match(parser, TOKEN_EQEQ) || parser_match(parser, TOKEN_NEQ)) {
+/**
+ * @brief Parses unary expressions joined by binary operators of at least
+ * `min_precedence`, climbing the table instead of calling a function per level.
+ */
+ast_expr_node_t *parser_parse_binary(parser_t *parser, int min_precedence) {
+    ast_expr_node_t *left = parser_parse_unary(parser);
+    size_t nesting = parser->nesting;
+    size_t height = parser->height;
+    for (;;) {
         token_type_t operator = parser->current->type;
+        int precedence = binary_precedence[operator];
+        if (precedence < min_precedence || precedence == PRECEDENCE_NONE) {
+            parser->nesting = nesting;
+            parser->height = height;
+            return left;
+        }
         parser_advance(parser);
-        ast_expr_node_t *right = parser_parse_comparasion(parser);
-        left = init_expr_binary(operator, left, right, parser->current->line, parser->current->column);
+        // Only tighter operators go into the right operand, so equal ones associate to the left.
+        ast_expr_node_t *right = parser_parse_binary(parser, precedence + 1);
+        // Only the right operand nests; a chain grows along its left spine, bounded by its height.
+        if (parser->nesting + 1 > nesting) nesting = parser->nesting + 1;
+        height = (parser->height > height ? parser->height : height) + 1;
+        parser_set_shape(parser, nesting, height);
+        left = init_expr_binary(operator, left, right, parser->current->offset);
     }
-    return left;
 }
 
-ast_expr_node_t *parser_parse_comparasion(parser_t *parser) {
-    ast_expr_node_t *left = parser_parse_term(parser);
-    while (parser_match(parser, TOKEN_GT) 
-        || parser_match(parser, TOKEN_GEQ)
-        || parser_match(parser, TOKEN_LT)
-        || parser_match(parser, TOKEN_LEQ)) {
-        token_type_t operator = parser->current->type;
-        parser_advance(parser);
-        ast_expr_node_t *right = parser_parse_term(parser);
-        left = init_expr_binary(operator, left, right, parser->current->line, parser->current->column);
+static bool is_prefix_operator(token_type_t type) {
+    switch (type) {
+        case TOKEN_NOT:
+        case TOKEN_MINUS:
+        case TOKEN_PLUS:
+        case TOKEN_PLUSPLUS:
+        case TOKEN_AWAIT:
+            return true;
+        default:
+            return false;
     }
-    return left;
 }
 
-ast_expr_node_t *parser_parse_term(parser_t *parser) {
-    ast_expr_node_t *left =  parser_parse_factor(parser);
-    while (parser_match(parser, TOKEN_PLUS) || parser_match(parser, TOKEN_MINUS)) {
-        token_type_t operator = parser->current->type;
+/**
+ * @brief Parses a run of prefix operators and their operand. The operators
+ * are skipped first and applied innermost out, so a long run takes no stack.
+ */
+ast_expr_node_t *parser_parse_unary(parser_t *parser) {
+    size_t first = parser->current_index;
+    while (is_prefix_operator(parser->current->type)) {
         parser_advance(parser);
-        ast_expr_node_t *right = parser_parse_factor(parser);
-        left = init_expr_binary(operator, left, right, parser->current->line, parser->current->column);
     }
-    return left;
-}
-
-ast_expr_node_t *parser_parse_factor(parser_t *parser) {
-    ast_expr_node_t *left =  parser_parse_unary(parser);
-    while (parser_match(parser, TOKEN_ASTERISK) || parser_match(parser, TOKEN_SLASH) || parser_match(parser, TOKEN_PERCENT)) {
-        token_type_t operator = parser->current->type;
-        parser_advance(parser);
-        ast_expr_node_t *right = parser_parse_unary(parser);
-        left = init_expr_binary(operator, left, right, parser->current->line, parser->current->column);
+    size_t count = parser->current_index - first;
+    ast_expr_node_t *expr = parser_parse_postfix(parser);
+    parser_set_shape(parser, parser->nesting + count, parser->height + count);
+    for (size_t i = count; i > 0; --i) {
+        token_t *operator = parser->tokens[first + i - 1];
+        expr = init_expr_unary(operator->type, expr, operator->offset);
     }
-    return left;
+    return expr;
 }
 
-ast_expr_node_t *parser_parse_unary(parser_t *parser) {
-    size_t line = parser->current->line;
-    size_t column = parser->current->column;
-    if (parser_match(parser, TOKEN_NOT)) {
-        token_type_t operator = parser->current->type;
+ast_expr_node_t *parser_parse_postfix(parser_t *parser) {
+    ast_expr_node_t *expr = parser_parse_primary(parser);
+    size_t nesting = parser->nesting;
+    size_t height = parser->height;
+    while (parser_match(parser, TOKEN_LBRACKET)) {
+        uint32_t offset = parser->current->offset;
         parser_advance(parser);
-        ast_expr_node_t *operand = parser_parse_unary(parser);
-        return init_expr_unary(operator, operand, line, column);
-    } else if (parser_match(parser, TOKEN_MINUS)) {
-        token_type_t operator = parser->current->type;
-        parser_advance(parser);
-        ast_expr_node_t *operand = parser_parse_unary(parser);
-        return init_expr_unary(operator, operand, line, column);
-    } else if (parser_match(parser, TOKEN_PLUS)) {
-        token_type_t operator = parser->current->type;
-        parser_advance(parser);
-        ast_expr_node_t *operand = parser_parse_unary(parser);
-        return init_expr_unary(operator, operand, line, column);
-    } else if (parser_match(parser, TOKEN_PLUSPLUS)) {
-        token_type_t operator = parser->current->type;
-        parser_advance(parser);
-        ast_expr_node_t *operand = parser_parse_unary(parser);
-        return init_expr_unary(operator, operand, line, column);
+        ast_expr_node_t *index = parser_parse_expression(parser);
+        parser_expect_advance(parser, TOKEN_RBRACKET);
+        // As for binary operators, the array operand of `a[i][j]` is not a level of its own.
+        if (parser->nesting + 1 > nesting) nesting = parser->nesting + 1;
+        height = (parser->height > height ? parser->height : height) + 1;
+        parser_set_shape(parser, nesting, height);
+        expr = init_expr_index(expr, index, offset);
     }
-    return parser_parse_primary(parser);
+    parser->nesting = nesting;
+    parser->height = height;
+    return expr;
 }
 
 ast_expr_node_t *parser_parse_primary(parser_t *parser) {
+    parser->nesting = 1;
+    parser->height = 1;
     if (parser->current->type == TOKEN_LITERAL_INT) {
-        ast_expr_node_t *node = init_expr_literal_int(atoi(parser->current->value), parser->current->line, parser->current->column);
+        ast_expr_node_t *node = init_expr_literal_int(parser->current->number.int_value, parser->current->offset);
         parser_advance(parser);
         return node;
     } else if (parser->current->type == TOKEN_LITERAL_FLOAT) {
-        ast_expr_node_t *node = init_expr_literal_float(atof(parser->current->value), parser->current->line, parser->current->column);
+        ast_expr_node_t *node = init_expr_literal_float(parser->current->number.float_value, parser->current->offset);
         parser_advance(parser);
         return node;
     } else if (parser->current->type == TOKEN_LITERAL_STR) {
-        ast_expr_node_t *node = init_expr_literal_string(parser->current->value, parser->current->line, parser->current->column);
+        ast_expr_node_t *node = init_expr_literal_string(parser->current->value, parser->current->offset);
         parser_advance(parser);
         return node;
     } else if (parser->current->type == TOKEN_TRUE || parser->current->type == TOKEN_FALSE) {
-        // TODO: Handle boolean literals
+        ast_expr_node_t *node = init_expr_literal_bool(parser->current->type == TOKEN_TRUE, parser->current->offset);
         parser_advance(parser);
+        return node;
     } else if (parser->current->type == TOKEN_NULL) {
-        // TODO: Handle null literal
+        ast_expr_node_t *node = init_expr_literal_null(parser->current->offset);
         parser_advance(parser);
+        return node;
     } else if (parser->current->type == TOKEN_IDENTIFIER && parser_peek_token(parser, 1)->type == TOKEN_LPAREN) {
         char *name = parser->current->value;
         parser_advance(parser);
@@ -598,17 +760,18 @@ ast_expr_node_t *parser_parse_primary(parser_t *parser) {
         expr_arg_list_t *arg_list = NULL;
         if (parser->current && parser->current->type != TOKEN_RPAREN) {
             arg_list = parser_parse_arg_list(parser);
+            parser_set_shape(parser, parser->nesting + 1, parser->height + 1);
         } else {
             arg_list = malloc(sizeof(expr_arg_list_t));
             CHECK_MEM_ALLOC_ERROR(arg_list);
             arg_list->args = NULL;
             arg_list->arg_count = 0;
         }
-        ast_expr_node_t *node = init_expr_call(name, arg_list, parser->current->line, parser->current->column);
+        ast_expr_node_t *node = init_expr_call(name, arg_list, parser->current->offset);
         parser_expect_advance(parser, TOKEN_RPAREN);
         return node;
     } else if (parser->current->type == TOKEN_IDENTIFIER) {
-        ast_expr_node_t *node = init_expr_identifier(parser->current->value, parser->current->line, parser->current->column);
+        ast_expr_node_t *node = init_expr_identifier(parser->current->value, parser->current->offset);
         parser_advance(parser);
         return node;
     } else if (parser->current->type == TOKEN_LPAREN) {
@@ -616,8 +779,11 @@ ast_expr_node_t *parser_parse_primary(parser_t *parser) {
         ast_expr_node_t *expr = parser_parse_expression(parser);
         parser_expect_advance(parser, TOKEN_RPAREN);
         return expr;
+    } else if (parser->current->type == TOKEN_INVALID) {
+        parser_invalid_token(parser);
     } else {
-        fprintf(stderr, "[%ld:%ld] Expected primary expression but got %s\n", parser->current->line, parser->current->column, parser->current->value);
+        parser_error_at(parser, parser->current->offset);
+        fprintf(stderr, "Expected primary expression but got %s\n", parser->current->value);
         exit(EXIT_FAILURE);
     }
     return NULL;
@@ -626,6 +792,8 @@ ast_expr_node_t *parser_parse_primary(parser_t *parser) {
 expr_arg_list_t *parser_parse_arg_list(parser_t *parser) {
     size_t arg_capacity = 8;
     size_t arg_count = 0;
+    size_t nesting = 0;
+    size_t height = 0;
 
     ast_expr_node_t **args = malloc(sizeof(ast_expr_node_t *) * arg_capacity);
     CHECK_MEM_ALLOC_ERROR(args);
@@ -639,6 +807,8 @@ expr_arg_list_t *parser_parse_arg_list(parser_t *parser) {
         }
 
         args[arg_count++] = parser_parse_expression(parser);
+        if (parser->nesting > nesting) nesting = parser->nesting;
+        if (parser->height > height) height = parser->height;
 
         if (parser_match(parser, TOKEN_COMMA)) {
             parser_advance(parser);
@@ -651,6 +821,8 @@ expr_arg_list_t *parser_parse_arg_list(parser_t *parser) {
     CHECK_MEM_ALLOC_ERROR(arg_list);
     arg_list->args = args;
     arg_list->arg_count = arg_count;
+    parser->nesting = nesting;
+    parser->height = height;
 
     return arg_list;
 }
@@ -0,0 +1,458 @@
+/**
+ * File Name: profiler.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#define _XOPEN_SOURCE 700
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "include/profiler.h"
+#include "include/vm.h"
+#include "include/utils.h"
+
+volatile sig_atomic_t profiler_sample_pending = 0;
+
+static void on_sigprof(int signal) {
+    (void)signal;
+    // Whatever the handler interrupts may be about to read errno.
+    int saved_errno = errno;
+    profiler_sample_pending = 1;
+    errno = saved_errno;
+}
+
+profiler_t *init_profiler(const image_t *image, unsigned hz) {
+    profiler_t *profiler = calloc(1, sizeof(profiler_t));
+    CHECK_MEM_ALLOC_ERROR(profiler);
+    profiler->image = image;
+    profiler->hz = hz ? hz : PROFILER_DEFAULT_HZ;
+
+    profiler->stack_capacity = 256;
+    profiler->stacks = calloc(profiler->stack_capacity, sizeof(profile_stack_t));
+    CHECK_MEM_ALLOC_ERROR(profiler->stacks);
+    profiler->line_capacity = 256;
+    profiler->lines = calloc(profiler->line_capacity, sizeof(profile_line_t));
+    CHECK_MEM_ALLOC_ERROR(profiler->lines);
+    profiler->scratch_capacity = 1024;
+    profiler->scratch = malloc(profiler->scratch_capacity);
+    CHECK_MEM_ALLOC_ERROR(profiler->scratch);
+    return profiler;
+}
+
+profiler_t *init_worker_profiler(const profiler_t *parent, const vm_t *vm) {
+    profiler_t *profiler = init_profiler(parent->image, parent->hz);
+    profiler->outer_count = parent->outer_count + vm->frame_count;
+    profiler->outer = malloc((profiler->outer_count ? profiler->outer_count : 1) * sizeof(profile_frame_t));
+    CHECK_MEM_ALLOC_ERROR(profiler->outer);
+    memcpy(profiler->outer, parent->outer, parent->outer_count * sizeof(profile_frame_t));
+    for (size_t i = 0; i < vm->frame_count; ++i) {
+        // Every frame stopped just after a CALL or the PARALLEL_FOR itself.
+        const call_frame_t *frame = &vm->frames[i];
+        profiler->outer[parent->outer_count + i] = (profile_frame_t){ frame->function, frame->pc > 0 ? frame->pc - 1 : 0 };
+    }
+    return profiler;
+}
+
+void free_profiler(profiler_t *profiler) {
+    if (!profiler) return;
+    profiler_stop(profiler);
+    free(profiler->outer);
+    for (size_t i = 0; i < profiler->stack_capacity; ++i) {
+        free(profiler->stacks[i].stack);
+    }
+    free(profiler->stacks);
+    free(profiler->lines);
+    free(profiler->scratch);
+    free(profiler);
+}
+
+bool profiler_start(profiler_t *profiler) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_sigprof;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(SIGPROF, &action, &profiler->previous_action) != 0) {
+        perror("sigaction");
+        return false;
+    }
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = (suseconds_t)(1000000 / profiler->hz);
+    if (timer.it_interval.tv_usec == 0) timer.it_interval.tv_usec = 1;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        perror("setitimer");
+        sigaction(SIGPROF, &profiler->previous_action, NULL);
+        return false;
+    }
+    profiler->running = true;
+    return true;
+}
+
+void profiler_stop(profiler_t *profiler) {
+    if (!profiler->running) return;
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    sigaction(SIGPROF, &profiler->previous_action, NULL);
+    profiler_sample_pending = 0;
+    profiler->running = false;
+}
+
+//------------------------------------------------------------------------------
+// tables
+//------------------------------------------------------------------------------
+
+static uint64_t hash_bytes(const char *bytes, size_t length) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_line(uint32_t function, uint32_t line, uint32_t column) {
+    uint64_t hash = ((uint64_t)function << 40) ^ ((uint64_t)line << 16) ^ column;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static void grow_stacks(profiler_t *profiler) {
+    size_t old_capacity = profiler->stack_capacity;
+    profile_stack_t *old = profiler->stacks;
+    profiler->stack_capacity *= 2;
+    profiler->stacks = calloc(profiler->stack_capacity, sizeof(profile_stack_t));
+    CHECK_MEM_ALLOC_ERROR(profiler->stacks);
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (!old[i].stack) continue;
+        size_t mask = profiler->stack_capacity - 1;
+        size_t slot = hash_bytes(old[i].stack, strlen(old[i].stack)) & mask;
+        while (profiler->stacks[slot].stack) slot = (slot + 1) & mask;
+        profiler->stacks[slot] = old[i];
+    }
+    free(old);
+}
+
+static void count_stack(profiler_t *profiler, const char *stack, size_t length, uint64_t count) {
+    if ((profiler->stack_count + 1) * 4 > profiler->stack_capacity * 3) {
+        grow_stacks(profiler);
+    }
+    size_t mask = profiler->stack_capacity - 1;
+    size_t slot = hash_bytes(stack, length) & mask;
+    while (profiler->stacks[slot].stack) {
+        if (strcmp(profiler->stacks[slot].stack, stack) == 0) {
+            profiler->stacks[slot].count += count;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    profiler->stacks[slot].stack = strdup(stack);
+    CHECK_MEM_ALLOC_ERROR(profiler->stacks[slot].stack);
+    profiler->stacks[slot].count = count;
+    profiler->stack_count++;
+}
+
+static void grow_lines(profiler_t *profiler) {
+    size_t old_capacity = profiler->line_capacity;
+    profile_line_t *old = profiler->lines;
+    profiler->line_capacity *= 2;
+    profiler->lines = calloc(profiler->line_capacity, sizeof(profile_line_t));
+    CHECK_MEM_ALLOC_ERROR(profiler->lines);
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (!old[i].used) continue;
+        size_t mask = profiler->line_capacity - 1;
+        size_t slot = hash_line(old[i].function, old[i].line, old[i].column) & mask;
+        while (profiler->lines[slot].used) slot = (slot + 1) & mask;
+        profiler->lines[slot] = old[i];
+    }
+    free(old);
+}
+
+static profile_line_t *find_line(profiler_t *profiler, uint32_t function, uint32_t line, uint32_t column) {
+    if ((profiler->line_count + 1) * 4 > profiler->line_capacity * 3) {
+        grow_lines(profiler);
+    }
+    size_t mask = profiler->line_capacity - 1;
+    size_t slot = hash_line(function, line, column) & mask;
+    while (profiler->lines[slot].used) {
+        profile_line_t *entry = &profiler->lines[slot];
+        if (entry->function == function && entry->line == line && entry->column == column) {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    profile_line_t *entry = &profiler->lines[slot];
+    entry->function = function;
+    entry->line = line;
+    entry->column = column;
+    entry->used = true;
+    profiler->line_count++;
+    return entry;
+}
+
+//------------------------------------------------------------------------------
+// sampling
+//------------------------------------------------------------------------------
+
+static void scratch_append(profiler_t *profiler, size_t *length, const char *text, size_t text_length) {
+    if (*length + text_length + 1 > profiler->scratch_capacity) {
+        while (*length + text_length + 1 > profiler->scratch_capacity) {
+            profiler->scratch_capacity *= 2;
+        }
+        profiler->scratch = realloc(profiler->scratch, profiler->scratch_capacity);
+        CHECK_MEM_ALLOC_ERROR(profiler->scratch);
+    }
+    memcpy(profiler->scratch + *length, text, text_length);
+    *length += text_length;
+    profiler->scratch[*length] = '\0';
+}
+
+void profiler_sample(profiler_t *profiler, const vm_t *vm, uint32_t pc) {
+    const image_t *image = profiler->image;
+    uint64_t sample = ++profiler->samples;
+
+    // A worker's frames sit under those of the VM that started its parallel for.
+    size_t depth = profiler->outer_count + vm->frame_count;
+    size_t first = 0;
+    size_t length = 0;
+    profiler->scratch[0] = '\0';
+    if (depth > PROFILER_MAX_DEPTH) {
+        first = depth - PROFILER_MAX_DEPTH;
+        scratch_append(profiler, &length, "[truncated];", 12);
+    }
+
+    for (size_t i = first; i < depth; ++i) {
+        bool innermost = i + 1 == depth;
+        uint32_t function, at;
+        if (i < profiler->outer_count) {
+            function = profiler->outer[i].function;
+            at = profiler->outer[i].pc;
+        } else {
+            const call_frame_t *frame = &vm->frames[i - profiler->outer_count];
+            function = frame->function;
+            // Outer frames stopped just after their CALL instruction.
+            at = innermost ? pc : (frame->pc > 0 ? frame->pc - 1 : 0);
+        }
+        uint32_t line, column;
+        image_position_for_pc(image, function, at, &line, &column);
+
+        profile_line_t *entry = find_line(profiler, function, line, column);
+        if (entry->last_sample != sample) {
+            entry->last_sample = sample;
+            entry->total++;
+        }
+        if (innermost) {
+            entry->self++;
+        }
+
+        char frame_text[96];
+        int written = snprintf(frame_text, sizeof(frame_text), "%s%s:%u", i > first ? ";" : "",
+            image_string(image, image->functions[function].name), line);
+        if (written > (int)sizeof(frame_text) - 1) written = (int)sizeof(frame_text) - 1;
+        scratch_append(profiler, &length, frame_text, (size_t)written);
+    }
+    count_stack(profiler, profiler->scratch, length, 1);
+}
+
+void profiler_merge(profiler_t *profiler, const profiler_t *worker) {
+    profiler->samples += worker->samples;
+    for (size_t i = 0; i < worker->stack_capacity; ++i) {
+        const profile_stack_t *stack = &worker->stacks[i];
+        if (stack->stack) {
+            count_stack(profiler, stack->stack, strlen(stack->stack), stack->count);
+        }
+    }
+    for (size_t i = 0; i < worker->line_capacity; ++i) {
+        const profile_line_t *line = &worker->lines[i];
+        if (!line->used) continue;
+        profile_line_t *entry = find_line(profiler, line->function, line->line, line->column);
+        entry->self += line->self;
+        entry->total += line->total;
+    }
+}
+
+//------------------------------------------------------------------------------
+// output
+//------------------------------------------------------------------------------
+
+bool profiler_write_folded(const profiler_t *profiler, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Error opening profile file: %s\n", path);
+        return false;
+    }
+    for (size_t i = 0; i < profiler->stack_capacity; ++i) {
+        const profile_stack_t *entry = &profiler->stacks[i];
+        if (entry->stack) {
+            fprintf(file, "%s %llu\n", entry->stack, (unsigned long long)entry->count);
+        }
+    }
+    return fclose(file) == 0;
+}
+
+static int compare_lines(const void *a, const void *b) {
+    const profile_line_t *x = *(const profile_line_t *const *)a;
+    const profile_line_t *y = *(const profile_line_t *const *)b;
+    if (x->self != y->self) return x->self < y->self ? 1 : -1;
+    if (x->total != y->total) return x->total < y->total ? 1 : -1;
+    return x->line < y->line ? -1 : (x->line > y->line);
+}
+
+void profiler_report(const profiler_t *profiler, FILE *out, size_t limit) {
+    fprintf(out, "== profile: %llu samples at %u Hz ==\n", (unsigned long long)profiler->samples, profiler->hz);
+    if (profiler->samples == 0) {
+        fprintf(out, "(the program finished before the first sample)\n");
+        return;
+    }
+
+    const profile_line_t **sorted = malloc((profiler->line_count ? profiler->line_count : 1) * sizeof(profile_line_t *));
+    CHECK_MEM_ALLOC_ERROR(sorted);
+    size_t count = 0;
+    for (size_t i = 0; i < profiler->line_capacity; ++i) {
+        if (profiler->lines[i].used) {
+            sorted[count++] = &profiler->lines[i];
+        }
+    }
+    qsort(sorted, count, sizeof(sorted[0]), compare_lines);
+
+    fprintf(out, "%8s %7s %8s %7s  %-10s %s\n", "self", "self%", "total", "total%", "line:col", "function");
+    double samples = (double)profiler->samples;
+    for (size_t i = 0; i < count && i < limit; ++i) {
+        const profile_line_t *entry = sorted[i];
+        char position[32];
+        snprintf(position, sizeof(position), "%u:%u", entry->line, entry->column);
+        fprintf(out, "%8llu %6.2f%% %8llu %6.2f%%  %-10s %s\n",
+            (unsigned long long)entry->self, 100.0 * (double)entry->self / samples,
+            (unsigned long long)entry->total, 100.0 * (double)entry->total / samples,
+            position, image_string(profiler->image, profiler->image->functions[entry->function].name));
+    }
+    free(sorted);
+}
+
+//------------------------------------------------------------------------------
+// opcode profile
+//------------------------------------------------------------------------------
+
+opcode_profile_t *init_opcode_profile(void) {
+    opcode_profile_t *profile = calloc(1, sizeof(opcode_profile_t));
+    CHECK_MEM_ALLOC_ERROR(profile);
+    return profile;
+}
+
+void free_opcode_profile(opcode_profile_t *profile) {
+    free(profile);
+}
+
+void opcode_profile_start(opcode_profile_t *profile) {
+    (void)profile;
+    profiler_sample_pending = 1;
+}
+
+void opcode_profile_stop(opcode_profile_t *profile) {
+    (void)profile;
+    profiler_sample_pending = 0;
+}
+
+void opcode_profile_record(opcode_profile_t *profile, opcode_window_t *window, const uint8_t *instruction) {
+    opcode_t op = (opcode_t)*instruction;
+    atomic_fetch_add_explicit(&profile->dispatches[op], 1, memory_order_relaxed);
+    if (opcode_is_super(op)) {
+        // Its other components run without a dispatch of their own.
+        window->length = 0;
+        return;
+    }
+    if (instruction != window->next) {
+        window->length = 0;
+    }
+    if (window->length >= 1) {
+        atomic_fetch_add_explicit(&profile->pairs[window->previous[1]][op], 1, memory_order_relaxed);
+    }
+    if (window->length >= 2) {
+        atomic_fetch_add_explicit(&profile->triples[window->previous[0]][window->previous[1]][op], 1, memory_order_relaxed);
+    }
+    window->previous[0] = window->previous[1];
+    window->previous[1] = op;
+    if (window->length < 2) window->length++;
+    window->next = instruction + 1 + opcode_operand_size(op);
+}
+
+uint64_t opcode_profile_dispatches(const opcode_profile_t *profile) {
+    uint64_t total = 0;
+    for (size_t op = 0; op < OP_COUNT; ++op) {
+        total += atomic_load_explicit(&profile->dispatches[op], memory_order_relaxed);
+    }
+    return total;
+}
+
+typedef struct opcode_sequence_struct {
+    uint64_t count;
+    opcode_t ops[OP_MAX_COMPONENTS];
+} opcode_sequence_t;
+
+static int compare_sequences(const void *a, const void *b) {
+    const opcode_sequence_t *x = a;
+    const opcode_sequence_t *y = b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return memcmp(x->ops, y->ops, sizeof(x->ops));
+}
+
+/**
+ * @brief Writes the nonzero counts among `counts`, sequences of `length`
+ * plain opcodes in row-major order, most frequent first.
+ */
+static void write_sequences(FILE *file, const char *kind, const _Atomic uint64_t *counts, size_t length) {
+    size_t total = length == 1 ? OP_COUNT : length == 2 ? OP_PLAIN_COUNT * OP_PLAIN_COUNT
+                                                        : OP_PLAIN_COUNT * OP_PLAIN_COUNT * OP_PLAIN_COUNT;
+    opcode_sequence_t *sequences = NULL;
+    size_t count = 0, capacity = 0;
+    for (size_t i = 0; i < total; ++i) {
+        uint64_t n = atomic_load_explicit(&counts[i], memory_order_relaxed);
+        if (n == 0) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            sequences = realloc(sequences, capacity * sizeof(opcode_sequence_t));
+            CHECK_MEM_ALLOC_ERROR(sequences);
+        }
+        opcode_sequence_t *sequence = &sequences[count++];
+        sequence->count = n;
+        size_t rest = i;
+        for (size_t k = length; k-- > 0;) {
+            sequence->ops[k] = (opcode_t)(length == 1 ? rest : rest % OP_PLAIN_COUNT);
+            rest = length == 1 ? 0 : rest / OP_PLAIN_COUNT;
+        }
+        for (size_t k = length; k < OP_MAX_COMPONENTS; ++k) {
+            sequence->ops[k] = OP_COUNT;
+        }
+    }
+    if (count) qsort(sequences, count, sizeof(opcode_sequence_t), compare_sequences);
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(file, "%s %llu", kind, (unsigned long long)sequences[i].count);
+        for (size_t k = 0; k < length; ++k) {
+            fprintf(file, " %s", opcode_to_string(sequences[i].ops[k]));
+        }
+        fputc('\n', file);
+    }
+    free(sequences);
+}
+
+bool opcode_profile_write(const opcode_profile_t *profile, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Error opening opcode profile file: %s\n", path);
+        return false;
+    }
+    fprintf(file, "total %llu\n", (unsigned long long)opcode_profile_dispatches(profile));
+    write_sequences(file, "dispatch", profile->dispatches, 1);
+    write_sequences(file, "pair", &profile->pairs[0][0], 2);
+    write_sequences(file, "triple", &profile->triples[0][0][0], 3);
+    return fclose(file) == 0;
+}
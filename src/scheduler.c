@@ -0,0 +1,271 @@
+/**
+ * File Name: scheduler.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "include/scheduler.h"
+#include "include/trace.h"
+#include "include/utils.h"
+
+typedef struct chunk_range_struct {
+    size_t begin;
+    size_t end;
+} chunk_range_t;
+
+/**
+ * The owner pushes and pops at the bottom, thieves take from the top. Ranges
+ * are coarse (a chunk is many loop iterations), so a lock per deque is cheap.
+ */
+typedef struct worker_deque_struct {
+    pthread_mutex_t lock;
+    chunk_range_t ranges[SCHEDULER_DEQUE_CAPACITY];
+    size_t top;         /**< Oldest range; top == bottom when empty */
+    size_t bottom;      /**< One past the newest range */
+} worker_deque_t;
+
+static size_t requested_threads = 0;
+static size_t thread_count = 0;         /**< Workers of the running pool, the caller included; 0 before start */
+static pthread_t *threads = NULL;
+static worker_deque_t *deques = NULL;
+static size_t deque_count = 0;
+static bool exit_handler_installed = false;
+
+static pthread_mutex_t region_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static uint64_t generation = 0;         /**< Bumped under pool_lock whenever a loop starts */
+static bool shutting_down = false;
+
+static scheduler_chunk_fn_t region_fn;
+static void *region_context;
+static atomic_size_t remaining;         /**< Chunks of the current loop not yet finished */
+static atomic_size_t busy;              /**< Pool threads inside the current loop */
+static atomic_bool cancelled;
+
+static _Thread_local bool in_region = false;
+static _Thread_local uint32_t steal_seed = 0;
+
+//------------------------------------------------------------------------------
+// deques
+//------------------------------------------------------------------------------
+
+static bool deque_push(worker_deque_t *deque, chunk_range_t range) {
+    pthread_mutex_lock(&deque->lock);
+    bool pushed = deque->bottom - deque->top < SCHEDULER_DEQUE_CAPACITY;
+    if (pushed) {
+        deque->ranges[deque->bottom++ % SCHEDULER_DEQUE_CAPACITY] = range;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return pushed;
+}
+
+static bool deque_pop(worker_deque_t *deque, chunk_range_t *range) {
+    pthread_mutex_lock(&deque->lock);
+    bool popped = deque->bottom > deque->top;
+    if (popped) {
+        *range = deque->ranges[--deque->bottom % SCHEDULER_DEQUE_CAPACITY];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return popped;
+}
+
+static bool deque_steal(worker_deque_t *deque, chunk_range_t *range) {
+    pthread_mutex_lock(&deque->lock);
+    bool stolen = deque->bottom > deque->top;
+    if (stolen) {
+        *range = deque->ranges[deque->top++ % SCHEDULER_DEQUE_CAPACITY];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return stolen;
+}
+
+/**
+ * @brief Tries every other worker once, starting at a random one so that
+ * thieves do not all line up behind the same victim.
+ */
+static bool steal(size_t self, chunk_range_t *range) {
+    if (thread_count < 2) return false;
+    steal_seed = steal_seed * 1103515245u + 12345u + (uint32_t)self;
+    size_t start = (steal_seed >> 8) % thread_count;
+    for (size_t i = 0; i < thread_count; ++i) {
+        size_t victim = (start + i) % thread_count;
+        if (victim != self && deque_steal(&deques[victim], range)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+// workers
+//------------------------------------------------------------------------------
+
+static void run_region(size_t self) {
+    for (;;) {
+        chunk_range_t range;
+        if (!deque_pop(&deques[self], &range) && !steal(self, &range)) {
+            if (atomic_load(&remaining) == 0) return;
+            sched_yield();
+            continue;
+        }
+
+        // Keep the lower half, leave the upper half where thieves can find it.
+        while (range.end - range.begin > 1) {
+            size_t middle = range.begin + (range.end - range.begin) / 2;
+            if (!deque_push(&deques[self], (chunk_range_t){ middle, range.end })) break;
+            range.end = middle;
+        }
+        for (size_t chunk = range.begin; chunk < range.end; ++chunk) {
+            if (!atomic_load_explicit(&cancelled, memory_order_relaxed) && !region_fn(region_context, self, chunk)) {
+                atomic_store(&cancelled, true);
+            }
+        }
+        atomic_fetch_sub(&remaining, range.end - range.begin);
+    }
+}
+
+static void *worker_main(void *argument) {
+    size_t self = (size_t)(uintptr_t)argument;
+    in_region = true;
+    if (trace_enabled) {
+        char name[32];
+        snprintf(name, sizeof(name), "worker %zu", self);
+        trace_set_thread_name(name);
+    }
+
+    uint64_t seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool_lock);
+        while (generation == seen && !shutting_down) {
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        }
+        if (shutting_down) {
+            pthread_mutex_unlock(&pool_lock);
+            return NULL;
+        }
+        seen = generation;
+        atomic_fetch_add(&busy, 1);
+        pthread_mutex_unlock(&pool_lock);
+
+        run_region(self);
+        atomic_fetch_sub(&busy, 1);
+    }
+}
+
+static size_t configured_threads(void) {
+    size_t count = requested_threads;
+    if (count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        count = online > 0 ? (size_t)online : 1;
+    }
+    return count > SCHEDULER_MAX_THREADS ? SCHEDULER_MAX_THREADS : count;
+}
+
+static void start_pool(void) {
+    size_t count = configured_threads();
+    deques = calloc(count, sizeof(worker_deque_t));
+    CHECK_MEM_ALLOC_ERROR(deques);
+    deque_count = count;
+    for (size_t i = 0; i < count; ++i) {
+        pthread_mutex_init(&deques[i].lock, NULL);
+    }
+    threads = malloc(count * sizeof(pthread_t));
+    CHECK_MEM_ALLOC_ERROR(threads);
+
+    shutting_down = false;
+    thread_count = 1;
+    for (size_t i = 1; i < count; ++i) {
+        if (pthread_create(&threads[i - 1], NULL, worker_main, (void *)(uintptr_t)i) != 0) {
+            fprintf(stderr, "Warning: started only %zu of %zu worker threads\n", i, count);
+            break;
+        }
+        thread_count++;
+    }
+    if (!exit_handler_installed) {
+        atexit(scheduler_shutdown);
+        exit_handler_installed = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+// public interface
+//------------------------------------------------------------------------------
+
+void scheduler_set_thread_count(size_t count) {
+    scheduler_shutdown();
+    requested_threads = count;
+}
+
+size_t scheduler_thread_count(void) {
+    return thread_count ? thread_count : configured_threads();
+}
+
+bool scheduler_parallel_for(size_t chunk_count, scheduler_chunk_fn_t fn, void *context) {
+    if (in_region || chunk_count < 2 || configured_threads() < 2) {
+        for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+            if (!fn(context, 0, chunk)) return false;
+        }
+        return true;
+    }
+
+    pthread_mutex_lock(&region_lock);
+    if (thread_count == 0) {
+        start_pool();
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    region_fn = fn;
+    region_context = context;
+    atomic_store(&cancelled, false);
+    atomic_store(&remaining, chunk_count);
+    for (size_t w = 0; w < thread_count; ++w) {
+        deques[w].top = deques[w].bottom = 0;
+        size_t begin = chunk_count * w / thread_count;
+        size_t end = chunk_count * (w + 1) / thread_count;
+        if (begin < end) {
+            deque_push(&deques[w], (chunk_range_t){ begin, end });
+        }
+    }
+    generation++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    in_region = true;
+    run_region(0);
+    while (atomic_load(&remaining) > 0 || atomic_load(&busy) > 0) {
+        sched_yield();
+    }
+    in_region = false;
+
+    bool completed = !atomic_load(&cancelled);
+    pthread_mutex_unlock(&region_lock);
+    return completed;
+}
+
+void scheduler_shutdown(void) {
+    if (thread_count == 0) return;
+    pthread_mutex_lock(&pool_lock);
+    shutting_down = true;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+    for (size_t i = 1; i < thread_count; ++i) {
+        pthread_join(threads[i - 1], NULL);
+    }
+    for (size_t i = 0; i < deque_count; ++i) {
+        pthread_mutex_destroy(&deques[i].lock);
+    }
+    free(threads);
+    free(deques);
+    threads = NULL;
+    deques = NULL;
+    deque_count = 0;
+    thread_count = 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * File Name: source_map.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/source_map.h"
+#include "include/utils.h"
+
+source_map_t *init_source_map(char *text, size_t length) {
+    source_map_t *map = calloc(1, sizeof(source_map_t));
+    CHECK_MEM_ALLOC_ERROR(map);
+    map->refcount = 1;
+    map->text = text;
+    map->length = length;
+    return map;
+}
+
+source_map_t *source_map_retain(source_map_t *map) {
+    if (map) map->refcount++;
+    return map;
+}
+
+void free_source_map(source_map_t *map) {
+    if (!map || --map->refcount > 0) return;
+    free(map->text);
+    free(map->line_starts);
+    free(map);
+}
+
+/**
+ * @brief Builds the index of line starts: one for the start of the text and
+ * one past each newline.
+ */
+static void build_index(source_map_t *map) {
+    size_t count = 1;
+    const char *end = map->text + map->length;
+    for (const char *c = map->text; (c = memchr(c, '\n', (size_t)(end - c))) != NULL; ++c) {
+        count++;
+    }
+
+    map->line_starts = malloc(count * sizeof(uint32_t));
+    CHECK_MEM_ALLOC_ERROR(map->line_starts);
+    map->line_starts[0] = 0;
+    size_t line = 1;
+    for (const char *c = map->text; (c = memchr(c, '\n', (size_t)(end - c))) != NULL; ++c) {
+        map->line_starts[line++] = (uint32_t)(c - map->text + 1);
+    }
+    map->line_count = count;
+}
+
+const uint32_t *source_map_line_starts(source_map_t *map, size_t *line_count) {
+    if (!map->line_starts) build_index(map);
+    *line_count = map->line_count;
+    return map->line_starts;
+}
+
+void source_map_locate(source_map_t *map, uint32_t offset, size_t *line, size_t *column) {
+    if (!map) {
+        *line = 0;
+        *column = 0;
+        return;
+    }
+    size_t count;
+    const uint32_t *starts = source_map_line_starts(map, &count);
+
+    // Lookups mostly come in source order, so try the line found last time first.
+    size_t found = map->last_line;
+    if (starts[found] > offset || (found + 1 < count && starts[found + 1] <= offset)) {
+        size_t low = 0, high = count;       // the last line starting at or before offset is in [low, high)
+        while (high - low > 1) {
+            size_t middle = low + (high - low) / 2;
+            if (starts[middle] <= offset) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        found = low;
+        map->last_line = found;
+    }
+
+    *line = found + 1;
+    *column = (size_t)(offset - starts[found]) + 1;
+}
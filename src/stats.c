@@ -0,0 +1,141 @@
+/**
+ * File Name: stats.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include <stdio.h>
+#include <time.h>
+#include <sys/resource.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "include/stats.h"
+
+char *stats_phase_to_string(stats_phase_t phase) {
+    switch (phase) {
+        case STATS_PHASE_READ:      return "init_lexer";
+        case STATS_PHASE_LEX:       return "token loop";
+        case STATS_PHASE_PARSE:     return "parse";
+        case STATS_PHASE_CACHE:     return "ast cache";
+        case STATS_PHASE_DUMP:      return "dump ast";
+        case STATS_PHASE_COMPILE:   return "compile";
+        case STATS_PHASE_RUN:       return "run";
+        case STATS_PHASE_FREE:      return "free";
+        default:                    return "unknown";
+    }
+}
+
+#ifdef JFF_STATS
+
+stats_t global_stats;
+
+static double clock_seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Bytes of heap currently handed out by malloc, or 0 where unknown.
+ */
+static int64_t heap_in_use(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return (int64_t)(info.uordblks + info.hblkhd);
+#else
+    return 0;
+#endif
+}
+
+void stats_phase_begin(stats_phase_t phase) {
+    stats_phase_info_t *info = &global_stats.phases[phase];
+    info->heap_start = heap_in_use();
+    info->cpu_start = clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    info->wall_start = clock_seconds(CLOCK_MONOTONIC);
+}
+
+void stats_phase_end(stats_phase_t phase) {
+    stats_phase_info_t *info = &global_stats.phases[phase];
+    info->wall_seconds += clock_seconds(CLOCK_MONOTONIC) - info->wall_start;
+    info->cpu_seconds += clock_seconds(CLOCK_PROCESS_CPUTIME_ID) - info->cpu_start;
+    info->heap_delta += heap_in_use() - info->heap_start;
+    info->calls++;
+}
+
+static void print_bytes(FILE *out, int64_t bytes) {
+    double value = (double)(bytes < 0 ? -bytes : bytes);
+    const char *sign = bytes < 0 ? "-" : "";
+    if (value >= 1024.0 * 1024.0) {
+        fprintf(out, "%s%.1f MiB", sign, value / (1024.0 * 1024.0));
+    } else if (value >= 1024.0) {
+        fprintf(out, "%s%.1f KiB", sign, value / 1024.0);
+    } else {
+        fprintf(out, "%s%.0f B", sign, value);
+    }
+}
+
+static uint64_t sum(const uint64_t *counts, size_t count) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += counts[i];
+    }
+    return total;
+}
+
+void stats_report(FILE *out, const char *input) {
+    const stats_t *stats = &global_stats;
+    fprintf(out, "== stats for %s ==\n", input);
+    fprintf(out, "bytes read: %zu\n", stats->bytes_read);
+
+    fprintf(out, "%-12s %12s %12s %14s\n", "phase", "wall ms", "cpu ms", "heap delta");
+    for (int i = 0; i < STATS_PHASE_COUNT; ++i) {
+        const stats_phase_info_t *info = &stats->phases[i];
+        if (info->calls == 0) continue;
+        fprintf(out, "%-12s %12.3f %12.3f %10s", stats_phase_to_string((stats_phase_t)i),
+            info->wall_seconds * 1e3, info->cpu_seconds * 1e3, "");
+        print_bytes(out, info->heap_delta);
+        fprintf(out, "\n");
+    }
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        fprintf(out, "peak RSS: ");
+        print_bytes(out, (int64_t)usage.ru_maxrss * 1024);
+        fprintf(out, "\n");
+    }
+
+    fprintf(out, "tokens: %llu\n", (unsigned long long)sum(stats->tokens, STATS_TOKEN_TYPES));
+    for (int i = 0; i < STATS_TOKEN_TYPES; ++i) {
+        if (stats->tokens[i]) {
+            fprintf(out, "  %-22s %12llu\n", token_type_to_string((token_type_t)i), (unsigned long long)stats->tokens[i]);
+        }
+    }
+    fprintf(out, "expression nodes: %llu\n", (unsigned long long)sum(stats->exprs, STATS_EXPR_TYPES));
+    for (int i = 0; i < STATS_EXPR_TYPES; ++i) {
+        if (stats->exprs[i]) {
+            fprintf(out, "  %-22s %12llu\n", expr_type_to_string((expr_type_t)i), (unsigned long long)stats->exprs[i]);
+        }
+    }
+    fprintf(out, "statement nodes: %llu\n", (unsigned long long)sum(stats->stmts, STATS_STMT_TYPES));
+    for (int i = 0; i < STATS_STMT_TYPES; ++i) {
+        if (stats->stmts[i]) {
+            fprintf(out, "  %-22s %12llu\n", stmt_type_to_string((stmt_type_t)i), (unsigned long long)stats->stmts[i]);
+        }
+    }
+    fprintf(out, "declaration nodes: %llu\n", (unsigned long long)sum(stats->decls, STATS_DECL_TYPES));
+    for (int i = 0; i < STATS_DECL_TYPES; ++i) {
+        if (stats->decls[i]) {
+            fprintf(out, "  %-22s %12llu\n", decl_type_to_string((decl_type_t)i), (unsigned long long)stats->decls[i]);
+        }
+    }
+}
+
+#else
+
+void stats_report(FILE *out, const char *input) {
+    (void)input;
+    fprintf(out, "Statistics are not available in release builds\n");
+}
+
+#endif // JFF_STATS
@@ -0,0 +1,218 @@
+/**
+ * File Name: str.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/str.h"
+#include "include/utils.h"
+
+#define STRING_MIN_CAPACITY 32
+
+void init_string_constant(string_t *string, const char *chars, size_t length) {
+    memset(string, 0, sizeof(*string));
+    string->object.kind = GC_STRING;
+    string->object.flags = GC_FLAG_CONSTANT;
+    string->kind = STRING_CONSTANT;
+    string->length = length;
+    string->as.constant = chars;
+}
+
+//------------------------------------------------------------------------------
+// buffers
+//------------------------------------------------------------------------------
+
+static string_buffer_t *new_buffer(size_t length, size_t capacity) {
+    string_buffer_t *buffer = malloc(sizeof(string_buffer_t));
+    CHECK_MEM_ALLOC_ERROR(buffer);
+    buffer->refcount = 1;
+    buffer->capacity = capacity > length ? capacity : length + 1;
+    buffer->used = length;
+    buffer->chars = malloc(buffer->capacity);
+    CHECK_MEM_ALLOC_ERROR(buffer->chars);
+    return buffer;
+}
+
+/**
+ * @brief Grows the buffer to hold at least `needed` bytes.
+ *
+ * @return The bytes added to its capacity.
+ */
+static size_t reserve(string_buffer_t *buffer, size_t needed) {
+    if (needed <= buffer->capacity) {
+        return 0;
+    }
+    size_t capacity = buffer->capacity * 2;
+    if (capacity < needed) capacity = needed;
+    // The strings over the buffer read through it, so the characters may move.
+    buffer->chars = realloc(buffer->chars, capacity);
+    CHECK_MEM_ALLOC_ERROR(buffer->chars);
+    size_t added = capacity - buffer->capacity;
+    buffer->capacity = capacity;
+    return added;
+}
+
+size_t string_free_storage(string_t *string) {
+    if (string->kind != STRING_SHARED || --string->as.buffer->refcount > 0) {
+        return 0;
+    }
+    size_t capacity = string->as.buffer->capacity;
+    free(string->as.buffer->chars);
+    free(string->as.buffer);
+    return capacity;
+}
+
+size_t string_external_bytes(const string_t *string) {
+    if (string->kind != STRING_SHARED) {
+        return 0;
+    }
+    return string->as.buffer->capacity / string->as.buffer->refcount;
+}
+
+//------------------------------------------------------------------------------
+// ropes
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Writes the characters of a rope into `out`, walking the tree with
+ * an explicit stack since ropes built in a loop are as deep as the loop.
+ */
+static void copy_rope(string_t *rope, char *out) {
+    size_t capacity = 64;
+    size_t count = 0;
+    string_t **stack = malloc(capacity * sizeof(string_t *));
+    CHECK_MEM_ALLOC_ERROR(stack);
+    stack[count++] = rope;
+    while (count > 0) {
+        string_t *string = stack[--count];
+        if (string->kind == STRING_ROPE) {
+            if (count + 2 > capacity) {
+                capacity *= 2;
+                stack = realloc(stack, capacity * sizeof(string_t *));
+                CHECK_MEM_ALLOC_ERROR(stack);
+            }
+            stack[count++] = string->as.rope.right;
+            stack[count++] = string->as.rope.left;
+            continue;
+        }
+        memcpy(out, string_chars(string), string->length);
+        out += string->length;
+    }
+    free(stack);
+}
+
+/**
+ * @brief Replaces a rope by a buffer holding its characters. Its children
+ * are dropped, so the collector can free them.
+ */
+static void flatten(string_t *rope) {
+    string_buffer_t *buffer = new_buffer(rope->length, rope->length);
+    copy_rope(rope, buffer->chars);
+    rope->kind = STRING_SHARED;
+    rope->as.buffer = buffer;
+}
+
+const char *string_chars(string_t *string) {
+    switch (string->kind) {
+        case STRING_INLINE:
+            return string->as.chars;
+        case STRING_ROPE:
+            flatten(string);
+            // fall through
+        case STRING_SHARED:
+            return string->as.buffer->chars;
+        case STRING_CONSTANT:
+            return string->as.constant;
+    }
+    return "";
+}
+
+//------------------------------------------------------------------------------
+// concatenation
+//------------------------------------------------------------------------------
+
+/**
+ * @brief True if `string` ends its buffer, so characters can be appended in
+ * place. A worker of a parallel for only appends to strings it has just
+ * made; everything else may be read by other threads.
+ */
+static bool appendable(const gc_heap_t *heap, const string_t *string) {
+    return string->kind == STRING_SHARED
+        && string->length == string->as.buffer->used
+        && (!heap->worker || gc_in_nursery(heap, &string->object));
+}
+
+static string_t *new_string(gc_heap_t *heap, string_kind_t kind, size_t length, size_t external) {
+    string_t *string = (string_t *)gc_allocate(heap, GC_STRING, sizeof(string_t), external);
+    string->kind = (uint8_t)kind;
+    string->length = length;
+    return string;
+}
+
+string_t *string_concat(gc_heap_t *heap, string_t *a, string_t *b) {
+    size_t length = a->length + b->length;
+    if (length <= STRING_INLINE_MAX) {
+        string_t *result = new_string(heap, STRING_INLINE, length, 0);
+        memcpy(result->as.chars, string_chars(a), a->length);
+        memcpy(result->as.chars + a->length, string_chars(b), b->length);
+        result->as.chars[length] = '\0';
+        return result;
+    }
+
+    if (appendable(heap, a)) {
+        string_buffer_t *buffer = a->as.buffer;
+        size_t added = reserve(buffer, length);
+        // `b` may be `a` itself, so read its characters after the buffer has moved.
+        memcpy(buffer->chars + a->length, string_chars(b), b->length);
+        buffer->used = length;
+        buffer->refcount++;
+        string_t *result = new_string(heap, STRING_SHARED, length, 0);
+        result->as.buffer = buffer;
+        gc_note_external(heap, &result->object, added);
+        return result;
+    }
+
+    if (length < STRING_ROPE_MIN) {
+        // Leave room to grow: the result is where the next `s = s + t` appends.
+        string_buffer_t *buffer = new_buffer(length, length < STRING_MIN_CAPACITY / 2 ? STRING_MIN_CAPACITY : length * 2);
+        memcpy(buffer->chars, string_chars(a), a->length);
+        memcpy(buffer->chars + a->length, string_chars(b), b->length);
+        string_t *result = new_string(heap, STRING_SHARED, length, buffer->capacity);
+        result->as.buffer = buffer;
+        return result;
+    }
+
+    string_t *result = new_string(heap, STRING_ROPE, length, 0);
+    result->as.rope.left = a;
+    result->as.rope.right = b;
+    if ((result->object.flags & GC_FLAG_OLD) && (gc_in_nursery(heap, &a->object) || gc_in_nursery(heap, &b->object))) {
+        // The nursery was full. A minor collection only follows ropes it
+        // promotes, so an old rope must not point into the nursery.
+        flatten(result);
+        gc_note_external(heap, &result->object, length);
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------
+// reading
+//------------------------------------------------------------------------------
+
+bool string_equal(string_t *a, string_t *b) {
+    return a == b || (a->length == b->length && memcmp(string_chars(a), string_chars(b), a->length) == 0);
+}
+
+int string_compare(string_t *a, string_t *b) {
+    size_t shorter = a->length < b->length ? a->length : b->length;
+    int order = memcmp(string_chars(a), string_chars(b), shorter);
+    if (order != 0) {
+        return order;
+    }
+    return (a->length > b->length) - (a->length < b->length);
+}
+
+void string_print(FILE *out, string_t *string) {
+    fwrite(string_chars(string), 1, string->length, out);
+}
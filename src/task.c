@@ -0,0 +1,303 @@
+/**
+ * File Name: task.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "include/task.h"
+#include "include/output.h"
+#include "include/utils.h"
+
+#define EVENT_LOOP_MAX_EVENTS 64
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void init_event_loop(event_loop_t *loop) {
+    memset(loop, 0, sizeof(*loop));
+    loop->epoll_fd = -1;
+}
+
+void free_event_loop(event_loop_t *loop) {
+    task_t *task = loop->tasks;
+    while (task) {
+        task_t *next = task->all_next;
+        free(task->frame);
+        free(task);
+        task = next;
+    }
+    free(loop->timers);
+    if (loop->epoll_fd >= 0) {
+        close(loop->epoll_fd);
+    }
+    init_event_loop(loop);
+}
+
+size_t event_loop_bytes(const event_loop_t *loop) {
+    return loop->task_count * sizeof(task_t) + loop->frame_bytes;
+}
+
+static void track_memory(event_loop_t *loop) {
+    size_t bytes = event_loop_bytes(loop);
+    if (bytes > loop->peak_bytes) {
+        loop->peak_bytes = bytes;
+    }
+}
+
+static task_t *task_create(event_loop_t *loop, task_kind_t kind) {
+    task_t *task = calloc(1, sizeof(task_t));
+    CHECK_MEM_ALLOC_ERROR(task);
+    task->kind = (uint8_t)kind;
+    task->state = TASK_WAITING;
+    task->fd = -1;
+    task->result = NULL_VALUE;
+    task->all_next = loop->tasks;
+    loop->tasks = task;
+    loop->task_count++;
+    return task;
+}
+
+task_t *task_create_coroutine(event_loop_t *loop, uint32_t function, uint32_t frame_size) {
+    task_t *task = task_create(loop, TASK_COROUTINE);
+    task->function = function;
+    task->frame_size = frame_size;
+    task->frame = malloc((frame_size ? frame_size : 1) * sizeof(value_t));
+    CHECK_MEM_ALLOC_ERROR(task->frame);
+    loop->frame_bytes += frame_size * sizeof(value_t);
+    track_memory(loop);
+    task_remember(loop, task);
+    return task;
+}
+
+void task_remember(event_loop_t *loop, task_t *task) {
+    if (!task->remembered) {
+        task->remembered = 1;
+        task->remembered_next = loop->remembered;
+        loop->remembered = task;
+    }
+}
+
+size_t event_loop_sweep(event_loop_t *loop) {
+    size_t freed = 0;
+    task_t **link = &loop->tasks;
+    while (*link) {
+        task_t *task = *link;
+        if (task->marked || task->remembered || task->state != TASK_DONE) {
+            task->marked = 0;
+            link = &task->all_next;
+            continue;
+        }
+        *link = task->all_next;
+        freed += sizeof(task_t);
+        loop->task_count--;
+        free(task);     // finished, so the frame is already gone
+    }
+    return freed;
+}
+
+void task_schedule(event_loop_t *loop, task_t *task) {
+    task->state = TASK_READY;
+    task->next = NULL;
+    if (loop->ready_tail) {
+        loop->ready_tail->next = task;
+    } else {
+        loop->ready_head = task;
+    }
+    loop->ready_tail = task;
+}
+
+task_t *event_loop_next_ready(event_loop_t *loop) {
+    task_t *task = loop->ready_head;
+    if (task) {
+        loop->ready_head = task->next;
+        if (!loop->ready_head) {
+            loop->ready_tail = NULL;
+        }
+        task->next = NULL;
+    }
+    return task;
+}
+
+void task_await(event_loop_t *loop, task_t *waiter, task_t *target) {
+    waiter->state = TASK_WAITING;
+    waiter->next = target->waiters;
+    target->waiters = waiter;
+    loop->waiting_count++;
+}
+
+void task_complete(event_loop_t *loop, task_t *task, value_t result) {
+    task->state = TASK_DONE;
+    task->result = result;
+    task_remember(loop, task);
+    if (task->frame) {
+        loop->frame_bytes -= task->frame_size * sizeof(value_t);
+        free(task->frame);
+        task->frame = NULL;
+    }
+
+    // Waiters were pushed at the front; wake them in the order they arrived.
+    task_t *reversed = NULL;
+    while (task->waiters) {
+        task_t *waiter = task->waiters;
+        task->waiters = waiter->next;
+        waiter->next = reversed;
+        reversed = waiter;
+    }
+    while (reversed) {
+        task_t *waiter = reversed;
+        reversed = waiter->next;
+        waiter->frame[waiter->saved_count++] = result;
+        task_remember(loop, waiter);
+        loop->waiting_count--;
+        task_schedule(loop, waiter);
+    }
+}
+
+//------------------------------------------------------------------------------
+// timers
+//------------------------------------------------------------------------------
+
+static bool timer_before(const task_timer_t *a, const task_timer_t *b) {
+    return a->deadline < b->deadline || (a->deadline == b->deadline && a->sequence < b->sequence);
+}
+
+static void timer_push(event_loop_t *loop, task_timer_t timer) {
+    if (loop->timer_count >= loop->timer_capacity) {
+        loop->timer_capacity = loop->timer_capacity ? loop->timer_capacity * 2 : 64;
+        loop->timers = realloc(loop->timers, loop->timer_capacity * sizeof(task_timer_t));
+        CHECK_MEM_ALLOC_ERROR(loop->timers);
+    }
+    size_t i = loop->timer_count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!timer_before(&timer, &loop->timers[parent])) break;
+        loop->timers[i] = loop->timers[parent];
+        i = parent;
+    }
+    loop->timers[i] = timer;
+}
+
+static task_timer_t timer_pop(event_loop_t *loop) {
+    task_timer_t top = loop->timers[0];
+    task_timer_t last = loop->timers[--loop->timer_count];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= loop->timer_count) break;
+        if (child + 1 < loop->timer_count && timer_before(&loop->timers[child + 1], &loop->timers[child])) {
+            child++;
+        }
+        if (!timer_before(&loop->timers[child], &last)) break;
+        loop->timers[i] = loop->timers[child];
+        i = child;
+    }
+    if (loop->timer_count > 0) {
+        loop->timers[i] = last;
+    }
+    return top;
+}
+
+task_t *event_loop_sleep(event_loop_t *loop, int64_t ms) {
+    task_t *task = task_create(loop, TASK_TIMER);
+    track_memory(loop);
+    uint64_t delay = ms > 0 ? (uint64_t)ms * 1000000ull : 0;
+    timer_push(loop, (task_timer_t){ monotonic_ns() + delay, loop->timer_sequence++, task });
+    return task;
+}
+
+//------------------------------------------------------------------------------
+// file descriptors
+//------------------------------------------------------------------------------
+
+task_t *event_loop_wait_fd(event_loop_t *loop, int fd, bool write, const char **error) {
+    if (loop->epoll_fd < 0) {
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epoll_fd < 0) {
+            *error = "Cannot create the epoll instance";
+            return NULL;
+        }
+    }
+
+    task_t *task = task_create(loop, TASK_FD);
+    track_memory(loop);
+    task->fd = fd;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = (write ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+    event.data.ptr = task;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0) {
+        loop->fd_wait_count++;
+        return task;
+    }
+
+    switch (errno) {
+        case EPERM:
+            // Regular files and directories are always ready.
+            task_complete(loop, task, BOOL_VALUE(true));
+            return task;
+        case EEXIST:
+            *error = "The file descriptor is already awaited by another task";
+            break;
+        default:
+            *error = "Invalid file descriptor";
+            break;
+    }
+    task->state = TASK_DONE;
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+// polling
+//------------------------------------------------------------------------------
+
+bool event_loop_pending(const event_loop_t *loop) {
+    return loop->timer_count > 0 || loop->fd_wait_count > 0;
+}
+
+void event_loop_poll(event_loop_t *loop) {
+    int timeout = -1;
+    if (loop->timer_count > 0) {
+        uint64_t now = monotonic_ns();
+        uint64_t deadline = loop->timers[0].deadline;
+        // Round up so a timer never fires early.
+        uint64_t wait = deadline > now ? (deadline - now + 999999ull) / 1000000ull : 0;
+        timeout = wait > 1000000000ull ? 1000000000 : (int)wait;
+    }
+    if (timeout != 0) {
+        // Show what has been printed so far before going idle.
+        output_flush();
+    }
+
+    if (loop->fd_wait_count > 0) {
+        struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+        int count = epoll_wait(loop->epoll_fd, events, EVENT_LOOP_MAX_EVENTS, timeout);
+        for (int i = 0; i < count; ++i) {
+            task_t *task = events[i].data.ptr;
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, task->fd, NULL);
+            loop->fd_wait_count--;
+            bool ready = (events[i].events & (EPOLLIN | EPOLLOUT)) != 0;
+            task_complete(loop, task, BOOL_VALUE(ready));
+        }
+    } else if (timeout > 0) {
+        struct timespec delay = { timeout / 1000, (long)(timeout % 1000) * 1000000L };
+        nanosleep(&delay, NULL);   // EINTR (e.g. SIGPROF) just polls again
+    }
+
+    uint64_t now = monotonic_ns();
+    while (loop->timer_count > 0 && loop->timers[0].deadline <= now) {
+        task_timer_t timer = timer_pop(loop);
+        task_complete(loop, timer.task, NULL_VALUE);
+    }
+}
@@ -0,0 +1,193 @@
+/**
+ * File Name: trace.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "include/trace.h"
+#include "include/utils.h"
+
+bool trace_enabled = false;
+
+static FILE *trace_file = NULL;
+static char *trace_path = NULL;
+static uint64_t trace_epoch;
+
+static _Atomic(trace_buffer_t *) trace_buffers = NULL;
+static atomic_uint next_thread_id = 1;
+static _Thread_local trace_buffer_t *local_buffer = NULL;
+
+static uint64_t now_nanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Returns the calling thread's buffer, creating and publishing it on first use.
+ */
+static trace_buffer_t *thread_buffer(void) {
+    if (local_buffer) return local_buffer;
+
+    trace_buffer_t *buffer = calloc(1, sizeof(trace_buffer_t));
+    CHECK_MEM_ALLOC_ERROR(buffer);
+    buffer->events = malloc(TRACE_RING_CAPACITY * sizeof(trace_event_t));
+    CHECK_MEM_ALLOC_ERROR(buffer->events);
+    buffer->thread_id = atomic_fetch_add(&next_thread_id, 1);
+    snprintf(buffer->thread_name, sizeof(buffer->thread_name), "thread %u", buffer->thread_id);
+
+    buffer->next = atomic_load(&trace_buffers);
+    while (!atomic_compare_exchange_weak(&trace_buffers, &buffer->next, buffer)) {
+        // buffer->next was reloaded, retry
+    }
+    local_buffer = buffer;
+    return buffer;
+}
+
+static void record(char phase, const char *name, const char *detail) {
+    trace_buffer_t *buffer = thread_buffer();
+    trace_event_t *event = &buffer->events[buffer->recorded & (TRACE_RING_CAPACITY - 1)];
+    event->timestamp = now_nanoseconds() - trace_epoch;
+    event->name = name;
+    event->phase = phase;
+    if (detail) {
+        size_t length = strlen(detail);
+        if (length >= TRACE_DETAIL_SIZE) length = TRACE_DETAIL_SIZE - 1;
+        memcpy(event->detail, detail, length);
+        event->detail[length] = '\0';
+    } else {
+        event->detail[0] = '\0';
+    }
+    buffer->recorded++;
+}
+
+void trace_begin(const char *name, const char *detail) {
+    record('B', name, detail);
+}
+
+void trace_end(const char *name) {
+    record('E', name, NULL);
+}
+
+void trace_set_thread_name(const char *name) {
+    trace_buffer_t *buffer = thread_buffer();
+    snprintf(buffer->thread_name, sizeof(buffer->thread_name), "%s", name);
+}
+
+bool trace_open(const char *path) {
+    trace_file = fopen(path, "w");
+    if (!trace_file) {
+        fprintf(stderr, "Error opening trace file: %s\n", path);
+        return false;
+    }
+    trace_path = strdup(path);
+    CHECK_MEM_ALLOC_ERROR(trace_path);
+    trace_epoch = now_nanoseconds();
+    trace_enabled = true;
+    trace_set_thread_name("main");
+    atexit(trace_flush);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// output
+//------------------------------------------------------------------------------
+
+static void write_json_string(FILE *out, const char *text) {
+    for (const unsigned char *c = (const unsigned char *)text; *c; ++c) {
+        switch (*c) {
+            case '"':  fputs("\\\"", out); break;
+            case '\\': fputs("\\\\", out); break;
+            case '\n': fputs("\\n", out); break;
+            case '\t': fputs("\\t", out); break;
+            default:
+                if (*c < 0x20) {
+                    fprintf(out, "\\u%04x", *c);
+                } else {
+                    fputc(*c, out);
+                }
+        }
+    }
+}
+
+static void write_event(FILE *out, bool *first, int pid, uint32_t tid, char phase, uint64_t timestamp,
+                        const char *name, const char *detail) {
+    fprintf(out, "%s\n{\"ph\":\"%c\",\"pid\":%d,\"tid\":%u,\"ts\":%llu.%03llu", *first ? "" : ",",
+        phase, pid, tid, (unsigned long long)(timestamp / 1000), (unsigned long long)(timestamp % 1000));
+    if (name) {
+        fputs(",\"name\":\"", out);
+        write_json_string(out, name);
+        if (detail && detail[0]) {
+            fputc(' ', out);
+            write_json_string(out, detail);
+        }
+        fputc('"', out);
+    }
+    fputc('}', out);
+    *first = false;
+}
+
+/**
+ * @brief Writes one thread's ring. End events whose begin was overwritten are
+ * dropped, and spans still open (e.g. after a fatal error) are closed at `end`.
+ */
+static void write_buffer(FILE *out, bool *first, int pid, const trace_buffer_t *buffer, uint64_t end) {
+    fprintf(out, "%s\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":\"",
+        *first ? "" : ",", pid, buffer->thread_id);
+    write_json_string(out, buffer->thread_name);
+    fputs("\"}}", out);
+    *first = false;
+
+    uint64_t start = buffer->recorded > TRACE_RING_CAPACITY ? buffer->recorded - TRACE_RING_CAPACITY : 0;
+    if (start > 0) {
+        fprintf(stderr, "Warning: trace of %s lost its %llu oldest events\n", buffer->thread_name, (unsigned long long)start);
+    }
+    size_t depth = 0;
+    for (uint64_t i = start; i < buffer->recorded; ++i) {
+        const trace_event_t *event = &buffer->events[i & (TRACE_RING_CAPACITY - 1)];
+        if (event->phase == 'E') {
+            if (depth == 0) continue;
+            depth--;
+        } else {
+            depth++;
+        }
+        // End events pair with the innermost open begin, so they carry no name.
+        const char *name = event->phase == 'B' ? event->name : NULL;
+        write_event(out, first, pid, buffer->thread_id, event->phase, event->timestamp, name, event->detail);
+    }
+    while (depth-- > 0) {
+        write_event(out, first, pid, buffer->thread_id, 'E', end, NULL, NULL);
+    }
+}
+
+void trace_flush(void) {
+    if (!trace_file) return;
+    trace_enabled = false;
+    uint64_t end = now_nanoseconds() - trace_epoch;
+    int pid = (int)getpid();
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace_file);
+    bool first = true;
+    trace_buffer_t *buffer = atomic_exchange(&trace_buffers, NULL);
+    while (buffer) {
+        write_buffer(trace_file, &first, pid, buffer, end);
+        trace_buffer_t *next = buffer->next;
+        free(buffer->events);
+        free(buffer);
+        buffer = next;
+    }
+    fputs("\n]}\n", trace_file);
+    if (fclose(trace_file) != 0) {
+        fprintf(stderr, "Error writing trace file: %s\n", trace_path);
+    }
+    trace_file = NULL;
+    local_buffer = NULL;
+    free(trace_path);
+    trace_path = NULL;
+}
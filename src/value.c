@@ -0,0 +1,79 @@
+/**
+ * File Name: value.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include <inttypes.h>
+
+#include "include/value.h"
+#include "include/array.h"
+#include "include/str.h"
+
+char *value_type_to_string(value_type_t type) {
+    switch (type) {
+        case VALUE_NULL:   return "null";
+        case VALUE_BOOL:   return "bool";
+        case VALUE_INT:    return "int";
+        case VALUE_FLOAT:  return "float";
+        case VALUE_STRING: return "string";
+        case VALUE_TASK:   return "task";
+        case VALUE_ARRAY:  return "array";
+        default:           return "unknown";
+    }
+}
+
+bool object_is_truthy(value_t value) {
+    if (IS_STRING(value)) {
+        return AS_STRING(value)->length != 0;
+    }
+    return true;  // arrays, tasks, and boxed ints, which are never 0
+}
+
+bool values_equal(value_t a, value_t b) {
+    if (BOTH_SMALL_INTS(a, b)) {
+        return a.bits == b.bits;
+    }
+    if (IS_NUMBER(a) && IS_NUMBER(b)) {
+        if (IS_INT(a) && IS_INT(b)) {
+            return AS_INT(a) == AS_INT(b);
+        }
+        return AS_DOUBLE(a) == AS_DOUBLE(b);
+    }
+    value_type_t type = value_type(a);
+    if (type != value_type(b)) {
+        return false;
+    }
+    switch (type) {
+        case VALUE_NULL:   return true;
+        case VALUE_BOOL:   return AS_BOOL(a) == AS_BOOL(b);
+        case VALUE_STRING: return string_equal(AS_STRING(a), AS_STRING(b));
+        case VALUE_TASK:   return AS_TASK(a) == AS_TASK(b);
+        case VALUE_ARRAY:  return AS_ARRAY(a) == AS_ARRAY(b);
+        default:           return false;
+    }
+}
+
+static void print_array(FILE *out, const array_t *array) {
+    fputc('[', out);
+    for (size_t i = 0; i < array->length; ++i) {
+        if (i > 0) fputs(", ", out);
+        if (array->element_type == VALUE_FLOAT) {
+            fprintf(out, "%g", array->as.floats[i]);
+        } else {
+            fprintf(out, "%" PRId64, array->as.ints[i]);
+        }
+    }
+    fputc(']', out);
+}
+
+void print_value(FILE *out, value_t value) {
+    switch (value_type(value)) {
+        case VALUE_NULL:   fputs("null", out); break;
+        case VALUE_BOOL:   fputs(AS_BOOL(value) ? "true" : "false", out); break;
+        case VALUE_INT:    fprintf(out, "%" PRId64, AS_INT(value)); break;
+        case VALUE_FLOAT:  fprintf(out, "%g", AS_FLOAT(value)); break;
+        case VALUE_STRING: string_print(out, AS_STRING(value)); break;
+        case VALUE_TASK:   fputs("<task>", out); break;
+        case VALUE_ARRAY:  print_array(out, AS_ARRAY(value)); break;
+    }
+}
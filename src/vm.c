@@ -0,0 +1,1396 @@
+/**
+ * File Name: vm.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <inttypes.h>
+
+#include "include/vm.h"
+#include "include/array.h"
+#include "include/opcode.h"
+#include "include/output.h"
+#include "include/profiler.h"
+#include "include/scheduler.h"
+#include "include/str.h"
+#include "include/trace.h"
+#include "include/utils.h"
+
+#define PARALLEL_MAX_CHUNKS 1024    /**< Fixed per loop, so reductions combine the same way on any thread count */
+
+typedef struct parallel_region_struct {
+    vm_t *parent;
+    uint16_t function;              /**< Worker: captured locals..., lo, hi */
+    const value_t *captures;
+    size_t capture_count;
+
+    int64_t start;
+    int64_t end;
+    uint32_t step;
+    uint64_t chunk_size;            /**< Iterations per chunk */
+    size_t chunk_count;
+
+    uint8_t reduction_count;
+    value_t *partials;              /**< reduction_count values per chunk */
+    boxed_int_t *partial_boxes;     /**< Outside any heap, for the partials that are boxed ints */
+
+    vm_t **workers;                 /**< One VM per pool worker, created on first use */
+    value_t *args;                  /**< One argument row per pool worker */
+    size_t worker_count;
+    atomic_bool failed;             /**< The first failing chunk reports, the others stay quiet */
+} parallel_region_t;
+
+/**
+ * @brief Decodes a constant of the image. Ints too wide for a value are
+ * boxed outside the heap, like the string constants.
+ */
+static value_t constant_value(vm_t *vm, uint16_t index) {
+    const image_constant_t *constant = &vm->image->constants[index];
+    switch ((image_constant_kind_t)constant->kind) {
+        case IMAGE_CONST_INT: {
+            int64_t integer = (int64_t)constant->payload;
+            if (INT_FITS_SMALL(integer)) {
+                return SMALL_INT_VALUE(integer);
+            }
+            boxed_int_t *boxed = &vm->boxed_constants[index];
+            boxed->object.kind = GC_BOXED_INT;
+            boxed->object.flags = GC_FLAG_CONSTANT;
+            boxed->object.next = NULL;
+            boxed->value = integer;
+            return BOXED_INT_VALUE(boxed);
+        }
+        case IMAGE_CONST_FLOAT: {
+            double d;
+            memcpy(&d, &constant->payload, sizeof(d));
+            return FLOAT_VALUE(d);
+        }
+        case IMAGE_CONST_STRING: {
+            const char *chars = vm->image->strings + constant->payload;
+            init_string_constant(&vm->constants[index], chars, strlen(chars));
+            return STRING_VALUE(&vm->constants[index]);
+        }
+    }
+    return NULL_VALUE;
+}
+
+vm_t *init_vm(const image_t *image) {
+    vm_t *vm = malloc(sizeof(vm_t));
+    CHECK_MEM_ALLOC_ERROR(vm);
+    vm->image = image;
+    vm->profiler = NULL;
+    vm->opcode_profile = NULL;
+    memset(&vm->opcode_window, 0, sizeof(vm->opcode_window));
+    vm->region = NULL;
+    vm->reductions = NULL;
+    vm->reduction_count = 0;
+    vm->reduction_boxes = NULL;
+    init_event_loop(&vm->loop);
+    vm->current_task = NULL;
+    init_gc_heap(&vm->heap);
+
+    size_t constant_count = image->header->constant_count;
+    vm->constants = malloc((constant_count ? constant_count : 1) * sizeof(string_t));
+    CHECK_MEM_ALLOC_ERROR(vm->constants);
+    vm->boxed_constants = malloc((constant_count ? constant_count : 1) * sizeof(boxed_int_t));
+    CHECK_MEM_ALLOC_ERROR(vm->boxed_constants);
+    vm->constant_values = malloc((constant_count ? constant_count : 1) * sizeof(value_t));
+    CHECK_MEM_ALLOC_ERROR(vm->constant_values);
+    for (size_t i = 0; i < constant_count; ++i) {
+        vm->constant_values[i] = constant_value(vm, (uint16_t)i);
+    }
+
+    vm->stack_capacity = 1024;
+    vm->stack = malloc(vm->stack_capacity * sizeof(value_t));
+    CHECK_MEM_ALLOC_ERROR(vm->stack);
+    vm->stack_top = 0;
+
+    vm->frame_capacity = 64;
+    vm->frames = malloc(vm->frame_capacity * sizeof(call_frame_t));
+    CHECK_MEM_ALLOC_ERROR(vm->frames);
+    vm->frame_count = 0;
+
+    size_t global_count = image->header->global_count;
+    vm->globals = malloc((global_count ? global_count : 1) * sizeof(value_t));
+    CHECK_MEM_ALLOC_ERROR(vm->globals);
+    for (size_t i = 0; i < global_count; ++i) {
+        vm->globals[i] = NULL_VALUE;
+    }
+    return vm;
+}
+
+void free_vm(vm_t *vm) {
+    if (vm) {
+        free(vm->stack);
+        free(vm->frames);
+        if (!vm->region) {
+            free(vm->globals);
+        }
+        free_event_loop(&vm->loop);
+        free_gc_heap(&vm->heap);
+        free(vm->constants);
+        free(vm->boxed_constants);
+        free(vm->constant_values);
+        free(vm);
+    }
+}
+
+#define VM_TRACEBACK_FRAMES 8
+
+static void ensure_stack(vm_t *vm, size_t needed) {
+    if (needed <= vm->stack_capacity) return;
+    while (vm->stack_capacity < needed) {
+        vm->stack_capacity *= 2;
+    }
+    vm->stack = realloc(vm->stack, vm->stack_capacity * sizeof(value_t));
+    CHECK_MEM_ALLOC_ERROR(vm->stack);
+}
+
+static void runtime_error(vm_t *vm, uint32_t pc, const char *format, ...) {
+    if (vm->region && atomic_exchange(&vm->region->failed, true)) {
+        return;
+    }
+    const image_t *image = vm->image;
+    call_frame_t *frame = &vm->frames[vm->frame_count - 1];
+    uint32_t line, column;
+    image_position_for_pc(image, frame->function, pc, &line, &column);
+
+    output_flush();
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "[%u:%u] Runtime error: ", line, column);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+
+    for (size_t i = vm->frame_count; i > 0; --i) {
+        if (vm->frame_count > 2 * VM_TRACEBACK_FRAMES && i == vm->frame_count - VM_TRACEBACK_FRAMES) {
+            size_t skipped = vm->frame_count - 2 * VM_TRACEBACK_FRAMES;
+            fprintf(stderr, "    ... %zu more frames\n", skipped);
+            i -= skipped - 1;
+            continue;
+        }
+        call_frame_t *f = &vm->frames[i - 1];
+        uint32_t at = (i == vm->frame_count) ? pc : (f->pc > 0 ? f->pc - 1 : 0);
+        image_position_for_pc(image, f->function, at, &line, &column);
+        fprintf(stderr, "    in %s [%u:%u]\n", image_string(image, image->functions[f->function].name), line, column);
+    }
+}
+
+static char *opcode_symbol(opcode_t op) {
+    switch (op) {
+        case OP_ADD: return "+";
+        case OP_SUB: return "-";
+        case OP_MUL: return "*";
+        case OP_DIV: return "/";
+        case OP_MOD: return "%";
+        case OP_EQ:  return "==";
+        case OP_NEQ: return "!=";
+        case OP_LT:  return "<";
+        case OP_LEQ: return "<=";
+        case OP_GT:  return ">";
+        case OP_GEQ: return ">=";
+        default:     return opcode_to_string(op);
+    }
+}
+
+/**
+ * @brief Integer arithmetic wraps around like two's complement instead of
+ * invoking undefined behaviour on overflow.
+ */
+static int64_t wrap_int(uint64_t value) {
+    return (int64_t)value;
+}
+
+/**
+ * @brief + - * / % of two numbers, any of them boxed. Int results too wide
+ * for a value are boxed in `heap`.
+ */
+static bool arithmetic(gc_heap_t *heap, opcode_t op, value_t a, value_t b, value_t *result, const char **error) {
+    if (IS_INT(a) && IS_INT(b)) {
+        int64_t x = AS_INT(a), y = AS_INT(b);
+        switch (op) {
+            case OP_ADD: *result = gc_int_value(heap, wrap_int((uint64_t)x + (uint64_t)y)); return true;
+            case OP_SUB: *result = gc_int_value(heap, wrap_int((uint64_t)x - (uint64_t)y)); return true;
+            case OP_MUL: *result = gc_int_value(heap, wrap_int((uint64_t)x * (uint64_t)y)); return true;
+            case OP_DIV:
+            case OP_MOD:
+                if (y == 0) {
+                    *error = "Division by zero";
+                    return false;
+                }
+                if (y == -1) {
+                    *result = op == OP_DIV ? gc_int_value(heap, wrap_int(0 - (uint64_t)x)) : SMALL_INT_VALUE(0);
+                    return true;
+                }
+                *result = gc_int_value(heap, op == OP_DIV ? x / y : x % y);
+                return true;
+            default:
+                break;
+        }
+    } else if (IS_NUMBER(a) && IS_NUMBER(b)) {
+        double x = AS_DOUBLE(a), y = AS_DOUBLE(b);
+        switch (op) {
+            case OP_ADD: *result = FLOAT_VALUE(x + y); return true;
+            case OP_SUB: *result = FLOAT_VALUE(x - y); return true;
+            case OP_MUL: *result = FLOAT_VALUE(x * y); return true;
+            case OP_DIV: *result = FLOAT_VALUE(x / y); return true;
+            case OP_MOD: *result = FLOAT_VALUE(fmod(x, y)); return true;
+            default:     break;
+        }
+    }
+    *error = NULL;
+    return false;
+}
+
+static bool compare(opcode_t op, value_t a, value_t b, bool *result) {
+    int order;
+    if (IS_INT(a) && IS_INT(b)) {
+        int64_t x = AS_INT(a), y = AS_INT(b);
+        order = (x > y) - (x < y);
+    } else if (IS_NUMBER(a) && IS_NUMBER(b)) {
+        double x = AS_DOUBLE(a), y = AS_DOUBLE(b);
+        if (x != x || y != y) {
+            *result = false;  // NaN compares false
+            return true;
+        }
+        order = (x > y) - (x < y);
+    } else if (IS_STRING(a) && IS_STRING(b)) {
+        order = string_compare(AS_STRING(a), AS_STRING(b));
+    } else {
+        return false;
+    }
+
+    switch (op) {
+        case OP_LT:  *result = order < 0; break;
+        case OP_LEQ: *result = order <= 0; break;
+        case OP_GT:  *result = order > 0; break;
+        case OP_GEQ: *result = order >= 0; break;
+        default:     return false;
+    }
+    return true;
+}
+
+static bool parallel_for(vm_t *vm, uint16_t worker, int64_t start, int64_t end, uint32_t step,
+    uint8_t reduction_count, uint32_t multiply_mask, value_t *results, const char **error);
+
+//------------------------------------------------------------------------------
+// arrays
+//------------------------------------------------------------------------------
+
+static const char *describe_type(value_t value) {
+    return IS_ARRAY(value) ? array_type_to_string(AS_ARRAY(value)) : value_type_to_string(value_type(value));
+}
+
+/**
+ * @brief Element-wise + - * / where one or both operands are arrays. The
+ * other operand may be a scalar of the element type (or an int for float[]).
+ *
+ * @return false with `error` set, or NULL for unsupported operand types.
+ */
+static bool array_arithmetic(vm_t *vm, opcode_t op, value_t a, value_t b, value_t *result, const char **error) {
+    const array_t *x = IS_ARRAY(a) ? AS_ARRAY(a) : NULL;
+    const array_t *y = IS_ARRAY(b) ? AS_ARRAY(b) : NULL;
+    const array_t *shape = x ? x : y;
+    value_type_t element = (value_type_t)shape->element_type;
+    *error = NULL;
+
+    array_op_t array_op;
+    switch (op) {
+        case OP_ADD: array_op = ARRAY_ADD; break;
+        case OP_SUB: array_op = ARRAY_SUB; break;
+        case OP_MUL: array_op = ARRAY_MUL; break;
+        case OP_DIV:
+            if (element != VALUE_FLOAT) return false;
+            array_op = ARRAY_DIV;
+            break;
+        default:
+            return false;
+    }
+    if (x && y) {
+        if (x->element_type != y->element_type) return false;
+        if (x->length != y->length) {
+            *error = "Element-wise operation on arrays of different lengths";
+            return false;
+        }
+    }
+
+    // A scalar operand is broadcast from a one element buffer.
+    int64_t int_scalar = 0;
+    double float_scalar = 0;
+    value_t scalar = x ? b : a;
+    if (!(x && y)) {
+        if (element == VALUE_INT && IS_INT(scalar)) {
+            int_scalar = AS_INT(scalar);
+        } else if (element == VALUE_FLOAT && IS_NUMBER(scalar)) {
+            float_scalar = AS_DOUBLE(scalar);
+        } else {
+            return false;
+        }
+    }
+    const void *scalar_data = element == VALUE_INT ? (const void *)&int_scalar : (const void *)&float_scalar;
+
+    array_t *out = gc_new_array(&vm->heap, element, shape->length);
+    array_elementwise(array_op, x ? x->as.data : scalar_data, x ? 1 : 0, y ? y->as.data : scalar_data, y ? 1 : 0, out);
+    *result = ARRAY_VALUE(out);
+    return true;
+}
+
+/**
+ * @brief Checks `array[index]`, formatting the runtime error into `message` if it is invalid.
+ */
+static bool check_index(value_t array, value_t index, char *message, size_t size) {
+    if (!IS_ARRAY(array)) {
+        snprintf(message, size, "Cannot index a value of type %s", describe_type(array));
+        return false;
+    }
+    if (!IS_INT(index)) {
+        snprintf(message, size, "Array index must be int, not %s", describe_type(index));
+        return false;
+    }
+    int64_t i = AS_INT(index);
+    if (i < 0 || (uint64_t)i >= AS_ARRAY(array)->length) {
+        snprintf(message, size, "Index %" PRId64 " out of bounds for %s of length %zu", i,
+            array_type_to_string(AS_ARRAY(array)), AS_ARRAY(array)->length);
+        return false;
+    }
+    return true;
+}
+
+static value_t array_element(gc_heap_t *heap, const array_t *array, size_t index) {
+    return array->element_type == VALUE_FLOAT ? FLOAT_VALUE(array->as.floats[index]) : gc_int_value(heap, array->as.ints[index]);
+}
+
+/**
+ * @brief Runs frames until the frame that was on top when called returns.
+ */
+static vm_status_t vm_execute(vm_t *vm, value_t *result) {
+    const image_t *image = vm->image;
+    size_t exit_depth = vm->frame_count - 1;
+
+    call_frame_t *frame = &vm->frames[vm->frame_count - 1];
+    const image_function_t *function = &image->functions[frame->function];
+    const uint8_t *code = image->code + function->code_offset;
+    const uint8_t *ip = code + frame->pc;
+    value_t *slots = vm->stack + frame->base;
+    value_t *sp = vm->stack + vm->stack_top;
+
+#define READ_U8()   (*ip++)
+#define READ_U16()  (ip += 2, (uint16_t)(ip[-2] | (ip[-1] << 8)))
+#define READ_U32()  (ip += 4, (uint32_t)ip[-4] | ((uint32_t)ip[-3] << 8) | ((uint32_t)ip[-2] << 16) | ((uint32_t)ip[-1] << 24))
+#define PUSH(v)     (*sp++ = (v))
+#define POP()       (*--sp)
+#define PEEK(n)     (sp[-1 - (n)])
+#define RUNTIME_ERROR(...) \
+    do { \
+        vm->stack_top = (size_t)(sp - vm->stack); \
+        runtime_error(vm, (uint32_t)(instruction - code), __VA_ARGS__); \
+        vm->frame_count = exit_depth; \
+        return VM_RUNTIME_ERROR; \
+    } while (0)
+/* Collects if an allocation asked for it; every live value is in a root here. */
+#define GC_SAFEPOINT() \
+    do { \
+        if (GC_PENDING(&vm->heap)) { \
+            vm->stack_top = (size_t)(sp - vm->stack); \
+            if (!gc_collect(vm)) { \
+                RUNTIME_ERROR("Out of memory: %zu bytes live, heap limit %zu", vm->heap.old_bytes, vm->heap.max_heap); \
+            } \
+        } \
+    } while (0)
+
+/*
+ * + - * of two ints of at most 48 bits, or of two floats, without leaving
+ * the loop; everything else, wide ints included, takes slow_arithmetic.
+ */
+#define ARITHMETIC_CASE(opcode, operator) \
+    case opcode: { \
+        value_t b = PEEK(0); \
+        value_t a = PEEK(1); \
+        if (BOTH_SMALL_INTS(a, b)) { \
+            int64_t r = SMALL_INT_OP(a, operator, b); \
+            if (INT_FITS_SMALL(r)) { \
+                PEEK(1) = SMALL_INT_VALUE(r); \
+                sp--; \
+                break; \
+            } \
+        } else if (BOTH_FLOATS(a, b)) { \
+            PEEK(1) = FLOAT_OP(a, operator, b); \
+            sp--; \
+            break; \
+        } \
+        goto slow_arithmetic; \
+    }
+/*
+ * Typed arithmetic of ints: the compiler proved both are ints, so only
+ * their width is checked. Wide ints, results that do not fit and division
+ * by anything but a positive int take slow_arithmetic as the generic
+ * opcode, which also reports division by zero.
+ */
+#define INT_ARITHMETIC_CASE(opcode, generic, operator) \
+    case opcode: { \
+        value_t b = PEEK(0); \
+        value_t a = PEEK(1); \
+        if (BOTH_SMALL_INTS(a, b)) { \
+            int64_t r = SMALL_INT_OP(a, operator, b); \
+            if (INT_FITS_SMALL(r)) { \
+                PEEK(1) = SMALL_INT_VALUE(r); \
+                sp--; \
+                break; \
+            } \
+        } \
+        op = generic; \
+        goto slow_arithmetic; \
+    }
+#define INT_DIVISION_CASE(opcode, generic, operator) \
+    case opcode: { \
+        value_t b = PEEK(0); \
+        value_t a = PEEK(1); \
+        if (BOTH_SMALL_INTS(a, b) && AS_SMALL_INT(b) > 0) { \
+            PEEK(1) = SMALL_INT_VALUE(AS_SMALL_INT(a) operator AS_SMALL_INT(b)); \
+            sp--; \
+            break; \
+        } \
+        op = generic; \
+        goto slow_arithmetic; \
+    }
+/* Typed float arithmetic, which cannot fail. */
+#define FLOAT_ARITHMETIC_CASE(opcode, operator) \
+    case opcode: \
+        PEEK(1) = FLOAT_OP(PEEK(1), operator, PEEK(0)); \
+        sp--; \
+        break;
+/*
+ * Typed int comparison. Off the small int fast path the tags are checked
+ * before a boxed int is read, as a loaded image may break the compiler's proof.
+ */
+#define INT_COMPARISON(generic, operator) \
+    value_t b = PEEK(0); \
+    value_t a = PEEK(1); \
+    if (BOTH_SMALL_INTS(a, b)) { \
+        PEEK(1) = BOOL_VALUE(AS_SMALL_INT(a) operator AS_SMALL_INT(b)); \
+    } else if (IS_INT(a) && IS_INT(b)) { \
+        PEEK(1) = BOOL_VALUE(AS_INT(a) operator AS_INT(b)); \
+    } else { \
+        RUNTIME_ERROR("Unsupported operands for '%s': %s and %s", opcode_symbol(generic), \
+            describe_type(a), describe_type(b)); \
+    } \
+    sp--;
+#define INT_COMPARISON_CASE(opcode, generic, operator) \
+    case opcode: { \
+        INT_COMPARISON(generic, operator) \
+        break; \
+    }
+/* Typed float comparisons, which cannot fail. */
+#define FLOAT_COMPARISON_CASE(opcode, operator) \
+    case opcode: \
+        PEEK(1) = BOOL_VALUE(AS_FLOAT(PEEK(1)) operator AS_FLOAT(PEEK(0))); \
+        sp--; \
+        break;
+#define COMPARISON_CASE(opcode, operator) \
+    case opcode: { \
+        value_t b = POP(); \
+        value_t a = POP(); \
+        bool outcome; \
+        if (BOTH_SMALL_INTS(a, b)) { \
+            outcome = AS_SMALL_INT(a) operator AS_SMALL_INT(b); \
+        } else if (!compare(op, a, b, &outcome)) { \
+            RUNTIME_ERROR("Unsupported operands for '%s': %s and %s", opcode_symbol(op), \
+                value_type_to_string(value_type(a)), value_type_to_string(value_type(b))); \
+        } \
+        PUSH(BOOL_VALUE(outcome)); \
+        break; \
+    }
+
+/*
+ * One component of a superinstruction, with `ip` at its opcode byte. A
+ * component off its fast path leaves `ip` there and continues the loop, so
+ * the plain instruction runs next and takes care of the rest. OP_COUNT, the
+ * missing third component of a pair, does nothing.
+ */
+#define SUPER_ARITHMETIC_STEP(opcode, operator) \
+    case opcode: { \
+        value_t b = PEEK(0); \
+        value_t a = PEEK(1); \
+        if (BOTH_SMALL_INTS(a, b)) { \
+            int64_t r = SMALL_INT_OP(a, operator, b); \
+            if (INT_FITS_SMALL(r)) { \
+                PEEK(1) = SMALL_INT_VALUE(r); \
+                sp--; \
+                ip++; \
+                break; \
+            } \
+        } else if ((opcode) < OP_ADD_INT && BOTH_FLOATS(a, b)) { \
+            PEEK(1) = FLOAT_OP(a, operator, b); \
+            sp--; \
+            ip++; \
+            break; \
+        } \
+        continue; \
+    }
+#define SUPER_DIVISION_STEP(opcode, operator) \
+    case opcode: { \
+        value_t b = PEEK(0); \
+        value_t a = PEEK(1); \
+        if (!BOTH_SMALL_INTS(a, b) || AS_SMALL_INT(b) <= 0) continue; \
+        PEEK(1) = SMALL_INT_VALUE(AS_SMALL_INT(a) operator AS_SMALL_INT(b)); \
+        sp--; \
+        ip++; \
+        break; \
+    }
+#define SUPER_COMPARISON_STEP(opcode, operator) \
+    case opcode: { \
+        value_t b = PEEK(0); \
+        value_t a = PEEK(1); \
+        if (!BOTH_SMALL_INTS(a, b)) continue; \
+        PEEK(1) = BOOL_VALUE(AS_SMALL_INT(a) operator AS_SMALL_INT(b)); \
+        sp--; \
+        ip++; \
+        break; \
+    }
+/* Int comparisons may head a superinstruction, so they never fall back. */
+#define SUPER_INT_COMPARISON_STEP(opcode, generic, operator) \
+    case opcode: { \
+        INT_COMPARISON(generic, operator) \
+        ip++; \
+        break; \
+    }
+#define SUPER_FLOAT_STEP(opcode, operator) \
+    case opcode: \
+        PEEK(1) = FLOAT_OP(PEEK(1), operator, PEEK(0)); \
+        sp--; \
+        ip++; \
+        break;
+#define SUPER_FLOAT_COMPARISON_STEP(opcode, operator) \
+    case opcode: \
+        PEEK(1) = BOOL_VALUE(AS_FLOAT(PEEK(1)) operator AS_FLOAT(PEEK(0))); \
+        sp--; \
+        ip++; \
+        break;
+#define SUPER_STEP(component) \
+    switch (component) { \
+        case OP_CONST:      ip++; PUSH(vm->constant_values[READ_U16()]); break; \
+        case OP_NULL:       ip++; PUSH(NULL_VALUE); break; \
+        case OP_TRUE:       ip++; PUSH(BOOL_VALUE(true)); break; \
+        case OP_FALSE:      ip++; PUSH(BOOL_VALUE(false)); break; \
+        case OP_POP:        ip++; sp--; break; \
+        case OP_DUP:        ip++; *sp = sp[-1]; sp++; break; \
+        case OP_GET_LOCAL:  ip++; PUSH(slots[READ_U16()]); break; \
+        case OP_SET_LOCAL:  ip++; slots[READ_U16()] = POP(); break; \
+        case OP_GET_GLOBAL: ip++; PUSH(vm->globals[READ_U16()]); break; \
+        case OP_SET_GLOBAL: \
+            if (vm->region) continue; \
+            ip++; \
+            vm->globals[READ_U16()] = POP(); \
+            break; \
+        case OP_NOT:        ip++; PEEK(0) = BOOL_VALUE(!value_is_truthy(PEEK(0))); break; \
+        case OP_EQ: \
+        case OP_NEQ: \
+            ip++; \
+            PEEK(1) = BOOL_VALUE(values_equal(PEEK(1), PEEK(0)) == ((component) == OP_EQ)); \
+            sp--; \
+            break; \
+        SUPER_ARITHMETIC_STEP(OP_ADD, +) \
+        SUPER_ARITHMETIC_STEP(OP_SUB, -) \
+        SUPER_ARITHMETIC_STEP(OP_MUL, *) \
+        SUPER_COMPARISON_STEP(OP_LT, <) \
+        SUPER_COMPARISON_STEP(OP_LEQ, <=) \
+        SUPER_COMPARISON_STEP(OP_GT, >) \
+        SUPER_COMPARISON_STEP(OP_GEQ, >=) \
+        SUPER_ARITHMETIC_STEP(OP_ADD_INT, +) \
+        SUPER_ARITHMETIC_STEP(OP_SUB_INT, -) \
+        SUPER_ARITHMETIC_STEP(OP_MUL_INT, *) \
+        SUPER_DIVISION_STEP(OP_DIV_INT, /) \
+        SUPER_DIVISION_STEP(OP_MOD_INT, %) \
+        SUPER_INT_COMPARISON_STEP(OP_EQ_INT, OP_EQ, ==) \
+        SUPER_INT_COMPARISON_STEP(OP_NEQ_INT, OP_NEQ, !=) \
+        SUPER_INT_COMPARISON_STEP(OP_LT_INT, OP_LT, <) \
+        SUPER_INT_COMPARISON_STEP(OP_LEQ_INT, OP_LEQ, <=) \
+        SUPER_INT_COMPARISON_STEP(OP_GT_INT, OP_GT, >) \
+        SUPER_INT_COMPARISON_STEP(OP_GEQ_INT, OP_GEQ, >=) \
+        SUPER_FLOAT_STEP(OP_ADD_FLOAT, +) \
+        SUPER_FLOAT_STEP(OP_SUB_FLOAT, -) \
+        SUPER_FLOAT_STEP(OP_MUL_FLOAT, *) \
+        SUPER_FLOAT_STEP(OP_DIV_FLOAT, /) \
+        case OP_NEG_FLOAT:  ip++; PEEK(0) = FLOAT_VALUE(-AS_FLOAT(PEEK(0))); break; \
+        SUPER_FLOAT_COMPARISON_STEP(OP_EQ_FLOAT, ==) \
+        SUPER_FLOAT_COMPARISON_STEP(OP_NEQ_FLOAT, !=) \
+        SUPER_FLOAT_COMPARISON_STEP(OP_LT_FLOAT, <) \
+        SUPER_FLOAT_COMPARISON_STEP(OP_LEQ_FLOAT, <=) \
+        SUPER_FLOAT_COMPARISON_STEP(OP_GT_FLOAT, >) \
+        SUPER_FLOAT_COMPARISON_STEP(OP_GEQ_FLOAT, >=) \
+        case OP_TO_FLOAT: \
+            ip++; \
+            if (IS_INT(PEEK(0))) { \
+                PEEK(0) = FLOAT_VALUE((double)AS_INT(PEEK(0))); \
+            } \
+            break; \
+        case OP_JUMP: { \
+            ip++; \
+            uint32_t target = READ_U32(); \
+            ip = code + target; \
+            break; \
+        } \
+        case OP_JUMP_IF_FALSE: { \
+            ip++; \
+            uint32_t target = READ_U32(); \
+            if (!value_is_truthy(POP())) { \
+                ip = code + target; \
+            } \
+            break; \
+        } \
+        default: \
+            break; \
+    }
+
+    for (;;) {
+        const uint8_t *instruction = ip;
+        if (profiler_sample_pending) {
+            if (vm->opcode_profile) {
+                opcode_profile_record(vm->opcode_profile, &vm->opcode_window, instruction);
+            } else if (vm->profiler) {
+                // Safepoint: the frame stack is consistent between instructions.
+                profiler_sample_pending = 0;
+                profiler_sample(vm->profiler, vm, (uint32_t)(instruction - code));
+            }
+        }
+        opcode_t op = (opcode_t)READ_U8();
+        switch (op) {
+            case OP_CONST:
+                PUSH(vm->constant_values[READ_U16()]);
+                break;
+            case OP_NULL:
+                PUSH(NULL_VALUE);
+                break;
+            case OP_TRUE:
+                PUSH(BOOL_VALUE(true));
+                break;
+            case OP_FALSE:
+                PUSH(BOOL_VALUE(false));
+                break;
+            case OP_POP:
+                sp--;
+                break;
+            case OP_DUP:
+                *sp = sp[-1];
+                sp++;
+                break;
+
+            case OP_GET_LOCAL:
+                PUSH(slots[READ_U16()]);
+                break;
+            case OP_SET_LOCAL:
+                slots[READ_U16()] = POP();
+                break;
+            case OP_GET_GLOBAL:
+                PUSH(vm->globals[READ_U16()]);
+                break;
+            case OP_SET_GLOBAL: {
+                uint16_t index = READ_U16();
+                if (vm->region) {
+                    // Globals are shared by every worker; writes would race.
+                    RUNTIME_ERROR("Cannot assign global '%s' inside a parallel for",
+                        image_string(image, image->globals[index].name));
+                }
+                vm->globals[index] = POP();
+                break;
+            }
+
+            ARITHMETIC_CASE(OP_ADD, +)
+            ARITHMETIC_CASE(OP_SUB, -)
+            ARITHMETIC_CASE(OP_MUL, *)
+            case OP_DIV:
+            case OP_MOD:
+            slow_arithmetic: {
+                value_t b = POP();
+                value_t a = POP();
+                const char *error = NULL;
+                bool ok = true;
+                if (IS_ARRAY(a) || IS_ARRAY(b)) {
+                    ok = array_arithmetic(vm, op, a, b, sp, &error);
+                } else if (op == OP_ADD && IS_STRING(a) && IS_STRING(b)) {
+                    *sp = STRING_VALUE(string_concat(&vm->heap, AS_STRING(a), AS_STRING(b)));
+                } else {
+                    ok = arithmetic(&vm->heap, op, a, b, sp, &error);
+                }
+                if (!ok) {
+                    if (error) {
+                        RUNTIME_ERROR("%s", error);
+                    }
+                    RUNTIME_ERROR("Unsupported operands for '%s': %s and %s", opcode_symbol(op),
+                        describe_type(a), describe_type(b));
+                }
+                sp++;
+                GC_SAFEPOINT();
+                break;
+            }
+            case OP_NEG: {
+                value_t a = PEEK(0);
+                if (IS_INT(a)) {
+                    PEEK(0) = gc_int_value(&vm->heap, wrap_int(0 - (uint64_t)AS_INT(a)));
+                } else if (IS_FLOAT(a)) {
+                    PEEK(0) = FLOAT_VALUE(-AS_FLOAT(a));
+                } else {
+                    RUNTIME_ERROR("Unsupported operand for unary '-': %s", value_type_to_string(value_type(a)));
+                }
+                GC_SAFEPOINT();
+                break;
+            }
+            case OP_NOT:
+                PEEK(0) = BOOL_VALUE(!value_is_truthy(PEEK(0)));
+                break;
+
+            INT_ARITHMETIC_CASE(OP_ADD_INT, OP_ADD, +)
+            INT_ARITHMETIC_CASE(OP_SUB_INT, OP_SUB, -)
+            INT_ARITHMETIC_CASE(OP_MUL_INT, OP_MUL, *)
+            INT_DIVISION_CASE(OP_DIV_INT, OP_DIV, /)
+            INT_DIVISION_CASE(OP_MOD_INT, OP_MOD, %)
+            case OP_NEG_INT: {
+                value_t a = PEEK(0);
+                if (!IS_INT(a)) {
+                    RUNTIME_ERROR("Unsupported operand for unary '-': %s", value_type_to_string(value_type(a)));
+                }
+                PEEK(0) = gc_int_value(&vm->heap, wrap_int(0 - (uint64_t)AS_INT(a)));
+                GC_SAFEPOINT();
+                break;
+            }
+            INT_COMPARISON_CASE(OP_EQ_INT, OP_EQ, ==)
+            INT_COMPARISON_CASE(OP_NEQ_INT, OP_NEQ, !=)
+            INT_COMPARISON_CASE(OP_LT_INT, OP_LT, <)
+            INT_COMPARISON_CASE(OP_LEQ_INT, OP_LEQ, <=)
+            INT_COMPARISON_CASE(OP_GT_INT, OP_GT, >)
+            INT_COMPARISON_CASE(OP_GEQ_INT, OP_GEQ, >=)
+            FLOAT_ARITHMETIC_CASE(OP_ADD_FLOAT, +)
+            FLOAT_ARITHMETIC_CASE(OP_SUB_FLOAT, -)
+            FLOAT_ARITHMETIC_CASE(OP_MUL_FLOAT, *)
+            FLOAT_ARITHMETIC_CASE(OP_DIV_FLOAT, /)
+            case OP_NEG_FLOAT:
+                PEEK(0) = FLOAT_VALUE(-AS_FLOAT(PEEK(0)));
+                break;
+            FLOAT_COMPARISON_CASE(OP_EQ_FLOAT, ==)
+            FLOAT_COMPARISON_CASE(OP_NEQ_FLOAT, !=)
+            FLOAT_COMPARISON_CASE(OP_LT_FLOAT, <)
+            FLOAT_COMPARISON_CASE(OP_LEQ_FLOAT, <=)
+            FLOAT_COMPARISON_CASE(OP_GT_FLOAT, >)
+            FLOAT_COMPARISON_CASE(OP_GEQ_FLOAT, >=)
+            case OP_TO_FLOAT:
+                if (IS_INT(PEEK(0))) {
+                    PEEK(0) = FLOAT_VALUE((double)AS_INT(PEEK(0)));
+                }
+                break;
+
+            case OP_EQ:
+            case OP_NEQ: {
+                value_t b = POP();
+                value_t a = POP();
+                bool equal = values_equal(a, b);
+                PUSH(BOOL_VALUE(op == OP_EQ ? equal : !equal));
+                break;
+            }
+            COMPARISON_CASE(OP_LT, <)
+            COMPARISON_CASE(OP_LEQ, <=)
+            COMPARISON_CASE(OP_GT, >)
+            COMPARISON_CASE(OP_GEQ, >=)
+
+            case OP_JUMP: {
+                uint32_t target = READ_U32();
+                ip = code + target;
+                break;
+            }
+            case OP_JUMP_IF_FALSE: {
+                uint32_t target = READ_U32();
+                if (!value_is_truthy(POP())) {
+                    ip = code + target;
+                }
+                break;
+            }
+
+            case OP_CALL: {
+                uint16_t index = READ_U16();
+                uint8_t argc = READ_U8();
+                const image_function_t *callee = &image->functions[index];
+                if (vm->frame_count >= VM_MAX_FRAMES) {
+                    RUNTIME_ERROR("Stack overflow calling '%s'", image_string(image, callee->name));
+                }
+
+                frame->pc = (uint32_t)(ip - code);
+                size_t base = (size_t)(sp - vm->stack) - argc;
+                ensure_stack(vm, base + callee->local_count + callee->max_stack);
+                if (vm->frame_count >= vm->frame_capacity) {
+                    vm->frame_capacity *= 2;
+                    vm->frames = realloc(vm->frames, vm->frame_capacity * sizeof(call_frame_t));
+                    CHECK_MEM_ALLOC_ERROR(vm->frames);
+                }
+
+                frame = &vm->frames[vm->frame_count++];
+                frame->function = index;
+                frame->pc = 0;
+                frame->base = base;
+                function = callee;
+                code = image->code + function->code_offset;
+                ip = code;
+                slots = vm->stack + base;
+                for (size_t i = argc; i < function->local_count; ++i) {
+                    slots[i] = NULL_VALUE;
+                }
+                sp = slots + function->local_count;
+                break;
+            }
+            case OP_TAIL_CALL: {
+                uint16_t index = READ_U16();
+                uint8_t argc = READ_U8();
+                const image_function_t *callee = &image->functions[index];
+                size_t args = (size_t)(sp - vm->stack) - argc;
+                ensure_stack(vm, frame->base + callee->local_count + callee->max_stack);
+
+                // The callee takes over the frame: its arguments move down to slot 0.
+                frame->function = index;
+                function = callee;
+                code = image->code + function->code_offset;
+                ip = code;
+                slots = vm->stack + frame->base;
+                memmove(slots, vm->stack + args, argc * sizeof(value_t));
+                for (size_t i = argc; i < function->local_count; ++i) {
+                    slots[i] = NULL_VALUE;
+                }
+                sp = slots + function->local_count;
+                break;
+            }
+            case OP_RETURN: {
+                value_t value = POP();
+                sp = vm->stack + frame->base;
+                vm->frame_count--;
+                if (vm->frame_count == exit_depth) {
+                    vm->stack_top = (size_t)(sp - vm->stack);
+                    if (result) *result = value;
+                    return VM_OK;
+                }
+                PUSH(value);
+                frame = &vm->frames[vm->frame_count - 1];
+                function = &image->functions[frame->function];
+                code = image->code + function->code_offset;
+                ip = code + frame->pc;
+                slots = vm->stack + frame->base;
+                break;
+            }
+            case OP_PRINT: {
+                uint8_t argc = READ_U8();
+                value_t *args = sp - argc;
+                output_print(args, argc);
+                sp = args;
+                break;
+            }
+
+            case OP_PARALLEL_FOR: {
+                uint16_t worker = READ_U16();
+                uint32_t step = READ_U32();
+                uint8_t reduction_count = READ_U8();
+                uint32_t multiply_mask = READ_U32();
+                value_t end = POP();
+                value_t start = POP();
+                if (!IS_INT(start) || !IS_INT(end)) {
+                    RUNTIME_ERROR("Bounds of a parallel for must be int, not %s and %s",
+                        value_type_to_string(value_type(start)), value_type_to_string(value_type(end)));
+                }
+
+                frame->pc = (uint32_t)(ip - code);
+                vm->stack_top = (size_t)(sp - vm->stack);
+                const char *error;
+                if (!parallel_for(vm, worker, AS_INT(start), AS_INT(end), step, reduction_count,
+                        multiply_mask, sp, &error)) {
+                    if (error) {
+                        RUNTIME_ERROR("%s", error);
+                    }
+                    // A chunk already reported its error.
+                    vm->frame_count = exit_depth;
+                    return VM_RUNTIME_ERROR;
+                }
+                sp += reduction_count;
+                break;
+            }
+            case OP_REDUCE: {
+                uint8_t index = READ_U8();
+                if (index >= vm->reduction_count) {
+                    RUNTIME_ERROR("Reduction %u outside of the parallel for that declares it", index);
+                }
+                value_t partial = POP();
+                if (VALUE_TAG(partial) == VALUE_TAG_BOXED_INT) {
+                    // The chunk's heap is reset before the partials are combined.
+                    boxed_int_t *box = &vm->reduction_boxes[index];
+                    box->value = AS_INT(partial);
+                    partial = BOXED_INT_VALUE(box);
+                }
+                vm->reductions[index] = partial;
+                break;
+            }
+
+            case OP_NEW_ARRAY: {
+                value_type_t element = (value_type_t)READ_U8();
+                value_t length = POP();
+                if (!IS_INT(length) || AS_INT(length) < 0 || (uint64_t)AS_INT(length) > ARRAY_MAX_LENGTH) {
+                    RUNTIME_ERROR("Invalid array length %s", IS_INT(length) ? "(negative or too large)" : describe_type(length));
+                }
+                PUSH(ARRAY_VALUE(gc_new_array(&vm->heap, element, (size_t)AS_INT(length))));
+                GC_SAFEPOINT();
+                break;
+            }
+            case OP_INDEX: {
+                value_t index = POP();
+                value_t array = POP();
+                char message[128];
+                if (!check_index(array, index, message, sizeof(message))) {
+                    RUNTIME_ERROR("%s", message);
+                }
+                PUSH(array_element(&vm->heap, AS_ARRAY(array), (size_t)AS_INT(index)));
+                GC_SAFEPOINT();
+                break;
+            }
+            case OP_SET_INDEX: {
+                opcode_t compound = (opcode_t)READ_U8();
+                value_t value = POP();
+                value_t index = POP();
+                value_t array = POP();
+                char message[128];
+                if (!check_index(array, index, message, sizeof(message))) {
+                    RUNTIME_ERROR("%s", message);
+                }
+                array_t *target = AS_ARRAY(array);
+                size_t i = (size_t)AS_INT(index);
+                if (compound != 0) {
+                    value_t current = array_element(&vm->heap, target, i);
+                    const char *error;
+                    if (!arithmetic(&vm->heap, compound, current, value, &value, &error)) {
+                        if (error) {
+                            RUNTIME_ERROR("%s", error);
+                        }
+                        RUNTIME_ERROR("Unsupported operands for '%s': %s and %s", opcode_symbol(compound),
+                            describe_type(current), describe_type(value));
+                    }
+                }
+                if (target->element_type == VALUE_FLOAT && IS_NUMBER(value)) {
+                    target->as.floats[i] = AS_DOUBLE(value);
+                } else if (target->element_type == VALUE_INT && IS_INT(value)) {
+                    target->as.ints[i] = AS_INT(value);
+                } else {
+                    RUNTIME_ERROR("Cannot store %s in %s", describe_type(value), array_type_to_string(target));
+                }
+                break;
+            }
+            case OP_LEN:
+            case OP_SUM: {
+                value_t array = POP();
+                if (!IS_ARRAY(array)) {
+                    RUNTIME_ERROR("%s() expects an array, not %s", op == OP_LEN ? "len" : "sum", describe_type(array));
+                }
+                // Lengths are at most ARRAY_MAX_LENGTH, well within 48 bits.
+                PUSH(op == OP_LEN ? SMALL_INT_VALUE(AS_ARRAY(array)->length) : array_sum(&vm->heap, AS_ARRAY(array)));
+                GC_SAFEPOINT();
+                break;
+            }
+            case OP_DOT: {
+                value_t b = POP();
+                value_t a = POP();
+                if (!IS_ARRAY(a) || !IS_ARRAY(b) || AS_ARRAY(a)->element_type != AS_ARRAY(b)->element_type) {
+                    RUNTIME_ERROR("dot() expects two arrays of the same type, not %s and %s", describe_type(a), describe_type(b));
+                }
+                if (AS_ARRAY(a)->length != AS_ARRAY(b)->length) {
+                    RUNTIME_ERROR("dot() of arrays of different lengths (%zu and %zu)", AS_ARRAY(a)->length, AS_ARRAY(b)->length);
+                }
+                PUSH(array_dot(&vm->heap, AS_ARRAY(a), AS_ARRAY(b)));
+                GC_SAFEPOINT();
+                break;
+            }
+
+            case OP_SPAWN: {
+                uint16_t index = READ_U16();
+                uint8_t argc = READ_U8();
+                const image_function_t *callee = &image->functions[index];
+                if (vm->region) {
+                    // Tasks belong to the VM's own event loop, which workers never run.
+                    RUNTIME_ERROR("Cannot start async function '%s' inside a parallel for",
+                        image_string(image, callee->name));
+                }
+
+                task_t *task = task_create_coroutine(&vm->loop, index, (uint32_t)callee->local_count + callee->max_stack);
+                value_t *args = sp - argc;
+                memcpy(task->frame, args, argc * sizeof(value_t));
+                for (size_t i = argc; i < callee->local_count; ++i) {
+                    task->frame[i] = NULL_VALUE;
+                }
+                task->saved_count = callee->local_count;
+                task_schedule(&vm->loop, task);
+                gc_note_allocation(&vm->heap, sizeof(task_t) + task->frame_size * sizeof(value_t));
+                sp = args;
+                PUSH(TASK_VALUE(task));
+                GC_SAFEPOINT();
+                break;
+            }
+            case OP_AWAIT: {
+                value_t awaited = POP();
+                if (!IS_TASK(awaited)) {
+                    RUNTIME_ERROR("Cannot await a value of type %s", value_type_to_string(value_type(awaited)));
+                }
+                task_t *target = AS_TASK(awaited);
+                if (target->state == TASK_DONE) {
+                    PUSH(target->result);
+                    break;
+                }
+                task_t *task = vm->current_task;
+                if (!task || vm->frame_count - 1 != exit_depth) {
+                    RUNTIME_ERROR("'await' outside of a task");
+                }
+                if (target == task) {
+                    RUNTIME_ERROR("A task cannot await itself");
+                }
+
+                // Save locals and operand stack; the result is pushed onto the saved stack on wake-up.
+                task->saved_count = (uint32_t)(sp - slots);
+                memcpy(task->frame, slots, task->saved_count * sizeof(value_t));
+                task_remember(&vm->loop, task);
+                task->pc = (uint32_t)(ip - code);
+                task_await(&vm->loop, task, target);
+                vm->stack_top = frame->base;
+                vm->frame_count = exit_depth;
+                return VM_SUSPENDED;
+            }
+            case OP_SLEEP: {
+                value_t ms = POP();
+                if (!IS_INT(ms)) {
+                    RUNTIME_ERROR("sleep() expects int milliseconds, not %s", value_type_to_string(value_type(ms)));
+                }
+                PUSH(TASK_VALUE(event_loop_sleep(&vm->loop, AS_INT(ms))));
+                gc_note_allocation(&vm->heap, sizeof(task_t));
+                GC_SAFEPOINT();
+                break;
+            }
+            case OP_WAIT_FD: {
+                uint8_t mode = READ_U8();
+                value_t fd = POP();
+                if (!IS_INT(fd) || AS_INT(fd) < 0 || AS_INT(fd) > INT32_MAX) {
+                    RUNTIME_ERROR("%s() expects an int file descriptor", mode == 1 ? "readable" : "writable");
+                }
+                const char *error = NULL;
+                task_t *task = event_loop_wait_fd(&vm->loop, (int)AS_INT(fd), mode == 2, &error);
+                if (!task) {
+                    RUNTIME_ERROR("%s (fd %lld)", error, (long long)AS_INT(fd));
+                }
+                PUSH(TASK_VALUE(task));
+                gc_note_allocation(&vm->heap, sizeof(task_t));
+                GC_SAFEPOINT();
+                break;
+            }
+
+            // Back up to the opcode byte of the first component, so every
+            // component starts at its own.
+#define SUPERINSTRUCTION(name, first, second, third) \
+            case name: \
+                ip--; \
+                SUPER_STEP(first) \
+                SUPER_STEP(second) \
+                SUPER_STEP(third) \
+                break;
+#include "include/superinstructions.h"
+#undef SUPERINSTRUCTION
+
+            default:
+                RUNTIME_ERROR("Invalid opcode %d", (int)op);
+        }
+    }
+
+#undef READ_U8
+#undef READ_U16
+#undef READ_U32
+#undef PUSH
+#undef POP
+#undef PEEK
+#undef RUNTIME_ERROR
+#undef GC_SAFEPOINT
+#undef ARITHMETIC_CASE
+#undef COMPARISON_CASE
+#undef INT_ARITHMETIC_CASE
+#undef INT_DIVISION_CASE
+#undef FLOAT_ARITHMETIC_CASE
+#undef INT_COMPARISON_CASE
+#undef INT_COMPARISON
+#undef FLOAT_COMPARISON_CASE
+#undef SUPER_ARITHMETIC_STEP
+#undef SUPER_DIVISION_STEP
+#undef SUPER_COMPARISON_STEP
+#undef SUPER_INT_COMPARISON_STEP
+#undef SUPER_FLOAT_STEP
+#undef SUPER_FLOAT_COMPARISON_STEP
+#undef SUPER_STEP
+}
+
+vm_status_t vm_call(vm_t *vm, uint32_t function, const value_t *args, value_t *result) {
+    const image_function_t *callee = &vm->image->functions[function];
+    size_t base = vm->stack_top;
+    ensure_stack(vm, base + callee->local_count + callee->max_stack);
+    if (vm->frame_count >= vm->frame_capacity) {
+        vm->frame_capacity *= 2;
+        vm->frames = realloc(vm->frames, vm->frame_capacity * sizeof(call_frame_t));
+        CHECK_MEM_ALLOC_ERROR(vm->frames);
+    }
+
+    for (size_t i = 0; i < callee->local_count; ++i) {
+        vm->stack[base + i] = i < callee->param_count ? args[i] : NULL_VALUE;
+    }
+    vm->stack_top = base + callee->local_count;
+
+    call_frame_t *frame = &vm->frames[vm->frame_count++];
+    frame->function = function;
+    frame->pc = 0;
+    frame->base = base;
+
+    vm_status_t status = vm_execute(vm, result);
+    vm->stack_top = base;
+    return status;
+}
+
+//------------------------------------------------------------------------------
+// parallel for
+//------------------------------------------------------------------------------
+
+static bool run_parallel_chunk(void *context, size_t worker, size_t chunk) {
+    parallel_region_t *region = context;
+    if (atomic_load_explicit(&region->failed, memory_order_relaxed)) {
+        return false;
+    }
+
+    vm_t *vm = region->workers[worker];
+    if (!vm) {
+        vm = init_vm(region->parent->image);
+        free(vm->globals);
+        vm->globals = region->parent->globals;
+        vm->opcode_profile = region->parent->opcode_profile;
+        if (region->parent->profiler) {
+            vm->profiler = init_worker_profiler(region->parent->profiler, region->parent);
+        }
+        vm->region = region;
+        vm->heap.worker = true;
+        gc_set_limits(&vm->heap, region->parent->heap.nursery_size, 0);
+        vm->heap.old_limit = SIZE_MAX;  // only minor collections; see below
+        region->workers[worker] = vm;
+    } else {
+        // Nothing a chunk allocates can escape it: globals and captured
+        // locals are read-only and reductions are numbers.
+        gc_reset(&vm->heap);
+    }
+
+    // Chunk bounds step from start in unsigned arithmetic; the last chunk ends at `end`.
+    uint64_t stride = region->chunk_size * region->step;
+    int64_t lo = (int64_t)((uint64_t)region->start + chunk * stride);
+    int64_t hi = chunk + 1 == region->chunk_count ? region->end : (int64_t)((uint64_t)lo + stride);
+
+    const image_function_t *function = &vm->image->functions[region->function];
+    value_t *args = region->args + worker * function->param_count;
+    memcpy(args, region->captures, region->capture_count * sizeof(value_t));
+    args[region->capture_count] = gc_int_value(&vm->heap, lo);
+    args[region->capture_count + 1] = gc_int_value(&vm->heap, hi);
+    vm->reductions = region->partials + chunk * region->reduction_count;
+    vm->reduction_count = region->reduction_count;
+    vm->reduction_boxes = region->partial_boxes + chunk * region->reduction_count;
+
+    TRACE_BEGIN("parallel chunk", image_string(vm->image, function->name));
+    vm_status_t status = vm_call(vm, region->function, args, NULL);
+    TRACE_END("parallel chunk");
+    // Lines printed by the loop come out before whatever follows it.
+    output_flush();
+    if (status != VM_OK) {
+        // Also covers a nested loop whose own chunk printed the error.
+        atomic_store(&region->failed, true);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Flattens the ropes among `values`. Reading a rope replaces it by
+ * a buffer, which the workers of a parallel for must not do to shared strings.
+ */
+static void flatten_strings(value_t *values, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (IS_STRING(values[i])) {
+            string_chars(AS_STRING(values[i]));
+        }
+    }
+}
+
+/**
+ * @brief Runs the worker over [start, end) in fixed chunks on the thread pool
+ * and folds the per-chunk partials of every reduction in chunk order.
+ *
+ * @return false with `error` set for a fault of the loop itself, or with
+ * `error` NULL when a chunk has already reported its runtime error.
+ */
+static bool parallel_for(vm_t *vm, uint16_t worker, int64_t start, int64_t end, uint32_t step,
+    uint8_t reduction_count, uint32_t multiply_mask, value_t *results, const char **error) {
+    for (uint8_t k = 0; k < reduction_count; ++k) {
+        results[k] = SMALL_INT_VALUE((multiply_mask >> k) & 1u ? 1 : 0);
+    }
+    if (start >= end) {
+        return true;
+    }
+
+    uint64_t distance = (uint64_t)end - (uint64_t)start;
+    uint64_t iterations = distance / step + (distance % step != 0);
+
+    parallel_region_t region;
+    memset(&region, 0, sizeof(region));
+    region.parent = vm;
+    region.function = worker;
+    region.capture_count = vm->image->functions[worker].param_count - 2u;
+    region.captures = vm->stack + vm->frames[vm->frame_count - 1].base;
+    region.start = start;
+    region.end = end;
+    region.step = step;
+    region.chunk_size = iterations / PARALLEL_MAX_CHUNKS + (iterations % PARALLEL_MAX_CHUNKS != 0);
+    region.chunk_count = (size_t)(iterations / region.chunk_size + (iterations % region.chunk_size != 0));
+    region.reduction_count = reduction_count;
+    region.partials = malloc((region.chunk_count * reduction_count + 1) * sizeof(value_t));
+    CHECK_MEM_ALLOC_ERROR(region.partials);
+    region.partial_boxes = malloc((region.chunk_count * reduction_count + 1) * sizeof(boxed_int_t));
+    CHECK_MEM_ALLOC_ERROR(region.partial_boxes);
+    for (size_t i = 0; i < region.chunk_count * reduction_count; ++i) {
+        region.partial_boxes[i].object.kind = GC_BOXED_INT;
+        region.partial_boxes[i].object.flags = GC_FLAG_CONSTANT;
+        region.partial_boxes[i].object.next = NULL;
+    }
+    region.worker_count = scheduler_thread_count();
+    region.workers = calloc(region.worker_count, sizeof(vm_t *));
+    CHECK_MEM_ALLOC_ERROR(region.workers);
+    region.args = malloc(region.worker_count * vm->image->functions[worker].param_count * sizeof(value_t));
+    CHECK_MEM_ALLOC_ERROR(region.args);
+    atomic_init(&region.failed, false);
+    flatten_strings(vm->stack + vm->frames[vm->frame_count - 1].base, region.capture_count);
+    flatten_strings(vm->globals, vm->image->header->global_count);
+    output_flush();
+
+    bool ok = scheduler_parallel_for(region.chunk_count, run_parallel_chunk, &region);
+    *error = NULL;
+    for (size_t chunk = 0; ok && chunk < region.chunk_count; ++chunk) {
+        const value_t *partial = region.partials + chunk * reduction_count;
+        for (uint8_t k = 0; ok && k < reduction_count; ++k) {
+            opcode_t op = (multiply_mask >> k) & 1u ? OP_MUL : OP_ADD;
+            if (!arithmetic(&vm->heap, op, results[k], partial[k], &results[k], error)) {
+                if (!*error) *error = "Unsupported operands in a parallel for reduction";
+                ok = false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < region.worker_count; ++i) {
+        if (region.workers[i] && region.workers[i]->profiler) {
+            profiler_merge(vm->profiler, region.workers[i]->profiler);
+            free_profiler(region.workers[i]->profiler);
+        }
+        free_vm(region.workers[i]);
+    }
+    free(region.workers);
+    free(region.args);
+    free(region.partials);
+    free(region.partial_boxes);
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// tasks
+//------------------------------------------------------------------------------
+
+/**
+ * @brief Copies a task's saved frame onto the stack and runs it until it
+ * returns or awaits an unfinished task.
+ */
+static vm_status_t resume_task(vm_t *vm, task_t *task) {
+    const image_function_t *function = &vm->image->functions[task->function];
+    size_t base = vm->stack_top;
+    ensure_stack(vm, base + function->local_count + function->max_stack);
+    if (vm->frame_count >= vm->frame_capacity) {
+        vm->frame_capacity *= 2;
+        vm->frames = realloc(vm->frames, vm->frame_capacity * sizeof(call_frame_t));
+        CHECK_MEM_ALLOC_ERROR(vm->frames);
+    }
+    memcpy(vm->stack + base, task->frame, task->saved_count * sizeof(value_t));
+    vm->stack_top = base + task->saved_count;
+
+    call_frame_t *frame = &vm->frames[vm->frame_count++];
+    frame->function = task->function;
+    frame->pc = task->pc;
+    frame->base = base;
+
+    vm->current_task = task;
+    value_t result = NULL_VALUE;
+    vm_status_t status = vm_execute(vm, &result);
+    vm->current_task = NULL;
+    vm->stack_top = base;
+    if (status == VM_OK) {
+        task_complete(&vm->loop, task, result);
+    }
+    return status == VM_SUSPENDED ? VM_OK : status;
+}
+
+static vm_status_t run_event_loop(vm_t *vm) {
+    event_loop_t *loop = &vm->loop;
+    for (;;) {
+        task_t *task;
+        while ((task = event_loop_next_ready(loop)) != NULL) {
+            TRACE_BEGIN("task", image_string(vm->image, vm->image->functions[task->function].name));
+            vm_status_t status = resume_task(vm, task);
+            TRACE_END("task");
+            if (status != VM_OK) {
+                return status;
+            }
+        }
+        if (!event_loop_pending(loop)) {
+            break;
+        }
+        event_loop_poll(loop);
+    }
+
+    if (loop->waiting_count > 0) {
+        output_flush();
+        fprintf(stderr, "Runtime error: deadlock, %zu tasks await tasks that can never finish\n", loop->waiting_count);
+        return VM_RUNTIME_ERROR;
+    }
+    return VM_OK;
+}
+
+vm_status_t vm_run(vm_t *vm) {
+    const image_header_t *header = vm->image->header;
+    vm_status_t status = vm_call(vm, header->init_function, NULL, NULL);
+    if (status != VM_OK) {
+        return status;
+    }
+
+    if (header->entry_function != IMAGE_NO_FUNCTION) {
+        const image_function_t *entry = &vm->image->functions[header->entry_function];
+        if (entry->flags & IMAGE_FUNCTION_ASYNC) {
+            task_t *task = task_create_coroutine(&vm->loop, header->entry_function,
+                (uint32_t)entry->local_count + entry->max_stack);
+            for (size_t i = 0; i < entry->local_count; ++i) {
+                task->frame[i] = NULL_VALUE;
+            }
+            task->saved_count = entry->local_count;
+            task_schedule(&vm->loop, task);
+            gc_note_allocation(&vm->heap, sizeof(task_t) + task->frame_size * sizeof(value_t));
+        } else {
+            value_t *args = malloc((entry->param_count ? entry->param_count : 1) * sizeof(value_t));
+            CHECK_MEM_ALLOC_ERROR(args);
+            for (size_t i = 0; i < entry->param_count; ++i) {
+                args[i] = NULL_VALUE;
+            }
+            status = vm_call(vm, header->entry_function, args, NULL);
+            free(args);
+            if (status != VM_OK) {
+                return status;
+            }
+        }
+    }
+    status = run_event_loop(vm);
+    output_flush();
+    return status;
+}
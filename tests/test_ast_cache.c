@@ -0,0 +1,186 @@
+/**
+ * File Name: test_ast_cache.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Stores the tree of every example and of a generated program of every
+ * shape in an AST cache and checks that it loads back into the same tree,
+ * positions included. Then damages the binary file of each example: every
+ * truncation must be rejected, and flipping bits of any byte must give
+ * either a rejection or a tree, never a crash.
+ *
+ * Usage: test_ast_cache
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/include/lexer.h"
+#include "../src/include/parser.h"
+#include "../src/include/ast_dump.h"
+#include "../src/include/ast_serialize.h"
+#include "../bench/bench_util.h"
+#include "../bench/program_gen.h"
+
+#define PROGRAM_SIZE (4 * 1024)
+
+static const uint8_t flips[] = { 0x01, 0x80, 0xff };
+
+static parser_t *parse_file(const char *path) {
+    lexer_t *lexer = init_lexer(path);
+    if (!lexer) exit(EXIT_FAILURE);
+    token_t *token;
+    while ((token = lexer_next_token(lexer))->type != TOKEN_EOF) {
+        lexer_append_token(lexer, token);
+    }
+    lexer_append_token(lexer, token);
+    parser_t *parser = init_parser(lexer);
+    parser_parse_program(parser);
+    return parser;
+}
+
+static char *read_file(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char *data = malloc((size_t)size + 1);
+    if (!data) exit(EXIT_FAILURE);
+    *length = fread(data, 1, (size_t)size, file);
+    data[*length] = '\0';
+    fclose(file);
+    return data;
+}
+
+static void write_file(const char *path, const void *data, size_t length) {
+    FILE *file = fopen(path, "wb");
+    if (!file || fwrite(data, 1, length, file) != length || fclose(file) != 0) {
+        fprintf(stderr, "Could not write %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief Whether the cached tree dumps exactly like the parsed one, as JSON
+ * so that the line and column of every node are compared too.
+ */
+static bool check_round_trip(const char *cache_dir, const char *path, const ast_t *ast) {
+    if (!ast_cache_store(cache_dir, path, ast)) {
+        fprintf(stderr, "%s: could not store the cache entry\n", path);
+        return false;
+    }
+    ast_t *cached = ast_cache_load(cache_dir, path);
+    if (!cached) {
+        fprintf(stderr, "%s: could not load the cache entry\n", path);
+        return false;
+    }
+    size_t expected_length, actual_length;
+    char *expected = ast_dump_to_string(ast, AST_DUMP_JSON, &expected_length);
+    char *actual = ast_dump_to_string(cached, AST_DUMP_JSON, &actual_length);
+    bool ok = expected_length == actual_length && memcmp(expected, actual, actual_length) == 0;
+    if (!ok) fprintf(stderr, "%s: the cached tree differs from the parsed one\n", path);
+    free(expected);
+    free(actual);
+    free_ast(cached);
+    return ok;
+}
+
+/**
+ * @brief Truncates and corrupts the binary form of the tree one byte at a
+ * time. A crash or leak shows up as the test failing under a sanitizer.
+ */
+static bool check_damage(const char *cache_dir, const char *name, const ast_t *ast) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/damaged%s", cache_dir, AST_CACHE_EXTENSION);
+    if (!ast_serialize(ast, 1, path)) {
+        fprintf(stderr, "%s: could not serialize\n", name);
+        return false;
+    }
+    size_t size;
+    uint8_t *original = (uint8_t *)read_file(path, &size);
+    if (!original) exit(EXIT_FAILURE);
+
+    bool ok = true;
+    ast_t *tree = ast_deserialize(path, 2);
+    if (tree) {
+        fprintf(stderr, "%s: a file of another source was accepted\n", name);
+        free_ast(tree);
+        ok = false;
+    }
+    for (size_t length = 0; ok && length < size; ++length) {
+        write_file(path, original, length);
+        tree = ast_deserialize(path, 1);
+        if (tree) {
+            fprintf(stderr, "%s: a file truncated to %zu of %zu bytes was accepted\n", name, length, size);
+            free_ast(tree);
+            ok = false;
+        }
+    }
+
+    uint8_t *damaged = malloc(size);
+    if (!damaged) exit(EXIT_FAILURE);
+    memcpy(damaged, original, size);
+    for (size_t i = 0; ok && i < size; ++i) {
+        for (size_t j = 0; j < sizeof(flips); ++j) {
+            damaged[i] = original[i] ^ flips[j];
+            write_file(path, damaged, size);
+            free_ast(ast_deserialize(path, 0));
+        }
+        damaged[i] = original[i];
+    }
+    free(damaged);
+    free(original);
+    remove(path);
+    return ok;
+}
+
+static bool check_program(const char *cache_dir, const char *path, const char *name, bool damage) {
+    parser_t *parser = parse_file(path);
+    bool ok = check_round_trip(cache_dir, path, parser->ast);
+    if (ok && damage) ok = check_damage(cache_dir, name, parser->ast);
+    free_lexer(parser->lexer);
+    free_parser(parser);
+    return ok;
+}
+
+int main(void) {
+    char cache_dir[] = "/tmp/jff-test-cache-XXXXXX";
+    if (!mkdtemp(cache_dir)) {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+
+    int checked = 0, failures = 0;
+    char path[256];
+    for (int i = 1;; ++i) {
+        snprintf(path, sizeof(path), "examples/e%d.jff", i);
+        FILE *example = fopen(path, "rb");
+        if (!example) break;
+        fclose(example);
+        if (!check_program(cache_dir, path, path, true)) failures++;
+        checked++;
+    }
+    for (int i = 0; i < PROGRAM_SHAPE_COUNT; ++i) {
+        const char *name = program_shape_to_string((program_shape_t)i);
+        program_gen_config_t config;
+        program_gen_default_config(&config, (program_shape_t)i, PROGRAM_SIZE);
+        size_t length;
+        char *source = generate_program(&config, &length);
+        snprintf(path, sizeof(path), "%s/%s.jff", cache_dir, name);
+        write_file(path, source, length);
+        free(source);
+        if (!check_program(cache_dir, path, name, false)) failures++;
+        checked++;
+    }
+    printf("test_ast_cache: %d of %d programs pass\n", checked - failures, checked);
+
+    char command[sizeof(cache_dir) + 16];
+    snprintf(command, sizeof(command), "rm -rf %s", cache_dir);
+    if (system(command) != 0) {
+        fprintf(stderr, "Could not remove %s\n", cache_dir);
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/**
+ * File Name: test_parser.c
+ * Author: Vishank Singh
+ * Github: https://github.com/VishankSingh
+ *
+ * Parses a generated program of every shape (see program_gen.h) with a fixed
+ * seed and compares what print_ast() prints with the tree saved in
+ * tests/expected/, so any change to the parser that reshapes a tree, such as
+ * the precedence or associativity of an operator, fails here. After a
+ * deliberate change to the grammar or the generator, rerun with --update and
+ * review the diff of the saved trees.
+ *
+ * Usage: test_parser [--update]
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/include/lexer.h"
+#include "../src/include/parser.h"
+#include "../bench/bench_util.h"
+#include "../bench/program_gen.h"
+
+#define EXPECTED_DIR "tests/expected"
+#define PROGRAM_SIZE (4 * 1024)
+
+static char *read_file(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    char *text = malloc((size_t)size + 1);
+    if (!text) exit(EXIT_FAILURE);
+    *length = fread(text, 1, (size_t)size, file);
+    text[*length] = '\0';
+    fclose(file);
+    return text;
+}
+
+static bool write_file(const char *path, const char *text, size_t length) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+    bool ok = fwrite(text, 1, length, file) == length;
+    return fclose(file) == 0 && ok;
+}
+
+/**
+ * @brief Line number of the first line where the two texts differ.
+ */
+static size_t first_difference(const char *a, size_t a_length, const char *b, size_t b_length) {
+    size_t line = 1;
+    for (size_t i = 0; i < a_length && i < b_length && a[i] == b[i]; ++i) {
+        if (a[i] == '\n') line++;
+    }
+    return line;
+}
+
+static bool check_shape(program_shape_t shape, bool update) {
+    const char *name = program_shape_to_string(shape);
+    program_gen_config_t config;
+    program_gen_default_config(&config, shape, PROGRAM_SIZE);
+    size_t source_length;
+    char *source = generate_program(&config, &source_length);
+
+    parser_t *parser = parse_source(name, source, source_length);
+    size_t actual_length;
+    char *actual = capture_print_ast(parser->ast, &actual_length);
+    free_lexer(parser->lexer);
+    free_parser(parser);
+    free(source);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/parser_%s.txt", EXPECTED_DIR, name);
+    bool ok;
+    if (update) {
+        ok = write_file(path, actual, actual_length);
+        if (!ok) fprintf(stderr, "%s: could not write %s\n", name, path);
+    } else {
+        size_t expected_length;
+        char *expected = read_file(path, &expected_length);
+        if (!expected) {
+            fprintf(stderr, "%s: could not read %s\n", name, path);
+            ok = false;
+        } else {
+            ok = expected_length == actual_length && memcmp(expected, actual, actual_length) == 0;
+            if (!ok) {
+                fprintf(stderr, "%s: tree differs from %s at line %zu\n", name, path,
+                    first_difference(expected, expected_length, actual, actual_length));
+            }
+            free(expected);
+        }
+    }
+    free(actual);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    bool update = argc > 1 && strcmp(argv[1], "--update") == 0;
+    if (argc > 1 && !update) {
+        fprintf(stderr, "Usage: %s [--update]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int failures = 0;
+    for (int i = 0; i < PROGRAM_SHAPE_COUNT; ++i) {
+        if (!check_shape((program_shape_t)i, update)) failures++;
+    }
+    printf("test_parser: %d of %d shapes %s\n", PROGRAM_SHAPE_COUNT - failures, PROGRAM_SHAPE_COUNT,
+        update ? "saved" : "match");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}